@@ -934,8 +934,6 @@ TmEcode NapatechPacketLoop(ThreadVars *tv, void *data, void *slot)
          * At this point the packet and the Napatech Packet Buffer have been returned
          * to the system in the NapatechReleasePacket() Callback.
          */
-
-        StatsSyncCountersIfSignalled(tv);
     } // while
 
     if (closer) {
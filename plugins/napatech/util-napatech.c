@@ -653,7 +653,6 @@ static void *NapatechStatsLoop(void *arg)
         }
 #endif /* NAPATECH_ENABLE_BYPASS */
 
-        StatsSyncCountersIfSignalled(tv);
         usleep(1000000);
     }
 
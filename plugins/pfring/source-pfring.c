@@ -396,7 +396,6 @@ TmEcode ReceivePfringLoop(ThreadVars *tv, void *data, void *slot)
             TmqhOutputPacketpool(ptv->tv, p);
             SCReturnInt(TM_ECODE_FAILED);
         }
-        StatsSyncCountersIfSignalled(tv);
     }
 
     return TM_ECODE_OK;
@@ -0,0 +1,286 @@
+/* Copyright (C) 2025 Open Information Security Foundation
+ *
+ * You can copy, redistribute or modify this Program under the terms of
+ * the GNU General Public License version 2 as published by the Free
+ * Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * version 2 along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+//! MIME body decoding benchmark: base64 and quoted-printable bodies split
+//! in 76 column lines, decoded line by line like the SMTP MIME parser
+//! does, against the byte at a time decoders used before the block decode
+//! and the memchr based quoted-printable decode.
+//!
+//! Run with `cargo bench --bench mime_decode`.
+
+use std::hint::black_box;
+use std::time::{Duration, Instant};
+
+use suricata::mime::smtp::mime_smtp_decode_qp;
+use suricata::utils::base64::{decode_rfc2045, decode_rfc4648, Decoder};
+
+const BODY_LEN: usize = 1 << 20;
+const LINE_LEN: usize = 76;
+
+/// Deterministic pseudo random body bytes.
+fn body() -> Vec<u8> {
+    let mut x: u32 = 0x2545_f491;
+    (0..BODY_LEN)
+        .map(|_| {
+            x ^= x << 13;
+            x ^= x >> 17;
+            x ^= x << 5;
+            x as u8
+        })
+        .collect()
+}
+
+fn base64_lines(data: &[u8]) -> Vec<Vec<u8>> {
+    const ALPHABET: &[u8; 64] = b"ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    let mut enc = Vec::with_capacity(data.len() / 3 * 4 + 4);
+    for c in data.chunks(3) {
+        let b = [c[0], *c.get(1).unwrap_or(&0), *c.get(2).unwrap_or(&0)];
+        let v = ((b[0] as u32) << 16) | ((b[1] as u32) << 8) | b[2] as u32;
+        enc.push(ALPHABET[(v >> 18) as usize & 63]);
+        enc.push(ALPHABET[(v >> 12) as usize & 63]);
+        enc.push(if c.len() > 1 {
+            ALPHABET[(v >> 6) as usize & 63]
+        } else {
+            b'='
+        });
+        enc.push(if c.len() > 2 {
+            ALPHABET[v as usize & 63]
+        } else {
+            b'='
+        });
+    }
+    enc.chunks(LINE_LEN).map(|l| l.to_vec()).collect()
+}
+
+/// Mostly printable text with an escaped byte every 16 bytes and a soft
+/// line break at the end of each line.
+fn qp_lines(data: &[u8]) -> Vec<Vec<u8>> {
+    const HEX: &[u8; 16] = b"0123456789ABCDEF";
+    let mut lines = Vec::new();
+    let mut line = Vec::with_capacity(LINE_LEN);
+    for (n, &b) in data.iter().enumerate() {
+        if n % 16 == 15 {
+            line.extend_from_slice(&[b'=', HEX[(b >> 4) as usize], HEX[(b & 15) as usize]]);
+        } else {
+            line.push(b'a' + b % 26);
+        }
+        if line.len() >= LINE_LEN - 3 {
+            line.push(b'=');
+            lines.push(std::mem::replace(&mut line, Vec::with_capacity(LINE_LEN)));
+        }
+    }
+    lines.push(line);
+    lines
+}
+
+fn ref_base64_map(c: u8) -> Option<u8> {
+    match c {
+        b'A'..=b'Z' => Some(c - b'A'),
+        b'a'..=b'z' => Some(c - b'a' + 26),
+        b'0'..=b'9' => Some(c - b'0' + 52),
+        b'+' => Some(62),
+        b'/' => Some(63),
+        _ => None,
+    }
+}
+
+/// The RFC 2045 decode before the block decode: every byte goes through
+/// the 4 byte temporary buffer.
+fn ref_decode_rfc2045(tmp: &mut [u8; 4], nb: &mut usize, input: &[u8], output: &mut [u8]) -> usize {
+    let mut offset = 0;
+    for &c in input {
+        if ref_base64_map(c).is_none() && c != b'=' {
+            continue;
+        }
+        tmp[*nb] = c;
+        *nb += 1;
+        if *nb < 4 {
+            continue;
+        }
+        *nb = 0;
+        let (Some(a0), Some(a1)) = (ref_base64_map(tmp[0]), ref_base64_map(tmp[1])) else {
+            return offset;
+        };
+        output[offset] = (a0 << 2) | (a1 >> 4);
+        offset += 1;
+        if tmp[2] == b'=' {
+            continue;
+        }
+        let Some(a2) = ref_base64_map(tmp[2]) else {
+            return offset;
+        };
+        output[offset] = (a1 << 4) | (a2 >> 2);
+        offset += 1;
+        if tmp[3] == b'=' {
+            continue;
+        }
+        let Some(a3) = ref_base64_map(tmp[3]) else {
+            return offset;
+        };
+        output[offset] = (a2 << 6) | a3;
+        offset += 1;
+    }
+    offset
+}
+
+fn ref_hex(c: u8) -> Option<u8> {
+    match c {
+        b'0'..=b'9' => Some(c - b'0'),
+        b'A'..=b'F' => Some(c - b'A' + 10),
+        _ => None,
+    }
+}
+
+/// The quoted-printable decode before the memchr scan: one push per byte.
+fn ref_decode_qp(i: &[u8], out: &mut Vec<u8>) -> (bool, bool) {
+    let mut c = 0;
+    let mut invalid = false;
+    while c < i.len() {
+        if i[c] == b'=' {
+            if c == i.len() - 1 {
+                return (true, invalid);
+            } else if c + 2 >= i.len() {
+                invalid = true;
+                break;
+            }
+            match (ref_hex(i[c + 1]), ref_hex(i[c + 2])) {
+                (Some(v), Some(v2)) => out.push((v << 4) | v2),
+                _ => invalid = true,
+            }
+            c += 3;
+        } else {
+            out.push(i[c]);
+            c += 1;
+        }
+    }
+    (false, invalid)
+}
+
+fn run<F: FnMut() -> usize>(mut f: F, runs: usize) -> (Duration, usize) {
+    let mut times = Vec::with_capacity(runs);
+    let mut len = 0;
+    for _ in 0..runs {
+        let start = Instant::now();
+        len = black_box(f());
+        times.push(start.elapsed());
+    }
+    times.sort();
+    (times[runs / 2], len)
+}
+
+fn report(name: &str, input_len: usize, (time, len): (Duration, usize), expected: usize) {
+    assert_eq!(len, expected, "{}: decoded length mismatch", name);
+    println!(
+        "{:24} {:10.3?} {:8.1} MB/s",
+        name,
+        time,
+        input_len as f64 / time.as_secs_f64() / 1e6
+    );
+}
+
+fn main() {
+    const RUNS: usize = 11;
+
+    let data = body();
+    let b64 = base64_lines(&data);
+    let b64_len: usize = b64.iter().map(|l| l.len()).sum();
+    let mut output = vec![0u8; LINE_LEN];
+
+    println!(
+        "base64, {} bytes in {} lines (median of {})",
+        b64_len,
+        b64.len(),
+        RUNS
+    );
+    let r = run(
+        || {
+            let mut decoder = Decoder::new();
+            let mut total = 0;
+            for line in &b64 {
+                let mut n = 0;
+                let _ = decode_rfc2045(&mut decoder, line, &mut output, &mut n);
+                total += n as usize;
+            }
+            total
+        },
+        RUNS,
+    );
+    report("decode_rfc2045", b64_len, r, data.len());
+    let r = run(
+        || {
+            let mut decoder = Decoder::new();
+            let mut total = 0;
+            for line in &b64 {
+                let mut n = 0;
+                let _ = decode_rfc4648(&mut decoder, line, &mut output, &mut n);
+                total += n as usize;
+            }
+            total
+        },
+        RUNS,
+    );
+    report("decode_rfc4648", b64_len, r, data.len());
+    let r = run(
+        || {
+            let mut tmp = [0u8; 4];
+            let mut nb = 0;
+            let mut total = 0;
+            for line in &b64 {
+                total += ref_decode_rfc2045(&mut tmp, &mut nb, line, &mut output);
+            }
+            total
+        },
+        RUNS,
+    );
+    report("byte at a time", b64_len, r, data.len());
+
+    let qp = qp_lines(&data);
+    let qp_len: usize = qp.iter().map(|l| l.len()).sum();
+    let mut out = Vec::with_capacity(LINE_LEN);
+    println!(
+        "quoted-printable, {} bytes in {} lines (median of {})",
+        qp_len,
+        qp.len(),
+        RUNS
+    );
+    let r = run(
+        || {
+            let mut total = 0;
+            for line in &qp {
+                out.clear();
+                black_box(mime_smtp_decode_qp(line, &mut out));
+                total += out.len();
+            }
+            total
+        },
+        RUNS,
+    );
+    report("mime_smtp_decode_qp", qp_len, r, data.len());
+    let r = run(
+        || {
+            let mut total = 0;
+            for line in &qp {
+                out.clear();
+                black_box(ref_decode_qp(line, &mut out));
+                total += out.len();
+            }
+            total
+        },
+        RUNS,
+    );
+    report("byte at a time", qp_len, r, data.len());
+}
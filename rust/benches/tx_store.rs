@@ -0,0 +1,106 @@
+/* Copyright (C) 2025 Open Information Security Foundation
+ *
+ * You can copy, redistribute or modify this Program under the terms of
+ * the GNU General Public License version 2 as published by the Free
+ * Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * version 2 along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+//! Transaction store benchmark: a long lived flow with many transactions
+//! in flight, freed out of order, against the `Vec` with a linear lookup
+//! the parsers used before `TxStore`.
+//!
+//! Run with `cargo bench --bench tx_store`.
+
+use std::hint::black_box;
+use std::time::{Duration, Instant};
+
+use suricata::applayer::{Transaction, TxStore};
+
+struct BenchTx {
+    id: u64,
+    _data: [u64; 8],
+}
+
+impl BenchTx {
+    fn new(id: u64) -> Self {
+        Self { id, _data: [0; 8] }
+    }
+}
+
+impl Transaction for BenchTx {
+    fn id(&self) -> u64 {
+        self.id
+    }
+}
+
+/// Id of the transaction freed after pushing transaction `id`: each
+/// window of transactions is freed newest first.
+fn free_id(id: u64, window: u64) -> Option<u64> {
+    if id <= window {
+        return None;
+    }
+    let old = id - window - 1;
+    Some((old / window) * window + (window - old % window))
+}
+
+fn run_tx_store(n: u64, window: u64) -> Duration {
+    let start = Instant::now();
+    let mut store = TxStore::new();
+    for id in 1..=n {
+        store.push(BenchTx::new(id));
+        black_box(store.get(id));
+        if let Some(free) = free_id(id, window) {
+            black_box(store.remove(free));
+        }
+    }
+    start.elapsed()
+}
+
+fn run_vec(n: u64, window: u64) -> Duration {
+    let start = Instant::now();
+    let mut txs: Vec<BenchTx> = Vec::new();
+    for id in 1..=n {
+        txs.push(BenchTx::new(id));
+        black_box(txs.iter().find(|tx| tx.id == id));
+        if let Some(free) = free_id(id, window) {
+            if let Some(pos) = txs.iter().position(|tx| tx.id == free) {
+                black_box(txs.remove(pos));
+            }
+        }
+    }
+    start.elapsed()
+}
+
+fn main() {
+    const N: u64 = 200_000;
+    const RUNS: usize = 5;
+
+    for window in [10, 100, 1000] {
+        let mut store = Vec::new();
+        let mut vec = Vec::new();
+        for _ in 0..RUNS {
+            store.push(run_tx_store(N, window));
+            vec.push(run_vec(N, window));
+        }
+        store.sort();
+        vec.sort();
+        println!(
+            "{} txs, window {:5}: TxStore {:10.3?} Vec {:10.3?} (median of {})",
+            N,
+            window,
+            store[RUNS / 2],
+            vec[RUNS / 2],
+            RUNS
+        );
+    }
+}
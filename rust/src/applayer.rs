@@ -23,13 +23,20 @@ use crate::direction::Direction;
 use crate::filecontainer::FileContainer;
 use crate::flow::Flow;
 use std::os::raw::{c_void,c_char,c_int};
-use std::ffi::CStr;
+use std::ffi::{CStr, CString};
+use std::collections::VecDeque;
+use std::marker::PhantomData;
+use std::ptr::NonNull;
+use std::sync::atomic::{AtomicPtr, Ordering};
 use crate::core::StreamingBufferConfig;
 
 // Make the AppLayerEvent derive macro available to users importing
 // AppLayerEvent from this module.
 pub use suricata_derive::AppLayerEvent;
-use suricata_sys::sys::{AppLayerParserState, AppProto};
+use suricata_sys::sys::{
+    AppLayerParserState, AppProto, SCSlabAlloc, SCSlabCache, SCSlabCacheRegister, SCSlabFree,
+    SC_SLAB_ALIGN,
+};
 
 /// Cast pointer to a variable, as a mutable reference to an object
 ///
@@ -664,6 +671,15 @@ pub unsafe fn get_event_info_by_id<T: AppLayerEvent>(
 /// in order to define some generic helper functions.
 pub trait Transaction {
     fn id(&self) -> u64;
+
+    /// Slab cache the `TxStore` allocates this transaction type from, the
+    /// `StateSlab::cache` of a `StateSlab<Self>`. Null to box them.
+    fn slab_cache() -> *mut SCSlabCache
+    where
+        Self: Sized,
+    {
+        std::ptr::null_mut()
+    }
 }
 
 pub trait State<Tx: Transaction> {
@@ -701,6 +717,364 @@ pub unsafe extern "C" fn state_get_tx_iterator<S: State<Tx>, Tx: Transaction>(
     state.get_transaction_iterator(min_tx_id, istate)
 }
 
+/// Owned transaction of a `TxStore`, allocated from the slab cache of the
+/// transaction type when it has one (see `Transaction::slab_cache`), boxed
+/// otherwise.
+pub struct TxBox<Tx: Transaction>(NonNull<Tx>);
+
+// same as for Box<Tx>
+unsafe impl<Tx: Transaction + Send> Send for TxBox<Tx> {}
+unsafe impl<Tx: Transaction + Sync> Sync for TxBox<Tx> {}
+
+impl<Tx: Transaction> TxBox<Tx> {
+    fn new(tx: Tx) -> Self {
+        let ptr = slab_alloc(Tx::slab_cache(), tx) as *mut Tx;
+        match NonNull::new(ptr) {
+            Some(ptr) => Self(ptr),
+            None => std::alloc::handle_alloc_error(std::alloc::Layout::new::<Tx>()),
+        }
+    }
+
+    fn into_inner(self) -> Tx {
+        let ptr = self.0.as_ptr();
+        std::mem::forget(self);
+        unsafe { slab_take(Tx::slab_cache(), ptr as *mut c_void) }
+    }
+}
+
+impl<Tx: Transaction> Drop for TxBox<Tx> {
+    fn drop(&mut self) {
+        unsafe { slab_free::<Tx>(Tx::slab_cache(), self.0.as_ptr() as *mut c_void) }
+    }
+}
+
+impl<Tx: Transaction> std::ops::Deref for TxBox<Tx> {
+    type Target = Tx;
+
+    fn deref(&self) -> &Tx {
+        unsafe { self.0.as_ref() }
+    }
+}
+
+impl<Tx: Transaction> std::ops::DerefMut for TxBox<Tx> {
+    fn deref_mut(&mut self) -> &mut Tx {
+        unsafe { self.0.as_mut() }
+    }
+}
+
+impl<Tx: Transaction + std::fmt::Debug> std::fmt::Debug for TxBox<Tx> {
+    fn fmt(&self, f: &mut std::fmt::Formatter<'_>) -> std::fmt::Result {
+        std::fmt::Debug::fmt(&**self, f)
+    }
+}
+
+/// Transaction container with O(1) lookup and removal by transaction id.
+///
+/// Positions in the store are slots: a slot is kept for each id between
+/// the oldest and the newest live transaction, `len()` counts only the
+/// live ones. Code keeping a position (like the `tx_index_completed` of
+/// the parsers) has to compare it to `slot_count()`, not to `len()`.
+///
+/// Transactions are kept in a ring indexed by `tx.id() - base`, `base`
+/// being the id of the oldest slot. Transactions are expected to be added
+/// with increasing ids, which is what all parsers do. Removing a
+/// transaction leaves an empty slot until all older transactions are
+/// removed as well. Transactions are allocated separately (`TxBox`), so
+/// such a slot only costs a pointer, not the size of a transaction, while
+/// one old transaction is kept alive.
+#[derive(Debug)]
+pub struct TxStore<Tx: Transaction> {
+    slots: VecDeque<Option<TxBox<Tx>>>,
+    /// id of the transaction in `slots[0]`
+    base: u64,
+    /// number of live transactions
+    live: usize,
+}
+
+impl<Tx: Transaction> Default for TxStore<Tx> {
+    fn default() -> Self {
+        Self::new()
+    }
+}
+
+impl<Tx: Transaction> TxStore<Tx> {
+    pub fn new() -> Self {
+        Self {
+            slots: VecDeque::new(),
+            base: 0,
+            live: 0,
+        }
+    }
+
+    /// Number of live transactions.
+    pub fn len(&self) -> usize {
+        self.live
+    }
+
+    pub fn is_empty(&self) -> bool {
+        self.live == 0
+    }
+
+    /// Number of slots, live transactions and holes of removed ones.
+    pub fn slot_count(&self) -> usize {
+        self.slots.len()
+    }
+
+    fn slot(&self, id: u64) -> Option<usize> {
+        if id < self.base {
+            return None;
+        }
+        let idx = id - self.base;
+        if idx < self.slots.len() as u64 {
+            return Some(idx as usize);
+        }
+        None
+    }
+
+    /// Add a transaction, returning a reference to it in the store.
+    pub fn push(&mut self, tx: Tx) -> &mut Tx {
+        let id = tx.id();
+        if self.slots.is_empty() {
+            self.base = id;
+        }
+        // out of order ids are not expected, but handled
+        debug_validate_bug_on!(id < self.base + self.slots.len() as u64);
+        while id < self.base {
+            self.slots.push_front(None);
+            self.base -= 1;
+        }
+        while self.base + (self.slots.len() as u64) <= id {
+            self.slots.push_back(None);
+        }
+        let idx = (id - self.base) as usize;
+        if self.slots[idx].is_none() {
+            self.live += 1;
+        }
+        self.slots[idx] = Some(TxBox::new(tx));
+        self.slots[idx].as_deref_mut().unwrap()
+    }
+
+    pub fn get(&self, id: u64) -> Option<&Tx> {
+        self.slot(id).and_then(|idx| self.slots[idx].as_deref())
+    }
+
+    pub fn get_mut(&mut self, id: u64) -> Option<&mut Tx> {
+        self.slot(id).and_then(move |idx| self.slots[idx].as_deref_mut())
+    }
+
+    /// Get the live transaction at position `index`, oldest first.
+    ///
+    /// O(1) as long as no transaction older than the newest one was
+    /// removed, O(n) otherwise as the slots before it are walked. Only
+    /// there for `State::get_transaction_by_index`, the parsers iterate
+    /// with `get_iterator`, which is O(1) per step.
+    pub fn get_by_index(&self, index: usize) -> Option<&Tx> {
+        if self.live == self.slots.len() {
+            return self.slots.get(index).and_then(|s| s.as_deref());
+        }
+        self.iter().nth(index)
+    }
+
+    /// Remove a transaction by id.
+    pub fn remove(&mut self, id: u64) -> Option<Tx> {
+        let idx = self.slot(id)?;
+        let tx = self.slots[idx].take()?;
+        self.live -= 1;
+        while let Some(None) = self.slots.front() {
+            self.slots.pop_front();
+            self.base += 1;
+        }
+        while let Some(None) = self.slots.back() {
+            self.slots.pop_back();
+        }
+        if self.slots.is_empty() && self.slots.capacity() > TX_STORE_SHRINK_CAPACITY {
+            // give back the memory of a burst of transactions
+            self.slots.shrink_to(TX_STORE_SHRINK_CAPACITY);
+        }
+        Some(tx.into_inner())
+    }
+
+    /// Oldest live transaction.
+    pub fn first(&self) -> Option<&Tx> {
+        self.slots.front().and_then(|s| s.as_deref())
+    }
+
+    /// Newest live transaction.
+    pub fn last(&self) -> Option<&Tx> {
+        self.slots.back().and_then(|s| s.as_deref())
+    }
+
+    pub fn last_mut(&mut self) -> Option<&mut Tx> {
+        self.slots.back_mut().and_then(|s| s.as_deref_mut())
+    }
+
+    /// Iterate over the live transactions, oldest first.
+    pub fn iter(&self) -> TxStoreIter<'_, Tx> {
+        self.slots.iter().filter_map(Option::as_deref as fn(_) -> _)
+    }
+
+    pub fn iter_mut(&mut self) -> TxStoreIterMut<'_, Tx> {
+        self.slots.iter_mut().filter_map(Option::as_deref_mut as fn(_) -> _)
+    }
+
+    /// Iterate over the live transactions starting at slot `pos`, returning
+    /// the slot of each transaction with it. Slots are only stable until the
+    /// next removal.
+    pub fn iter_mut_from(&mut self, pos: usize) -> impl Iterator<Item = (usize, &mut Tx)> {
+        let pos = std::cmp::min(pos, self.slots.len());
+        self.slots
+            .range_mut(pos..)
+            .enumerate()
+            .filter_map(move |(i, s)| s.as_deref_mut().map(|tx| (pos + i, tx)))
+    }
+
+    pub fn clear(&mut self) {
+        self.slots.clear();
+        self.live = 0;
+    }
+
+    /// Implementation of the `AppLayerGetTxIterator` callback.
+    ///
+    /// `istate` holds the id of the next transaction to look at, so the
+    /// iteration survives removals between calls.
+    pub fn get_iterator(&self, min_tx_id: u64, istate: &mut u64) -> AppLayerGetTxIterTuple {
+        let end = self.base + self.slots.len() as u64;
+        let mut id = std::cmp::max(std::cmp::max(*istate, min_tx_id + 1), self.base);
+        while id < end {
+            if let Some(tx) = self.slots[(id - self.base) as usize].as_deref() {
+                *istate = id + 1;
+                return AppLayerGetTxIterTuple::with_values(
+                    tx as *const _ as *mut _,
+                    id - 1,
+                    id + 1 < end,
+                );
+            }
+            id += 1;
+        }
+        AppLayerGetTxIterTuple::not_found()
+    }
+}
+
+/// Capacity kept by an empty `TxStore`.
+const TX_STORE_SHRINK_CAPACITY: usize = 16;
+
+pub type TxStoreIter<'a, Tx> = std::iter::FilterMap<
+    std::collections::vec_deque::Iter<'a, Option<TxBox<Tx>>>,
+    fn(&'a Option<TxBox<Tx>>) -> Option<&'a Tx>,
+>;
+pub type TxStoreIterMut<'a, Tx> = std::iter::FilterMap<
+    std::collections::vec_deque::IterMut<'a, Option<TxBox<Tx>>>,
+    fn(&'a mut Option<TxBox<Tx>>) -> Option<&'a mut Tx>,
+>;
+
+impl<'a, Tx: Transaction> IntoIterator for &'a TxStore<Tx> {
+    type Item = &'a Tx;
+    type IntoIter = TxStoreIter<'a, Tx>;
+
+    fn into_iter(self) -> Self::IntoIter {
+        self.iter()
+    }
+}
+
+impl<'a, Tx: Transaction> IntoIterator for &'a mut TxStore<Tx> {
+    type Item = &'a mut Tx;
+    type IntoIter = TxStoreIterMut<'a, Tx>;
+
+    fn into_iter(self) -> Self::IntoIter {
+        self.iter_mut()
+    }
+}
+
+/// Per thread slab cache for a parser state or transaction type, see
+/// `util-slab.h`.
+///
+/// Until the cache is registered, objects are allocated as a `Box`. The
+/// registration has to happen at parser registration time, before the
+/// first object is allocated.
+pub struct StateSlab<S> {
+    cache: AtomicPtr<SCSlabCache>,
+    _state: PhantomData<fn() -> S>,
+}
+
+impl<S> Default for StateSlab<S> {
+    fn default() -> Self {
+        Self::new()
+    }
+}
+
+impl<S> StateSlab<S> {
+    pub const fn new() -> Self {
+        Self {
+            cache: AtomicPtr::new(std::ptr::null_mut()),
+            _state: PhantomData,
+        }
+    }
+
+    /// Register the cache. The memory use of the states in use is reported
+    /// as the `app_layer.memuse.<name>` counter, the memory of the cached
+    /// free states as `app_layer.memcache.<name>`.
+    pub fn register(&self, name: &str) {
+        if std::mem::align_of::<S>() > SC_SLAB_ALIGN as usize {
+            return;
+        }
+        let name = CString::new(name).unwrap();
+        let cache = unsafe { SCSlabCacheRegister(name.as_ptr(), std::mem::size_of::<S>() as u32) };
+        self.cache.store(cache, Ordering::Relaxed);
+    }
+
+    /// The registered cache, null if not registered.
+    pub fn cache(&self) -> *mut SCSlabCache {
+        self.cache.load(Ordering::Relaxed)
+    }
+
+    /// Move a state into the cache, returning the pointer to pass to C.
+    pub fn alloc(&self, state: S) -> *mut c_void {
+        slab_alloc(self.cache(), state)
+    }
+
+    /// Drop a state returned by `alloc`.
+    ///
+    /// # Safety
+    ///
+    /// `ptr` has to be a pointer returned by `alloc` of this cache.
+    pub unsafe fn free(&self, ptr: *mut c_void) {
+        slab_free::<S>(self.cache(), ptr)
+    }
+}
+
+/// Move `obj` into `cache`, or into a `Box` if `cache` is null.
+fn slab_alloc<S>(cache: *mut SCSlabCache, obj: S) -> *mut c_void {
+    if cache.is_null() {
+        return Box::into_raw(Box::new(obj)) as *mut c_void;
+    }
+    let ptr = unsafe { SCSlabAlloc(cache) } as *mut S;
+    if ptr.is_null() {
+        return std::ptr::null_mut();
+    }
+    unsafe { std::ptr::write(ptr, obj) };
+    ptr as *mut c_void
+}
+
+/// Drop an object returned by `slab_alloc` for the same `cache`.
+unsafe fn slab_free<S>(cache: *mut SCSlabCache, ptr: *mut c_void) {
+    if cache.is_null() {
+        std::mem::drop(Box::from_raw(ptr as *mut S));
+        return;
+    }
+    std::ptr::drop_in_place(ptr as *mut S);
+    SCSlabFree(cache, ptr);
+}
+
+/// Move an object returned by `slab_alloc` for the same `cache` out of it.
+unsafe fn slab_take<S>(cache: *mut SCSlabCache, ptr: *mut c_void) -> S {
+    if cache.is_null() {
+        return *Box::from_raw(ptr as *mut S);
+    }
+    let obj = std::ptr::read(ptr as *mut S);
+    SCSlabFree(cache, ptr);
+    obj
+}
+
 /// AppLayerFrameType trait.
 ///
 /// This is the behavior expected from an enum of frame types. For most instances
@@ -829,3 +1203,105 @@ pub trait AppLayerState {
         return std::ptr::null();
     }
 }
+
+#[cfg(test)]
+mod test {
+    use super::*;
+
+    #[derive(Debug)]
+    struct TestTx {
+        id: u64,
+    }
+
+    impl Transaction for TestTx {
+        fn id(&self) -> u64 {
+            self.id
+        }
+    }
+
+    fn iter_ids(store: &TxStore<TestTx>, min_tx_id: u64) -> Vec<u64> {
+        let mut ids = Vec::new();
+        let mut istate = 0;
+        let mut min = min_tx_id;
+        loop {
+            let r = store.get_iterator(min, &mut istate);
+            if r.tx_ptr.is_null() {
+                break;
+            }
+            ids.push(r.tx_id);
+            min = r.tx_id + 1;
+            if !r.has_next {
+                break;
+            }
+        }
+        ids
+    }
+
+    #[test]
+    fn test_tx_store() {
+        let mut store = TxStore::new();
+        for id in 1..=5 {
+            store.push(TestTx { id });
+        }
+        assert_eq!(store.len(), 5);
+        assert_eq!(store.get(3).unwrap().id, 3);
+        assert!(store.get(0).is_none());
+        assert!(store.get(6).is_none());
+        assert_eq!(store.get_by_index(2).unwrap().id, 3);
+        assert!(store.get_by_index(5).is_none());
+
+        // free from the middle leaves a hole
+        assert_eq!(store.remove(3).unwrap().id, 3);
+        assert!(store.remove(3).is_none());
+        assert!(store.get(3).is_none());
+        assert_eq!(store.len(), 4);
+        assert_eq!(iter_ids(&store, 0), vec![0, 1, 3, 4]);
+        assert_eq!(iter_ids(&store, 2), vec![3, 4]);
+        assert_eq!(store.get_by_index(2).unwrap().id, 4);
+        assert!(store.get_by_index(4).is_none());
+
+        // freeing the oldest ones moves the base past the hole
+        store.remove(1);
+        store.remove(2);
+        assert_eq!(store.first().unwrap().id, 4);
+        assert_eq!(store.slots.len(), 2);
+
+        store.remove(5);
+        assert_eq!(store.last().unwrap().id, 4);
+        store.push(TestTx { id: 8 });
+        assert_eq!(store.iter().map(|tx| tx.id).collect::<Vec<_>>(), vec![4, 8]);
+        let slots: Vec<_> = store.iter_mut_from(1).map(|(i, tx)| (i, tx.id)).collect();
+        assert_eq!(slots, vec![(4, 8)]);
+
+        store.remove(4);
+        store.remove(8);
+        assert!(store.is_empty());
+        assert!(store.slots.is_empty());
+        assert_eq!(iter_ids(&store, 0), Vec::<u64>::new());
+    }
+
+    /// Many transactions in flight, freed out of order: the slots stay
+    /// bounded by the span of live ids. See `benches/tx_store.rs` for the
+    /// timing of this pattern.
+    #[test]
+    fn test_tx_store_many() {
+        const N: u64 = 20_000;
+        const WINDOW: u64 = 1000;
+        let mut store = TxStore::new();
+        for id in 1..=N {
+            store.push(TestTx { id });
+            if id > WINDOW {
+                // free each window of transactions newest first
+                let old = id - WINDOW - 1;
+                let free = (old / WINDOW) * WINDOW + (WINDOW - old % WINDOW);
+                assert_eq!(store.remove(free).map(|tx| tx.id), Some(free));
+            }
+            assert!(store.slots.len() as u64 <= 2 * WINDOW);
+        }
+        for id in 1..=N {
+            assert!(store.get(id).is_none() == store.remove(id).is_none());
+        }
+        assert!(store.is_empty());
+        assert!(store.slots.capacity() <= 2 * TX_STORE_SHRINK_CAPACITY);
+    }
+}
@@ -31,7 +31,6 @@ use suricata_sys::sys::{
 use std;
 use std::cmp;
 use std::ffi::CString;
-use std::collections::VecDeque;
 use crate::conf::conf_get;
 
 // Constant DCERPC UDP Header length
@@ -322,7 +321,7 @@ pub struct DCERPCState {
     pub header: Option<DCERPCHdr>,
     pub bind: Option<DCERPCBind>,
     pub bindack: Option<DCERPCBindAck>,
-    pub transactions: VecDeque<DCERPCTransaction>,
+    pub transactions: TxStore<DCERPCTransaction>,
     tx_index_completed: usize,
     pub pad: u8,
     pub padleft: u16,
@@ -341,7 +340,11 @@ impl State<DCERPCTransaction> for DCERPCState {
     }
 
     fn get_transaction_by_index(&self, index: usize) -> Option<&DCERPCTransaction> {
-        self.transactions.get(index)
+        self.transactions.get_by_index(index)
+    }
+
+    fn get_transaction_iterator(&self, min_tx_id: u64, state: &mut u64) -> AppLayerGetTxIterTuple {
+        self.transactions.get_iterator(min_tx_id, state)
     }
 }
 
@@ -361,8 +364,8 @@ impl DCERPCState {
         self.tx_id += 1;
         if self.transactions.len() > unsafe { DCERPC_MAX_TX } {
             let mut index = self.tx_index_completed;
-            for tx_old in &mut self.transactions.range_mut(self.tx_index_completed..) {
-                index += 1;
+            for (slot, tx_old) in self.transactions.iter_mut_from(self.tx_index_completed) {
+                index = slot + 1;
                 if !tx_old.req_done || !tx_old.resp_done {
                     tx_old.tx_data.updated_tc = true;
                     tx_old.tx_data.updated_ts = true;
@@ -381,23 +384,10 @@ impl DCERPCState {
 
     pub fn free_tx(&mut self, tx_id: u64) {
         SCLogDebug!("Freeing TX with ID {} TX.ID {}", tx_id, tx_id+1);
-        let len = self.transactions.len();
-        let mut found = false;
-        let mut index = 0;
-        for i in 0..len {
-            let tx = &self.transactions[i];
-            if tx.id == tx_id { //+ 1 {
-                found = true;
-                index = i;
-                SCLogDebug!("tx {} progress {}/{}", tx.id, tx.req_done, tx.resp_done);
-                break;
-            }
-        }
-        if found {
-            SCLogDebug!("freeing TX with ID {} TX.ID {} at index {} left: {} max id: {}",
-                            tx_id, tx_id+1, index, self.transactions.len(), self.tx_id);
+        if let Some(_tx) = self.transactions.remove(tx_id + 1) {
+            SCLogDebug!("freed TX with ID {} progress {}/{} left: {} max id: {}",
+                            _tx.id, _tx.req_done, _tx.resp_done, self.transactions.len(), self.tx_id);
             self.tx_index_completed = 0;
-            self.transactions.remove(index);
         }
     }
 
@@ -462,13 +452,7 @@ impl DCERPCState {
     /// Return value:
     /// Option mutable reference to DCERPCTransaction
     pub fn get_tx(&mut self, tx_id: u64) -> Option<&mut DCERPCTransaction> {
-        for tx in &mut self.transactions {
-            let found = tx.id == tx_id;
-            if found {
-                return Some(tx);
-            }
-        }
-        None
+        self.transactions.get_mut(tx_id + 1)
     }
 
     /// Find the transaction as per call ID defined in header. If the tx is not
@@ -662,7 +646,7 @@ impl DCERPCState {
                     sc_app_layer_parser_trigger_raw_stream_inspection(flow, Direction::ToServer as i32);
                 }
                 tx.frag_cnt_ts = 1;
-                self.transactions.push_back(tx);
+                self.transactions.push(tx);
                 // Bytes parsed with `parse_dcerpc_bind` + (bytes parsed per bindctxitem [44] * number
                 // of bindctxitems)
                 (input.len() - leftover_bytes.len()) as i32 + retval * numctxitems as i32
@@ -835,7 +819,7 @@ impl DCERPCState {
                         tx.ctxid = request.ctxid;
                         tx.opnum = request.opnum;
                         tx.first_request_seen = request.first_request_seen;
-                        self.transactions.push_back(tx);
+                        self.transactions.push(tx);
                     }
                 }
                 let parsed = self.handle_common_stub(
@@ -948,8 +932,7 @@ impl DCERPCState {
                     } else {
                         let mut tx = self.create_tx(current_call_id);
                         tx.resp_cmd = x;
-                        self.transactions.push_back(tx);
-                        self.transactions.back_mut().unwrap()
+                        self.transactions.push(tx)
                     };
                     tx.resp_done = true;
                     tx.frag_cnt_tc = 1;
@@ -974,7 +957,7 @@ impl DCERPCState {
                         None => {
                             let mut tx = self.create_tx(current_call_id);
                             tx.resp_cmd = x;
-                            self.transactions.push_back(tx);
+                            self.transactions.push(tx);
                         }
                     };
                     retval = self.handle_common_stub(
@@ -1710,7 +1693,7 @@ mod tests {
             assert_eq!(5, hdr.rpc_vers);
             assert_eq!(1024, hdr.frag_length);
         }
-        let tx = &dcerpc_state.transactions[0];
+        let tx = dcerpc_state.transactions.first().unwrap();
         assert_eq!(11, tx.ctxid);
         assert_eq!(9, tx.opnum);
         assert_eq!(1, tx.first_request_seen);
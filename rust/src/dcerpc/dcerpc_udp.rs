@@ -30,7 +30,6 @@ use suricata_sys::sys::{
 };
 use std;
 use std::ffi::CString;
-use std::collections::VecDeque;
 use crate::dcerpc::parser;
 
 // Constant DCERPC UDP Header length
@@ -63,7 +62,7 @@ pub struct DCERPCHdrUdp {
 pub struct DCERPCUDPState {
     state_data: AppLayerStateData,
     pub tx_id: u64,
-    pub transactions: VecDeque<DCERPCTransaction>,
+    pub transactions: TxStore<DCERPCTransaction>,
     tx_index_completed: usize,
 }
 
@@ -73,7 +72,11 @@ impl State<DCERPCTransaction> for DCERPCUDPState {
     }
 
     fn get_transaction_by_index(&self, index: usize) -> Option<&DCERPCTransaction> {
-        self.transactions.get(index)
+        self.transactions.get_by_index(index)
+    }
+
+    fn get_transaction_iterator(&self, min_tx_id: u64, state: &mut u64) -> AppLayerGetTxIterTuple {
+        self.transactions.get_iterator(min_tx_id, state)
     }
 }
 
@@ -91,8 +94,8 @@ impl DCERPCUDPState {
         self.tx_id += 1;
         if self.transactions.len() > unsafe { DCERPC_MAX_TX } {
             let mut index = self.tx_index_completed;
-            for tx_old in &mut self.transactions.range_mut(self.tx_index_completed..) {
-                index += 1;
+            for (slot, tx_old) in self.transactions.iter_mut_from(self.tx_index_completed) {
+                index = slot + 1;
                 if !tx_old.req_done || !tx_old.resp_done {
                     tx_old.tx_data.updated_tc = true;
                     tx_old.tx_data.updated_ts = true;
@@ -108,23 +111,10 @@ impl DCERPCUDPState {
 
     pub fn free_tx(&mut self, tx_id: u64) {
         SCLogDebug!("Freeing TX with ID {} TX.ID {}", tx_id, tx_id+1);
-        let len = self.transactions.len();
-        let mut found = false;
-        let mut index = 0;
-        for i in 0..len {
-            let tx = &self.transactions[i];
-            if tx.id == tx_id { //+ 1 {
-                found = true;
-                index = i;
-                SCLogDebug!("tx {} progress {}/{}", tx.id, tx.req_done, tx.resp_done);
-                break;
-            }
-        }
-        if found {
-            SCLogDebug!("freeing TX with ID {} TX.ID {} at index {} left: {} max id: {}",
-                            tx_id, tx_id+1, index, self.transactions.len(), self.tx_id);
+        if let Some(_tx) = self.transactions.remove(tx_id + 1) {
+            SCLogDebug!("freed TX with ID {} progress {}/{} left: {} max id: {}",
+                            _tx.id, _tx.req_done, _tx.resp_done, self.transactions.len(), self.tx_id);
             self.tx_index_completed = 0;
-            self.transactions.remove(index);
         }
     }
 
@@ -138,13 +128,7 @@ impl DCERPCUDPState {
     /// Return value:
     /// Option mutable reference to DCERPCTransaction
     pub fn get_tx(&mut self, tx_id: u64) -> Option<&mut DCERPCTransaction> {
-        for tx in &mut self.transactions {
-            let found = tx.id == tx_id;
-            if found {
-                return Some(tx);
-            }
-        }
-        None
+        self.transactions.get_mut(tx_id + 1)
     }
 
     fn find_incomplete_tx(&mut self, hdr: &DCERPCHdrUdp) -> Option<&mut DCERPCTransaction> {
@@ -166,8 +150,7 @@ impl DCERPCUDPState {
         if otx.is_none() {
             let ntx = self.create_tx(hdr);
             SCLogDebug!("new tx id {}, last tx_id {}, {} {}", ntx.id, self.tx_id, ntx.seqnum, ntx.activityuuid[0]);
-            self.transactions.push_back(ntx);
-            otx = self.transactions.back_mut();
+            otx = Some(self.transactions.push(ntx));
         }
 
         if let Some(tx) = otx {
@@ -565,7 +548,7 @@ mod tests {
         );
         assert_eq!(
             1392,
-            dcerpcudp_state.transactions[0].stub_data_buffer_ts.len()
+            dcerpcudp_state.transactions.first().unwrap().stub_data_buffer_ts.len()
         );
     }
 }
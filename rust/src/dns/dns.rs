@@ -26,6 +26,7 @@ use crate::core::{self, *};
 use crate::direction::Direction;
 use crate::direction::DIR_BOTH;
 use crate::dns::parser;
+use crate::dns::pool;
 use crate::flow::Flow;
 use crate::frames::Frame;
 
@@ -33,7 +34,7 @@ use nom7::number::streaming::be_u16;
 use nom7::{Err, IResult};
 use suricata_sys::sys::{
     AppLayerParserState, AppProto, DetectEngineThreadCtx, SCAppLayerParserConfParserEnabled,
-    SCAppLayerProtoDetectConfProtoDetectionEnabled,
+    SCAppLayerProtoDetectConfProtoDetectionEnabled, SCSlabCache,
 };
 
 /// DNS record types.
@@ -235,6 +236,12 @@ pub struct DNSName {
     pub flags: DNSNameFlags,
 }
 
+impl DNSName {
+    fn recycle(self) {
+        pool::buf_put(self.value);
+    }
+}
+
 /// Represents RData of various formats
 #[derive(Debug, PartialEq, Eq)]
 pub enum DNSRData {
@@ -258,6 +265,44 @@ pub enum DNSRData {
     Unknown(Vec<u8>),
 }
 
+impl DNSRData {
+    fn recycle(self) {
+        match self {
+            // addresses are not pooled, see dns_parse_rdata_a
+            DNSRData::A(_) | DNSRData::AAAA(_) => {}
+            DNSRData::NULL(v) | DNSRData::Unknown(v) => {
+                pool::buf_put(v);
+            }
+            DNSRData::CNAME(name)
+            | DNSRData::PTR(name)
+            | DNSRData::MX(name)
+            | DNSRData::NS(name) => {
+                name.recycle();
+            }
+            DNSRData::TXT(txt) => {
+                for v in txt {
+                    pool::buf_put(v);
+                }
+            }
+            DNSRData::SOA(soa) => {
+                soa.mname.recycle();
+                soa.rname.recycle();
+            }
+            DNSRData::SRV(srv) => {
+                srv.target.recycle();
+            }
+            DNSRData::SSHFP(sshfp) => {
+                pool::buf_put(sshfp.fingerprint);
+            }
+            DNSRData::OPT(opts) => {
+                for opt in opts {
+                    pool::buf_put(opt.data);
+                }
+            }
+        }
+    }
+}
+
 #[derive(Debug, PartialEq, Eq)]
 pub struct DNSAnswerEntry {
     pub name: DNSName,
@@ -278,6 +323,24 @@ pub struct DNSMessage {
     pub invalid_additionals: bool,
 }
 
+impl DNSMessage {
+    /// Hand the buffers of the message back to the pool of this thread.
+    fn recycle(self) {
+        for query in self.queries {
+            query.name.recycle();
+        }
+        for answer in self
+            .answers
+            .into_iter()
+            .chain(self.authorities)
+            .chain(self.additionals)
+        {
+            answer.name.recycle();
+            answer.data.recycle();
+        }
+    }
+}
+
 #[derive(Debug, Default)]
 pub struct DNSTransaction {
     pub id: u64,
@@ -290,6 +353,10 @@ impl Transaction for DNSTransaction {
     fn id(&self) -> u64 {
         self.id
     }
+
+    fn slab_cache() -> *mut SCSlabCache {
+        DNS_TX_SLAB.cache()
+    }
 }
 
 impl DNSTransaction {
@@ -326,6 +393,15 @@ impl DNSTransaction {
     pub fn set_event(&mut self, event: DNSEvent) {
         self.tx_data.set_event(event as u8);
     }
+
+    fn recycle(&mut self) {
+        if let Some(request) = self.request.take() {
+            request.recycle();
+        }
+        if let Some(response) = self.response.take() {
+            response.recycle();
+        }
+    }
 }
 
 struct ConfigTracker {
@@ -382,7 +458,7 @@ pub struct DNSState {
     tx_id: u64,
 
     // Transactions.
-    transactions: VecDeque<DNSTransaction>,
+    transactions: TxStore<DNSTransaction>,
 
     config: Option<ConfigTracker>,
 
@@ -395,7 +471,11 @@ impl State<DNSTransaction> for DNSState {
     }
 
     fn get_transaction_by_index(&self, index: usize) -> Option<&DNSTransaction> {
-        self.transactions.get(index)
+        self.transactions.get_by_index(index)
+    }
+
+    fn get_transaction_iterator(&self, min_tx_id: u64, state: &mut u64) -> AppLayerGetTxIterTuple {
+        self.transactions.get_iterator(min_tx_id, state)
     }
 }
 
@@ -555,7 +635,7 @@ impl DNSState {
             variant: DnsVariant::Dns,
             state_data: AppLayerStateData::default(),
             tx_id: 0,
-            transactions: VecDeque::default(),
+            transactions: TxStore::new(),
             config: None,
             gap: false,
         }
@@ -566,42 +646,27 @@ impl DNSState {
             variant,
             state_data: AppLayerStateData::default(),
             tx_id: 0,
-            transactions: VecDeque::default(),
+            transactions: TxStore::new(),
             config: None,
             gap: false,
         }
     }
 
     fn free_tx(&mut self, tx_id: u64) {
-        let len = self.transactions.len();
-        let mut found = false;
-        let mut index = 0;
-        for i in 0..len {
-            let tx = &self.transactions[i];
-            if tx.id == tx_id + 1 {
-                found = true;
-                index = i;
-                break;
-            }
-        }
-        if found {
-            self.transactions.remove(index);
+        if let Some(mut tx) = self.transactions.remove(tx_id + 1) {
+            tx.recycle();
         }
     }
 
     fn get_tx(&mut self, tx_id: u64) -> Option<&DNSTransaction> {
-        return self.transactions.iter().find(|&tx| tx.id == tx_id + 1);
+        return self.transactions.get(tx_id + 1);
     }
 
     /// Set an event. The event is set on the most recent transaction.
     fn set_event(&mut self, event: DNSEvent) {
-        let len = self.transactions.len();
-        if len == 0 {
-            return;
+        if let Some(tx) = self.transactions.last_mut() {
+            tx.tx_data.set_event(event as u8);
         }
-
-        let tx = &mut self.transactions[len - 1];
-        tx.tx_data.set_event(event as u8);
     }
 
     fn parse_request(
@@ -614,7 +679,7 @@ impl DNSState {
                 if let Some(frame) = frame {
                     frame.set_tx(flow, tx.id);
                 }
-                self.transactions.push_back(tx);
+                self.transactions.push(tx);
                 return true;
             }
             Err(e) => match e {
@@ -682,7 +747,7 @@ impl DNSState {
                 if let Some(frame) = frame {
                     frame.set_tx(flow, tx.id);
                 }
-                self.transactions.push_back(tx);
+                self.transactions.push(tx);
                 return true;
             }
             Err(e) => match e {
@@ -914,20 +979,29 @@ fn probe_tcp(input: &[u8]) -> (bool, bool, bool) {
     return (false, false, false);
 }
 
+/// Per thread cache for the DNS states.
+static DNS_STATE_SLAB: StateSlab<DNSState> = StateSlab::new();
+
+/// Per thread cache for the DNS transactions, also used by mDNS as it
+/// shares the transaction type.
+static DNS_TX_SLAB: StateSlab<DNSTransaction> = StateSlab::new();
+
+/// Register the transaction cache, before any transaction is created.
+pub(crate) fn register_tx_slab() {
+    DNS_TX_SLAB.register("dns_tx");
+}
+
 /// Returns *mut DNSState
 pub(crate) extern "C" fn state_new(
     _orig_state: *mut std::os::raw::c_void, _orig_proto: AppProto,
 ) -> *mut std::os::raw::c_void {
-    let state = DNSState::new();
-    let boxed = Box::new(state);
-    return Box::into_raw(boxed) as *mut _;
+    return DNS_STATE_SLAB.alloc(DNSState::new());
 }
 
 /// Params:
 /// - state: *mut DNSState as void pointer
 pub(crate) extern "C" fn state_free(state: *mut std::os::raw::c_void) {
-    // Just unbox...
-    std::mem::drop(unsafe { Box::from_raw(state as *mut DNSState) });
+    unsafe { DNS_STATE_SLAB.free(state) };
 }
 
 pub(crate) unsafe extern "C" fn state_tx_free(state: *mut std::os::raw::c_void, tx_id: u64) {
@@ -1315,6 +1389,8 @@ pub unsafe extern "C" fn SCRegisterDnsUdpParser() {
         let alproto = AppLayerRegisterProtocolDetection(&parser, 1);
         ALPROTO_DNS = alproto;
         if SCAppLayerParserConfParserEnabled(ip_proto_str.as_ptr(), parser.name) != 0 {
+            DNS_STATE_SLAB.register("dns");
+            register_tx_slab();
             let _ = AppLayerRegisterParser(&parser, alproto);
         }
     }
@@ -1362,6 +1438,8 @@ pub unsafe extern "C" fn SCRegisterDnsTcpParser() {
         let alproto = AppLayerRegisterProtocolDetection(&parser, 1);
         ALPROTO_DNS = alproto;
         if SCAppLayerParserConfParserEnabled(ip_proto_str.as_ptr(), parser.name) != 0 {
+            DNS_STATE_SLAB.register("dns");
+            register_tx_slab();
             let _ = AppLayerRegisterParser(&parser, alproto);
         }
     }
@@ -1567,6 +1645,13 @@ mod tests {
         ];
         let mut state = DNSState::new();
         assert!(state.parse_response(buf, false, None, std::ptr::null()));
+
+        // query name, soa record name, mname and rname go back to the pool
+        let pool_len = pool::pool_len();
+        state.free_tx(0);
+        assert_eq!(pool::pool_len(), pool_len + 4);
+        assert!(state.parse_response(buf, false, None, std::ptr::null()));
+        assert_eq!(pool::pool_len(), pool_len);
     }
 
     // Port of the C RustDNSUDPParserTest02 unit test.
@@ -22,3 +22,4 @@ pub mod dns;
 pub mod log;
 pub mod lua;
 pub mod parser;
+pub(crate) mod pool;
@@ -19,6 +19,7 @@
 
 use crate::detect::EnumString;
 use crate::dns::dns::*;
+use crate::dns::pool;
 use nom7::combinator::rest;
 use nom7::error::ErrorKind;
 use nom7::multi::{count, length_data};
@@ -66,7 +67,7 @@ fn dns_parse_name<'b>(
 ) -> IResult<&'b [u8], DNSName> {
     let mut pos = start;
     let mut pivot = start;
-    let mut name: Vec<u8> = Vec::with_capacity(32);
+    let mut name: Vec<u8> = pool::buf_get();
     let mut count = 0;
     let mut flags = DNSNameFlags::default();
 
@@ -210,7 +211,7 @@ fn dns_parse_answer<'a>(
                 // with empty data (data length = 0x0000)
                 if val.data.is_empty() && val.rrtype == DNSRecordType::OPT as u16 {
                     answers.push(DNSAnswerEntry {
-                        name: val.name.clone(),
+                        name: val.name,
                         rrtype: val.rrtype,
                         rrclass: val.rrclass,
                         ttl: val.ttl,
@@ -221,7 +222,7 @@ fn dns_parse_answer<'a>(
                 }
                 let (_, rdata) = dns_parse_rdata(val.data, message, val.rrtype, flags)?;
                 answers.push(DNSAnswerEntry {
-                    name: val.name.clone(),
+                    name: val.name,
                     rrtype: val.rrtype,
                     rrclass: val.rrclass,
                     ttl: val.ttl,
@@ -260,6 +261,8 @@ fn dns_parse_query<'a>(
     ))
 }
 
+// Addresses are small and of fixed size, so an exact size copy is used
+// rather than a pooled buffer.
 fn dns_parse_rdata_a(input: &[u8]) -> IResult<&[u8], DNSRData> {
     rest(input).map(|(input, data)| (input, DNSRData::A(data.to_vec())))
 }
@@ -346,7 +349,7 @@ fn dns_parse_rdata_txt(input: &[u8]) -> IResult<&[u8], DNSRData> {
 
     while !i.is_empty() {
         let (j, txt) = length_data(be_u8)(i)?;
-        txt_strings.push(txt.to_vec());
+        txt_strings.push(pool::buf_from(txt));
         i = j;
     }
 
@@ -354,7 +357,7 @@ fn dns_parse_rdata_txt(input: &[u8]) -> IResult<&[u8], DNSRData> {
 }
 
 fn dns_parse_rdata_null(input: &[u8]) -> IResult<&[u8], DNSRData> {
-    rest(input).map(|(input, data)| (input, DNSRData::NULL(data.to_vec())))
+    rest(input).map(|(input, data)| (input, DNSRData::NULL(pool::buf_from(data))))
 }
 
 fn dns_parse_rdata_sshfp(input: &[u8]) -> IResult<&[u8], DNSRData> {
@@ -367,7 +370,7 @@ fn dns_parse_rdata_sshfp(input: &[u8]) -> IResult<&[u8], DNSRData> {
         DNSRData::SSHFP(DNSRDataSSHFP {
             algo,
             fp_type,
-            fingerprint: fingerprint.to_vec(),
+            fingerprint: pool::buf_from(fingerprint),
         }),
     ))
 }
@@ -382,14 +385,14 @@ fn dns_parse_rdata_opt(input: &[u8]) -> IResult<&[u8], DNSRData> {
         i = j;
         dns_rdata_opt_vec.push(DNSRDataOPT {
             code,
-            data: data.to_vec(),
+            data: pool::buf_from(data),
         });
     }
     Ok((i, DNSRData::OPT(dns_rdata_opt_vec)))
 }
 
 fn dns_parse_rdata_unknown(input: &[u8]) -> IResult<&[u8], DNSRData> {
-    rest(input).map(|(input, data)| (input, DNSRData::Unknown(data.to_vec())))
+    rest(input).map(|(input, data)| (input, DNSRData::Unknown(pool::buf_from(data))))
 }
 
 fn dns_parse_rdata<'a>(
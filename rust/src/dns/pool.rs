@@ -0,0 +1,136 @@
+/* Copyright (C) 2026 Open Information Security Foundation
+ *
+ * You can copy, redistribute or modify this Program under the terms of
+ * the GNU General Public License version 2 as published by the Free
+ * Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * version 2 along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+//! Per thread recycling of the buffers of DNS transactions.
+//!
+//! A DNS transaction holds a byte buffer for every name and most record
+//! data. Instead of returning these to the allocator when the transaction
+//! is freed, they are kept in a pool of the thread and reused by the
+//! parser for the next message of any flow handled by that thread.
+//!
+//! Only variable length data is pooled: the fixed size A and AAAA rdata
+//! are plain exact size copies. To not use more memory than a plain copy
+//! would, the pool only keeps buffers between `POOL_BUF_DEFAULT_CAPACITY`
+//! and `POOL_BUF_MAX_CAPACITY` bytes, and `buf_from` does not use a
+//! recycled buffer that is much larger than the data it is to hold.
+
+use std::cell::RefCell;
+
+/// Max number of buffers kept per thread.
+const POOL_SIZE: usize = 1024;
+/// Buffers with a larger capacity are released, so the rare huge TXT or
+/// NULL record does not stay around. Large enough for a maximum length
+/// name.
+const POOL_BUF_MAX_CAPACITY: usize = 256;
+/// Capacity of new buffers, enough for most names.
+const POOL_BUF_DEFAULT_CAPACITY: usize = 64;
+
+thread_local! {
+    static POOL: RefCell<Vec<Vec<u8>>> = RefCell::new(Vec::new());
+}
+
+/// Get an empty buffer.
+pub(crate) fn buf_get() -> Vec<u8> {
+    POOL.try_with(|p| p.borrow_mut().pop())
+        .ok()
+        .flatten()
+        .unwrap_or_else(|| Vec::with_capacity(POOL_BUF_DEFAULT_CAPACITY))
+}
+
+/// Get a buffer holding a copy of `data`.
+///
+/// A recycled buffer is only used if its capacity is at most twice the
+/// length of `data`, or of a default buffer for short data. Otherwise it
+/// stays in the pool and an exact size copy is returned.
+pub(crate) fn buf_from(data: &[u8]) -> Vec<u8> {
+    let max = 2 * data.len().max(POOL_BUF_DEFAULT_CAPACITY);
+    let buf = POOL
+        .try_with(|p| {
+            let mut p = p.borrow_mut();
+            match p.last() {
+                Some(b) if b.capacity() <= max => p.pop(),
+                _ => None,
+            }
+        })
+        .ok()
+        .flatten();
+    match buf {
+        Some(mut buf) => {
+            buf.extend_from_slice(data);
+            buf
+        }
+        None => data.to_vec(),
+    }
+}
+
+/// Hand a buffer back to the pool of the current thread.
+pub(crate) fn buf_put(mut buf: Vec<u8>) {
+    let cap = buf.capacity();
+    if !(POOL_BUF_DEFAULT_CAPACITY..=POOL_BUF_MAX_CAPACITY).contains(&cap) {
+        return;
+    }
+    buf.clear();
+    let _ = POOL.try_with(|p| {
+        let mut p = p.borrow_mut();
+        if p.len() < POOL_SIZE {
+            p.push(buf);
+        }
+    });
+}
+
+#[cfg(test)]
+pub(crate) fn pool_len() -> usize {
+    POOL.with(|p| p.borrow().len())
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn test_dns_pool() {
+        let mut buf = buf_get();
+        buf.extend_from_slice(b"suricata.io");
+        let ptr = buf.as_ptr();
+        let len = pool_len();
+        buf_put(buf);
+        assert_eq!(pool_len(), len + 1);
+
+        // the buffer is reused, and empty
+        let buf = buf_get();
+        assert_eq!(buf.as_ptr(), ptr);
+        assert!(buf.is_empty());
+
+        // too large and too small buffers are not kept
+        buf_put(Vec::with_capacity(POOL_BUF_MAX_CAPACITY + 1));
+        assert_eq!(pool_len(), len);
+        buf_put(vec![0; 4]);
+        assert_eq!(pool_len(), len);
+
+        // a small copy does not take a large recycled buffer
+        buf_put(Vec::with_capacity(POOL_BUF_MAX_CAPACITY));
+        assert_eq!(pool_len(), len + 1);
+        let buf = buf_from(b"abcd");
+        assert_eq!(buf, b"abcd");
+        assert_eq!(buf.capacity(), 4);
+        assert_eq!(pool_len(), len + 1);
+        // a large enough one does
+        let buf = buf_from(&[0; POOL_BUF_MAX_CAPACITY / 2]);
+        assert_eq!(buf.capacity(), POOL_BUF_MAX_CAPACITY);
+        assert_eq!(pool_len(), len);
+    }
+}
@@ -232,6 +232,36 @@ pub unsafe extern "C" fn SCMd5HashBufferToHex(
     crate::ffi::strings::copy_to_c_char(hex, out, len as usize)
 }
 
+/// Size of the blocks used when updating several hash contexts with the same
+/// data. Each block is fed to all contexts while it is still in the L1 cache.
+const MULTI_UPDATE_BLOCK_SIZE: usize = 4096;
+
+/// Update the MD5, SHA1 and SHA256 contexts that are not NULL with the same
+/// data, in a single pass over the data.
+#[no_mangle]
+pub unsafe extern "C" fn SCHashUpdateMulti(
+    md5: *mut SCMd5, sha1: *mut SCSha1, sha256: *mut SCSha256, bytes: *const u8, len: u32,
+) {
+    if bytes.is_null() || len == 0 {
+        return;
+    }
+    let data = std::slice::from_raw_parts(bytes, len as usize);
+    let mut md5 = md5.as_mut();
+    let mut sha1 = sha1.as_mut();
+    let mut sha256 = sha256.as_mut();
+    for block in data.chunks(MULTI_UPDATE_BLOCK_SIZE) {
+        if let Some(hasher) = md5.as_mut() {
+            Digest::update(&mut hasher.0, block);
+        }
+        if let Some(hasher) = sha1.as_mut() {
+            Digest::update(&mut hasher.0, block);
+        }
+        if let Some(hasher) = sha256.as_mut() {
+            Digest::update(&mut hasher.0, block);
+        }
+    }
+}
+
 // Functions that are generic over Digest. For the most part the C bindings are
 // just wrappers around these.
 
@@ -312,4 +342,49 @@ mod test {
             assert_eq!(string, "5216ddcc58e8dade5256075e77f642da");
         }
     }
+
+    // The multi update must give the same digests as updating each context
+    // on its own, also for data spanning several blocks.
+    #[test]
+    fn test_multi_update() {
+        let data: Vec<u8> = (0..(MULTI_UPDATE_BLOCK_SIZE * 2 + 123))
+            .map(|i| i as u8)
+            .collect();
+        unsafe {
+            let md5 = SCMd5New();
+            let sha1 = SCSha1New();
+            let sha256 = SCSha256New();
+            SCHashUpdateMulti(md5, sha1, sha256, data.as_ptr(), 10);
+            SCHashUpdateMulti(
+                md5,
+                sha1,
+                sha256,
+                data[10..].as_ptr(),
+                (data.len() - 10) as u32,
+            );
+
+            let mut out = [0_u8; SC_MD5_LEN];
+            SCMd5Finalize(&mut *md5, out.as_mut_ptr(), SC_MD5_LEN as u32);
+            assert_eq!(out[..], Md5::digest(&data)[..]);
+            let mut out = [0_u8; SC_SHA1_LEN];
+            SCSha1Finalize(&mut *sha1, out.as_mut_ptr(), SC_SHA1_LEN as u32);
+            assert_eq!(out[..], Sha1::digest(&data)[..]);
+            let mut out = [0_u8; SC_SHA256_LEN];
+            SCSha256Finalize(&mut *sha256, out.as_mut_ptr(), SC_SHA256_LEN as u32);
+            assert_eq!(out[..], Sha256::digest(&data)[..]);
+
+            // NULL contexts are skipped
+            let sha256 = SCSha256New();
+            SCHashUpdateMulti(
+                std::ptr::null_mut(),
+                std::ptr::null_mut(),
+                sha256,
+                data.as_ptr(),
+                data.len() as u32,
+            );
+            let mut out = [0_u8; SC_SHA256_LEN];
+            SCSha256Finalize(&mut *sha256, out.as_mut_ptr(), SC_SHA256_LEN as u32);
+            assert_eq!(out[..], Sha256::digest(&data)[..]);
+        }
+    }
 }
@@ -34,7 +34,7 @@ use crate::dns::dns::{dns_parse_request, dns_parse_response, DNSTransaction};
 
 use nom7::Err;
 use std;
-use std::collections::VecDeque;
+use std::collections::HashMap;
 use std::ffi::CString;
 use std::fmt;
 use std::io;
@@ -568,7 +568,9 @@ pub struct HTTP2State {
     response_frame_size: u32,
     dynamic_headers_ts: HTTP2DynTable,
     dynamic_headers_tc: HTTP2DynTable,
-    transactions: VecDeque<HTTP2Transaction>,
+    transactions: TxStore<HTTP2Transaction>,
+    /// stream id to the id of the newest transaction for that stream
+    streams: HashMap<u32, u64>,
     progress: HTTP2ConnectionState,
 
     c2s_buf: HTTP2HeaderReassemblyBuffer,
@@ -581,7 +583,11 @@ impl State<HTTP2Transaction> for HTTP2State {
     }
 
     fn get_transaction_by_index(&self, index: usize) -> Option<&HTTP2Transaction> {
-        self.transactions.get(index)
+        self.transactions.get_by_index(index)
+    }
+
+    fn get_transaction_iterator(&self, min_tx_id: u64, state: &mut u64) -> AppLayerGetTxIterTuple {
+        self.transactions.get_iterator(min_tx_id, state)
     }
 }
 
@@ -603,7 +609,8 @@ impl HTTP2State {
             // a variable number of dynamic headers
             dynamic_headers_ts: HTTP2DynTable::new(),
             dynamic_headers_tc: HTTP2DynTable::new(),
-            transactions: VecDeque::new(),
+            transactions: TxStore::new(),
+            streams: HashMap::new(),
             progress: HTTP2ConnectionState::Http2StateInit,
             c2s_buf: HTTP2HeaderReassemblyBuffer::default(),
             s2c_buf: HTTP2HeaderReassemblyBuffer::default(),
@@ -632,88 +639,68 @@ impl HTTP2State {
             }
         }
         self.transactions.clear();
+        self.streams.clear();
     }
 
     pub fn set_event(&mut self, event: HTTP2Event) {
-        let len = self.transactions.len();
-        if len == 0 {
-            return;
+        if let Some(tx) = self.transactions.last_mut() {
+            tx.tx_data.set_event(event as u8);
         }
-        let tx = &mut self.transactions[len - 1];
-        tx.tx_data.set_event(event as u8);
     }
 
     // Free a transaction by ID.
     fn free_tx(&mut self, tx_id: u64) {
-        let len = self.transactions.len();
-        let mut found = false;
-        let mut index = 0;
-        for i in 0..len {
-            let tx = &mut self.transactions[i];
-            if tx.tx_id == tx_id + 1 {
-                found = true;
-                index = i;
-                // this should be in HTTP2Transaction::free
-                // but we need state's file container cf https://redmine.openinfosecfoundation.org/issues/4444
-                if !tx.file_range.is_null() {
-                    if let Some(c) = unsafe { SC } {
-                        if let Some(sfcm) = unsafe { SURICATA_HTTP2_FILE_CONFIG } {
-                            (c.HTPFileCloseHandleRange)(
-                                sfcm.files_sbcfg,
-                                &mut tx.ft_tc.file,
-                                0,
-                                tx.file_range,
-                                std::ptr::null_mut(),
-                                0,
-                            );
-                            (c.HttpRangeFreeBlock)(tx.file_range);
-                            tx.file_range = std::ptr::null_mut();
-                        }
+        if let Some(mut tx) = self.transactions.remove(tx_id + 1) {
+            if self.streams.get(&tx.stream_id) == Some(&tx.tx_id) {
+                self.streams.remove(&tx.stream_id);
+            }
+            // this should be in HTTP2Transaction::free
+            // but we need state's file container cf https://redmine.openinfosecfoundation.org/issues/4444
+            if !tx.file_range.is_null() {
+                if let Some(c) = unsafe { SC } {
+                    if let Some(sfcm) = unsafe { SURICATA_HTTP2_FILE_CONFIG } {
+                        (c.HTPFileCloseHandleRange)(
+                            sfcm.files_sbcfg,
+                            &mut tx.ft_tc.file,
+                            0,
+                            tx.file_range,
+                            std::ptr::null_mut(),
+                            0,
+                        );
+                        (c.HttpRangeFreeBlock)(tx.file_range);
+                        tx.file_range = std::ptr::null_mut();
                     }
                 }
-                break;
             }
         }
-        if found {
-            self.transactions.remove(index);
-        }
     }
 
     pub fn get_tx(&mut self, tx_id: u64) -> Option<&HTTP2Transaction> {
-        for tx in &mut self.transactions {
-            if tx.tx_id == tx_id + 1 {
-                tx.tx_data.update_file_flags(self.state_data.file_flags);
-                tx.update_file_flags(tx.tx_data.file_flags);
-                return Some(tx);
-            }
-        }
-        return None;
+        let tx = self.transactions.get_mut(tx_id + 1)?;
+        tx.tx_data.update_file_flags(self.state_data.file_flags);
+        tx.update_file_flags(tx.tx_data.file_flags);
+        return Some(tx);
     }
 
-    fn find_tx_index(&mut self, sid: u32) -> usize {
-        for i in 0..self.transactions.len() {
-            //reverse order should be faster
-            let idx = self.transactions.len() - 1 - i;
-            if sid == self.transactions[idx].stream_id {
-                return idx + 1;
-            }
-        }
-        return 0;
+    /// Get the id of the newest transaction for a stream.
+    fn find_tx_id(&self, sid: u32) -> Option<u64> {
+        self.streams.get(&sid).copied()
     }
 
     fn find_child_stream_id(&mut self, sid: u32) -> u32 {
-        for i in 0..self.transactions.len() {
-            //reverse order should be faster
-            if sid == self.transactions[self.transactions.len() - 1 - i].stream_id {
-                if self.transactions[self.transactions.len() - 1 - i].child_stream_id > 0 {
-                    return self.transactions[self.transactions.len() - 1 - i].child_stream_id;
-                }
-                return sid;
+        if let Some(tx) = self.find_tx_id(sid).and_then(|id| self.transactions.get(id)) {
+            if tx.child_stream_id > 0 {
+                return tx.child_stream_id;
             }
         }
         return sid;
     }
 
+    fn push_tx(&mut self, tx: HTTP2Transaction) -> &mut HTTP2Transaction {
+        self.streams.insert(tx.stream_id, tx.tx_id);
+        self.transactions.push(tx)
+    }
+
     fn create_global_tx(&mut self) -> &mut HTTP2Transaction {
         //special transaction with only one frame
         //as it affects the global connection, there is no end to it
@@ -722,8 +709,7 @@ impl HTTP2State {
         tx.tx_id = self.tx_id;
         tx.state = HTTP2TransactionState::HTTP2StateGlobal;
         // a global tx (stream id 0) does not hold files cf RFC 9113 section 5.1.1
-        self.transactions.push_back(tx);
-        return self.transactions.back_mut().unwrap();
+        return self.push_tx(tx);
     }
 
     pub fn find_or_create_tx(
@@ -759,9 +745,10 @@ impl HTTP2State {
             }
             _ => header.stream_id,
         };
-        let index = self.find_tx_index(sid);
-        if index > 0 {
-            if self.transactions[index - 1].state == HTTP2TransactionState::HTTP2StateClosed {
+        if let Some(id) = self.find_tx_id(sid) {
+            if self.transactions.get(id).map(|tx| tx.state)
+                == Some(HTTP2TransactionState::HTTP2StateClosed)
+            {
                 //these frames can be received in this state for a short period
                 if header.ftype != parser::HTTP2FrameType::RstStream as u8
                     && header.ftype != parser::HTTP2FrameType::WindowUpdate as u8
@@ -771,7 +758,7 @@ impl HTTP2State {
                 }
             }
 
-            let tx = &mut self.transactions[index - 1];
+            let tx = self.transactions.get_mut(id)?;
             tx.tx_data.update_file_flags(self.state_data.file_flags);
             tx.update_file_flags(tx.tx_data.file_flags);
             tx.tx_data.updated_tc = true;
@@ -801,8 +788,7 @@ impl HTTP2State {
             tx.tx_data.update_file_flags(self.state_data.file_flags);
             tx.update_file_flags(tx.tx_data.file_flags);
             tx.tx_data.file_tx = STREAM_TOSERVER | STREAM_TOCLIENT; // might hold files in both directions
-            self.transactions.push_back(tx);
-            return Some(self.transactions.back_mut().unwrap());
+            return Some(self.push_tx(tx));
         }
     }
 
@@ -1254,9 +1240,10 @@ impl HTTP2State {
                         match unsafe { SURICATA_HTTP2_FILE_CONFIG } {
                             Some(sfcm) => {
                                 //borrow checker forbids to reuse directly tx
-                                let index = self.find_tx_index(sid);
-                                if index > 0 {
-                                    let tx_same = &mut self.transactions[index - 1];
+                                let tx_same = self
+                                    .find_tx_id(sid)
+                                    .and_then(|id| self.transactions.get_mut(id));
+                                if let Some(tx_same) = tx_same {
                                     if dir == Direction::ToServer {
                                         tx_same.ft_tc.tx_id = tx_same.tx_id - 1;
                                     } else {
@@ -33,7 +33,8 @@ use std::os::raw::{c_char, c_int, c_void};
 use suricata_sys::sys::{
     AppLayerParserState, AppProto, SCAppLayerParserConfParserEnabled,
     SCAppLayerParserRegisterLogger, SCAppLayerParserStateIssetFlag,
-    SCAppLayerProtoDetectConfProtoDetectionEnabled, SCAppLayerRequestProtocolTLSUpgrade,
+    SCAppLayerProtoDetectConfProtoDetectionEnabled, SCAppLayerProtoDetectPPRegisterFirstBytes,
+    SCAppLayerRequestProtocolTLSUpgrade,
 };
 
 use super::types::*;
@@ -528,6 +529,9 @@ fn tx_is_complete(op: &ProtocolOp, dir: Direction) -> bool {
     }
 }
 
+/// LDAPMessage is a BER encoded SEQUENCE
+const LDAP_FIRST_BYTES: [u8; 1] = [0x30];
+
 fn probe(input: &[u8], direction: Direction, rdir: *mut u8) -> AppProto {
     match ldap_parse_msg(input) {
         Ok((_, ldap_msg)) => {
@@ -705,6 +709,12 @@ pub unsafe extern "C" fn SCRegisterLdapTcpParser() {
     if SCAppLayerProtoDetectConfProtoDetectionEnabled(ip_proto_str.as_ptr(), parser.name) != 0 {
         let alproto = AppLayerRegisterProtocolDetection(&parser, 1);
         ALPROTO_LDAP = alproto;
+        SCAppLayerProtoDetectPPRegisterFirstBytes(
+            parser.ipproto,
+            alproto,
+            LDAP_FIRST_BYTES.as_ptr(),
+            LDAP_FIRST_BYTES.len() as u16,
+        );
         if SCAppLayerParserConfParserEnabled(ip_proto_str.as_ptr(), parser.name) != 0 {
             let _ = AppLayerRegisterParser(&parser, alproto);
         }
@@ -764,6 +774,12 @@ pub unsafe extern "C" fn SCRegisterLdapUdpParser() {
     if SCAppLayerProtoDetectConfProtoDetectionEnabled(ip_proto_str.as_ptr(), parser.name) != 0 {
         let alproto = AppLayerRegisterProtocolDetection(&parser, 1);
         ALPROTO_LDAP = alproto;
+        SCAppLayerProtoDetectPPRegisterFirstBytes(
+            parser.ipproto,
+            alproto,
+            LDAP_FIRST_BYTES.as_ptr(),
+            LDAP_FIRST_BYTES.len() as u16,
+        );
         if SCAppLayerParserConfParserEnabled(ip_proto_str.as_ptr(), parser.name) != 0 {
             let _ = AppLayerRegisterParser(&parser, alproto);
         }
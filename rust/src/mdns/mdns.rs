@@ -46,13 +46,22 @@ unsafe extern "C" fn probe(
     return 0;
 }
 
+/// Per thread cache for the mDNS states, separate from DNS so the memory
+/// use is reported per protocol.
+static MDNS_STATE_SLAB: StateSlab<dns::DNSState> = StateSlab::new();
+
 /// Returns *mut DNSState
 pub(crate) extern "C" fn state_new(
     _orig_state: *mut std::os::raw::c_void, _orig_proto: AppProto,
 ) -> *mut std::os::raw::c_void {
     let state = dns::DNSState::new_variant(dns::DnsVariant::MulticastDns);
-    let boxed = Box::new(state);
-    return Box::into_raw(boxed) as *mut _;
+    return MDNS_STATE_SLAB.alloc(state);
+}
+
+/// Params:
+/// - state: *mut DNSState as void pointer
+pub(crate) extern "C" fn state_free(state: *mut std::os::raw::c_void) {
+    unsafe { MDNS_STATE_SLAB.free(state) };
 }
 
 /// Get the mDNS response answer name and index i.
@@ -96,7 +105,7 @@ pub unsafe extern "C" fn SCRegisterMdnsParser() {
         min_depth: 0,
         max_depth: std::mem::size_of::<dns::DNSHeader>() as u16,
         state_new,
-        state_free: dns::state_free,
+        state_free,
         tx_free: dns::state_tx_free,
         parse_ts: dns::parse_request,
         parse_tc: dns::parse_request,
@@ -128,6 +137,8 @@ pub unsafe extern "C" fn SCRegisterMdnsParser() {
         let alproto = AppLayerRegisterProtocolDetection(&parser, 1);
         ALPROTO_MDNS = alproto;
         if SCAppLayerParserConfParserEnabled(ip_proto_str.as_ptr(), parser.name) != 0 {
+            MDNS_STATE_SLAB.register("mdns");
+            dns::register_tx_slab();
             let _ = AppLayerRegisterParser(&parser, alproto);
         }
     }
@@ -23,6 +23,7 @@ use digest::generic_array::{typenum::U16, GenericArray};
 use digest::Digest;
 use digest::Update;
 use md5::Md5;
+use memchr::memchr;
 use std::ffi::CStr;
 use std::os::raw::c_uchar;
 
@@ -280,6 +281,47 @@ fn hex(i: u8) -> Option<u8> {
     return None;
 }
 
+/// Decode a quoted-printable line (without its EOL) into `out`.
+///
+/// Literal runs between '=' escapes are located with memchr and copied in
+/// bulk, so lines without escapes cost a single scan and copy.
+///
+/// Returns a tuple of: the line ends with a soft line break, an invalid
+/// escape sequence was found.
+pub fn mime_smtp_decode_qp(i: &[u8], out: &mut Vec<u8>) -> (bool, bool) {
+    let mut c = 0;
+    let mut invalid = false;
+    while c < i.len() {
+        let eq = match memchr(b'=', &i[c..]) {
+            Some(o) => c + o,
+            None => {
+                out.extend_from_slice(&i[c..]);
+                break;
+            }
+        };
+        out.extend_from_slice(&i[c..eq]);
+        c = eq;
+        if c == i.len() - 1 {
+            return (true, invalid);
+        } else if c + 2 >= i.len() {
+            // log event ?
+            invalid = true;
+            break;
+        }
+        if let Some(v) = hex(i[c + 1]) {
+            if let Some(v2) = hex(i[c + 2]) {
+                out.push((v << 4) | v2);
+            } else {
+                invalid = true;
+            }
+        } else {
+            invalid = true;
+        }
+        c += 3;
+    }
+    return (false, invalid);
+}
+
 const SMTP_MIME_MAX_DECODED_LINE_LENGTH: usize = 8192;
 
 fn mime_smtp_finish_url(input: &[u8]) -> &[u8] {
@@ -571,33 +613,10 @@ fn mime_smtp_parse_line(
                         if i.len() > MAX_ENC_LINE_LEN {
                             warnings |= MIME_ANOM_LONG_ENC_LINE;
                         }
-                        let mut c = 0;
-                        let mut eol_equal = false;
-                        let mut quoted_buffer = Vec::with_capacity(i.len());
-                        while c < i.len() {
-                            if i[c] == b'=' {
-                                if c == i.len() - 1 {
-                                    eol_equal = true;
-                                    break;
-                                } else if c + 2 >= i.len() {
-                                    // log event ?
-                                    warnings |= MIME_ANOM_INVALID_QP;
-                                    break;
-                                }
-                                if let Some(v) = hex(i[c + 1]) {
-                                    if let Some(v2) = hex(i[c + 2]) {
-                                        quoted_buffer.push((v << 4) | v2);
-                                    } else {
-                                        warnings |= MIME_ANOM_INVALID_QP;
-                                    }
-                                } else {
-                                    warnings |= MIME_ANOM_INVALID_QP;
-                                }
-                                c += 3;
-                            } else {
-                                quoted_buffer.push(i[c]);
-                                c += 1;
-                            }
+                        let mut quoted_buffer = Vec::with_capacity(full.len());
+                        let (eol_equal, invalid) = mime_smtp_decode_qp(i, &mut quoted_buffer);
+                        if invalid {
+                            warnings |= MIME_ANOM_INVALID_QP;
                         }
                         if !eol_equal {
                             quoted_buffer.extend_from_slice(&full[i.len()..]);
@@ -758,3 +777,33 @@ pub unsafe extern "C" fn SCMimeSmtpConfigExtractUrlsSchemeAdd(
     }
     return -1;
 }
+
+#[cfg(test)]
+mod test {
+    use super::*;
+
+    #[test]
+    fn test_mime_smtp_decode_qp() {
+        let mut out = Vec::new();
+        assert_eq!(mime_smtp_decode_qp(b"plain text", &mut out), (false, false));
+        assert_eq!(out, b"plain text");
+
+        out.clear();
+        assert_eq!(mime_smtp_decode_qp(b"caf=C3=A9 au lait=", &mut out), (true, false));
+        assert_eq!(out, b"caf\xc3\xa9 au lait");
+
+        out.clear();
+        assert_eq!(mime_smtp_decode_qp(b"=3D=3D", &mut out), (false, false));
+        assert_eq!(out, b"==");
+
+        // lowercase hex is invalid and skipped
+        out.clear();
+        assert_eq!(mime_smtp_decode_qp(b"a=c3b", &mut out), (false, true));
+        assert_eq!(out, b"ab");
+
+        // truncated escape
+        out.clear();
+        assert_eq!(mime_smtp_decode_qp(b"ab=C", &mut out), (false, true));
+        assert_eq!(out, b"ab");
+    }
+}
@@ -28,7 +28,6 @@ use crate::flow::Flow;
 use crate::frames::*;
 use nom7::Err;
 use std;
-use std::collections::VecDeque;
 use std::ffi::CString;
 use suricata_sys::sys::{
     AppLayerParserState, AppProto, SCAppLayerParserConfParserEnabled,
@@ -112,7 +111,7 @@ pub struct MQTTState {
     state_data: AppLayerStateData,
     tx_id: u64,
     pub protocol_version: u8,
-    transactions: VecDeque<MQTTTransaction>,
+    transactions: TxStore<MQTTTransaction>,
     connected: bool,
     skip_request: usize,
     skip_response: usize,
@@ -126,7 +125,11 @@ impl State<MQTTTransaction> for MQTTState {
     }
 
     fn get_transaction_by_index(&self, index: usize) -> Option<&MQTTTransaction> {
-        self.transactions.get(index)
+        self.transactions.get_by_index(index)
+    }
+
+    fn get_transaction_iterator(&self, min_tx_id: u64, state: &mut u64) -> AppLayerGetTxIterTuple {
+        self.transactions.get_iterator(min_tx_id, state)
     }
 }
 
@@ -142,7 +145,7 @@ impl MQTTState {
             state_data: AppLayerStateData::new(),
             tx_id: 0,
             protocol_version: 0,
-            transactions: VecDeque::new(),
+            transactions: TxStore::new(),
             connected: false,
             skip_request: 0,
             skip_response: 0,
@@ -152,29 +155,17 @@ impl MQTTState {
     }
 
     fn free_tx(&mut self, tx_id: u64) {
-        let len = self.transactions.len();
-        let mut found = false;
-        let mut index = 0;
-        for i in 0..len {
-            let tx = &self.transactions[i];
-            if tx.tx_id == tx_id + 1 {
-                found = true;
-                index = i;
-                break;
-            }
-        }
-        if found {
+        if self.transactions.remove(tx_id + 1).is_some() {
             self.tx_index_completed = 0;
-            self.transactions.remove(index);
         }
     }
 
     pub fn get_tx(&mut self, tx_id: u64) -> Option<&MQTTTransaction> {
-        self.transactions.iter().find(|tx| tx.tx_id == tx_id + 1)
+        self.transactions.get(tx_id + 1)
     }
 
     pub fn get_tx_by_pkt_id(&mut self, pkt_id: u32) -> Option<&mut MQTTTransaction> {
-        for tx in &mut self.transactions.range_mut(self.tx_index_completed..) {
+        for (_, tx) in self.transactions.iter_mut_from(self.tx_index_completed) {
             if !tx.complete {
                 if let Some(mpktid) = tx.pkt_id {
                     if mpktid == pkt_id {
@@ -199,8 +190,8 @@ impl MQTTState {
         tx.tx_id = self.tx_id;
         if self.transactions.len() > unsafe { MQTT_MAX_TX } {
             let mut index = self.tx_index_completed;
-            for tx_old in &mut self.transactions.range_mut(self.tx_index_completed..) {
-                index += 1;
+            for (slot, tx_old) in self.transactions.iter_mut_from(self.tx_index_completed) {
+                index = slot + 1;
                 if !tx_old.complete {
                     tx_old.tx_data.updated_tc = true;
                     tx_old.tx_data.updated_ts = true;
@@ -231,7 +222,7 @@ impl MQTTState {
                 if self.connected {
                     MQTTState::set_event(&mut tx, MQTTEvent::DoubleConnect);
                 }
-                self.transactions.push_back(tx);
+                self.transactions.push(tx);
             }
             MQTTOperation::PUBLISH(ref publish) => {
                 let qos = msg.header.qos_level;
@@ -257,7 +248,7 @@ impl MQTTState {
                 if !self.connected {
                     MQTTState::set_event(&mut tx, MQTTEvent::UnintroducedMessage);
                 }
-                self.transactions.push_back(tx);
+                self.transactions.push(tx);
             }
             MQTTOperation::SUBSCRIBE(ref subscribe) => {
                 let pkt_id = subscribe.message_id as u32;
@@ -279,7 +270,7 @@ impl MQTTState {
                 if !self.connected {
                     MQTTState::set_event(&mut tx, MQTTEvent::UnintroducedMessage);
                 }
-                self.transactions.push_back(tx);
+                self.transactions.push(tx);
             }
             MQTTOperation::UNSUBSCRIBE(ref unsubscribe) => {
                 let pkt_id = unsubscribe.message_id as u32;
@@ -301,7 +292,7 @@ impl MQTTState {
                 if !self.connected {
                     MQTTState::set_event(&mut tx, MQTTEvent::UnintroducedMessage);
                 }
-                self.transactions.push_back(tx);
+                self.transactions.push(tx);
             }
             MQTTOperation::CONNACK(ref _connack) => {
                 if let Some(tx) = self.get_tx_by_pkt_id(MQTT_CONNECT_PKT_ID) {
@@ -313,7 +304,7 @@ impl MQTTState {
                     let mut tx = self.new_tx(msg, toclient);
                     MQTTState::set_event(&mut tx, MQTTEvent::MissingConnect);
                     tx.complete = true;
-                    self.transactions.push_back(tx);
+                    self.transactions.push(tx);
                 }
             }
             MQTTOperation::PUBREC(ref v) | MQTTOperation::PUBREL(ref v) => {
@@ -326,7 +317,7 @@ impl MQTTState {
                         MQTTState::set_event(&mut tx, MQTTEvent::UnintroducedMessage);
                     }
                     tx.complete = true;
-                    self.transactions.push_back(tx);
+                    self.transactions.push(tx);
                 }
             }
             MQTTOperation::PUBACK(ref v) | MQTTOperation::PUBCOMP(ref v) => {
@@ -341,7 +332,7 @@ impl MQTTState {
                         MQTTState::set_event(&mut tx, MQTTEvent::UnintroducedMessage);
                     }
                     tx.complete = true;
-                    self.transactions.push_back(tx);
+                    self.transactions.push(tx);
                 }
             }
             MQTTOperation::SUBACK(ref suback) => {
@@ -356,7 +347,7 @@ impl MQTTState {
                         MQTTState::set_event(&mut tx, MQTTEvent::UnintroducedMessage);
                     }
                     tx.complete = true;
-                    self.transactions.push_back(tx);
+                    self.transactions.push(tx);
                 }
             }
             MQTTOperation::UNSUBACK(ref unsuback) => {
@@ -371,19 +362,19 @@ impl MQTTState {
                         MQTTState::set_event(&mut tx, MQTTEvent::UnintroducedMessage);
                     }
                     tx.complete = true;
-                    self.transactions.push_back(tx);
+                    self.transactions.push(tx);
                 }
             }
             MQTTOperation::UNASSIGNED => {
                 let mut tx = self.new_tx(msg, toclient);
                 tx.complete = true;
                 MQTTState::set_event(&mut tx, MQTTEvent::UnassignedMsgType);
-                self.transactions.push_back(tx);
+                self.transactions.push(tx);
             }
             MQTTOperation::TRUNCATED(_) => {
                 let mut tx = self.new_tx(msg, toclient);
                 tx.complete = true;
-                self.transactions.push_back(tx);
+                self.transactions.push(tx);
             }
             MQTTOperation::AUTH(_) | MQTTOperation::DISCONNECT(_) => {
                 let mut tx = self.new_tx(msg, toclient);
@@ -391,7 +382,7 @@ impl MQTTState {
                 if !self.connected {
                     MQTTState::set_event(&mut tx, MQTTEvent::UnintroducedMessage);
                 }
-                self.transactions.push_back(tx);
+                self.transactions.push(tx);
             }
             MQTTOperation::PINGREQ | MQTTOperation::PINGRESP => {
                 let mut tx = self.new_tx(msg, toclient);
@@ -399,7 +390,7 @@ impl MQTTState {
                 if !self.connected {
                     MQTTState::set_event(&mut tx, MQTTEvent::UnintroducedMessage);
                 }
-                self.transactions.push_back(tx);
+                self.transactions.push(tx);
             }
         }
         // If a new transaction was pushed, only then reassemble the data
@@ -607,7 +598,7 @@ impl MQTTState {
         }
         tx.complete = true;
         tx.tx_data.set_event(event as u8);
-        self.transactions.push_back(tx);
+        self.transactions.push(tx);
     }
 
     fn mqtt_hdr_and_data_frames(
@@ -28,7 +28,6 @@ use crate::direction::Direction;
 use crate::flow::Flow;
 use nom7::{Err, IResult};
 use std;
-use std::collections::VecDeque;
 use std::ffi::CString;
 use suricata_sys::sys::{
     AppLayerParserState, AppProto, SCAppLayerParserConfParserEnabled,
@@ -155,7 +154,7 @@ enum PgsqlStateProgress {
 struct PgsqlState {
     state_data: AppLayerStateData,
     tx_id: u64,
-    transactions: VecDeque<PgsqlTransaction>,
+    transactions: TxStore<PgsqlTransaction>,
     request_gap: bool,
     response_gap: bool,
     backend_secret_key: u32,
@@ -170,7 +169,11 @@ impl State<PgsqlTransaction> for PgsqlState {
     }
 
     fn get_transaction_by_index(&self, index: usize) -> Option<&PgsqlTransaction> {
-        self.transactions.get(index)
+        self.transactions.get_by_index(index)
+    }
+
+    fn get_transaction_iterator(&self, min_tx_id: u64, state: &mut u64) -> AppLayerGetTxIterTuple {
+        self.transactions.get_iterator(min_tx_id, state)
     }
 }
 
@@ -185,7 +188,7 @@ impl PgsqlState {
         Self {
             state_data: AppLayerStateData::new(),
             tx_id: 0,
-            transactions: VecDeque::new(),
+            transactions: TxStore::new(),
             request_gap: false,
             response_gap: false,
             backend_secret_key: 0,
@@ -197,25 +200,13 @@ impl PgsqlState {
 
     // Free a transaction by ID.
     fn free_tx(&mut self, tx_id: u64) {
-        let len = self.transactions.len();
-        let mut found = false;
-        let mut index = 0;
-        for i in 0..len {
-            let tx = &self.transactions[i];
-            if tx.tx_id == tx_id + 1 {
-                found = true;
-                index = i;
-                break;
-            }
-        }
-        if found {
+        if self.transactions.remove(tx_id + 1).is_some() {
             self.tx_index_completed = 0;
-            self.transactions.remove(index);
         }
     }
 
     fn get_tx(&mut self, tx_id: u64) -> Option<&PgsqlTransaction> {
-        self.transactions.iter().find(|tx| tx.tx_id == tx_id + 1)
+        self.transactions.get(tx_id + 1)
     }
 
     fn new_tx(&mut self) -> PgsqlTransaction {
@@ -223,13 +214,13 @@ impl PgsqlState {
         self.tx_id += 1;
         tx.tx_id = self.tx_id;
         SCLogDebug!("Creating new transaction. tx_id: {}", tx.tx_id);
-        if self.transactions.len() > unsafe { PGSQL_MAX_TX } + self.tx_index_completed {
+        if self.transactions.slot_count() > unsafe { PGSQL_MAX_TX } + self.tx_index_completed {
             // If there are too many open transactions,
             // mark the earliest ones as completed, and take care
             // to avoid quadratic complexity
             let mut index = self.tx_index_completed;
-            for tx_old in &mut self.transactions.range_mut(self.tx_index_completed..) {
-                index += 1;
+            for (slot, tx_old) in self.transactions.iter_mut_from(self.tx_index_completed) {
+                index = slot + 1;
                 if tx_old.tx_res_state < PgsqlTxProgress::Done {
                     tx_old.tx_data.updated_tc = true;
                     tx_old.tx_data.updated_ts = true;
@@ -268,11 +259,11 @@ impl PgsqlState {
             || self.state_progress == PgsqlStateProgress::FirstCopyDataInReceived
         {
             let tx = self.new_tx();
-            self.transactions.push_back(tx);
+            self.transactions.push(tx);
         }
         // If we don't need a new transaction, just return the current one
         SCLogDebug!("find_or_create state is {:?}", &self.state_progress);
-        return self.transactions.back_mut();
+        return self.transactions.last_mut();
     }
 
     fn get_curr_state(&mut self) -> PgsqlStateProgress {
@@ -470,14 +461,14 @@ impl PgsqlState {
                     match err {
                         PgsqlParseError::InvalidLength => {
                             tx.tx_data.set_event(PgsqlEvent::InvalidLength as u8);
-                            self.transactions.push_back(tx);
+                            self.transactions.push(tx);
                             // If we don't get a valid length, we can't know how to proceed
                             return AppLayerResult::err();
                         }
                         PgsqlParseError::NomError(_i, error_kind) => {
                             if error_kind == nom7::error::ErrorKind::Switch {
                                 tx.tx_data.set_event(PgsqlEvent::MalformedRequest as u8);
-                                self.transactions.push_back(tx);
+                                self.transactions.push(tx);
                             }
                             SCLogDebug!("Parsing error: {:?}", error_kind);
                         }
@@ -547,12 +538,12 @@ impl PgsqlState {
             PgsqlBEMessage::CopyInResponse(_) => Some(PgsqlStateProgress::CopyInResponseReceived),
             PgsqlBEMessage::ConsolidatedDataRow(msg) => {
                 // Increment tx.data_size here, since we know msg type, so that we can later on log that info
-                self.transactions.back_mut()?.sum_data_size(msg.data_size);
+                self.transactions.last_mut()?.sum_data_size(msg.data_size);
                 Some(PgsqlStateProgress::DataRowReceived)
             }
             PgsqlBEMessage::ConsolidatedCopyDataOut(msg) => {
                 // Increment tx.data_size here, since we know msg type, so that we can later on log that info
-                self.transactions.back_mut()?.sum_data_size(msg.data_size);
+                self.transactions.last_mut()?.sum_data_size(msg.data_size);
                 Some(PgsqlStateProgress::CopyDataOutReceived)
             }
             PgsqlBEMessage::CopyDone(_) => Some(PgsqlStateProgress::CopyDoneReceived),
@@ -703,14 +694,14 @@ impl PgsqlState {
                     match err {
                         PgsqlParseError::InvalidLength => {
                             tx.tx_data.set_event(PgsqlEvent::InvalidLength as u8);
-                            self.transactions.push_back(tx);
+                            self.transactions.push(tx);
                             // If we don't get a valid length, we can't know how to proceed
                             return AppLayerResult::err();
                         }
                         PgsqlParseError::NomError(_i, error_kind) => {
                             if error_kind == nom7::error::ErrorKind::Switch {
                                 tx.tx_data.set_event(PgsqlEvent::MalformedResponse as u8);
-                                self.transactions.push_back(tx);
+                                self.transactions.push(tx);
                             }
                             SCLogDebug!("Parsing error: {:?}", error_kind);
                         }
@@ -32,6 +32,7 @@ use std::collections::VecDeque;
 use suricata_sys::sys::{
     AppLayerParserState, AppProto, SCAppLayerParserConfParserEnabled,
     SCAppLayerParserRegisterLogger, SCAppLayerProtoDetectConfProtoDetectionEnabled,
+    SCAppLayerProtoDetectPPRegisterFirstBytes,
 };
 use tls_parser::{parse_tls_plaintext, TlsMessage, TlsMessageHandshake, TlsRecordType};
 
@@ -533,6 +534,9 @@ pub unsafe extern "C" fn SCRegisterRdpParser() {
     if SCAppLayerProtoDetectConfProtoDetectionEnabled(ip_proto_str.as_ptr(), parser.name) != 0 {
         let alproto = AppLayerRegisterProtocolDetection(&parser, 1);
         ALPROTO_RDP = alproto;
+        // every message is a T.123 packet
+        let first = [TpktVersion::T123 as u8];
+        SCAppLayerProtoDetectPPRegisterFirstBytes(IPPROTO_TCP, alproto, first.as_ptr(), 1);
         if SCAppLayerParserConfParserEnabled(ip_proto_str.as_ptr(), parser.name) != 0 {
             let _ = AppLayerRegisterParser(&parser, alproto);
         }
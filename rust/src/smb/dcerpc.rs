@@ -133,8 +133,8 @@ impl SMBState {
                     SMBTransactionDCERPC::new_request(cmd, call_id)));
 
         SCLogDebug!("SMB: TX DCERPC created: ID {} hdr {:?}", tx.id, tx.hdr);
-        self.transactions.push_back(tx);
-        let tx_ref = self.transactions.back_mut();
+        self.transactions.push(tx);
+        let tx_ref = self.transactions.last_mut();
         return tx_ref.unwrap();
     }
 
@@ -148,8 +148,8 @@ impl SMBState {
                     SMBTransactionDCERPC::new_response(call_id)));
 
         SCLogDebug!("SMB: TX DCERPC created: ID {} hdr {:?}", tx.id, tx.hdr);
-        self.transactions.push_back(tx);
-        let tx_ref = self.transactions.back_mut();
+        self.transactions.push(tx);
+        let tx_ref = self.transactions.last_mut();
         return tx_ref.unwrap();
     }
 
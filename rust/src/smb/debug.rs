@@ -24,8 +24,8 @@ impl SMBState {
     #[cfg(feature = "debug")]
     pub fn _debug_tx_stats(&self) {
         if self.transactions.len() > 1 {
-            let txf = self.transactions.front().unwrap();
-            let txl = self.transactions.back().unwrap();
+            let txf = self.transactions.first().unwrap();
+            let txl = self.transactions.last().unwrap();
 
             SCLogDebug!("TXs {} MIN {} MAX {}", self.transactions.len(), txf.id, txl.id);
             SCLogDebug!("- OLD tx.id {}: {:?}", txf.id, txf);
@@ -38,9 +38,7 @@ impl SMBState {
     pub fn _dump_txs(&self) { }
     #[cfg(feature = "debug")]
     pub fn _dump_txs(&self) {
-        let len = self.transactions.len();
-        for i in 0..len {
-            let tx = &self.transactions[i];
+        for tx in &self.transactions {
             let ver = tx.vercmd.get_version();
             let _smbcmd = if ver == 2 {
                 let (_, cmd) = tx.vercmd.get_smb2_cmd();
@@ -69,12 +69,8 @@ impl SMBTransaction {
 impl SMBState {
     /// Set an event. The event is set on the most recent transaction.
     pub fn set_event(&mut self, event: SMBEvent) {
-        let len = self.transactions.len();
-        if len == 0 {
-            return;
+        if let Some(tx) = self.transactions.last_mut() {
+            tx.set_event(event);
         }
-
-        let tx = &mut self.transactions[len - 1];
-        tx.set_event(event);
     }
 }
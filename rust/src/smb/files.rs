@@ -102,8 +102,8 @@ impl SMBState {
         tx.tx_data.file_tx = if direction == Direction::ToServer { STREAM_TOSERVER } else { STREAM_TOCLIENT }; // TODO direction to flag func?
         SCLogDebug!("SMB: new_file_tx: TX FILE created: ID {} NAME {}",
                 tx.id, String::from_utf8_lossy(file_name));
-        self.transactions.push_back(tx);
-        let tx_ref = self.transactions.back_mut();
+        self.transactions.push(tx);
+        let tx_ref = self.transactions.last_mut();
         return tx_ref.unwrap();
     }
 
@@ -28,7 +28,6 @@
 use std;
 use std::str;
 use std::ffi::{self, CString};
-use std::collections::VecDeque;
  
 use nom7::{Err, Needed};
 use nom7::error::{make_error, ErrorKind};
@@ -358,8 +357,8 @@ impl SMBState {
         tx.response_done = self.tc_trunc; // no response expected if tc is truncated
 
         SCLogDebug!("SMB: TX SETFILEPATHINFO created: ID {}", tx.id);
-        self.transactions.push_back(tx);
-        let tx_ref = self.transactions.back_mut();
+        self.transactions.push(tx);
+        let tx_ref = self.transactions.last_mut();
         return tx_ref.unwrap();
     }
 
@@ -377,8 +376,8 @@ impl SMBState {
         tx.response_done = self.tc_trunc; // no response expected if tc is truncated
 
         SCLogDebug!("SMB: TX SETFILEPATHINFO created: ID {}", tx.id);
-        self.transactions.push_back(tx);
-        let tx_ref = self.transactions.back_mut();
+        self.transactions.push(tx);
+        let tx_ref = self.transactions.last_mut();
         return tx_ref.unwrap();
     }
 }
@@ -410,8 +409,8 @@ impl SMBState {
         tx.response_done = self.tc_trunc; // no response expected if tc is truncated
 
         SCLogDebug!("SMB: TX RENAME created: ID {}", tx.id);
-        self.transactions.push_back(tx);
-        let tx_ref = self.transactions.back_mut();
+        self.transactions.push(tx);
+        let tx_ref = self.transactions.last_mut();
         return tx_ref.unwrap();
     }
 }
@@ -751,7 +750,7 @@ pub struct SMBState<> {
     post_gap_files_checked: bool,
 
     /// transactions list
-    pub transactions: VecDeque<SMBTransaction>,
+    pub transactions: TxStore<SMBTransaction>,
     tx_index_completed: usize,
 
     /// tx counter for assigning incrementing id's to tx's
@@ -780,7 +779,11 @@ impl State<SMBTransaction> for SMBState {
     }
 
     fn get_transaction_by_index(&self, index: usize) -> Option<&SMBTransaction> {
-        self.transactions.get(index)
+        self.transactions.get_by_index(index)
+    }
+
+    fn get_transaction_iterator(&self, min_tx_id: u64, state: &mut u64) -> AppLayerGetTxIterTuple {
+        self.transactions.get_iterator(min_tx_id, state)
     }
 }
 
@@ -814,7 +817,7 @@ impl SMBState {
             tc_trunc: false,
             check_post_gap_file_txs: false,
             post_gap_files_checked: false,
-            transactions: VecDeque::new(),
+            transactions: TxStore::new(),
             tx_index_completed: 0,
             tx_id:0,
             dialect:0,
@@ -838,8 +841,8 @@ impl SMBState {
         SCLogDebug!("TX {} created", tx.id);
         if self.transactions.len() > unsafe { SMB_MAX_TX } {
             let mut index = self.tx_index_completed;
-            for tx_old in &mut self.transactions.range_mut(self.tx_index_completed..) {
-                index += 1;
+            for (slot, tx_old) in self.transactions.iter_mut_from(self.tx_index_completed) {
+                index = slot + 1;
                 if !tx_old.request_done || !tx_old.response_done {
                     tx_old.tx_data.updated_tc = true;
                     tx_old.tx_data.updated_ts = true;
@@ -857,23 +860,10 @@ impl SMBState {
 
     pub fn free_tx(&mut self, tx_id: u64) {
         SCLogDebug!("Freeing TX with ID {} TX.ID {}", tx_id, tx_id+1);
-        let len = self.transactions.len();
-        let mut found = false;
-        let mut index = 0;
-        for i in 0..len {
-            let tx = &self.transactions[i];
-            if tx.id == tx_id + 1 {
-                found = true;
-                index = i;
-                SCLogDebug!("tx {} progress {}/{}", tx.id, tx.request_done, tx.response_done);
-                break;
-            }
-        }
-        if found {
-            SCLogDebug!("freeing TX with ID {} TX.ID {} at index {} left: {} max id: {}",
-                    tx_id, tx_id+1, index, self.transactions.len(), self.tx_id);
+        if let Some(_tx) = self.transactions.remove(tx_id + 1) {
+            SCLogDebug!("freed TX with ID {} progress {}/{} left: {} max id: {}",
+                    _tx.id, _tx.request_done, _tx.response_done, self.transactions.len(), self.tx_id);
             self.tx_index_completed = 0;
-            self.transactions.remove(index);
         }
     }
 
@@ -885,26 +875,24 @@ impl SMBState {
             panic!("txs exploded");
         }
 */
-        for tx in &mut self.transactions {
-            if tx.id == tx_id + 1 {
-                let ver = tx.vercmd.get_version();
-                let mut _smbcmd;
-                if ver == 2 {
-                    let (_, cmd) = tx.vercmd.get_smb2_cmd();
-                    _smbcmd = cmd;
-                } else {
-                    let (_, cmd) = tx.vercmd.get_smb1_cmd();
-                    _smbcmd = cmd as u16;
-                }
-                SCLogDebug!("Found SMB TX: id {} ver:{} cmd:{} progress {}/{} type_data {:?}",
-                        tx.id, ver, _smbcmd, tx.request_done, tx.response_done, tx.type_data);
-                /* hack: apply flow file flags to file tx here to make sure its propagated */
-                if let Some(SMBTransactionTypeData::FILE(ref mut d)) = tx.type_data {
-                    tx.tx_data.update_file_flags(self.state_data.file_flags);
-                    d.update_file_flags(tx.tx_data.file_flags);
-                }
-                return Some(tx);
+        if let Some(tx) = self.transactions.get_mut(tx_id + 1) {
+            let ver = tx.vercmd.get_version();
+            let mut _smbcmd;
+            if ver == 2 {
+                let (_, cmd) = tx.vercmd.get_smb2_cmd();
+                _smbcmd = cmd;
+            } else {
+                let (_, cmd) = tx.vercmd.get_smb1_cmd();
+                _smbcmd = cmd as u16;
+            }
+            SCLogDebug!("Found SMB TX: id {} ver:{} cmd:{} progress {}/{} type_data {:?}",
+                    tx.id, ver, _smbcmd, tx.request_done, tx.response_done, tx.type_data);
+            /* hack: apply flow file flags to file tx here to make sure its propagated */
+            if let Some(SMBTransactionTypeData::FILE(ref mut d)) = tx.type_data {
+                tx.tx_data.update_file_flags(self.state_data.file_flags);
+                d.update_file_flags(tx.tx_data.file_flags);
             }
+            return Some(tx);
         }
         SCLogDebug!("Failed to find SMB TX with ID {}", tx_id);
         return None;
@@ -937,15 +925,15 @@ impl SMBState {
 
         SCLogDebug!("SMB: TX GENERIC created: ID {} tx list {} {:?}",
                 tx.id, self.transactions.len(), &tx);
-        self.transactions.push_back(tx);
-        let tx_ref = self.transactions.back_mut();
+        self.transactions.push(tx);
+        let tx_ref = self.transactions.last_mut();
         return tx_ref.unwrap();
     }
 
     pub fn get_last_tx(&mut self, smb_ver: u8, smb_cmd: u16)
         -> Option<&mut SMBTransaction>
     {
-        let tx_ref = self.transactions.back_mut();
+        let tx_ref = self.transactions.last_mut();
         if let Some(tx) = tx_ref {
             let found = if tx.vercmd.get_version() == smb_ver {
                 if smb_ver == 1 {
@@ -1011,8 +999,8 @@ impl SMBState {
         tx.response_done = self.tc_trunc; // no response expected if tc is truncated
 
         SCLogDebug!("SMB: TX NEGOTIATE created: ID {} SMB ver {}", tx.id, smb_ver);
-        self.transactions.push_back(tx);
-        let tx_ref = self.transactions.back_mut();
+        self.transactions.push(tx);
+        let tx_ref = self.transactions.last_mut();
         return tx_ref.unwrap();
     }
 
@@ -1048,8 +1036,8 @@ impl SMBState {
 
         SCLogDebug!("SMB: TX TREECONNECT created: ID {} NAME {}",
                 tx.id, String::from_utf8_lossy(&name));
-        self.transactions.push_back(tx);
-        let tx_ref = self.transactions.back_mut();
+        self.transactions.push(tx);
+        let tx_ref = self.transactions.last_mut();
         return tx_ref.unwrap();
     }
 
@@ -1084,8 +1072,8 @@ impl SMBState {
         tx.request_done = true;
         tx.response_done = self.tc_trunc; // no response expected if tc is truncated
 
-        self.transactions.push_back(tx);
-        let tx_ref = self.transactions.back_mut();
+        self.transactions.push(tx);
+        let tx_ref = self.transactions.last_mut();
         return tx_ref.unwrap();
     }
 
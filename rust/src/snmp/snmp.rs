@@ -36,6 +36,7 @@ use suricata_sys::sys::{
     AppLayerParserState, AppProto, AppProtoNewProtoFromString, EveJsonTxLoggerRegistrationData,
     SCAppLayerParserRegisterLogger, SCAppLayerProtoDetectConfProtoDetectionEnabled,
     SCOutputEvePreRegisterLogger, SCOutputJsonLogDirection, SCSigTablePreRegister, SCAppLayerParserConfParserEnabled,
+    SCAppLayerProtoDetectPPRegisterFirstBytes,
 };
 
 #[derive(AppLayerEvent)]
@@ -442,5 +443,8 @@ pub unsafe extern "C" fn SCRegisterSnmpParser() {
     if SCAppLayerParserConfParserEnabled(ip_proto_str.as_ptr(), parser.name) != 0 {
         let _ = AppLayerRegisterParser(&parser, ALPROTO_SNMP);
     }
+    // the message is a DER encoded SEQUENCE
+    let first = [0x30];
+    SCAppLayerProtoDetectPPRegisterFirstBytes(IPPROTO_UDP, ALPROTO_SNMP, first.as_ptr(), 1);
     SCAppLayerParserRegisterLogger(IPPROTO_UDP, ALPROTO_SNMP);
 }
@@ -649,6 +649,11 @@ extern "C" {
         max_depth: u16, ProbingParserTs: ProbingParserFPtr, ProbingParserTc: ProbingParserFPtr,
     ) -> ::std::os::raw::c_int;
 }
+extern "C" {
+    pub fn SCAppLayerProtoDetectPPRegisterFirstBytes(
+        ipproto: u8, alproto: AppProto, bytes: *const u8, bytes_len: u16,
+    );
+}
 extern "C" {
     #[doc = " \\brief Registers a case-sensitive pattern for protocol detection."]
     pub fn SCAppLayerProtoDetectPMRegisterPatternCS(
@@ -718,3 +723,39 @@ extern "C" {
 extern "C" {
     pub fn SCAppLayerParserStateIssetFlag(pstate: *mut AppLayerParserState, flag: u16) -> u16;
 }
+pub const SC_SLAB_ALIGN: u32 = 16;
+#[repr(C)]
+#[derive(Debug, Copy, Clone)]
+pub struct SCSlabCache_ {
+    _unused: [u8; 0],
+}
+pub type SCSlabCache = SCSlabCache_;
+extern "C" {
+    pub fn SCSlabCacheRegister(
+        name: *const ::std::os::raw::c_char, size: u32,
+    ) -> *mut SCSlabCache;
+}
+extern "C" {
+    pub fn SCSlabAlloc(c: *mut SCSlabCache) -> *mut ::std::os::raw::c_void;
+}
+extern "C" {
+    pub fn SCSlabFree(c: *mut SCSlabCache, ptr: *mut ::std::os::raw::c_void);
+}
+extern "C" {
+    pub fn SCSlabMemuse(c: *mut SCSlabCache) -> u64;
+}
+extern "C" {
+    pub fn SCSlabMemcache(c: *mut SCSlabCache) -> u64;
+}
+extern "C" {
+    pub fn SCSlabRegisterCounters();
+}
+extern "C" {
+    pub fn SCSlabThreadCleanup();
+}
+extern "C" {
+    pub fn SCSlabShutdown();
+}
+extern "C" {
+    pub fn SCSlabRegisterTests();
+}
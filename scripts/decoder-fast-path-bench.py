@@ -0,0 +1,122 @@
+#! /usr/bin/env python3
+#
+# A/B benchmark for the decoder fast path (decoder.fast-path).
+#
+# Runs Suricata on each pcap with the fast path disabled and enabled,
+# reports the run times, and checks that both runs produce the same decoder
+# stats and the same anomaly events.
+#
+# Usage: ./scripts/decoder-fast-path-bench.py --suricata ./src/suricata \
+#            --config suricata.yaml [--runs 5] capture.pcap [capture.pcap ...]
+#
+# No rules are loaded, so the run time is dominated by capture, decoding
+# and flow handling. Use real captures of the traffic the sensor will see:
+# the gain depends on the share of plain Ethernet + IPv4/IPv6 + TCP/UDP
+# frames.
+
+
+import argparse
+import json
+import os
+import statistics
+import subprocess
+import sys
+import tempfile
+import time
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Decoder fast path A/B benchmark")
+    parser.add_argument("--suricata", default="./src/suricata", help="suricata binary")
+    parser.add_argument("--config", default="suricata.yaml", help="suricata.yaml to use")
+    parser.add_argument("--runs", type=int, default=5, help="runs per pcap and setting")
+    parser.add_argument("--runmode", default="single", help="runmode to use")
+    parser.add_argument("pcaps", nargs="+", help="captures to run on")
+    args = parser.parse_args()
+
+    failed = False
+    for pcap in args.pcaps:
+        results = {}
+        for fast_path in ("no", "yes"):
+            times = []
+            for _ in range(args.runs):
+                elapsed, stats, anomalies = run(args, pcap, fast_path)
+                times.append(elapsed)
+            results[fast_path] = (times, stats, anomalies)
+
+        base = statistics.median(results["no"][0])
+        fast = statistics.median(results["yes"][0])
+        print("%s: fast-path no %.3fs (min %.3fs), yes %.3fs (min %.3fs), speedup %.1f%%" % (
+            pcap, base, min(results["no"][0]), fast, min(results["yes"][0]),
+            (base - fast) * 100.0 / base if base > 0 else 0.0))
+
+        if not check_parity(pcap, "stats", results["no"][1], results["yes"][1]):
+            failed = True
+        if not check_parity(pcap, "anomalies", results["no"][2], results["yes"][2]):
+            failed = True
+
+    return 1 if failed else 0
+
+
+def run(args, pcap, fast_path):
+    """Run suricata once and return the run time, the decoder stats and
+    the anomaly event counts."""
+    with tempfile.TemporaryDirectory() as logdir:
+        rules = os.path.join(logdir, "empty.rules")
+        open(rules, "w").close()
+        cmd = [
+            args.suricata,
+            "-c", args.config,
+            "-r", pcap,
+            "-l", logdir,
+            "-S", rules,
+            "-k", "none",
+            "--runmode", args.runmode,
+            "--set", "decoder.fast-path=%s" % fast_path,
+        ]
+        start = time.monotonic()
+        subprocess.run(cmd, check=True, stdout=subprocess.DEVNULL, stderr=subprocess.DEVNULL)
+        elapsed = time.monotonic() - start
+        stats, anomalies = load_eve(os.path.join(logdir, "eve.json"))
+    return elapsed, stats, anomalies
+
+
+def load_eve(path):
+    """Return the decoder part of the last stats record and the anomaly
+    event counts from an eve.json file."""
+    stats = {}
+    anomalies = {}
+    with open(path) as fileobj:
+        for line in fileobj:
+            event = json.loads(line)
+            if event["event_type"] == "stats":
+                stats = flatten("decoder", event["stats"].get("decoder", {}))
+            elif event["event_type"] == "anomaly":
+                key = "%s.%s" % (event["anomaly"].get("type"), event["anomaly"].get("event"))
+                anomalies[key] = anomalies.get(key, 0) + 1
+    return stats, anomalies
+
+
+def flatten(prefix, obj):
+    out = {}
+    for key, val in obj.items():
+        name = "%s.%s" % (prefix, key)
+        if isinstance(val, dict):
+            out.update(flatten(name, val))
+        else:
+            out[name] = val
+    return out
+
+
+def check_parity(pcap, what, base, fast):
+    ok = True
+    for key in sorted(set(base.keys()) | set(fast.keys())):
+        if base.get(key) != fast.get(key):
+            print("%s: %s mismatch for %s: fast-path no %s, yes %s" % (
+                pcap, what, key, base.get(key), fast.get(key)), file=sys.stderr)
+            ok = False
+    return ok
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -72,6 +72,11 @@ typedef struct AppLayerProtoDetectProbingParserElement_ {
     /* the max length of data after which this parser won't be invoked */
     uint16_t max_depth;
 
+    /* bitmap of the first bytes the parser can accept, only used if
+     * 'first_bytes_set' is true. Set up by AppLayerProtoDetectPrepareState. */
+    bool first_bytes_set;
+    uint8_t first_bytes[32];
+
     /* the to_server probing parser function */
     ProbingParserFPtr ProbingParserTs;
 
@@ -138,6 +143,15 @@ typedef struct AppLayerProtoDetectCtxIpproto_ {
     AppLayerProtoDetectPMCtx ctx_pm[2];
 } AppLayerProtoDetectCtxIpproto;
 
+/** first bytes declared by a probing parser, see
+ *  SCAppLayerProtoDetectPPRegisterFirstBytes() */
+typedef struct AppLayerProtoDetectPPFirstBytes_ {
+    uint8_t ipproto;
+    AppProto alproto;
+    uint8_t bytes[32];
+    struct AppLayerProtoDetectPPFirstBytes_ *next;
+} AppLayerProtoDetectPPFirstBytes;
+
 /**
  * \brief The app layer protocol detection context.
  */
@@ -165,6 +179,10 @@ typedef struct AppLayerProtoDetectCtx_ {
      * is referenced (or 0 if there is no expectation). */
     uint8_t *expectation_proto;
     size_t expectation_proto_len;
+
+    /* first bytes declared by the probing parsers, applied to the
+     * probing parser elements when preparing the state */
+    AppLayerProtoDetectPPFirstBytes *pp_first_bytes;
 } AppLayerProtoDetectCtx;
 
 typedef struct AppLayerProtoDetectAliases_ {
@@ -497,7 +515,14 @@ static inline AppProto PPGetProto(const AppLayerProtoDetectProbingParserElement
         }
 
         AppProto alproto = ALPROTO_UNKNOWN;
-        if (flags & STREAM_TOSERVER && pe->ProbingParserTs != NULL) {
+        if (pe->first_bytes_set && buflen > 0 &&
+                !(pe->first_bytes[buf[0] >> 3] & BIT_U8(buf[0] & 7))) {
+            /* the data can't be for this parser, no need to call it. The
+             * first byte won't change, so handle it like a failed probe. */
+            SCLogDebug("first byte %02x rules out %s", buf[0],
+                    AppProtoToString(pe->alproto));
+            alproto = ALPROTO_FAILED;
+        } else if (flags & STREAM_TOSERVER && pe->ProbingParserTs != NULL) {
             alproto = pe->ProbingParserTs(f, flags, buf, buflen, rdir);
         } else if (flags & STREAM_TOCLIENT && pe->ProbingParserTc != NULL) {
             alproto = pe->ProbingParserTc(f, flags, buf, buflen, rdir);
@@ -833,6 +858,8 @@ AppLayerProtoDetectProbingParserElementDuplicate(AppLayerProtoDetectProbingParse
     new_pe->alproto = pe->alproto;
     new_pe->min_depth = pe->min_depth;
     new_pe->max_depth = pe->max_depth;
+    new_pe->first_bytes_set = pe->first_bytes_set;
+    memcpy(new_pe->first_bytes, pe->first_bytes, sizeof(new_pe->first_bytes));
     new_pe->ProbingParserTs = pe->ProbingParserTs;
     new_pe->ProbingParserTc = pe->ProbingParserTc;
     new_pe->next = NULL;
@@ -1480,6 +1507,36 @@ end:
 
 /***** State Preparation *****/
 
+static void AppLayerProtoDetectPPApplyFirstBytesList(
+        AppLayerProtoDetectProbingParserElement *pe, const AppLayerProtoDetectPPFirstBytes *fb)
+{
+    for (; pe != NULL; pe = pe->next) {
+        if (pe->alproto != fb->alproto)
+            continue;
+        pe->first_bytes_set = true;
+        memcpy(pe->first_bytes, fb->bytes, sizeof(pe->first_bytes));
+    }
+}
+
+/** \internal
+ *  \brief copy the declared first bytes into the probing parser elements,
+ *         so the prefilter is a single bitmap check per element */
+static void AppLayerProtoDetectPPApplyFirstBytes(void)
+{
+    for (const AppLayerProtoDetectPPFirstBytes *fb = alpd_ctx.pp_first_bytes; fb != NULL;
+            fb = fb->next) {
+        for (AppLayerProtoDetectProbingParser *pp = alpd_ctx.ctx_pp; pp != NULL; pp = pp->next) {
+            if (pp->ipproto != fb->ipproto)
+                continue;
+            for (AppLayerProtoDetectProbingParserPort *pp_port = pp->port; pp_port != NULL;
+                    pp_port = pp_port->next) {
+                AppLayerProtoDetectPPApplyFirstBytesList(pp_port->dp, fb);
+                AppLayerProtoDetectPPApplyFirstBytesList(pp_port->sp, fb);
+            }
+        }
+    }
+}
+
 int AppLayerProtoDetectPrepareState(void)
 {
     SCEnter();
@@ -1505,6 +1562,8 @@ int AppLayerProtoDetectPrepareState(void)
         }
     }
 
+    AppLayerProtoDetectPPApplyFirstBytes();
+
 #ifdef DEBUG
     if (SCLogDebugEnabled()) {
         AppLayerProtoDetectPrintProbingParsers(alpd_ctx.ctx_pp);
@@ -1621,6 +1680,40 @@ int SCAppLayerProtoDetectPPParseConfPorts(const char *ipproto_name, uint8_t ippr
     SCReturnInt(config);
 }
 
+/** \brief declare the bytes the input of a probing parser can start with
+ *
+ *  Data starting with another byte is ruled out without calling the
+ *  probing parser, as if the parser returned ALPROTO_FAILED. Only to be
+ *  used if the parser fails on such data in both directions, midstream
+ *  included. Can be called more than once to add bytes.
+ *
+ *  \param bytes array of accepted first bytes
+ *  \param bytes_len number of bytes in 'bytes'
+ */
+void SCAppLayerProtoDetectPPRegisterFirstBytes(
+        uint8_t ipproto, AppProto alproto, const uint8_t *bytes, uint16_t bytes_len)
+{
+    AppLayerProtoDetectPPFirstBytes *fb = alpd_ctx.pp_first_bytes;
+    while (fb != NULL) {
+        if (fb->ipproto == ipproto && fb->alproto == alproto)
+            break;
+        fb = fb->next;
+    }
+    if (fb == NULL) {
+        fb = SCCalloc(1, sizeof(*fb));
+        if (unlikely(fb == NULL)) {
+            FatalError("Unable to alloc AppLayerProtoDetectPPFirstBytes.");
+        }
+        fb->ipproto = ipproto;
+        fb->alproto = alproto;
+        fb->next = alpd_ctx.pp_first_bytes;
+        alpd_ctx.pp_first_bytes = fb;
+    }
+    for (uint16_t i = 0; i < bytes_len; i++) {
+        fb->bytes[bytes[i] >> 3] |= BIT_U8(bytes[i] & 7);
+    }
+}
+
 /***** PM registration *****/
 
 int SCAppLayerProtoDetectPMRegisterPatternCS(uint8_t ipproto, AppProto alproto, const char *pattern,
@@ -1730,6 +1823,14 @@ int AppLayerProtoDetectDeSetup(void)
     alpd_ctx.expectation_proto = NULL;
     alpd_ctx.expectation_proto_len = 0;
 
+    AppLayerProtoDetectPPFirstBytes *fb = alpd_ctx.pp_first_bytes;
+    while (fb != NULL) {
+        AppLayerProtoDetectPPFirstBytes *fb_next = fb->next;
+        SCFree(fb);
+        fb = fb_next;
+    }
+    alpd_ctx.pp_first_bytes = NULL;
+
     SpmDestroyGlobalThreadCtx(alpd_ctx.spm_global_thread_ctx);
 
     AppLayerProtoDetectFreeAliases();
@@ -3512,6 +3613,61 @@ static int AppLayerProtoDetectTest19(void)
     return result;
 }
 
+static int pp_first_bytes_calls = 0;
+
+static uint16_t ProbingParserFirstBytesForTesting(
+        const Flow *f, uint8_t direction, const uint8_t *input, uint32_t input_len, uint8_t *rdir)
+{
+    pp_first_bytes_calls++;
+    if (input_len > 0 && input[0] == 0x03)
+        return ALPROTO_RDP;
+    return ALPROTO_FAILED;
+}
+
+/** \test probing parser with declared first bytes is only called if the
+ *        data starts with one of them */
+static int AppLayerProtoDetectTest20(void)
+{
+    AppLayerProtoDetectUnittestCtxBackup();
+    AppLayerProtoDetectSetup();
+
+    SCAppLayerProtoDetectPPRegister(IPPROTO_TCP, "3389", ALPROTO_RDP, 0, 0, STREAM_TOSERVER,
+            ProbingParserFirstBytesForTesting, ProbingParserFirstBytesForTesting);
+    const uint8_t first[] = { 0x03 };
+    SCAppLayerProtoDetectPPRegisterFirstBytes(IPPROTO_TCP, ALPROTO_RDP, first, sizeof(first));
+    AppLayerProtoDetectPrepareState();
+
+    const uint8_t tls[] = { 0x16, 0x03, 0x01, 0x00, 0x10 };
+    const uint8_t tpkt[] = { 0x03, 0x00, 0x00, 0x13 };
+    bool reverse_flow = false;
+    Flow f;
+    memset(&f, 0, sizeof(f));
+    f.protomap = FlowGetProtoMapping(IPPROTO_TCP);
+    f.sp = 49152;
+    f.dp = 3389;
+
+    pp_first_bytes_calls = 0;
+    AppProto alproto = AppLayerProtoDetectPPGetProto(
+            &f, tls, sizeof(tls), IPPROTO_TCP, STREAM_TOSERVER, &reverse_flow);
+    FAIL_IF_NOT(alproto == ALPROTO_UNKNOWN);
+    FAIL_IF_NOT(pp_first_bytes_calls == 0);
+    /* ruled out like a failed probe */
+    FAIL_IF_NOT(FLOW_IS_PP_DONE(&f, STREAM_TOSERVER));
+
+    memset(&f, 0, sizeof(f));
+    f.protomap = FlowGetProtoMapping(IPPROTO_TCP);
+    f.sp = 49152;
+    f.dp = 3389;
+    alproto = AppLayerProtoDetectPPGetProto(
+            &f, tpkt, sizeof(tpkt), IPPROTO_TCP, STREAM_TOSERVER, &reverse_flow);
+    FAIL_IF_NOT(alproto == ALPROTO_RDP);
+    FAIL_IF_NOT(pp_first_bytes_calls == 1);
+
+    AppLayerProtoDetectDeSetup();
+    AppLayerProtoDetectUnittestCtxRestore();
+    PASS;
+}
+
 void AppLayerProtoDetectUnittestsRegister(void)
 {
     SCEnter();
@@ -3535,6 +3691,7 @@ void AppLayerProtoDetectUnittestsRegister(void)
     UtRegisterTest("AppLayerProtoDetectTest17", AppLayerProtoDetectTest17);
     UtRegisterTest("AppLayerProtoDetectTest18", AppLayerProtoDetectTest18);
     UtRegisterTest("AppLayerProtoDetectTest19", AppLayerProtoDetectTest19);
+    UtRegisterTest("AppLayerProtoDetectTest20", AppLayerProtoDetectTest20);
 
     SCReturn;
 }
@@ -72,6 +72,8 @@ void SCAppLayerProtoDetectPPRegister(uint8_t ipproto, const char *portstr, AppPr
 int SCAppLayerProtoDetectPPParseConfPorts(const char *ipproto_name, uint8_t ipproto,
         const char *alproto_name, AppProto alproto, uint16_t min_depth, uint16_t max_depth,
         ProbingParserFPtr ProbingParserTs, ProbingParserFPtr ProbingParserTc);
+void SCAppLayerProtoDetectPPRegisterFirstBytes(
+        uint8_t ipproto, AppProto alproto, const uint8_t *bytes, uint16_t bytes_len);
 
 /***** PM registration *****/
 
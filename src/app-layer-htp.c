@@ -2508,6 +2508,24 @@ static AppLayerGetTxIterTuple HTPGetTxIterator(const uint8_t ipproto, const AppP
     return no_tuple;
 }
 
+/** \brief forget how far the request bodies were prefiltered
+ *
+ *  Used when a flow is first inspected by a new detection engine, as the
+ *  patterns of the old engine's prefilter are no longer the ones in use.
+ */
+void HTPStateResetBodyMpmScanned(void *alstate)
+{
+    HtpState *http_state = (HtpState *)alstate;
+    const uint64_t size = HTPStateGetTxCnt(alstate);
+    for (uint64_t i = 0; i < size; i++) {
+        htp_tx_t *tx = htp_connp_tx_index(http_state->connp, i);
+        if (tx == NULL)
+            continue;
+        HtpTxUserData *htud = (HtpTxUserData *)htp_tx_get_user_data(tx);
+        htud->request_body.body_mpm_scanned = 0;
+    }
+}
+
 void *HtpGetTxForH2(void *alstate)
 {
     // gets last transaction
@@ -139,6 +139,8 @@ typedef struct HtpBody_ {
     uint64_t body_parsed;
     /* inspection tracker */
     uint64_t body_inspected;
+    /* offset up to which the prefilter scanned the body */
+    uint64_t body_mpm_scanned;
 } HtpBody;
 
 #define HTP_BOUNDARY_SET        BIT_U8(1)    /**< We have a boundary string */
@@ -217,6 +219,7 @@ void AppLayerHtpEnableRequestBodyCallback(void);
 void AppLayerHtpEnableResponseBodyCallback(void);
 void AppLayerHtpNeedFileInspection(void);
 void AppLayerHtpPrintStats(void);
+void HTPStateResetBodyMpmScanned(void *alstate);
 
 void HTPConfigure(void);
 
@@ -37,6 +37,8 @@
 
 #include "util-validate.h"
 #include "util-config.h"
+#include "util-latency.h"
+#include "util-slab.h"
 
 #include "app-layer.h"
 #include "app-layer-detect-proto.h"
@@ -232,11 +234,18 @@ int AppLayerParserProtoIsRegistered(uint8_t ipproto, AppProto alproto)
     return (alp_ctx.ctxs[alproto][ipproto_map].StateAlloc != NULL) ? 1 : 0;
 }
 
+/** per thread cache for the parser states, NULL if it couldn't be set up */
+static SCSlabCache *pstate_slab = NULL;
+
 AppLayerParserState *AppLayerParserStateAlloc(void)
 {
     SCEnter();
 
-    AppLayerParserState *pstate = (AppLayerParserState *)SCCalloc(1, sizeof(*pstate));
+    AppLayerParserState *pstate;
+    if (pstate_slab != NULL)
+        pstate = SCSlabAlloc(pstate_slab);
+    else
+        pstate = (AppLayerParserState *)SCCalloc(1, sizeof(*pstate));
     if (pstate == NULL)
         goto end;
 
@@ -251,7 +260,10 @@ void AppLayerParserStateFree(AppLayerParserState *pstate)
     if (pstate->decoder_events != NULL)
         AppLayerDecoderEventsFreeEvents(&pstate->decoder_events);
     AppLayerParserFramesFreeContainer(pstate->frames);
-    SCFree(pstate);
+    if (pstate_slab != NULL)
+        SCSlabFree(pstate_slab, pstate);
+    else
+        SCFree(pstate);
 
     SCReturn;
 }
@@ -266,6 +278,7 @@ int AppLayerParserSetup(void)
         FatalError("Unable to alloc alp_ctx.ctxs.");
     }
     alp_ctx.ctxs_len = g_alproto_max;
+    pstate_slab = SCSlabCacheRegister("parser", sizeof(AppLayerParserState));
     SCReturnInt(0);
 }
 
@@ -1384,8 +1397,13 @@ int AppLayerParserParse(ThreadVars *tv, AppLayerParserThreadCtx *alp_tctx, Flow
         }
 #endif
         /* invoke the parser */
+        const bool sampled = tv != NULL && SCLatencyIsSampled(tv);
+        const uint64_t parse_start = sampled ? UtilCpuGetTicks() : 0;
         AppLayerResult res = p->Parser[direction](f, alstate, pstate, stream_slice,
                 alp_tctx->alproto_local_storage[alproto][f->protomap]);
+        if (unlikely(sampled)) {
+            SCLatencyRecordAppLayer(tv, alproto, UtilCpuGetTicks() - parse_start);
+        }
         if (res.status < 0) {
             AppLayerIncParserErrorCounter(tv, f);
             goto error;
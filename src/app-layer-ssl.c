@@ -42,6 +42,7 @@
 #include "util-debug.h"
 #include "util-ja3.h"
 #include "util-enum.h"
+#include "util-hash-lookup3.h"
 #include "util-validate.h"
 
 static SCEnumCharMap tls_state_client_table[] = {
@@ -205,6 +206,12 @@ typedef struct SslConfig_ {
     bool disable_ja3; /**< ja3 explicitly disabled. Don't enable on demand. */
     SC_ATOMIC_DECLARE(int, enable_ja4);
     bool disable_ja4; /**< ja4 explicitly disabled. Don't enable on demand. */
+    /** dynamic setting for decoding the subject, issuer, serial, SANs and
+     *  validity of the first certificate, enabled by the rules, loggers and
+     *  Lua scripts that use them. */
+    SC_ATOMIC_DECLARE(int, enable_cert_decode);
+    /** dynamic setting for the first certificate fingerprint */
+    SC_ATOMIC_DECLARE(int, enable_cert_fingerprint);
 } SslConfig;
 
 SslConfig ssl_config;
@@ -466,12 +473,263 @@ static inline int TlsDecodeHSCertificateAddCertToChain(
     return 0;
 }
 
+/** \internal
+ *  \brief take ownership of a string returned by the x509 decoder
+ *
+ *  The cert0 strings are allocated with SCMalloc so that cached copies
+ *  and freshly decoded values are freed the same way.
+ */
+static char *SSLX509String(char *str)
+{
+    if (str == NULL)
+        return NULL;
+    char *s = SCStrdup(str);
+    SCRustCStringFree(str);
+    return s;
+}
+
+static char **SSLCertSANsDup(char **sans, const uint16_t sans_len)
+{
+    char **copy = SCCalloc(sans_len, sizeof(char *));
+    if (copy == NULL)
+        return NULL;
+    for (uint16_t i = 0; i < sans_len; i++) {
+        if (sans[i] == NULL)
+            continue;
+        copy[i] = SCStrdup(sans[i]);
+        if (copy[i] == NULL) {
+            for (uint16_t j = 0; j < i; j++) {
+                SCFree(copy[j]);
+            }
+            SCFree(copy);
+            return NULL;
+        }
+    }
+    return copy;
+}
+
+static void SSLCertSANsFree(char **sans, const uint16_t sans_len)
+{
+    if (sans == NULL)
+        return;
+    for (uint16_t i = 0; i < sans_len; i++) {
+        SCFree(sans[i]);
+    }
+    SCFree(sans);
+}
+
+/** size of the per thread cache of decoded certificates. Servers present
+ *  the same certificate to many clients, so most of the certificates a
+ *  thread sees are repeats. */
+#define SSL_CERT_CACHE_SIZE 256
+/** don't cache unusually large certificates */
+#define SSL_CERT_CACHE_MAX_LEN 16384
+
+typedef struct SSLCertCacheEntry_ {
+    uint32_t hash;
+    uint32_t der_len; /**< 0 if the entry is unused */
+    uint8_t *der;
+    char *subject;
+    char *issuerdn;
+    char *serial;
+    char **sans;
+    uint16_t sans_len;
+    int64_t not_before;
+    int64_t not_after;
+    char *fingerprint; /**< only set once a fingerprint was needed */
+} SSLCertCacheEntry;
+
+typedef struct SSLCertCache_ {
+    SSLCertCacheEntry entries[SSL_CERT_CACHE_SIZE];
+} SSLCertCache;
+
+/** cache of the thread running the parser, set from the parser local
+ *  storage on each call so the certificate decoding doesn't need it passed
+ *  down through all the record parsing functions. */
+static thread_local SSLCertCache *ssl_cert_cache = NULL;
+
+static void SSLCertCacheEntryClear(SSLCertCacheEntry *e)
+{
+    SCFree(e->der);
+    SCFree(e->subject);
+    SCFree(e->issuerdn);
+    SCFree(e->serial);
+    SCFree(e->fingerprint);
+    SSLCertSANsFree(e->sans, e->sans_len);
+    memset(e, 0, sizeof(*e));
+}
+
+static void *SSLLocalStorageAlloc(void)
+{
+    return SCCalloc(1, sizeof(SSLCertCache));
+}
+
+static void SSLLocalStorageFree(void *ptr)
+{
+    SSLCertCache *cache = ptr;
+    if (cache == NULL)
+        return;
+    for (uint32_t i = 0; i < SSL_CERT_CACHE_SIZE; i++) {
+        SSLCertCacheEntryClear(&cache->entries[i]);
+    }
+    if (ssl_cert_cache == cache)
+        ssl_cert_cache = NULL;
+    SCFree(cache);
+}
+
+/** \internal
+ *  \brief store the decoded fields of 'connp' in a cache entry */
+static void SSLCertCacheStore(SSLCertCacheEntry *e, const uint32_t hash, const uint8_t *der,
+        const uint32_t der_len, const SSLStateConnp *connp)
+{
+    SSLCertCacheEntryClear(e);
+
+    e->der = SCMalloc(der_len);
+    e->subject = SCStrdup(connp->cert0_subject);
+    e->issuerdn = SCStrdup(connp->cert0_issuerdn);
+    e->serial = SCStrdup(connp->cert0_serial);
+    e->sans = SSLCertSANsDup(connp->cert0_sans, connp->cert0_sans_len);
+    if (connp->cert0_fingerprint != NULL)
+        e->fingerprint = SCStrdup(connp->cert0_fingerprint);
+    if (e->der == NULL || e->subject == NULL || e->issuerdn == NULL || e->serial == NULL ||
+            e->sans == NULL || (connp->cert0_fingerprint != NULL && e->fingerprint == NULL)) {
+        e->sans_len = connp->cert0_sans_len;
+        SSLCertCacheEntryClear(e);
+        return;
+    }
+    memcpy(e->der, der, der_len);
+    e->sans_len = connp->cert0_sans_len;
+    e->not_before = connp->cert0_not_before;
+    e->not_after = connp->cert0_not_after;
+    e->hash = hash;
+    e->der_len = der_len;
+}
+
+/** \internal
+ *  \brief set the fields of 'connp' from a cache entry
+ *  \retval 0 ok, -1 on allocation failure
+ */
+static int SSLCertCacheLoad(SSLStateConnp *connp, const SSLCertCacheEntry *e)
+{
+    connp->cert0_subject = SCStrdup(e->subject);
+    connp->cert0_issuerdn = SCStrdup(e->issuerdn);
+    connp->cert0_serial = SCStrdup(e->serial);
+    connp->cert0_sans = SSLCertSANsDup(e->sans, e->sans_len);
+    if (connp->cert0_sans != NULL)
+        connp->cert0_sans_len = e->sans_len;
+    connp->cert0_not_before = e->not_before;
+    connp->cert0_not_after = e->not_after;
+    if (connp->cert0_subject == NULL || connp->cert0_issuerdn == NULL ||
+            connp->cert0_serial == NULL || connp->cert0_sans == NULL)
+        return -1;
+    return 0;
+}
+
+/** \internal
+ *  \brief decode the fields of the first certificate of the chain
+ *
+ *  \retval 0 ok, 1 invalid certificate (event set), -1 error
+ */
+static int TlsDecodeHSCertificateFields(SSLState *ssl_state, SSLStateConnp *connp,
+        const uint8_t *input, const uint32_t cert_len, const bool need_fingerprint)
+{
+    uint32_t err_code = 0;
+    int rc;
+
+    SSLCertCacheEntry *e = NULL;
+    uint32_t hash = 0;
+    if (ssl_cert_cache != NULL && cert_len <= SSL_CERT_CACHE_MAX_LEN) {
+        hash = hashlittle_safe(input, cert_len, 0);
+        e = &ssl_cert_cache->entries[hash % SSL_CERT_CACHE_SIZE];
+        if (e->der_len == cert_len && e->hash == hash && memcmp(e->der, input, cert_len) == 0) {
+            if (SSLCertCacheLoad(connp, e) != 0)
+                return -1;
+            if (need_fingerprint) {
+                if (e->fingerprint == NULL) {
+                    if (TlsDecodeHSCertificateFingerprint(connp, input, cert_len) != 0)
+                        return -1;
+                    e->fingerprint = SCStrdup(connp->cert0_fingerprint);
+                } else {
+                    connp->cert0_fingerprint = SCStrdup(e->fingerprint);
+                    if (connp->cert0_fingerprint == NULL)
+                        return -1;
+                }
+            }
+            return 0;
+        }
+    }
+
+    X509 *x509 = SCX509Decode(input, cert_len, &err_code);
+    if (x509 == NULL) {
+        TlsDecodeHSCertificateErrSetEvent(ssl_state, err_code);
+        return 1;
+    }
+
+    char *str = SSLX509String(SCX509GetSubject(x509));
+    if (str == NULL) {
+        err_code = ERR_EXTRACT_SUBJECT;
+        goto error;
+    }
+    connp->cert0_subject = str;
+
+    str = SSLX509String(SCX509GetIssuer(x509));
+    if (str == NULL) {
+        err_code = ERR_EXTRACT_ISSUER;
+        goto error;
+    }
+    connp->cert0_issuerdn = str;
+
+    const uint16_t sans_len = SCX509GetSubjectAltNameLen(x509);
+    char **sans = SCCalloc(sans_len, sizeof(char *));
+    if (sans == NULL) {
+        goto error;
+    }
+    for (uint16_t i = 0; i < sans_len; i++) {
+        sans[i] = SSLX509String(SCX509GetSubjectAltNameAt(x509, i));
+    }
+    connp->cert0_sans = sans;
+    connp->cert0_sans_len = sans_len;
+    str = SSLX509String(SCX509GetSerial(x509));
+    if (str == NULL) {
+        err_code = ERR_INVALID_SERIAL;
+        goto error;
+    }
+    connp->cert0_serial = str;
+
+    rc = SCX509GetValidity(x509, &connp->cert0_not_before, &connp->cert0_not_after);
+    if (rc != 0) {
+        err_code = ERR_EXTRACT_VALIDITY;
+        goto error;
+    }
+
+    SCX509Free(x509);
+    x509 = NULL;
+
+    if (need_fingerprint) {
+        rc = TlsDecodeHSCertificateFingerprint(connp, input, cert_len);
+        if (rc != 0) {
+            SCLogDebug("TlsDecodeHSCertificateFingerprint failed with %d", rc);
+            goto error;
+        }
+    }
+
+    if (e != NULL) {
+        SSLCertCacheStore(e, hash, input, cert_len, connp);
+    }
+    return 0;
+
+error:
+    if (err_code != 0)
+        TlsDecodeHSCertificateErrSetEvent(ssl_state, err_code);
+    if (x509 != NULL)
+        SCX509Free(x509);
+    return -1;
+}
+
 static int TlsDecodeHSCertificate(SSLState *ssl_state, SSLStateConnp *connp,
         const uint8_t *const initial_input, const uint32_t input_len, const int certn)
 {
     const uint8_t *input = (uint8_t *)initial_input;
-    uint32_t err_code = 0;
-    X509 *x509 = NULL;
     int rc = 0;
 
     if (!(HAS_SPACE(3)))
@@ -485,56 +743,26 @@ static int TlsDecodeHSCertificate(SSLState *ssl_state, SSLStateConnp *connp,
 
     /* only store fields from the first certificate in the chain */
     if (certn == 0 && connp->cert0_subject == NULL && connp->cert0_issuerdn == NULL &&
-            connp->cert0_serial == NULL) {
-        x509 = SCX509Decode(input, cert_len, &err_code);
-        if (x509 == NULL) {
-            TlsDecodeHSCertificateErrSetEvent(ssl_state, err_code);
-            goto next;
-        }
-
-        char *str = SCX509GetSubject(x509);
-        if (str == NULL) {
-            err_code = ERR_EXTRACT_SUBJECT;
-            goto error;
-        }
-        connp->cert0_subject = str;
-
-        str = SCX509GetIssuer(x509);
-        if (str == NULL) {
-            err_code = ERR_EXTRACT_ISSUER;
-            goto error;
-        }
-        connp->cert0_issuerdn = str;
-
-        connp->cert0_sans_len = SCX509GetSubjectAltNameLen(x509);
-        char **sans = SCCalloc(connp->cert0_sans_len, sizeof(char *));
-        if (sans == NULL) {
-            goto error;
-        }
-        for (uint16_t i = 0; i < connp->cert0_sans_len; i++) {
-            sans[i] = SCX509GetSubjectAltNameAt(x509, i);
-        }
-        connp->cert0_sans = sans;
-        str = SCX509GetSerial(x509);
-        if (str == NULL) {
-            err_code = ERR_INVALID_SERIAL;
-            goto error;
-        }
-        connp->cert0_serial = str;
-
-        rc = SCX509GetValidity(x509, &connp->cert0_not_before, &connp->cert0_not_after);
-        if (rc != 0) {
-            err_code = ERR_EXTRACT_VALIDITY;
-            goto error;
-        }
-
-        SCX509Free(x509);
-        x509 = NULL;
-
-        rc = TlsDecodeHSCertificateFingerprint(connp, input, cert_len);
-        if (rc != 0) {
-            SCLogDebug("TlsDecodeHSCertificateFingerprint failed with %d", rc);
-            goto error;
+            connp->cert0_serial == NULL && !connp->cert0_decode_skipped) {
+        const bool need_fingerprint = SC_ATOMIC_GET(ssl_config.enable_cert_fingerprint);
+        if (SC_ATOMIC_GET(ssl_config.enable_cert_decode)) {
+            rc = TlsDecodeHSCertificateFields(ssl_state, connp, input, cert_len, need_fingerprint);
+            if (rc == 1) {
+                goto next;
+            } else if (rc != 0) {
+                goto error;
+            }
+        } else {
+            /* no rule or logger needs the decoded fields, only keep the raw
+             * certificate in the chain */
+            connp->cert0_decode_skipped = true;
+            if (need_fingerprint) {
+                rc = TlsDecodeHSCertificateFingerprint(connp, input, cert_len);
+                if (rc != 0) {
+                    SCLogDebug("TlsDecodeHSCertificateFingerprint failed with %d", rc);
+                    goto error;
+                }
+            }
         }
     }
 
@@ -549,11 +777,6 @@ next:
     return (int)(input - initial_input);
 
 error:
-    if (err_code != 0)
-        TlsDecodeHSCertificateErrSetEvent(ssl_state, err_code);
-    if (x509 != NULL)
-        SCX509Free(x509);
-
     SSLStateCertSANFree(connp);
     return -1;
 
@@ -2781,14 +3004,15 @@ static AppLayerResult SSLDecode(Flow *f, uint8_t direction, void *alstate,
         counter++;
     } /* while (input_len) */
 
-    /* mark handshake as done if we have subject and issuer */
+    /* mark handshake as done if we have subject and issuer, or if we got the
+     * certificate but didn't need to decode it */
     if ((ssl_state->flags & SSL_AL_FLAG_NEED_CLIENT_CERT) &&
-            ssl_state->client_connp.cert0_subject && ssl_state->client_connp.cert0_issuerdn) {
+            SSLCert0Done(&ssl_state->client_connp)) {
         /* update both sides to keep existing behavior */
         UpdateClientState(ssl_state, TLS_STATE_CLIENT_HANDSHAKE_DONE);
         UpdateServerState(ssl_state, TLS_STATE_SERVER_HANDSHAKE_DONE);
     } else if ((ssl_state->flags & SSL_AL_FLAG_NEED_CLIENT_CERT) == 0 &&
-               ssl_state->server_connp.cert0_subject && ssl_state->server_connp.cert0_issuerdn) {
+               SSLCert0Done(&ssl_state->server_connp)) {
         /* update both sides to keep existing behavior */
         UpdateClientState(ssl_state, TLS_STATE_CLIENT_HANDSHAKE_DONE);
         UpdateServerState(ssl_state, TLS_STATE_SERVER_HANDSHAKE_DONE);
@@ -2808,12 +3032,14 @@ static AppLayerResult SSLDecode(Flow *f, uint8_t direction, void *alstate,
 static AppLayerResult SSLParseClientRecord(Flow *f, void *alstate, AppLayerParserState *pstate,
         StreamSlice stream_slice, void *local_data)
 {
+    ssl_cert_cache = local_data;
     return SSLDecode(f, 0 /* toserver */, alstate, pstate, stream_slice);
 }
 
 static AppLayerResult SSLParseServerRecord(Flow *f, void *alstate, AppLayerParserState *pstate,
         StreamSlice stream_slice, void *local_data)
 {
+    ssl_cert_cache = local_data;
     return SSLDecode(f, 1 /* toclient */, alstate, pstate, stream_slice);
 }
 
@@ -2840,12 +3066,9 @@ static void *SSLStateAlloc(void *orig_state, AppProto proto_orig)
 
 static void SSLStateCertSANFree(SSLStateConnp *connp)
 {
-    if (connp->cert0_sans) {
-        for (uint16_t i = 0; i < connp->cert0_sans_len; i++) {
-            SCRustCStringFree(connp->cert0_sans[i]);
-        }
-        SCFree(connp->cert0_sans);
-    }
+    SSLCertSANsFree(connp->cert0_sans, connp->cert0_sans_len);
+    connp->cert0_sans = NULL;
+    connp->cert0_sans_len = 0;
 }
 
 /**
@@ -2858,11 +3081,11 @@ static void SSLStateFree(void *p)
     SSLCertsChain *item;
 
     if (ssl_state->client_connp.cert0_subject)
-        SCRustCStringFree(ssl_state->client_connp.cert0_subject);
+        SCFree(ssl_state->client_connp.cert0_subject);
     if (ssl_state->client_connp.cert0_issuerdn)
-        SCRustCStringFree(ssl_state->client_connp.cert0_issuerdn);
+        SCFree(ssl_state->client_connp.cert0_issuerdn);
     if (ssl_state->client_connp.cert0_serial)
-        SCRustCStringFree(ssl_state->client_connp.cert0_serial);
+        SCFree(ssl_state->client_connp.cert0_serial);
     if (ssl_state->client_connp.cert0_fingerprint)
         SCFree(ssl_state->client_connp.cert0_fingerprint);
     if (ssl_state->client_connp.sni)
@@ -2873,11 +3096,11 @@ static void SSLStateFree(void *p)
         SCFree(ssl_state->client_connp.hs_buffer);
 
     if (ssl_state->server_connp.cert0_subject)
-        SCRustCStringFree(ssl_state->server_connp.cert0_subject);
+        SCFree(ssl_state->server_connp.cert0_subject);
     if (ssl_state->server_connp.cert0_issuerdn)
-        SCRustCStringFree(ssl_state->server_connp.cert0_issuerdn);
+        SCFree(ssl_state->server_connp.cert0_issuerdn);
     if (ssl_state->server_connp.cert0_serial)
-        SCRustCStringFree(ssl_state->server_connp.cert0_serial);
+        SCFree(ssl_state->server_connp.cert0_serial);
     if (ssl_state->server_connp.cert0_fingerprint)
         SCFree(ssl_state->server_connp.cert0_fingerprint);
     if (ssl_state->server_connp.sni)
@@ -2986,6 +3209,12 @@ static int SSLStateGetEventInfo(
 {
     if (SCAppLayerGetEventIdByName(event_name, tls_decoder_event_table, event_id) == 0) {
         *event_type = APP_LAYER_EVENT_TYPE_TRANSACTION;
+        /* the certificate events are set by the certificate decoder, so a
+         * rule using them needs it enabled */
+        if (*event_id >= TLS_DECODER_EVENT_INVALID_CERTIFICATE &&
+                *event_id <= TLS_DECODER_EVENT_CERTIFICATE_INVALID_VALIDITY) {
+            SSLEnableCertDecoding();
+        }
         return 0;
     }
     return -1;
@@ -3182,6 +3411,24 @@ static void CheckJA4Enabled(void)
 }
 #endif /* HAVE_JA4 */
 
+static void CheckCertDecodingEnabled(void)
+{
+    const char *strval = NULL;
+    /* by default the first certificate is only decoded if a rule, logger or
+     * Lua script uses its fields. "always" restores unconditional decoding. */
+    if (SCConfGet("app-layer.protocols.tls.certificate-decoding", &strval) == 1 &&
+            strval != NULL) {
+        if (strcmp(strval, "always") == 0) {
+            SC_ATOMIC_SET(ssl_config.enable_cert_decode, 1);
+            SC_ATOMIC_SET(ssl_config.enable_cert_fingerprint, 1);
+        } else if (strcmp(strval, "auto") != 0) {
+            SCLogWarning("app-layer.protocols.tls.certificate-decoding: invalid value \"%s\", "
+                         "using \"auto\"",
+                    strval);
+        }
+    }
+}
+
 /**
  * \brief Function to register the SSL protocol parser and other functions
  */
@@ -3190,6 +3437,8 @@ void RegisterSSLParsers(void)
     const char *proto_name = "tls";
 
     SC_ATOMIC_INIT(ssl_config.enable_ja3);
+    SC_ATOMIC_INIT(ssl_config.enable_cert_decode);
+    SC_ATOMIC_INIT(ssl_config.enable_cert_fingerprint);
 
     /** SSLv2  and SSLv23*/
     if (SCAppLayerProtoDetectConfProtoDetectionEnabled("tcp", proto_name)) {
@@ -3230,6 +3479,8 @@ void RegisterSSLParsers(void)
         AppLayerParserRegisterGetEventInfoById(IPPROTO_TCP, ALPROTO_TLS, SSLStateGetEventInfoById);
 
         AppLayerParserRegisterStateFuncs(IPPROTO_TCP, ALPROTO_TLS, SSLStateAlloc, SSLStateFree);
+        AppLayerParserRegisterLocalStorageFunc(
+                IPPROTO_TCP, ALPROTO_TLS, SSLLocalStorageAlloc, SSLLocalStorageFree);
 
         SCAppLayerParserRegisterParserAcceptableDataDirection(
                 IPPROTO_TCP, ALPROTO_TLS, STREAM_TOSERVER);
@@ -3285,6 +3536,7 @@ void RegisterSSLParsers(void)
 #ifdef HAVE_JA4
         CheckJA4Enabled();
 #endif /* HAVE_JA4 */
+        CheckCertDecodingEnabled();
 
         if (g_disable_hashing) {
             if (SC_ATOMIC_GET(ssl_config.enable_ja3)) {
@@ -3370,3 +3622,30 @@ bool SSLJA4IsEnabled(void)
 {
     return SC_ATOMIC_GET(ssl_config.enable_ja4);
 }
+
+/**
+ * \brief enable decoding of the subject, issuer, serial, SANs and validity
+ *        of the first certificate of the chain
+ *
+ * Called by the rules, loggers and Lua scripts that use these fields.
+ * Implemented using atomic to allow rule reloads to do this at runtime.
+ */
+void SSLEnableCertDecoding(void)
+{
+    if (SC_ATOMIC_GET(ssl_config.enable_cert_decode)) {
+        return;
+    }
+    SC_ATOMIC_SET(ssl_config.enable_cert_decode, 1);
+}
+
+/**
+ * \brief enable computing the fingerprint of the first certificate of the
+ *        chain
+ */
+void SSLEnableCertFingerprint(void)
+{
+    if (SC_ATOMIC_GET(ssl_config.enable_cert_fingerprint)) {
+        return;
+    }
+    SC_ATOMIC_SET(ssl_config.enable_cert_fingerprint, 1);
+}
@@ -193,6 +193,9 @@ typedef struct SSLStateConnp_ {
 
     char **cert0_sans;
     uint16_t cert0_sans_len;
+    /** the first certificate was seen, but its fields were not decoded
+     *  as no rule or logger uses them */
+    bool cert0_decode_skipped;
     /* ssl server name indication extension */
     char *sni;
 
@@ -254,5 +257,15 @@ void SSLEnableJA3(void);
 bool SSLJA3IsEnabled(void);
 void SSLEnableJA4(void);
 bool SSLJA4IsEnabled(void);
+void SSLEnableCertDecoding(void);
+void SSLEnableCertFingerprint(void);
+
+/** \brief check if the first certificate of a direction was seen, whether
+ *         or not its fields were decoded */
+static inline bool SSLCert0Done(const SSLStateConnp *connp)
+{
+    return (connp->cert0_subject != NULL && connp->cert0_issuerdn != NULL) ||
+           connp->cert0_decode_skipped;
+}
 
 #endif /* SURICATA_APP_LAYER_SSL_H */
@@ -50,6 +50,7 @@
 #include "decode-events.h"
 #include "app-layer-htp-mem.h"
 #include "util-exception-policy.h"
+#include "util-slab.h"
 
 extern bool g_stats_eps_per_app_proto_errors;
 /**
@@ -1138,6 +1139,7 @@ void AppLayerDestroyCtxThread(AppLayerThreadCtx *app_tctx)
     if (app_tctx->alp_tctx != NULL)
         AppLayerParserThreadCtxFree(app_tctx->alp_tctx);
     SCFree(app_tctx);
+    SCSlabThreadCleanup();
 
     SCReturn;
 }
@@ -1169,6 +1171,7 @@ void AppLayerRegisterGlobalCounters(void)
     StatsRegisterGlobalCounter("ippair.memcap", IPPairGetMemcap);
     StatsRegisterGlobalCounter("host.memuse", HostGetMemuse);
     StatsRegisterGlobalCounter("host.memcap", HostGetMemcap);
+    SCSlabRegisterCounters();
 }
 
 static bool IsAppLayerErrorExceptionPolicyStatsValid(enum ExceptionPolicy policy)
@@ -49,4 +49,6 @@
 #include "app-layer-detect-proto.h"
 #include "app-layer-parser.h"
 
+#include "util-slab.h"
+
 #endif
@@ -0,0 +1,874 @@
+/* Copyright (C) 2026 Open Information Security Foundation
+ *
+ * You can copy, redistribute or modify this Program under the terms of
+ * the GNU General Public License version 2 as published by the Free
+ * Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * version 2 along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+/**
+ * \file
+ *
+ * OpenMetrics (Prometheus) exporter for the engine stats.
+ *
+ * A management thread serves the stats table the stats thread produces
+ * every interval over HTTP, on a TCP or unix socket. Metric names and
+ * labels are built once, the text is rendered into a buffer that is
+ * reused for every scrape. Packet threads are not involved at all.
+ */
+
+#include "suricata-common.h"
+#include "counters.h"
+#include "counters-openmetrics.h"
+#include "output-stats.h"
+#include "conf.h"
+#include "runmodes.h"
+#include "tm-threads.h"
+#include "util-buffer.h"
+#include "util-privs.h"
+#include "util-unittest.h"
+
+#if defined(BUILD_UNIX_SOCKET) && defined(HAVE_SYS_UN_H) && defined(HAVE_SYS_STAT_H) && defined(HAVE_SYS_TYPES_H)
+#include <sys/un.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+
+// MSG_NOSIGNAL does not exists on OS X
+#ifdef OS_DARWIN
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL SO_NOSIGPIPE
+#endif
+#endif
+#endif
+
+#define OPENMETRICS_LISTEN_DEFAULT "127.0.0.1:9464"
+#define OPENMETRICS_PREFIX         "suricata_"
+#define OPENMETRICS_CONTENT_TYPE   "application/openmetrics-text; version=1.0.0; charset=utf-8"
+#define OPENMETRICS_REQ_MAX        1024
+#define OPENMETRICS_BUF_INIT       65536
+/** poll timeout in ms, bounds how long shutdown can take */
+#define OPENMETRICS_POLL_MS 200
+
+/** suffix of the metric names of the per thread series */
+#define OPENMETRICS_THREAD_SUFFIX "_thread"
+
+/** precomputed metric name of a counter */
+typedef struct OpenMetricsCounter_ {
+    /** counter name the metric name was built from */
+    char *src;
+    char *name;
+    uint16_t name_len;
+    /** name clashes with an earlier counter, not exported */
+    bool skip;
+} OpenMetricsCounter;
+
+typedef struct OpenMetricsCtx_ {
+    int fd;
+    /** unix socket path to remove on shutdown, or NULL */
+    char *unix_path;
+    /** add per thread series, as '<name>_thread' metrics */
+    bool threads;
+
+    /* name caches, sized on the first scrape */
+    uint32_t nstats;
+    uint32_t ntstats;
+    OpenMetricsCounter *counters;
+    /** thread names and their escaped version, per thread in the stats
+     *  table */
+    char **thread_names;
+    char **thread_labels;
+
+    /** output buffer, reused across scrapes */
+    MemBuffer *buf;
+    bool render_ok;
+} OpenMetricsCtx;
+
+bool StatsOpenMetricsEnabled(void)
+{
+    int enabled = 0;
+    if (SCConfGetBool("stats.openmetrics.enabled", &enabled) != 1)
+        return false;
+    return enabled == 1;
+}
+
+/** \internal
+ *  \brief turn a counter name into a metric name: "suricata_" followed by
+ *         the name with every char outside [a-zA-Z0-9_] replaced by '_'
+ */
+static int OpenMetricsCounterSetup(OpenMetricsCounter *m, const char *name)
+{
+    const size_t plen = strlen(OPENMETRICS_PREFIX);
+    const size_t len = strlen(name);
+    if (plen + len + strlen(OPENMETRICS_THREAD_SUFFIX) > UINT16_MAX)
+        return -1;
+
+    m->src = SCStrdup(name);
+    if (m->src == NULL)
+        return -1;
+    m->name = SCMalloc(plen + len + 1);
+    if (m->name == NULL) {
+        SCFree(m->src);
+        m->src = NULL;
+        return -1;
+    }
+    memcpy(m->name, OPENMETRICS_PREFIX, plen);
+    for (size_t i = 0; i < len; i++) {
+        const char c = name[i];
+        m->name[plen + i] = isalnum((unsigned char)c) ? c : '_';
+    }
+    m->name[plen + len] = '\0';
+    m->name_len = (uint16_t)(plen + len);
+    m->skip = false;
+    return 0;
+}
+
+static void OpenMetricsCounterFree(OpenMetricsCounter *m)
+{
+    SCFree(m->src);
+    SCFree(m->name);
+    memset(m, 0, sizeof(*m));
+}
+
+/** metric name of a counter, or of its per thread series */
+typedef struct OpenMetricsName_ {
+    const char *name;
+    uint16_t len;
+    bool thread; /**< name is followed by OPENMETRICS_THREAD_SUFFIX */
+    uint32_t idx;
+} OpenMetricsName;
+
+static inline char OpenMetricsNameChar(const OpenMetricsName *n, const size_t i)
+{
+    if (i < n->len)
+        return n->name[i];
+    if (n->thread && i - n->len < sizeof(OPENMETRICS_THREAD_SUFFIX) - 1)
+        return OPENMETRICS_THREAD_SUFFIX[i - n->len];
+    return '\0';
+}
+
+static int OpenMetricsNameCompare(const void *a, const void *b)
+{
+    const OpenMetricsName *n0 = a;
+    const OpenMetricsName *n1 = b;
+    for (size_t i = 0;; i++) {
+        const char c0 = OpenMetricsNameChar(n0, i);
+        const char c1 = OpenMetricsNameChar(n1, i);
+        if (c0 != c1)
+            return (unsigned char)c0 < (unsigned char)c1 ? -1 : 1;
+        if (c0 == '\0')
+            break;
+    }
+    /* same name: the first counter in the table wins */
+    return n0->idx < n1->idx ? -1 : (n0->idx > n1->idx ? 1 : 0);
+}
+
+/** \internal
+ *  \brief find counters that map to the same metric name
+ *
+ *  Sanitizing the names can map different counters to the same metric,
+ *  e.g. 'a.b_c' and 'a_b.c'. The first one in the table is exported, the
+ *  others are skipped with a warning.
+ */
+static int OpenMetricsCheckCollisions(OpenMetricsCtx *ctx, const StatsTable *st)
+{
+    const uint32_t per = ctx->threads ? 2 : 1;
+    OpenMetricsName *names = SCCalloc((size_t)st->nstats * per, sizeof(*names));
+    if (names == NULL)
+        return -1;
+    uint32_t cnt = 0;
+    for (uint32_t c = 0; c < st->nstats; c++) {
+        OpenMetricsCounter *m = &ctx->counters[c];
+        if (m->name == NULL)
+            continue;
+        m->skip = false;
+        names[cnt++] = (OpenMetricsName){ m->name, m->name_len, false, c };
+        if (ctx->threads)
+            names[cnt++] = (OpenMetricsName){ m->name, m->name_len, true, c };
+    }
+    qsort(names, cnt, sizeof(*names), OpenMetricsNameCompare);
+
+    uint32_t first = 0;
+    for (uint32_t i = 1; i < cnt; i++) {
+        const OpenMetricsName key = { names[i].name, names[i].len, names[i].thread,
+            names[first].idx };
+        if (OpenMetricsNameCompare(&names[first], &key) != 0) {
+            first = i;
+            continue;
+        }
+        OpenMetricsCounter *m = &ctx->counters[names[i].idx];
+        if (!m->skip) {
+            m->skip = true;
+            SCLogWarning("openmetrics: counter \"%s\" maps to the same metric name as "
+                         "\"%s\", not exporting it",
+                    st->stats[names[i].idx].name, st->stats[names[first].idx].name);
+        }
+    }
+    SCFree(names);
+    return 0;
+}
+
+/** \internal
+ *  \brief escape a string for use as a label value */
+static char *OpenMetricsLabelEscape(const char *s)
+{
+    const size_t len = strlen(s);
+    char *e = SCMalloc(len * 2 + 1);
+    if (e == NULL)
+        return NULL;
+    size_t o = 0;
+    for (size_t i = 0; i < len; i++) {
+        if (s[i] == '\\' || s[i] == '"') {
+            e[o++] = '\\';
+            e[o++] = s[i];
+        } else if (s[i] == '\n') {
+            e[o++] = '\\';
+            e[o++] = 'n';
+        } else {
+            e[o++] = s[i];
+        }
+    }
+    e[o] = '\0';
+    return e;
+}
+
+static void OpenMetricsThreadLabelFree(OpenMetricsCtx *ctx, uint32_t t)
+{
+    SCFree(ctx->thread_names[t]);
+    SCFree(ctx->thread_labels[t]);
+    ctx->thread_names[t] = NULL;
+    ctx->thread_labels[t] = NULL;
+}
+
+static void OpenMetricsCacheFree(OpenMetricsCtx *ctx)
+{
+    if (ctx->counters != NULL) {
+        for (uint32_t c = 0; c < ctx->nstats; c++) {
+            OpenMetricsCounterFree(&ctx->counters[c]);
+        }
+        SCFree(ctx->counters);
+        ctx->counters = NULL;
+    }
+    if (ctx->thread_labels != NULL) {
+        for (uint32_t t = 0; t < ctx->ntstats; t++) {
+            OpenMetricsThreadLabelFree(ctx, t);
+        }
+    }
+    SCFree(ctx->thread_names);
+    SCFree(ctx->thread_labels);
+    ctx->thread_names = NULL;
+    ctx->thread_labels = NULL;
+    ctx->nstats = ctx->ntstats = 0;
+}
+
+/** \internal
+ *  \brief make sure we have names and labels for everything in the table
+ *
+ *  The cache is keyed on the counter and thread names, not only on the
+ *  table size, so a different set of counters of the same size gets new
+ *  metric names. The table layout is fixed after the first stats interval,
+ *  so after the first scrape this only compares the names.
+ */
+static int OpenMetricsCacheUpdate(OpenMetricsCtx *ctx, const StatsTable *st)
+{
+    if (ctx->nstats != st->nstats || ctx->ntstats != st->ntstats) {
+        OpenMetricsCacheFree(ctx);
+        ctx->counters = SCCalloc(st->nstats, sizeof(OpenMetricsCounter));
+        if (st->ntstats > 0) {
+            ctx->thread_names = SCCalloc(st->ntstats, sizeof(char *));
+            ctx->thread_labels = SCCalloc(st->ntstats, sizeof(char *));
+        }
+        if (ctx->counters == NULL ||
+                (st->ntstats > 0 && (ctx->thread_names == NULL || ctx->thread_labels == NULL))) {
+            OpenMetricsCacheFree(ctx);
+            return -1;
+        }
+        ctx->nstats = st->nstats;
+        ctx->ntstats = st->ntstats;
+    }
+
+    bool changed = false;
+    for (uint32_t c = 0; c < st->nstats; c++) {
+        OpenMetricsCounter *m = &ctx->counters[c];
+        const char *name = st->stats[c].name;
+        if (m->src != NULL && (name == NULL || strcmp(m->src, name) != 0)) {
+            OpenMetricsCounterFree(m);
+            changed = true;
+        }
+        if (m->src == NULL && name != NULL) {
+            if (OpenMetricsCounterSetup(m, name) != 0)
+                return -1;
+            changed = true;
+        }
+    }
+    if (changed && OpenMetricsCheckCollisions(ctx, st) != 0)
+        return -1;
+    if (!ctx->threads)
+        return 0;
+
+    for (uint32_t t = 0; t < st->ntstats; t++) {
+        const char *tm_name = NULL;
+        for (uint32_t c = 0; c < st->nstats; c++) {
+            const StatsRecord *r = &st->tstats[t * st->nstats + c];
+            if (r->name != NULL && r->tm_name != NULL) {
+                tm_name = r->tm_name;
+                break;
+            }
+        }
+        if (ctx->thread_names[t] != NULL &&
+                (tm_name == NULL || strcmp(ctx->thread_names[t], tm_name) != 0)) {
+            OpenMetricsThreadLabelFree(ctx, t);
+        }
+        if (ctx->thread_names[t] == NULL && tm_name != NULL) {
+            ctx->thread_names[t] = SCStrdup(tm_name);
+            ctx->thread_labels[t] = OpenMetricsLabelEscape(tm_name);
+            if (ctx->thread_names[t] == NULL || ctx->thread_labels[t] == NULL) {
+                OpenMetricsThreadLabelFree(ctx, t);
+                return -1;
+            }
+        }
+    }
+    return 0;
+}
+
+static void OpenMetricsWrite(OpenMetricsCtx *ctx, const char *s, uint32_t len)
+{
+    if (!ctx->render_ok)
+        return;
+    /* MemBufferWriteRaw() keeps room for a terminating NUL */
+    if (MEMBUFFER_OFFSET(ctx->buf) + len + 1 > MEMBUFFER_SIZE(ctx->buf)) {
+        if (MemBufferExpand(&ctx->buf, MAX(len + 1, MEMBUFFER_SIZE(ctx->buf))) != 0) {
+            ctx->render_ok = false;
+            return;
+        }
+    }
+    MemBufferWriteRaw(ctx->buf, (const uint8_t *)s, len);
+}
+
+#define OpenMetricsWriteLit(ctx, s) OpenMetricsWrite((ctx), (s), (uint32_t)(sizeof(s) - 1))
+
+static void OpenMetricsWriteType(OpenMetricsCtx *ctx, const OpenMetricsCounter *m, bool thread)
+{
+    /* counters can be 'set' as well as incremented, so we can't
+     * tell counters from gauges */
+    OpenMetricsWriteLit(ctx, "# TYPE ");
+    OpenMetricsWrite(ctx, m->name, m->name_len);
+    if (thread)
+        OpenMetricsWriteLit(ctx, OPENMETRICS_THREAD_SUFFIX);
+    OpenMetricsWriteLit(ctx, " unknown\n");
+}
+
+static void OpenMetricsWriteSample(OpenMetricsCtx *ctx, const OpenMetricsCounter *m,
+        const char *thread, int64_t value)
+{
+    char num[32];
+    const int nlen = snprintf(num, sizeof(num), " %" PRId64 "\n", value);
+
+    OpenMetricsWrite(ctx, m->name, m->name_len);
+    if (thread != NULL) {
+        OpenMetricsWriteLit(ctx, OPENMETRICS_THREAD_SUFFIX "{thread=\"");
+        OpenMetricsWrite(ctx, thread, (uint32_t)strlen(thread));
+        OpenMetricsWriteLit(ctx, "\"}");
+    }
+    OpenMetricsWrite(ctx, num, (uint32_t)nlen);
+}
+
+/** \internal
+ *  \brief render the stats table, called with the stats table locked */
+static void OpenMetricsRender(const StatsTable *st, void *data)
+{
+    OpenMetricsCtx *ctx = data;
+
+    MemBufferReset(ctx->buf);
+    ctx->render_ok = true;
+    if (OpenMetricsCacheUpdate(ctx, st) != 0) {
+        ctx->render_ok = false;
+        return;
+    }
+
+    for (uint32_t c = 0; c < st->nstats; c++) {
+        const OpenMetricsCounter *m = &ctx->counters[c];
+        if (m->name == NULL || m->skip)
+            continue;
+
+        OpenMetricsWriteType(ctx, m, false);
+        OpenMetricsWriteSample(ctx, m, NULL, st->stats[c].value);
+
+        /* per thread values are a separate metric, so that summing
+         * a metric doesn't count the values twice */
+        if (!ctx->threads)
+            continue;
+        OpenMetricsWriteType(ctx, m, true);
+        for (uint32_t t = 0; t < st->ntstats; t++) {
+            const StatsRecord *r = &st->tstats[t * st->nstats + c];
+            if (r->name == NULL || ctx->thread_labels[t] == NULL)
+                continue;
+            OpenMetricsWriteSample(ctx, m, ctx->thread_labels[t], r->value);
+        }
+    }
+    OpenMetricsWriteLit(ctx, "# EOF\n");
+}
+
+static void OpenMetricsCtxFree(OpenMetricsCtx *ctx)
+{
+    if (ctx == NULL)
+        return;
+    if (ctx->fd != -1)
+        close(ctx->fd);
+    if (ctx->unix_path != NULL) {
+        (void)unlink(ctx->unix_path);
+        SCFree(ctx->unix_path);
+    }
+    OpenMetricsCacheFree(ctx);
+    if (ctx->buf != NULL)
+        MemBufferFree(ctx->buf);
+    SCFree(ctx);
+}
+
+static OpenMetricsCtx *OpenMetricsCtxAlloc(void)
+{
+    OpenMetricsCtx *ctx = SCCalloc(1, sizeof(*ctx));
+    if (ctx == NULL)
+        return NULL;
+    ctx->fd = -1;
+    ctx->buf = MemBufferCreateNew(OPENMETRICS_BUF_INIT);
+    if (ctx->buf == NULL) {
+        SCFree(ctx);
+        return NULL;
+    }
+    return ctx;
+}
+
+#if defined(BUILD_UNIX_SOCKET) && defined(HAVE_SYS_UN_H) && defined(HAVE_SYS_STAT_H) && defined(HAVE_SYS_TYPES_H)
+
+static OpenMetricsCtx *om_ctx = NULL;
+
+static void OpenMetricsSendAll(int fd, const uint8_t *data, size_t len)
+{
+    while (len > 0) {
+        ssize_t r = send(fd, data, len, MSG_NOSIGNAL);
+        if (r < 0 && errno == EINTR)
+            continue;
+        if (r <= 0)
+            return;
+        data += r;
+        len -= (size_t)r;
+    }
+}
+
+static void OpenMetricsReply(int fd, const char *status, const char *ctype, const uint8_t *body,
+        uint32_t body_len)
+{
+    char hdr[256];
+    const int hlen = snprintf(hdr, sizeof(hdr),
+            "HTTP/1.1 %s\r\nContent-Type: %s\r\nContent-Length: %u\r\n"
+            "Connection: close\r\n\r\n",
+            status, ctype, body_len);
+    OpenMetricsSendAll(fd, (const uint8_t *)hdr, (size_t)hlen);
+    OpenMetricsSendAll(fd, body, body_len);
+}
+
+#define OpenMetricsReplyText(fd, status, msg)                                                      \
+    OpenMetricsReply((fd), (status), "text/plain", (const uint8_t *)(msg),                         \
+            (uint32_t)(sizeof(msg) - 1))
+
+/** \internal
+ *  \brief handle a single HTTP request on a connected socket */
+static void OpenMetricsServeClient(OpenMetricsCtx *ctx, int fd)
+{
+    struct timeval tmo = { .tv_sec = 1, .tv_usec = 0 };
+    (void)setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tmo, sizeof(tmo));
+    (void)setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tmo, sizeof(tmo));
+
+    char req[OPENMETRICS_REQ_MAX];
+    size_t len = 0;
+    req[0] = '\0';
+    while (len < sizeof(req) - 1) {
+        ssize_t r = recv(fd, req + len, sizeof(req) - 1 - len, 0);
+        if (r < 0 && errno == EINTR)
+            continue;
+        if (r <= 0)
+            return;
+        len += (size_t)r;
+        req[len] = '\0';
+        if (strstr(req, "\r\n\r\n") != NULL || strstr(req, "\n\n") != NULL)
+            break;
+    }
+
+    if (strncmp(req, "GET ", 4) != 0) {
+        OpenMetricsReplyText(fd, "405 Method Not Allowed", "method not allowed\n");
+        return;
+    }
+    const char *path = req + 4;
+    const size_t plen = strcspn(path, " ?\r\n");
+    if (!((plen == 1 && path[0] == '/') || (plen == 8 && strncmp(path, "/metrics", 8) == 0))) {
+        OpenMetricsReplyText(fd, "404 Not Found", "not found\n");
+        return;
+    }
+
+    if (!StatsTableRun(OpenMetricsRender, ctx)) {
+        OpenMetricsReplyText(fd, "503 Service Unavailable", "stats not yet synchronized\n");
+        return;
+    }
+    if (!ctx->render_ok) {
+        OpenMetricsReplyText(fd, "500 Internal Server Error", "out of memory\n");
+        return;
+    }
+    OpenMetricsReply(fd, "200 OK", OPENMETRICS_CONTENT_TYPE, MEMBUFFER_BUFFER(ctx->buf),
+            MEMBUFFER_OFFSET(ctx->buf));
+}
+
+static int OpenMetricsListenUnix(OpenMetricsCtx *ctx, const char *path)
+{
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    if (strlen(path) >= sizeof(addr.sun_path)) {
+        SCLogError("openmetrics: unix socket path '%s' too long", path);
+        return -1;
+    }
+    addr.sun_family = AF_UNIX;
+    strlcpy(addr.sun_path, path, sizeof(addr.sun_path));
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd == -1) {
+        SCLogError("openmetrics: unable to create unix socket: %s", strerror(errno));
+        return -1;
+    }
+    (void)unlink(path);
+    if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) == -1) {
+        SCLogError("openmetrics: bind(%s) error: %s", path, strerror(errno));
+        close(fd);
+        return -1;
+    }
+    if (chmod(path, S_IRUSR | S_IWUSR | S_IRGRP | S_IWGRP) == -1) {
+        SCLogWarning("openmetrics: unable to change permission on socket: %s", strerror(errno));
+    }
+    ctx->unix_path = SCStrdup(path);
+    return fd;
+}
+
+static int OpenMetricsListenTcp(const char *listen)
+{
+    char host[256];
+    if (strlcpy(host, listen, sizeof(host)) >= sizeof(host)) {
+        SCLogError("openmetrics: invalid listen address '%s'", listen);
+        return -1;
+    }
+    char *port = strrchr(host, ':');
+    if (port == NULL || port[1] == '\0') {
+        SCLogError("openmetrics: listen address '%s' needs to be <address>:<port> or a "
+                   "unix socket path",
+                listen);
+        return -1;
+    }
+    *port++ = '\0';
+    char *addr = host;
+    /* [ipv6]:port */
+    if (addr[0] == '[') {
+        addr++;
+        char *end = strchr(addr, ']');
+        if (end != NULL)
+            *end = '\0';
+    }
+
+    struct addrinfo hints;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_flags = AI_PASSIVE | AI_NUMERICHOST | AI_NUMERICSERV;
+    struct addrinfo *res = NULL;
+    int r = getaddrinfo(addr, port, &hints, &res);
+    if (r != 0) {
+        SCLogError("openmetrics: invalid listen address '%s': %s", listen, gai_strerror(r));
+        return -1;
+    }
+
+    int fd = socket(res->ai_family, res->ai_socktype, res->ai_protocol);
+    if (fd == -1) {
+        SCLogError("openmetrics: unable to create socket: %s", strerror(errno));
+        freeaddrinfo(res);
+        return -1;
+    }
+    int on = 1;
+    (void)setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+    if (bind(fd, res->ai_addr, res->ai_addrlen) == -1) {
+        SCLogError("openmetrics: bind(%s) error: %s", listen, strerror(errno));
+        close(fd);
+        freeaddrinfo(res);
+        return -1;
+    }
+    freeaddrinfo(res);
+    return fd;
+}
+
+static void *StatsOpenMetricsThread(void *arg)
+{
+    ThreadVars *tv_local = (ThreadVars *)arg;
+    OpenMetricsCtx *ctx = om_ctx;
+
+    SCSetThreadName(tv_local->name);
+
+    if (tv_local->thread_setup_flags != 0)
+        TmThreadSetupOptions(tv_local);
+
+    /* Set the threads capability */
+    tv_local->cap_flags = 0;
+    SCDropCaps(tv_local);
+
+    TmThreadsSetFlag(tv_local, THV_INIT_DONE | THV_RUNNING);
+    bool run = TmThreadsWaitForUnpause(tv_local);
+    while (run) {
+        struct pollfd pfd = { .fd = ctx->fd, .events = POLLIN, .revents = 0 };
+        int r = poll(&pfd, 1, OPENMETRICS_POLL_MS);
+        if (r > 0 && (pfd.revents & POLLIN)) {
+            int cfd = accept(ctx->fd, NULL, NULL);
+            if (cfd >= 0) {
+                OpenMetricsServeClient(ctx, cfd);
+                close(cfd);
+            }
+        }
+
+        if (TmThreadsCheckFlag(tv_local, THV_KILL)) {
+            break;
+        }
+    }
+
+    TmThreadsSetFlag(tv_local, THV_RUNNING_DONE);
+    TmThreadWaitForFlag(tv_local, THV_DEINIT);
+
+    om_ctx = NULL;
+    OpenMetricsCtxFree(ctx);
+
+    TmThreadsSetFlag(tv_local, THV_CLOSED);
+    return NULL;
+}
+
+/**
+ * \brief set up the listener and spawn the exporter thread, if enabled
+ *
+ * Called when spawning the stats threads. Failing to set up the listener
+ * is logged but not fatal.
+ */
+void StatsOpenMetricsSpawnThread(void)
+{
+    if (!StatsOpenMetricsEnabled())
+        return;
+
+    const char *listen_addr = NULL;
+    if (SCConfGet("stats.openmetrics.listen", &listen_addr) != 1 || listen_addr == NULL) {
+        listen_addr = OPENMETRICS_LISTEN_DEFAULT;
+    }
+
+    OpenMetricsCtx *ctx = OpenMetricsCtxAlloc();
+    if (ctx == NULL) {
+        SCLogError("openmetrics: failed to allocate exporter context");
+        return;
+    }
+    int threads = 0;
+    if (SCConfGetBool("stats.openmetrics.threads", &threads) == 1)
+        ctx->threads = threads == 1;
+
+    if (listen_addr[0] == '/') {
+        ctx->fd = OpenMetricsListenUnix(ctx, listen_addr);
+    } else {
+        ctx->fd = OpenMetricsListenTcp(listen_addr);
+    }
+    if (ctx->fd == -1) {
+        OpenMetricsCtxFree(ctx);
+        return;
+    }
+    /* accept() must not block if a client went away after poll() */
+    int flags = fcntl(ctx->fd, F_GETFL, 0);
+    if (flags == -1 || fcntl(ctx->fd, F_SETFL, flags | O_NONBLOCK) == -1 ||
+            listen(ctx->fd, 16) == -1) {
+        SCLogError("openmetrics: listen(%s) error: %s", listen_addr, strerror(errno));
+        OpenMetricsCtxFree(ctx);
+        return;
+    }
+    om_ctx = ctx;
+
+    ThreadVars *tv = TmThreadCreateMgmtThread(
+            thread_name_counter_openmetrics, StatsOpenMetricsThread, 1);
+    if (tv == NULL || TmThreadSpawn(tv) != 0) {
+        FatalError("Unable to create and start openmetrics thread");
+    }
+    SCLogConfig("openmetrics: exporting stats on %s%s", listen_addr,
+            ctx->threads ? " (including per thread series)" : "");
+}
+
+#else /* BUILD_UNIX_SOCKET */
+
+void StatsOpenMetricsSpawnThread(void)
+{
+    if (StatsOpenMetricsEnabled()) {
+        SCLogError("openmetrics: exporter is not compiled in, it needs unix socket support");
+    }
+}
+
+#endif /* BUILD_UNIX_SOCKET */
+
+#ifdef UNITTESTS
+static int OpenMetricsTest01(void)
+{
+    OpenMetricsCounter m;
+    memset(&m, 0, sizeof(m));
+    FAIL_IF_NOT(OpenMetricsCounterSetup(&m, "decoder.event.ipv4.pkt-too-small") == 0);
+    FAIL_IF_NOT(strcmp(m.name, "suricata_decoder_event_ipv4_pkt_too_small") == 0);
+    FAIL_IF_NOT(m.name_len == strlen(m.name));
+    FAIL_IF_NOT(strcmp(m.src, "decoder.event.ipv4.pkt-too-small") == 0);
+    OpenMetricsCounterFree(&m);
+
+    FAIL_IF_NOT(OpenMetricsCounterSetup(&m, "uptime") == 0);
+    FAIL_IF_NOT(strcmp(m.name, "suricata_uptime") == 0);
+    OpenMetricsCounterFree(&m);
+
+    char *e = OpenMetricsLabelEscape("W#01 \"a\\b\"");
+    FAIL_IF_NULL(e);
+    FAIL_IF_NOT(strcmp(e, "W#01 \\\"a\\\\b\\\"") == 0);
+    SCFree(e);
+    PASS;
+}
+
+static int OpenMetricsTest02(void)
+{
+    StatsRecord stats[2] = {
+        { .name = "capture.kernel_packets", .value = 30 },
+        { .name = "flow.memuse", .value = 1024 },
+    };
+    /* thread 1 doesn't have flow.memuse */
+    StatsRecord tstats[4] = {
+        { .name = "capture.kernel_packets", .tm_name = "W#01", .value = 10 },
+        { .name = "flow.memuse", .tm_name = "W#01", .value = 1024 },
+        { .name = "capture.kernel_packets", .tm_name = "W#02", .value = 20 },
+        { .name = NULL },
+    };
+    StatsTable st = { .stats = stats, .tstats = tstats, .nstats = 2, .ntstats = 2 };
+
+    OpenMetricsCtx *ctx = OpenMetricsCtxAlloc();
+    FAIL_IF_NULL(ctx);
+    ctx->threads = true;
+
+    OpenMetricsRender(&st, ctx);
+    FAIL_IF_NOT(ctx->render_ok);
+    const char *expect = "# TYPE suricata_capture_kernel_packets unknown\n"
+                         "suricata_capture_kernel_packets 30\n"
+                         "# TYPE suricata_capture_kernel_packets_thread unknown\n"
+                         "suricata_capture_kernel_packets_thread{thread=\"W#01\"} 10\n"
+                         "suricata_capture_kernel_packets_thread{thread=\"W#02\"} 20\n"
+                         "# TYPE suricata_flow_memuse unknown\n"
+                         "suricata_flow_memuse 1024\n"
+                         "# TYPE suricata_flow_memuse_thread unknown\n"
+                         "suricata_flow_memuse_thread{thread=\"W#01\"} 1024\n"
+                         "# EOF\n";
+    FAIL_IF_NOT(MEMBUFFER_OFFSET(ctx->buf) == strlen(expect));
+    FAIL_IF_NOT(memcmp(MEMBUFFER_BUFFER(ctx->buf), expect, strlen(expect)) == 0);
+
+    /* second render reuses the caches and gives the same result */
+    stats[0].value = 31;
+    OpenMetricsRender(&st, ctx);
+    FAIL_IF_NOT(ctx->render_ok);
+    FAIL_IF_NOT(MEMBUFFER_OFFSET(ctx->buf) == strlen(expect));
+
+    OpenMetricsCtxFree(ctx);
+    PASS;
+}
+
+/** \test counters mapping to the same metric name are only exported once */
+static int OpenMetricsTest03(void)
+{
+    StatsRecord stats[4] = {
+        { .name = "a.b_c", .value = 1 },
+        { .name = "a_b.c", .value = 2 },
+        { .name = "x.y", .value = 3 },
+        { .name = "x.y_thread", .value = 4 },
+    };
+    StatsTable st = { .stats = stats, .nstats = 4 };
+
+    OpenMetricsCtx *ctx = OpenMetricsCtxAlloc();
+    FAIL_IF_NULL(ctx);
+
+    /* without thread series 'x.y_thread' doesn't clash */
+    OpenMetricsRender(&st, ctx);
+    FAIL_IF_NOT(ctx->render_ok);
+    const char *expect = "# TYPE suricata_a_b_c unknown\n"
+                         "suricata_a_b_c 1\n"
+                         "# TYPE suricata_x_y unknown\n"
+                         "suricata_x_y 3\n"
+                         "# TYPE suricata_x_y_thread unknown\n"
+                         "suricata_x_y_thread 4\n"
+                         "# EOF\n";
+    FAIL_IF_NOT(MEMBUFFER_OFFSET(ctx->buf) == strlen(expect));
+    FAIL_IF_NOT(memcmp(MEMBUFFER_BUFFER(ctx->buf), expect, strlen(expect)) == 0);
+    FAIL_IF_NOT(ctx->counters[1].skip);
+    FAIL_IF(ctx->counters[3].skip);
+
+    /* with thread series it clashes with the per thread series of 'x.y' */
+    OpenMetricsCtxFree(ctx);
+    ctx = OpenMetricsCtxAlloc();
+    FAIL_IF_NULL(ctx);
+    ctx->threads = true;
+    OpenMetricsRender(&st, ctx);
+    FAIL_IF_NOT(ctx->render_ok);
+    FAIL_IF_NOT(ctx->counters[1].skip);
+    FAIL_IF(ctx->counters[2].skip);
+    FAIL_IF_NOT(ctx->counters[3].skip);
+
+    OpenMetricsCtxFree(ctx);
+    PASS;
+}
+
+/** \test a different set of counters of the same size gets new names */
+static int OpenMetricsTest04(void)
+{
+    StatsRecord stats[1] = {
+        { .name = "flow.memuse", .value = 1 },
+    };
+    StatsRecord tstats[1] = {
+        { .name = "flow.memuse", .tm_name = "W#01", .value = 1 },
+    };
+    StatsTable st = { .stats = stats, .tstats = tstats, .nstats = 1, .ntstats = 1 };
+
+    OpenMetricsCtx *ctx = OpenMetricsCtxAlloc();
+    FAIL_IF_NULL(ctx);
+    ctx->threads = true;
+
+    OpenMetricsRender(&st, ctx);
+    FAIL_IF_NOT(ctx->render_ok);
+    FAIL_IF_NOT(strcmp(ctx->counters[0].name, "suricata_flow_memuse") == 0);
+    FAIL_IF_NOT(strcmp(ctx->thread_labels[0], "W#01") == 0);
+
+    stats[0].name = "tcp.memuse";
+    tstats[0].name = "tcp.memuse";
+    tstats[0].tm_name = "W#02";
+    OpenMetricsRender(&st, ctx);
+    FAIL_IF_NOT(ctx->render_ok);
+    const char *expect = "# TYPE suricata_tcp_memuse unknown\n"
+                         "suricata_tcp_memuse 1\n"
+                         "# TYPE suricata_tcp_memuse_thread unknown\n"
+                         "suricata_tcp_memuse_thread{thread=\"W#02\"} 1\n"
+                         "# EOF\n";
+    FAIL_IF_NOT(MEMBUFFER_OFFSET(ctx->buf) == strlen(expect));
+    FAIL_IF_NOT(memcmp(MEMBUFFER_BUFFER(ctx->buf), expect, strlen(expect)) == 0);
+
+    OpenMetricsCtxFree(ctx);
+    PASS;
+}
+#endif /* UNITTESTS */
+
+void StatsOpenMetricsRegisterTests(void)
+{
+#ifdef UNITTESTS
+    UtRegisterTest("OpenMetricsTest01", OpenMetricsTest01);
+    UtRegisterTest("OpenMetricsTest02", OpenMetricsTest02);
+    UtRegisterTest("OpenMetricsTest03", OpenMetricsTest03);
+    UtRegisterTest("OpenMetricsTest04", OpenMetricsTest04);
+#endif
+}
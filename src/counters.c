@@ -32,18 +32,17 @@
 
 #include "output.h"
 #include "output-json-stats.h"
+#include "counters-openmetrics.h"
 
 #include "util-byte.h"
 #include "util-conf.h"
+#include "util-cpu.h"
 #include "util-hash.h"
 #include "util-time.h"
 
 #include "tm-threads.h"
 #include "util-privs.h"
 
-/* Time interval for syncing the local counters with the global ones */
-#define STATS_WUT_TTS 3
-
 /* Time interval at which the mgmt thread o/p the stats */
 #define STATS_MGMTT_TTS 8
 
@@ -92,8 +91,8 @@ typedef struct StatsGlobalContext_ {
 static void *stats_thread_data = NULL;
 static StatsGlobalContext *stats_ctx = NULL;
 static time_t stats_start_time;
-/** refresh interval in seconds */
-static uint32_t stats_tts = STATS_MGMTT_TTS;
+/** refresh interval in milliseconds */
+static uint32_t stats_interval_ms = STATS_MGMTT_TTS * 1000;
 /** is the stats counter enabled? */
 static bool stats_enabled = true;
 
@@ -130,12 +129,45 @@ static void StatsPublicThreadContextCleanup(StatsPublicThreadContext *t)
     SCMutexLock(&t->m);
     StatsReleaseCounters(t->head);
     t->head = NULL;
-    SC_ATOMIC_SET(t->sync_now, false);
+    t->pca = NULL;
     t->curr_id = 0;
     SCMutexUnlock(&t->m);
     SCMutexDestroy(&t->m);
 }
 
+/** \internal
+ *  \brief update a local counter value
+ *
+ *  Only the owning thread writes the counter, so a plain load and a
+ *  relaxed store are enough: no locked instructions on the fast path.
+ *  Average counters update 'value' and 'updates' inside a seqlock so
+ *  the stats thread reads them as a consistent pair.
+ *
+ *  \param v new value
+ *  \param updates number of updates to add (average counters only)
+ */
+static inline void StatsLocalCounterStore(StatsLocalCounter *c, int64_t v, uint64_t updates)
+{
+    if (c->type != STATS_TYPE_AVERAGE) {
+        SC_ATOMIC_STORE_EXPLICIT(c->value, v, SC_ATOMIC_MEMORY_ORDER_RELAXED);
+        return;
+    }
+
+    const uint32_t seq = SC_ATOMIC_LOAD_EXPLICIT(c->seq, SC_ATOMIC_MEMORY_ORDER_RELAXED);
+    SC_ATOMIC_STORE_EXPLICIT(c->seq, seq + 1, SC_ATOMIC_MEMORY_ORDER_RELAXED);
+    SC_ATOMIC_THREAD_FENCE(SC_ATOMIC_MEMORY_ORDER_RELEASE);
+    SC_ATOMIC_STORE_EXPLICIT(c->value, v, SC_ATOMIC_MEMORY_ORDER_RELAXED);
+    SC_ATOMIC_STORE_EXPLICIT(c->updates,
+            SC_ATOMIC_LOAD_EXPLICIT(c->updates, SC_ATOMIC_MEMORY_ORDER_RELAXED) + updates,
+            SC_ATOMIC_MEMORY_ORDER_RELAXED);
+    SC_ATOMIC_STORE_EXPLICIT(c->seq, seq + 2, SC_ATOMIC_MEMORY_ORDER_RELEASE);
+}
+
+static inline int64_t StatsLocalCounterLoad(const StatsLocalCounter *c)
+{
+    return SC_ATOMIC_LOAD_EXPLICIT(c->value, SC_ATOMIC_MEMORY_ORDER_RELAXED);
+}
+
 /**
  * \brief Adds a value of type uint64_t to the local counter.
  *
@@ -153,8 +185,8 @@ void StatsAddUI64(ThreadVars *tv, uint16_t id, uint64_t x)
 #ifdef DEBUG
     BUG_ON ((id < 1) || (id > pca->size));
 #endif
-    pca->head[id].value += x;
-    pca->head[id].updates++;
+    StatsLocalCounter *c = &pca->head[id];
+    StatsLocalCounterStore(c, StatsLocalCounterLoad(c) + (int64_t)x, 1);
 }
 
 /**
@@ -173,8 +205,8 @@ void StatsIncr(ThreadVars *tv, uint16_t id)
 #ifdef DEBUG
     BUG_ON ((id < 1) || (id > pca->size));
 #endif
-    pca->head[id].value++;
-    pca->head[id].updates++;
+    StatsLocalCounter *c = &pca->head[id];
+    StatsLocalCounterStore(c, StatsLocalCounterLoad(c) + 1, 1);
 }
 
 /**
@@ -193,8 +225,8 @@ void StatsDecr(ThreadVars *tv, uint16_t id)
 #ifdef DEBUG
     BUG_ON((id < 1) || (id > pca->size));
 #endif
-    pca->head[id].value--;
-    pca->head[id].updates++;
+    StatsLocalCounter *c = &pca->head[id];
+    StatsLocalCounterStore(c, StatsLocalCounterLoad(c) - 1, 1);
 }
 
 /**
@@ -215,13 +247,20 @@ void StatsSetUI64(ThreadVars *tv, uint16_t id, uint64_t x)
     BUG_ON ((id < 1) || (id > pca->size));
 #endif
 
-    if ((pca->head[id].pc->type == STATS_TYPE_MAXIMUM) && ((int64_t)x > pca->head[id].value)) {
-        pca->head[id].value = x;
-    } else if (pca->head[id].pc->type == STATS_TYPE_NORMAL) {
-        pca->head[id].value = x;
+    StatsLocalCounter *c = &pca->head[id];
+    switch (c->type) {
+        case STATS_TYPE_MAXIMUM:
+            if ((int64_t)x > StatsLocalCounterLoad(c))
+                StatsLocalCounterStore(c, (int64_t)x, 0);
+            break;
+        case STATS_TYPE_NORMAL:
+            StatsLocalCounterStore(c, (int64_t)x, 0);
+            break;
+        case STATS_TYPE_AVERAGE:
+            /* value is not set, only the number of updates */
+            StatsLocalCounterStore(c, StatsLocalCounterLoad(c), 1);
+            break;
     }
-
-    pca->head[id].updates++;
 }
 
 static SCConfNode *GetConfig(void)
@@ -266,13 +305,25 @@ static void StatsInitCtxPreOutput(void)
         }
 
         const char *interval = SCConfNodeLookupChildValue(stats, "interval");
-        if (interval != NULL)
-            if (StringParseUint32(&stats_tts, 10, 0, interval) < 0) {
+        if (interval != NULL) {
+            /* seconds, or milliseconds with a 'ms' suffix */
+            uint32_t mult = 1000;
+            size_t len = strlen(interval);
+            if (len > 2 && strcmp(interval + len - 2, "ms") == 0) {
+                mult = 1;
+                len -= 2;
+            }
+            uint32_t val = 0;
+            if (StringParseUint32(&val, 10, len, interval) < 0 || val == 0 ||
+                    val > UINT32_MAX / mult) {
                 SCLogWarning("Invalid value for "
                              "interval: \"%s\". Resetting to %d.",
                         interval, STATS_MGMTT_TTS);
-                stats_tts = STATS_MGMTT_TTS;
+                val = STATS_MGMTT_TTS;
+                mult = 1000;
             }
+            stats_interval_ms = val * mult;
+        }
 
         int b;
         int ret = SCConfGetChildValueBool(stats, "decoder-events", &b);
@@ -307,9 +358,10 @@ static void StatsInitCtxPostOutput(void)
     if (stats_enabled && !OutputStatsLoggersRegistered()) {
         stats_loggers_active = 0;
 
-        /* if the unix command socket is enabled we do the background
-         * stats sync just in case someone runs 'dump-counters' */
-        if (!ConfUnixSocketIsEnable()) {
+        /* if the unix command socket or the openmetrics exporter are
+         * enabled we do the background stats sync just in case someone
+         * runs 'dump-counters' or scrapes the exporter */
+        if (!ConfUnixSocketIsEnable() && !StatsOpenMetricsEnabled()) {
             SCLogWarning("stats are enabled but no loggers are active");
             stats_enabled = false;
             SCReturn;
@@ -412,7 +464,12 @@ static void *StatsMgmtThread(void *arg)
         struct timeval cur_timev;
         gettimeofday(&cur_timev, NULL);
         struct timespec cond_time = FROM_TIMEVAL(cur_timev);
-        cond_time.tv_sec += (stats_tts);
+        cond_time.tv_sec += stats_interval_ms / 1000;
+        cond_time.tv_nsec += (long)(stats_interval_ms % 1000) * 1000000L;
+        if (cond_time.tv_nsec >= 1000000000L) {
+            cond_time.tv_sec++;
+            cond_time.tv_nsec -= 1000000000L;
+        }
 
         /* wait for the set time, or until we are woken up by
          * the shutdown procedure */
@@ -442,106 +499,6 @@ static void *StatsMgmtThread(void *arg)
     return NULL;
 }
 
-void StatsSyncCounters(ThreadVars *tv)
-{
-    StatsUpdateCounterArray(&tv->perf_private_ctx, &tv->perf_public_ctx);
-}
-
-void StatsSyncCountersIfSignalled(ThreadVars *tv)
-{
-    if (SC_ATOMIC_GET(tv->perf_public_ctx.sync_now)) {
-        StatsUpdateCounterArray(&tv->perf_private_ctx, &tv->perf_public_ctx);
-    }
-}
-
-/**
- * \brief Wake up thread.  This thread wakes up every TTS(time to sleep) seconds
- *        and sets the flag for every ThreadVars' StatsPublicThreadContext
- *
- * \param arg is NULL always
- *
- * \retval NULL This is the value that is always returned
- */
-static void *StatsWakeupThread(void *arg)
-{
-    ThreadVars *tv_local = (ThreadVars *)arg;
-
-    SCSetThreadName(tv_local->name);
-
-    if (tv_local->thread_setup_flags != 0)
-        TmThreadSetupOptions(tv_local);
-
-    /* Set the threads capability */
-    tv_local->cap_flags = 0;
-    SCDropCaps(tv_local);
-
-    if (stats_ctx == NULL) {
-        SCLogError("Stats API not init"
-                   "StatsInitCounterApi() has to be called first");
-        TmThreadsSetFlag(tv_local, THV_CLOSED | THV_RUNNING_DONE);
-        return NULL;
-    }
-
-    TmThreadsSetFlag(tv_local, THV_INIT_DONE | THV_RUNNING);
-    bool run = TmThreadsWaitForUnpause(tv_local);
-
-    while (run) {
-        struct timeval cur_timev;
-        gettimeofday(&cur_timev, NULL);
-        struct timespec cond_time = FROM_TIMEVAL(cur_timev);
-        cond_time.tv_sec += STATS_WUT_TTS;
-
-        /* wait for the set time, or until we are woken up by
-         * the shutdown procedure */
-        SCCtrlMutexLock(tv_local->ctrl_mutex);
-        SCCtrlCondTimedwait(tv_local->ctrl_cond, tv_local->ctrl_mutex, &cond_time);
-        SCCtrlMutexUnlock(tv_local->ctrl_mutex);
-
-        SCMutexLock(&tv_root_lock);
-        ThreadVars *tv = tv_root[TVT_PPT];
-        while (tv != NULL) {
-            if (tv->perf_public_ctx.head == NULL) {
-                tv = tv->next;
-                continue;
-            }
-
-            SC_ATOMIC_SET(tv->perf_public_ctx.sync_now, true);
-
-            if (tv->inq != NULL) {
-                PacketQueue *q = tv->inq->pq;
-                SCMutexLock(&q->mutex_q);
-                SCCondSignal(&q->cond_q);
-                SCMutexUnlock(&q->mutex_q);
-            }
-
-            tv = tv->next;
-        }
-
-        /* mgt threads for flow manager */
-        tv = tv_root[TVT_MGMT];
-        while (tv != NULL) {
-            if (tv->perf_public_ctx.head == NULL) {
-                tv = tv->next;
-                continue;
-            }
-
-            SC_ATOMIC_SET(tv->perf_public_ctx.sync_now, true);
-
-            tv = tv->next;
-        }
-        SCMutexUnlock(&tv_root_lock);
-
-        if (TmThreadsCheckFlag(tv_local, THV_KILL)) {
-            break;
-        }
-    }
-
-    TmThreadsSetFlag(tv_local, THV_RUNNING_DONE);
-    TmThreadWaitForFlag(tv_local, THV_DEINIT);
-    TmThreadsSetFlag(tv_local, THV_CLOSED);
-    return NULL;
-}
-
 /**
  * \brief Releases a counter
  *
@@ -624,17 +581,57 @@ static uint16_t StatsRegisterQualifiedCounter(const char *name, const char *tm_n
 /**
  * \brief Copies the StatsCounter value from the local counter present in the
  *        StatsPrivateThreadContext to its corresponding global counterpart.  Used
- *        internally by StatsUpdateCounterArray()
+ *        internally by StatsPullCounters()
+ *
+ *  Runs in the stats thread while the owning thread keeps updating the
+ *  local counter.
  *
  * \param pcae     Pointer to the StatsPrivateThreadContext which holds the local
  *                 versions of the counters
  */
-static void StatsCopyCounterValue(StatsLocalCounter *pcae)
+static void StatsCopyCounterValue(const StatsLocalCounter *pcae)
 {
     StatsCounter *pc = pcae->pc;
 
-    pc->value = pcae->value;
-    pc->updates = pcae->updates;
+    if (pcae->type != STATS_TYPE_AVERAGE) {
+        pc->value = SC_ATOMIC_LOAD_EXPLICIT(pcae->value, SC_ATOMIC_MEMORY_ORDER_RELAXED);
+        return;
+    }
+
+    /* seqlock read: retry if an update was in progress or happened
+     * while we were reading */
+    while (1) {
+        const uint32_t seq1 = SC_ATOMIC_LOAD_EXPLICIT(pcae->seq, SC_ATOMIC_MEMORY_ORDER_ACQUIRE);
+        if (seq1 & 1) {
+            UtilCpuRelax();
+            continue;
+        }
+        const int64_t value =
+                SC_ATOMIC_LOAD_EXPLICIT(pcae->value, SC_ATOMIC_MEMORY_ORDER_RELAXED);
+        const uint64_t updates =
+                SC_ATOMIC_LOAD_EXPLICIT(pcae->updates, SC_ATOMIC_MEMORY_ORDER_RELAXED);
+        SC_ATOMIC_THREAD_FENCE(SC_ATOMIC_MEMORY_ORDER_ACQUIRE);
+        const uint32_t seq2 = SC_ATOMIC_LOAD_EXPLICIT(pcae->seq, SC_ATOMIC_MEMORY_ORDER_RELAXED);
+        if (seq1 == seq2) {
+            pc->value = value;
+            pc->updates = updates;
+            return;
+        }
+        UtilCpuRelax();
+    }
+}
+
+/** \internal
+ *  \brief take a snapshot of the private counters into the public ones
+ *
+ *  \note caller must hold the public context lock
+ */
+static void StatsPullCounters(const StatsPrivateThreadContext *pca)
+{
+    const StatsLocalCounter *pcae = pca->head;
+    for (uint32_t i = 1; i <= pca->size; i++) {
+        StatsCopyCounterValue(&pcae[i]);
+    }
 }
 
 /**
@@ -708,6 +705,9 @@ static int StatsOutput(ThreadVars *tv)
                 max_id * sizeof(struct CountersMergeTable));
 
         SCMutexLock(&sts->ctx->m);
+        if (sts->ctx->pca != NULL) {
+            StatsPullCounters(sts->ctx->pca);
+        }
         pc = sts->ctx->head;
         while (pc != NULL) {
             SCLogDebug("Counter %s (%u:%u) value %"PRIu64,
@@ -718,6 +718,8 @@ static int StatsOutput(ThreadVars *tv)
                 case STATS_TYPE_FUNC:
                     if (pc->Func != NULL)
                         thread_table[pc->gid].value = pc->Func();
+                    else if (pc->FuncWithData != NULL)
+                        thread_table[pc->gid].value = pc->FuncWithData(pc->func_data);
                     break;
                 case STATS_TYPE_AVERAGE:
                 default:
@@ -848,6 +850,27 @@ TmEcode StatsOutputCounterSocket(json_t *cmd,
 }
 #endif /* BUILD_UNIX_SOCKET */
 
+/**
+ * \brief call 'Func' with the current stats table, while holding the table
+ *        lock so the stats thread can't update it underneath us
+ *
+ * \retval false if stats are disabled or not yet synchronized
+ */
+bool StatsTableRun(void (*Func)(const StatsTable *st, void *data), void *data)
+{
+    if (!stats_enabled)
+        return false;
+
+    bool r = false;
+    SCMutexLock(&stats_table_mutex);
+    if (stats_table.start_time != 0) {
+        Func(&stats_table, data);
+        r = true;
+    }
+    SCMutexUnlock(&stats_table_mutex);
+    return r;
+}
+
 static void StatsLogSummary(void)
 {
     if (!stats_enabled) {
@@ -895,10 +918,10 @@ void StatsSetupPostConfigPostOutput(void)
 
 
 /**
- * \brief Spawns the wakeup, and the management thread used by the stats api
+ * \brief Spawns the management thread used by the stats api
  *
- *  The threads use the condition variable in the thread vars to control
- *  their wait loops to make sure the main thread can quickly kill them.
+ *  The thread uses the condition variable in the thread vars to control
+ *  its wait loop to make sure the main thread can quickly kill it.
  */
 void StatsSpawnThreads(void)
 {
@@ -908,22 +931,8 @@ void StatsSpawnThreads(void)
         SCReturn;
     }
 
-    ThreadVars *tv_wakeup = NULL;
     ThreadVars *tv_mgmt = NULL;
 
-    /* spawn the stats wakeup thread */
-    tv_wakeup = TmThreadCreateMgmtThread(thread_name_counter_wakeup,
-                                         StatsWakeupThread, 1);
-    if (tv_wakeup == NULL) {
-        FatalError("TmThreadCreateMgmtThread "
-                   "failed");
-    }
-
-    if (TmThreadSpawn(tv_wakeup) != 0) {
-        FatalError("TmThreadSpawn failed for "
-                   "StatsWakeupThread");
-    }
-
     /* spawn the stats mgmt thread */
     tv_mgmt = TmThreadCreateMgmtThread(thread_name_counter_stats,
                                        StatsMgmtThread, 1);
@@ -933,9 +942,11 @@ void StatsSpawnThreads(void)
 
     if (TmThreadSpawn(tv_mgmt) != 0) {
         FatalError("TmThreadSpawn failed for "
-                   "StatsWakeupThread");
+                   "StatsMgmtThread");
     }
 
+    StatsOpenMetricsSpawnThread();
+
     SCReturn;
 }
 
@@ -1022,6 +1033,40 @@ uint16_t StatsRegisterGlobalCounter(const char *name, uint64_t (*Func)(void))
     return id;
 }
 
+/**
+ * \brief Registers a counter, which represents a global value, with a
+ *        data pointer that is passed to the function
+ *
+ * \param name Name of the counter, to be registered
+ * \param Func Function Pointer returning a uint64_t
+ * \param data Data passed to Func
+ *
+ * \retval id Counter id for the newly registered counter, or the already
+ *            present counter
+ */
+uint16_t StatsRegisterGlobalCounterWithData(
+        const char *name, uint64_t (*Func)(void *), void *data)
+{
+#if defined (UNITTESTS) || defined (FUZZ)
+    if (stats_ctx == NULL)
+        return 0;
+#else
+    BUG_ON(stats_ctx == NULL);
+#endif
+    uint16_t id = StatsRegisterQualifiedCounter(name, NULL,
+            &(stats_ctx->global_counter_ctx),
+            STATS_TYPE_FUNC,
+            NULL);
+    for (StatsCounter *pc = stats_ctx->global_counter_ctx.head; pc != NULL; pc = pc->next) {
+        if (pc->id == id) {
+            pc->FuncWithData = Func;
+            pc->func_data = data;
+            break;
+        }
+    }
+    return id;
+}
+
 typedef struct CountersIdType_ {
     uint16_t id;
     const char *string;
@@ -1167,9 +1212,13 @@ static int StatsGetCounterArrayRange(uint16_t s_id, uint16_t e_id,
         return -1;
     }
 
-    if ((pca->head = SCCalloc(1, sizeof(StatsLocalCounter) * (e_id - s_id + 2))) == NULL) {
+    /* the array is only written by the owning thread: align it so it
+     * doesn't share cache lines with data of other threads */
+    const size_t size = sizeof(StatsLocalCounter) * (e_id - s_id + 2);
+    if ((pca->head = SCMallocAligned(size, CLS)) == NULL) {
         return -1;
     }
+    memset(pca->head, 0, size);
 
     pc = pctx->head;
     while (pc->id != s_id)
@@ -1179,6 +1228,7 @@ static int StatsGetCounterArrayRange(uint16_t s_id, uint16_t e_id,
     while ((pc != NULL) && (pc->id <= e_id)) {
         pca->head[i].pc = pc;
         pca->head[i].id = pc->id;
+        pca->head[i].type = (uint8_t)pc->type;
         pc = pc->next;
         i++;
     }
@@ -1208,7 +1258,11 @@ static int StatsGetAllCountersArray(StatsPublicThreadContext *pctx, StatsPrivate
 
 int StatsSetupPrivate(ThreadVars *tv)
 {
-    StatsGetAllCountersArray(&(tv)->perf_public_ctx, &(tv)->perf_private_ctx);
+    if (StatsGetAllCountersArray(&(tv)->perf_public_ctx, &(tv)->perf_private_ctx) == 0) {
+        SCMutexLock(&tv->perf_public_ctx.m);
+        tv->perf_public_ctx.pca = &tv->perf_private_ctx;
+        SCMutexUnlock(&tv->perf_public_ctx.m);
+    }
 
     StatsThreadRegister(tv->printable_name ? tv->printable_name : tv->name,
         &(tv)->perf_public_ctx);
@@ -1216,7 +1270,10 @@ int StatsSetupPrivate(ThreadVars *tv)
 }
 
 /**
- * \brief the private stats store with the public stats store
+ * \brief update the public stats store from the private stats store
+ *
+ *  Safe to call from any thread: the private counters are read without
+ *  the owning thread's involvement.
  *
  * \param pca      Pointer to the StatsPrivateThreadContext
  * \param pctx     Pointer the tv's StatsPublicThreadContext
@@ -1233,13 +1290,8 @@ int StatsUpdateCounterArray(StatsPrivateThreadContext *pca, StatsPublicThreadCon
     }
 
     SCMutexLock(&pctx->m);
-    StatsLocalCounter *pcae = pca->head;
-    for (uint32_t i = 1; i <= pca->size; i++) {
-        StatsCopyCounterValue(&pcae[i]);
-    }
+    StatsPullCounters(pca);
     SCMutexUnlock(&pctx->m);
-
-    SC_ATOMIC_SET(pctx->sync_now, false);
     return 1;
 }
 
@@ -1258,7 +1310,7 @@ uint64_t StatsGetLocalCounterValue(ThreadVars *tv, uint16_t id)
 #ifdef DEBUG
     BUG_ON ((id < 1) || (id > pca->size));
 #endif
-    return pca->head[id].value;
+    return StatsLocalCounterLoad(&pca->head[id]);
 }
 
 /**
@@ -1297,7 +1349,7 @@ static void StatsReleasePrivateThreadContext(StatsPrivateThreadContext *pca)
 {
     if (pca != NULL) {
         if (pca->head != NULL) {
-            SCFree(pca->head);
+            SCFreeAligned(pca->head);
             pca->head = NULL;
             pca->size = 0;
         }
@@ -1456,7 +1508,7 @@ static int StatsTestUpdateCounter08(void)
     StatsIncr(&tv, id);
     StatsAddUI64(&tv, id, 100);
 
-    FAIL_IF_NOT(pca->head[id].value == 101);
+    FAIL_IF_NOT(SC_ATOMIC_GET(pca->head[id].value) == 101);
 
     StatsReleaseCounters(tv.perf_public_ctx.head);
     StatsReleasePrivateThreadContext(pca);
@@ -1484,7 +1536,8 @@ static int StatsTestUpdateCounter09(void)
     StatsIncr(&tv, id2);
     StatsAddUI64(&tv, id2, 100);
 
-    FAIL_IF_NOT((pca->head[id1].value == 0) && (pca->head[id2].value == 101));
+    FAIL_IF_NOT((SC_ATOMIC_GET(pca->head[id1].value) == 0) &&
+                (SC_ATOMIC_GET(pca->head[id2].value) == 101));
 
     StatsReleaseCounters(tv.perf_public_ctx.head);
     StatsReleasePrivateThreadContext(pca);
@@ -1564,6 +1617,45 @@ static int StatsTestCounterValues11(void)
     PASS;
 }
 
+static int StatsTestCounterTypes12(void)
+{
+    ThreadVars tv;
+    memset(&tv, 0, sizeof(ThreadVars));
+
+    uint16_t id_avg = StatsRegisterQualifiedCounter(
+            "avg", "c1", &tv.perf_public_ctx, STATS_TYPE_AVERAGE, NULL);
+    uint16_t id_max = StatsRegisterQualifiedCounter(
+            "max", "c1", &tv.perf_public_ctx, STATS_TYPE_MAXIMUM, NULL);
+    uint16_t id_set = RegisterCounter("set", "c1", &tv.perf_public_ctx);
+
+    FAIL_IF_NOT(StatsGetAllCountersArray(&tv.perf_public_ctx, &tv.perf_private_ctx) == 0);
+    StatsPrivateThreadContext *pca = &tv.perf_private_ctx;
+    FAIL_IF_NOT(((uintptr_t)pca->head % CLS) == 0);
+
+    StatsAddUI64(&tv, id_avg, 10);
+    StatsAddUI64(&tv, id_avg, 20);
+    StatsSetUI64(&tv, id_max, 5);
+    StatsSetUI64(&tv, id_max, 3);
+    StatsSetUI64(&tv, id_set, 5);
+    StatsSetUI64(&tv, id_set, 3);
+    /* no seqlock update left open */
+    FAIL_IF(SC_ATOMIC_GET(pca->head[id_avg].seq) & 1);
+
+    StatsUpdateCounterArray(pca, &tv.perf_public_ctx);
+
+    const StatsCounter *pc = tv.perf_public_ctx.head;
+    FAIL_IF_NOT(pc->value == 30 && pc->updates == 2);
+    pc = pc->next;
+    FAIL_IF_NOT(pc->value == 5);
+    pc = pc->next;
+    FAIL_IF_NOT(pc->value == 3);
+
+    StatsReleaseCounters(tv.perf_public_ctx.head);
+    StatsReleasePrivateThreadContext(pca);
+
+    PASS;
+}
+
 #endif
 
 void StatsRegisterTests(void)
@@ -1580,5 +1672,6 @@ void StatsRegisterTests(void)
     UtRegisterTest("StatsTestUpdateGlobalCounter10",
                    StatsTestUpdateGlobalCounter10);
     UtRegisterTest("StatsTestCounterValues11", StatsTestCounterValues11);
+    UtRegisterTest("StatsTestCounterTypes12", StatsTestCounterTypes12);
 #endif
 }
@@ -29,6 +29,7 @@
 
 /* forward declaration of the ThreadVars structure */
 struct ThreadVars_;
+struct StatsTable_;
 
 /**
  * \brief Container to hold the counter variable
@@ -42,13 +43,17 @@ typedef struct StatsCounter_ {
     /* global id, used in output */
     uint16_t gid;
 
-    /* counter value(s): copies from the 'private' counter */
+    /* counter value(s): snapshot of the 'private' counter, taken by the
+     * stats thread */
     int64_t value;      /**< sum of updates/increments, or 'set' value */
     uint64_t updates;   /**< number of updates (for avg) */
 
     /* when using type STATS_TYPE_Q_FUNC this function is called once
      * to get the counter value, regardless of how many threads there are. */
     uint64_t (*Func)(void);
+    /* same, for counters registered with a data pointer */
+    uint64_t (*FuncWithData)(void *);
+    void *func_data;
 
     /* name of the counter */
     const char *name;
@@ -59,45 +64,40 @@ typedef struct StatsCounter_ {
 } StatsCounter;
 
 /**
- * \brief Stats Context for a ThreadVars instance
+ * \brief Storage for local counters, with a link to the public counter
+ *
+ *  Only the owning thread writes a local counter. It does so with relaxed
+ *  atomic stores, so the stats thread can read the values directly without
+ *  the owning thread ever taking a lock. Average counters need 'value' and
+ *  'updates' to be read as a pair, so updates to those are wrapped in a
+ *  seqlock.
  */
-typedef struct StatsPublicThreadContext_ {
-    /* flag set by the wakeup thread, to inform the client threads to sync */
-    SC_ATOMIC_DECLARE(bool, sync_now);
-
-    /* pointer to the head of a list of counters assigned under this context */
-    StatsCounter *head;
+typedef struct StatsLocalCounter_ {
+    /* total value of the adds/increments, or exact value in case of 'set' */
+    SC_ATOMIC_DECLARE(int64_t, value);
 
-    /* holds the total no of counters already assigned for this perf context */
-    uint16_t curr_id;
+    /* no of times the local counter has been updated. Only maintained
+     * for average counters. */
+    SC_ATOMIC_DECLARE(uint64_t, updates);
 
-    /* mutex to prevent simultaneous access during update_counter/output_stat */
-    SCMutex m;
-} StatsPublicThreadContext;
+    /* seqlock for average counters: odd while an update is in progress */
+    SC_ATOMIC_DECLARE(uint32_t, seq);
 
-/**
- * \brief Storage for local counters, with a link to the public counter used
- *        for syncs
- */
-typedef struct StatsLocalCounter_ {
-    /* pointer to the counter that corresponds to this local counter */
-    StatsCounter *pc;
+    /* copy of pc->type so the update path doesn't need to touch pc */
+    uint8_t type;
 
     /* local counter id of the above counter */
     uint16_t id;
 
-    /* total value of the adds/increments, or exact value in case of 'set' */
-    int64_t value;
-
-    /* no of times the local counter has been updated */
-    uint64_t updates;
+    /* pointer to the counter that corresponds to this local counter */
+    StatsCounter *pc;
 } StatsLocalCounter;
 
 /**
  * \brief used to hold the private version of the counters registered
  */
 typedef struct StatsPrivateThreadContext_ {
-    /* points to the array holding local counters */
+    /* points to the cache line aligned array holding local counters */
     StatsLocalCounter *head;
 
     /* size of head array in elements */
@@ -106,6 +106,25 @@ typedef struct StatsPrivateThreadContext_ {
     int initialized;
 } StatsPrivateThreadContext;
 
+/**
+ * \brief Stats Context for a ThreadVars instance
+ */
+typedef struct StatsPublicThreadContext_ {
+    /* pointer to the head of a list of counters assigned under this context */
+    StatsCounter *head;
+
+    /* holds the total no of counters already assigned for this perf context */
+    uint16_t curr_id;
+
+    /* private counters of the thread, read directly by the stats thread.
+     * NULL for the global counters and after the thread is cleaned up. */
+    StatsPrivateThreadContext *pca;
+
+    /* mutex to prevent simultaneous access during registration/cleanup
+     * and output. Never taken by the owning thread while it runs. */
+    SCMutex m;
+} StatsPublicThreadContext;
+
 /* the initialization functions */
 void StatsInit(void);
 void StatsSetupPostConfigPreOutput(void);
@@ -122,6 +141,8 @@ uint16_t StatsRegisterCounter(const char *, struct ThreadVars_ *);
 uint16_t StatsRegisterAvgCounter(const char *, struct ThreadVars_ *);
 uint16_t StatsRegisterMaxCounter(const char *, struct ThreadVars_ *);
 uint16_t StatsRegisterGlobalCounter(const char *cname, uint64_t (*Func)(void));
+uint16_t StatsRegisterGlobalCounterWithData(
+        const char *cname, uint64_t (*Func)(void *), void *data);
 
 /* functions used to update local counter values */
 void StatsAddUI64(struct ThreadVars_ *, uint16_t, uint64_t);
@@ -134,9 +155,7 @@ int StatsUpdateCounterArray(StatsPrivateThreadContext *, StatsPublicThreadContex
 uint64_t StatsGetLocalCounterValue(struct ThreadVars_ *, uint16_t);
 int StatsSetupPrivate(struct ThreadVars_ *);
 void StatsThreadCleanup(struct ThreadVars_ *);
-
-void StatsSyncCounters(struct ThreadVars_ *tv);
-void StatsSyncCountersIfSignalled(struct ThreadVars_ *tv);
+bool StatsTableRun(void (*Func)(const struct StatsTable_ *st, void *data), void *data);
 
 #ifdef BUILD_UNIX_SOCKET
 TmEcode StatsOutputCounterSocket(json_t *cmd,
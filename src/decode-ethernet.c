@@ -39,11 +39,141 @@
 #include "util-unittest.h"
 #include "util-debug.h"
 
+/* anomalies that send a frame to the full decoders */
+#define ETH_FAST_ETHERTYPE BIT_U8(0) /**< not IPv4 or IPv6 */
+#define ETH_FAST_IP_HDR    BIT_U8(1) /**< wrong ip version or ipv4 options */
+#define ETH_FAST_IP_LEN    BIT_U8(2) /**< ip len too small or truncated */
+#define ETH_FAST_IP_FRAG   BIT_U8(3) /**< ipv4 fragment */
+#define ETH_FAST_IP_PROTO  BIT_U8(4) /**< not TCP or UDP, or ipv6 ext hdr */
+#define ETH_FAST_LAYERS    BIT_U8(5) /**< would hit decoder.max-layers */
+
+static inline void DecodeEthernetFastPathSetEthernet(
+        ThreadVars *tv, DecodeThreadVars *dtv, Packet *p, const uint8_t *pkt)
+{
+    StatsIncr(tv, dtv->counter_eth);
+    p->nb_decoded_layers++;
+    PacketSetEthernet(p, pkt);
+}
+
+static inline uint8_t DecodeEthernetFastPathCheckIPV4(const IPV4Hdr *ip4h, uint16_t ip_len)
+{
+    const uint16_t iplen = IPV4_GET_RAW_IPLEN(ip4h);
+    const uint8_t proto = IPV4_GET_RAW_IPPROTO(ip4h);
+
+    uint8_t anomalies = 0;
+    anomalies |= (ip4h->ip_verhl != 0x45) ? ETH_FAST_IP_HDR : 0;
+    anomalies |= (iplen < IPV4_HEADER_LEN || iplen > ip_len) ? ETH_FAST_IP_LEN : 0;
+    anomalies |=
+            (IPV4_GET_RAW_FRAGOFFSET(ip4h) > 0 || IPV4_GET_RAW_FLAG_MF(ip4h)) ? ETH_FAST_IP_FRAG : 0;
+    anomalies |= (proto != IPPROTO_TCP && proto != IPPROTO_UDP) ? ETH_FAST_IP_PROTO : 0;
+    return anomalies;
+}
+
+static inline uint8_t DecodeEthernetFastPathCheckIPV6(const IPV6Hdr *ip6h, uint16_t ip_len)
+{
+    const uint8_t nh = IPV6_GET_RAW_NH(ip6h);
+
+    uint8_t anomalies = 0;
+    anomalies |= (IP_GET_RAW_VER((const uint8_t *)ip6h) != 6) ? ETH_FAST_IP_HDR : 0;
+    anomalies |= (ip_len < IPV6_HEADER_LEN + IPV6_GET_RAW_PLEN(ip6h)) ? ETH_FAST_IP_LEN : 0;
+    anomalies |= (nh != IPPROTO_TCP && nh != IPPROTO_UDP) ? ETH_FAST_IP_PROTO : 0;
+    return anomalies;
+}
+
+/**
+ * \brief Fused decoding of a plain Ethernet + IPv4/IPv6 + TCP/UDP frame
+ *
+ * All checks DecodeEthernet, DecodeIPV4 and DecodeIPV6 would do are
+ * evaluated up front into an anomaly mask, without touching the packet.
+ * Only if the mask is empty the packet is set up the way those decoders
+ * would have done it and the TCP or UDP decoder is called directly. For
+ * anything unusual the full decoders run instead, so events and stats are
+ * the same on both paths.
+ *
+ * \retval true the frame was decoded
+ * \retval false the frame needs the full decoders
+ */
+static inline bool DecodeEthernetFastPath(
+        ThreadVars *tv, DecodeThreadVars *dtv, Packet *p, const uint8_t *pkt, uint32_t len)
+{
+    if (len < ETHERNET_HEADER_LEN + IPV4_HEADER_LEN)
+        return false;
+
+    const EthernetHdr *ethh = (const EthernetHdr *)pkt;
+    const uint8_t *ip = pkt + ETHERNET_HEADER_LEN;
+    /* DecodeNetworkLayer caps the length passed to the ip decoders */
+    const uint16_t ip_len = (uint16_t)MIN(len - ETHERNET_HEADER_LEN, (uint32_t)USHRT_MAX);
+
+    /* both the ethernet and the ip layer are counted */
+    uint8_t anomalies = (p->nb_decoded_layers + 2 >= decoder_max_layers) ? ETH_FAST_LAYERS : 0;
+    if (ethh->eth_type == htons(ETHERNET_TYPE_IP)) {
+        const IPV4Hdr *ip4h = (const IPV4Hdr *)ip;
+        anomalies |= DecodeEthernetFastPathCheckIPV4(ip4h, ip_len);
+        if (anomalies != 0) {
+            SCLogDebug("p %p ipv4 fast path anomalies %02x", p, anomalies);
+            return false;
+        }
+
+        DecodeEthernetFastPathSetEthernet(tv, dtv, p, pkt);
+        StatsIncr(tv, dtv->counter_ipv4);
+        p->nb_decoded_layers++;
+        PacketSetIPV4(p, ip);
+        SET_IPV4_SRC_ADDR(ip4h, &p->src);
+        SET_IPV4_DST_ADDR(ip4h, &p->dst);
+        p->proto = IPV4_GET_RAW_IPPROTO(ip4h);
+
+        const uint8_t *data = ip + IPV4_HEADER_LEN;
+        const uint16_t data_len = IPV4_GET_RAW_IPLEN(ip4h) - IPV4_HEADER_LEN;
+        if (p->proto == IPPROTO_TCP) {
+            DecodeTCP(tv, dtv, p, data, data_len);
+        } else {
+            DecodeUDP(tv, dtv, p, data, data_len);
+        }
+        return true;
+
+    } else if (ethh->eth_type == htons(ETHERNET_TYPE_IPV6)) {
+        if (ip_len < IPV6_HEADER_LEN)
+            return false;
+
+        const IPV6Hdr *ip6h = (const IPV6Hdr *)ip;
+        anomalies |= DecodeEthernetFastPathCheckIPV6(ip6h, ip_len);
+        if (anomalies != 0) {
+            SCLogDebug("p %p ipv6 fast path anomalies %02x", p, anomalies);
+            return false;
+        }
+
+        DecodeEthernetFastPathSetEthernet(tv, dtv, p, pkt);
+        StatsIncr(tv, dtv->counter_ipv6);
+        p->nb_decoded_layers++;
+        PacketSetIPV6(p, ip);
+        SET_IPV6_SRC_ADDR(ip6h, &p->src);
+        SET_IPV6_DST_ADDR(ip6h, &p->dst);
+        p->proto = IPV6_GET_RAW_NH(ip6h);
+        IPV6_SET_L4PROTO(p, p->proto);
+
+        const uint8_t *data = ip + IPV6_HEADER_LEN;
+        const uint16_t data_len = IPV6_GET_RAW_PLEN(ip6h);
+        if (p->proto == IPPROTO_TCP) {
+            DecodeTCP(tv, dtv, p, data, data_len);
+        } else {
+            DecodeUDP(tv, dtv, p, data, data_len);
+        }
+        return true;
+    }
+
+    SCLogDebug("p %p fast path anomalies %02x", p, anomalies | ETH_FAST_ETHERTYPE);
+    return false;
+}
+
 int DecodeEthernet(ThreadVars *tv, DecodeThreadVars *dtv, Packet *p,
                    const uint8_t *pkt, uint32_t len)
 {
     DEBUG_VALIDATE_BUG_ON(pkt == NULL);
 
+    if (decoder_fast_path && DecodeEthernetFastPath(tv, dtv, p, pkt, len)) {
+        return TM_ECODE_OK;
+    }
+
     StatsIncr(tv, dtv->counter_eth);
 
     if (unlikely(len < ETHERNET_HEADER_LEN)) {
@@ -65,6 +195,9 @@ int DecodeEthernet(ThreadVars *tv, DecodeThreadVars *dtv, Packet *p,
 }
 
 #ifdef UNITTESTS
+#include "flow.h"
+#include "packet.h"
+
 /** DecodeEthernettest01
  *  \brief Valid Ethernet packet
  *  \retval 0 Expected test value
@@ -166,6 +299,272 @@ static int DecodeEthernetTestDceNextTooSmall(void)
     PASS;
 }
 
+/* eth + ipv4 (DF) + tcp syn with a mss option */
+static uint8_t fast_path_frame[] = {
+    0x00, 0x10, 0x94, 0x55, 0x00, 0x01, 0x00, 0x10,
+    0x94, 0x56, 0x00, 0x01, 0x08, 0x00, 0x45, 0x00,
+    0x00, 0x2c, 0x00, 0x01, 0x40, 0x00, 0x40, 0x06,
+    0x00, 0x00, 0x0a, 0x00, 0x00, 0x01, 0x0a, 0x00,
+    0x00, 0x02, 0x04, 0xd2, 0x00, 0x50, 0x00, 0x00,
+    0x00, 0x01, 0x00, 0x00, 0x00, 0x00, 0x60, 0x02,
+    0x16, 0xd0, 0x00, 0x00, 0x00, 0x00, 0x02, 0x04,
+    0x05, 0xb4 };
+
+/**
+ * Test that the fast path sets up the packet like the full decoders.
+ */
+static int DecodeEthernetTestFastPath01(void)
+{
+    Packet *p1 = PacketGetFromAlloc();
+    FAIL_IF_NULL(p1);
+    Packet *p2 = PacketGetFromAlloc();
+    FAIL_IF_NULL(p2);
+    ThreadVars tv;
+    DecodeThreadVars dtv;
+
+    memset(&dtv, 0, sizeof(DecodeThreadVars));
+    memset(&tv,  0, sizeof(ThreadVars));
+
+    FlowInitConfig(FLOW_QUIET);
+    const bool fast_path = decoder_fast_path;
+    decoder_fast_path = true;
+    FAIL_IF_NOT(DecodeEthernet(&tv, &dtv, p1, fast_path_frame, sizeof(fast_path_frame)) ==
+                TM_ECODE_OK);
+    decoder_fast_path = false;
+    FAIL_IF_NOT(DecodeEthernet(&tv, &dtv, p2, fast_path_frame, sizeof(fast_path_frame)) ==
+                TM_ECODE_OK);
+    decoder_fast_path = fast_path;
+
+    FAIL_IF_NOT(PacketIsIPv4(p1));
+    FAIL_IF_NOT(PacketIsTCP(p1));
+    FAIL_IF_NOT(PacketIsIPv4(p2));
+    FAIL_IF_NOT(PacketIsTCP(p2));
+    FAIL_IF_NOT(p1->nb_decoded_layers == p2->nb_decoded_layers);
+    FAIL_IF_NOT(CMP_ADDR(&p1->src, &p2->src));
+    FAIL_IF_NOT(CMP_ADDR(&p1->dst, &p2->dst));
+    FAIL_IF_NOT(p1->proto == IPPROTO_TCP);
+    FAIL_IF_NOT(p1->sp == 1234 && p2->sp == 1234);
+    FAIL_IF_NOT(p1->dp == 80 && p2->dp == 80);
+    FAIL_IF_NOT(p1->payload_len == 0 && p2->payload_len == 0);
+    FAIL_IF_NOT(TCP_HAS_MSS(p1) && TCP_GET_MSS(p1) == TCP_GET_MSS(p2));
+    FAIL_IF_NOT(p1->flow_hash == p2->flow_hash);
+    FAIL_IF_NOT(p1->events.cnt == 0 && p2->events.cnt == 0);
+
+    PacketRecycle(p1);
+    PacketRecycle(p2);
+    FlowShutdown();
+    SCFree(p1);
+    SCFree(p2);
+    PASS;
+}
+
+/**
+ * Test that a truncated frame still gets the events of the full decoders.
+ */
+static int DecodeEthernetTestFastPath02(void)
+{
+    uint8_t raw_eth[sizeof(fast_path_frame)];
+    memcpy(raw_eth, fast_path_frame, sizeof(raw_eth));
+    /* ip len larger than the frame */
+    raw_eth[16] = 0x01;
+
+    Packet *p = PacketGetFromAlloc();
+    FAIL_IF_NULL(p);
+    ThreadVars tv;
+    DecodeThreadVars dtv;
+
+    memset(&dtv, 0, sizeof(DecodeThreadVars));
+    memset(&tv,  0, sizeof(ThreadVars));
+
+    const bool fast_path = decoder_fast_path;
+    decoder_fast_path = true;
+    DecodeEthernet(&tv, &dtv, p, raw_eth, sizeof(raw_eth));
+    decoder_fast_path = fast_path;
+
+    FAIL_IF_NOT(ENGINE_ISSET_EVENT(p, IPV4_TRUNC_PKT));
+    FAIL_IF(PacketIsTCP(p));
+
+    PacketRecycle(p);
+    SCFree(p);
+    PASS;
+}
+
+/* eth + ipv4 + udp */
+static uint8_t fast_path_frame_udp[] = {
+    0x00, 0x10, 0x94, 0x55, 0x00, 0x01, 0x00, 0x10,
+    0x94, 0x56, 0x00, 0x01, 0x08, 0x00, 0x45, 0x00,
+    0x00, 0x1c, 0x00, 0x01, 0x00, 0x00, 0x40, 0x11,
+    0x00, 0x00, 0x0a, 0x00, 0x00, 0x01, 0x0a, 0x00,
+    0x00, 0x02, 0x04, 0xd2, 0x00, 0x35, 0x00, 0x08,
+    0x00, 0x00 };
+
+/* eth + ipv6 + tcp syn */
+static uint8_t fast_path_frame_ipv6[] = {
+    0x00, 0x10, 0x94, 0x55, 0x00, 0x01, 0x00, 0x10,
+    0x94, 0x56, 0x00, 0x01, 0x86, 0xdd, 0x60, 0x00,
+    0x00, 0x00, 0x00, 0x14, 0x06, 0x40, 0x20, 0x01,
+    0x0d, 0xb8, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x01, 0x20, 0x01,
+    0x0d, 0xb8, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x02, 0x04, 0xd2,
+    0x00, 0x50, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00,
+    0x00, 0x00, 0x50, 0x02, 0x16, 0xd0, 0x00, 0x00,
+    0x00, 0x00 };
+
+/* eth + ipv6 + hop-by-hop + udp */
+static uint8_t fast_path_frame_ipv6_hbh[] = {
+    0x00, 0x10, 0x94, 0x55, 0x00, 0x01, 0x00, 0x10,
+    0x94, 0x56, 0x00, 0x01, 0x86, 0xdd, 0x60, 0x00,
+    0x00, 0x00, 0x00, 0x10, 0x00, 0x40, 0x20, 0x01,
+    0x0d, 0xb8, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x01, 0x20, 0x01,
+    0x0d, 0xb8, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x02, 0x11, 0x00,
+    0x01, 0x04, 0x00, 0x00, 0x00, 0x00, 0x04, 0xd2,
+    0x00, 0x35, 0x00, 0x08, 0x00, 0x00 };
+
+/* eth + vlan + ipv4 + udp */
+static uint8_t fast_path_frame_vlan[] = {
+    0x00, 0x10, 0x94, 0x55, 0x00, 0x01, 0x00, 0x10,
+    0x94, 0x56, 0x00, 0x01, 0x81, 0x00, 0x00, 0x0a,
+    0x08, 0x00, 0x45, 0x00, 0x00, 0x1c, 0x00, 0x01,
+    0x00, 0x00, 0x40, 0x11, 0x00, 0x00, 0x0a, 0x00,
+    0x00, 0x01, 0x0a, 0x00, 0x00, 0x02, 0x04, 0xd2,
+    0x00, 0x35, 0x00, 0x08, 0x00, 0x00 };
+
+/**
+ * Test that events, packet fields and stats are the same with and without
+ * the fast path, for frames that take it and frames that don't.
+ */
+static int DecodeEthernetTestFastPath03(void)
+{
+    /* ipv4 with a nop option */
+    uint8_t ipv4_opts[sizeof(fast_path_frame_udp) + 4];
+    memcpy(ipv4_opts, fast_path_frame_udp, 34);
+    memcpy(ipv4_opts + 38, fast_path_frame_udp + 34, 8);
+    ipv4_opts[14] = 0x46;
+    ipv4_opts[17] = 0x20;
+    memcpy(ipv4_opts + 34, "\x01\x01\x01\x00", 4);
+    /* ipv4 icmp echo request */
+    uint8_t ipv4_icmp[sizeof(fast_path_frame_udp)];
+    memcpy(ipv4_icmp, fast_path_frame_udp, sizeof(ipv4_icmp));
+    ipv4_icmp[23] = IPPROTO_ICMP;
+    ipv4_icmp[34] = 0x08;
+    ipv4_icmp[35] = 0x00;
+    /* ipv4 len larger than the frame */
+    uint8_t ipv4_trunc[sizeof(fast_path_frame_udp)];
+    memcpy(ipv4_trunc, fast_path_frame_udp, sizeof(ipv4_trunc));
+    ipv4_trunc[17] = 0x40;
+    /* ipv4 len smaller than the header */
+    uint8_t ipv4_short[sizeof(fast_path_frame_udp)];
+    memcpy(ipv4_short, fast_path_frame_udp, sizeof(ipv4_short));
+    ipv4_short[17] = 0x10;
+    /* tcp header cut short by the ipv4 len */
+    uint8_t tcp_short[sizeof(fast_path_frame)];
+    memcpy(tcp_short, fast_path_frame, sizeof(tcp_short));
+    tcp_short[17] = 0x1e;
+    /* ipv6 payload len larger than the frame */
+    uint8_t ipv6_trunc[sizeof(fast_path_frame_ipv6)];
+    memcpy(ipv6_trunc, fast_path_frame_ipv6, sizeof(ipv6_trunc));
+    ipv6_trunc[19] = 0x40;
+    /* ipv6 header with a wrong version */
+    uint8_t ipv6_ver[sizeof(fast_path_frame_ipv6)];
+    memcpy(ipv6_ver, fast_path_frame_ipv6, sizeof(ipv6_ver));
+    ipv6_ver[14] = 0x40;
+
+    struct {
+        const uint8_t *pkt;
+        uint32_t len;
+        bool fast;
+    } frames[] = {
+        { fast_path_frame, sizeof(fast_path_frame), true },
+        { fast_path_frame_udp, sizeof(fast_path_frame_udp), true },
+        { fast_path_frame_ipv6, sizeof(fast_path_frame_ipv6), true },
+        { tcp_short, sizeof(tcp_short), true },
+        { fast_path_frame_ipv6_hbh, sizeof(fast_path_frame_ipv6_hbh), false },
+        { fast_path_frame_vlan, sizeof(fast_path_frame_vlan), false },
+        { ipv4_opts, sizeof(ipv4_opts), false },
+        { ipv4_icmp, sizeof(ipv4_icmp), false },
+        { ipv4_trunc, sizeof(ipv4_trunc), false },
+        { ipv4_short, sizeof(ipv4_short), false },
+        { ipv6_trunc, sizeof(ipv6_trunc), false },
+        { ipv6_ver, sizeof(ipv6_ver), false },
+        { fast_path_frame, ETHERNET_HEADER_LEN + 10, false },
+    };
+
+    ThreadVars tv_fast, tv_full, tv_scratch;
+    DecodeThreadVars dtv_fast, dtv_full, dtv_scratch;
+    memset(&tv_fast, 0, sizeof(ThreadVars));
+    memset(&tv_full, 0, sizeof(ThreadVars));
+    memset(&tv_scratch, 0, sizeof(ThreadVars));
+    memset(&dtv_fast, 0, sizeof(DecodeThreadVars));
+    memset(&dtv_full, 0, sizeof(DecodeThreadVars));
+    memset(&dtv_scratch, 0, sizeof(DecodeThreadVars));
+    SCMutexInit(&tv_fast.perf_public_ctx.m, NULL);
+    SCMutexInit(&tv_full.perf_public_ctx.m, NULL);
+    DecodeRegisterPerfCounters(&dtv_fast, &tv_fast);
+    DecodeRegisterPerfCounters(&dtv_full, &tv_full);
+    StatsSetupPrivate(&tv_fast);
+    StatsSetupPrivate(&tv_full);
+    FAIL_IF_NOT(tv_fast.perf_private_ctx.size == tv_full.perf_private_ctx.size);
+
+    FlowInitConfig(FLOW_QUIET);
+    const bool fast_path = decoder_fast_path;
+    for (size_t i = 0; i < ARRAY_SIZE(frames); i++) {
+        Packet *p_fast = PacketGetFromAlloc();
+        FAIL_IF_NULL(p_fast);
+        Packet *p_full = PacketGetFromAlloc();
+        FAIL_IF_NULL(p_full);
+        Packet *p_scratch = PacketGetFromAlloc();
+        FAIL_IF_NULL(p_scratch);
+
+        FAIL_IF_NOT(DecodeEthernetFastPath(&tv_scratch, &dtv_scratch, p_scratch, frames[i].pkt,
+                            frames[i].len) == frames[i].fast);
+
+        decoder_fast_path = true;
+        int r_fast = DecodeEthernet(&tv_fast, &dtv_fast, p_fast, frames[i].pkt, frames[i].len);
+        decoder_fast_path = false;
+        int r_full = DecodeEthernet(&tv_full, &dtv_full, p_full, frames[i].pkt, frames[i].len);
+        decoder_fast_path = fast_path;
+
+        FAIL_IF_NOT(r_fast == r_full);
+        FAIL_IF_NOT(p_fast->events.cnt == p_full->events.cnt);
+        for (uint8_t e = 0; e < p_fast->events.cnt; e++) {
+            FAIL_IF_NOT(p_fast->events.events[e] == p_full->events.events[e]);
+        }
+        FAIL_IF_NOT(p_fast->flags == p_full->flags);
+        FAIL_IF_NOT(p_fast->nb_decoded_layers == p_full->nb_decoded_layers);
+        FAIL_IF_NOT(p_fast->proto == p_full->proto);
+        FAIL_IF_NOT(PacketIsIPv4(p_fast) == PacketIsIPv4(p_full));
+        FAIL_IF_NOT(PacketIsIPv6(p_fast) == PacketIsIPv6(p_full));
+        FAIL_IF_NOT(PacketIsTCP(p_fast) == PacketIsTCP(p_full));
+        FAIL_IF_NOT(PacketIsUDP(p_fast) == PacketIsUDP(p_full));
+        FAIL_IF_NOT(CMP_ADDR(&p_fast->src, &p_full->src));
+        FAIL_IF_NOT(CMP_ADDR(&p_fast->dst, &p_full->dst));
+        FAIL_IF_NOT(p_fast->sp == p_full->sp && p_fast->dp == p_full->dp);
+        FAIL_IF_NOT(p_fast->payload_len == p_full->payload_len);
+        FAIL_IF_NOT(p_fast->flow_hash == p_full->flow_hash);
+
+        PacketRecycle(p_fast);
+        PacketRecycle(p_full);
+        PacketRecycle(p_scratch);
+        SCFree(p_fast);
+        SCFree(p_full);
+        SCFree(p_scratch);
+    }
+
+    FAIL_IF_NOT(StatsGetLocalCounterValue(&tv_fast, dtv_fast.counter_eth) == ARRAY_SIZE(frames));
+    for (uint16_t id = 1; id <= tv_fast.perf_private_ctx.size; id++) {
+        FAIL_IF_NOT(StatsGetLocalCounterValue(&tv_fast, id) ==
+                    StatsGetLocalCounterValue(&tv_full, id));
+    }
+
+    FlowShutdown();
+    StatsThreadCleanup(&tv_fast);
+    StatsThreadCleanup(&tv_full);
+    PASS;
+}
+
 #endif /* UNITTESTS */
 
 
@@ -181,6 +580,9 @@ void DecodeEthernetRegisterTests(void)
             DecodeEthernetTestDceNextTooSmall);
     UtRegisterTest("DecodeEthernetTestDceTooSmall",
             DecodeEthernetTestDceTooSmall);
+    UtRegisterTest("DecodeEthernetTestFastPath01", DecodeEthernetTestFastPath01);
+    UtRegisterTest("DecodeEthernetTestFastPath02", DecodeEthernetTestFastPath02);
+    UtRegisterTest("DecodeEthernetTestFastPath03", DecodeEthernetTestFastPath03);
 #endif /* UNITTESTS */
 }
 /**
@@ -481,21 +481,13 @@ struct PacketL4 {
     } vars;
 };
 
-/* sizes of the members:
- * src: 17 bytes
- * dst: 17 bytes
- * sp/type: 1 byte
- * dp/code: 1 byte
- * proto: 1 byte
- * recurs: 1 byte
+/* Layout: the fields used for (almost) every packet are packed into the
+ * first two cache lines (128 bytes on 64 bit platforms), the rest follows
+ * ordered by how often it is used. The PACKET_HOT_FIELD asserts below
+ * guard this, use 'pahole -C Packet' on a built object to inspect it.
  *
- * sum of above: 38 bytes
- *
- * flow ptr: 4/8 bytes
- * flags: 1 byte
- * flowflags: 1 byte
- *
- * sum of above 44/48 bytes
+ * line 1: tuple, vlan, flow flags, action and packet flags
+ * line 2: flow, timestamp, payload, packet data, tunnel root, release
  */
 typedef struct Packet_
 {
@@ -540,6 +532,11 @@ typedef struct Packet_
     /** bit flags of SignatureHookPkt values this packet should trigger */
     uint16_t pkt_hooks;
 
+    /* IPS action to take */
+    uint8_t action;
+
+    uint8_t pkt_src;
+
     /* Pkt Flags */
     uint32_t flags;
 
@@ -549,120 +546,90 @@ typedef struct Packet_
      * hash size still */
     uint32_t flow_hash;
 
-    /* tunnel type: none, root or child */
-    enum PacketTunnelType ttype;
+    /* storage: set to pointer to heap and extended via allocation if necessary */
+    uint32_t pktlen;
 
     SCTime_t ts;
 
-    union {
-        /* nfq stuff */
-#ifdef HAVE_NFLOG
-        NFLOGPacketVars nflog_v;
-#endif /* HAVE_NFLOG */
-#ifdef NFQ
-        NFQPacketVars nfq_v;
-#endif /* NFQ */
-#ifdef IPFW
-        IPFWPacketVars ipfw_v;
-#endif /* IPFW */
-#ifdef AF_PACKET
-        AFPPacketVars afp_v;
-#endif
-#ifdef HAVE_NETMAP
-        NetmapPacketVars netmap_v;
-#endif
-#ifdef WINDIVERT
-        WinDivertPacketVars windivert_v;
-#endif /* WINDIVERT */
-#ifdef HAVE_DPDK
-        DPDKPacketVars dpdk_v;
-#endif
-#ifdef HAVE_AF_XDP
-        AFXDPPacketVars afxdp_v;
-#endif
-        /* A chunk of memory that a plugin can use for its packet vars. */
-        uint8_t plugin_v[PLUGIN_VAR_SIZE];
+    /* ptr to the payload of the packet
+     * with it's length. */
+    uint8_t *payload;
 
-        /** libpcap vars: shared by Pcap Live mode and Pcap File mode */
-        PcapPacketVars pcap_v;
-    };
+    uint8_t *ext_pkt;
+
+    uint16_t payload_len;
+
+    /* count decoded layers of packet : too many layers
+     * cause issues with performance and stability (stack exhaustion)
+     */
+    uint8_t nb_decoded_layers;
+
+    /* enum PacketDropReason::PKT_DROP_REASON_* as uint8_t for compactness */
+    uint8_t drop_reason;
+
+    /* tunnel type: none, root or child */
+    enum PacketTunnelType ttype;
+
+    /* tunnel/encapsulation handling */
+    struct Packet_ *root; /* in case of tunnel this is a ptr
+                           * to the 'real' packet, the one we
+                           * need to set the verdict on --
+                           * It should always point to the lowest
+                           * packet in a encapsulated packet */
 
     /** The release function for packet structure and data */
     void (*ReleasePacket)(struct Packet_ *);
-    /** The function triggering bypass the flow in the capture method.
-     * Return 1 for success and 0 on error */
-    int (*BypassPacketsFlow)(struct Packet_ *);
 
-    /* pkt vars */
-    PktVar *pktvar;
+    /* end of the hot part */
 
     struct PacketL2 l2;
     struct PacketL3 l3;
     struct PacketL4 l4;
 
-    /* ptr to the payload of the packet
-     * with it's length. */
-    uint8_t *payload;
-    uint16_t payload_len;
-
-    /* IPS action to take */
-    uint8_t action;
-
-    uint8_t pkt_src;
-
-    /* storage: set to pointer to heap and extended via allocation if necessary */
-    uint32_t pktlen;
-    uint8_t *ext_pkt;
-
     /* Incoming interface */
     struct LiveDevice_ *livedev;
 
-    PacketAlerts alerts;
+    /* pkt vars */
+    PktVar *pktvar;
 
     struct Host_ *host_src;
     struct Host_ *host_dst;
 
-    /** packet number in the pcap file, matches wireshark */
-    uint64_t pcap_cnt;
-
+    /* double linked list ptrs */
+    struct Packet_ *next;
+    struct Packet_ *prev;
 
     /* engine events */
     PacketEngineEvents events;
 
     AppLayerDecoderEvents *app_layer_events;
 
-    /* double linked list ptrs */
-    struct Packet_ *next;
-    struct Packet_ *prev;
-
-    /** data linktype in host order */
-    int datalink;
+    PacketAlerts alerts;
 
-    /* count decoded layers of packet : too many layers
-     * cause issues with performance and stability (stack exhaustion)
-     */
-    uint8_t nb_decoded_layers;
+    /** packet number in the pcap file, matches wireshark */
+    uint64_t pcap_cnt;
 
-    /* enum PacketDropReason::PKT_DROP_REASON_* as uint8_t for compactness */
-    uint8_t drop_reason;
+    /** ticks at which a latency sampled packet was handed to the autofp
+     *  queue, 0 if not sampled */
+    uint64_t latency_ticks;
 
-    /** has verdict on this tunneled packet been issued? */
-    bool tunnel_verdicted;
+    /** data linktype in host order */
+    int datalink;
 
-    /* tunnel/encapsulation handling */
-    struct Packet_ *root; /* in case of tunnel this is a ptr
-                           * to the 'real' packet, the one we
-                           * need to set the verdict on --
-                           * It should always point to the lowest
-                           * packet in a encapsulated packet */
+    /** tenant id for this packet, if any. If 0 then no tenant was assigned. */
+    uint32_t tenant_id;
 
     /* ready to set verdict counter, only set in root */
     uint16_t tunnel_rtv_cnt;
     /* tunnel packet ref count */
     uint16_t tunnel_tpr_cnt;
 
-    /** tenant id for this packet, if any. If 0 then no tenant was assigned. */
-    uint32_t tenant_id;
+    /** has verdict on this tunneled packet been issued? */
+    bool tunnel_verdicted;
+
+    /** The function triggering bypass the flow in the capture method.
+     * Return 1 for success and 0 on error */
+    int (*BypassPacketsFlow)(struct Packet_ *);
 
     /* The Packet pool from which this packet was allocated. Used when returning
      * the packet to its owner's stack. If NULL, then allocated with malloc.
@@ -672,6 +639,40 @@ typedef struct Packet_
 #ifdef PROFILING
     PktProfiling *profile;
 #endif
+
+    union {
+        /* nfq stuff */
+#ifdef HAVE_NFLOG
+        NFLOGPacketVars nflog_v;
+#endif /* HAVE_NFLOG */
+#ifdef NFQ
+        NFQPacketVars nfq_v;
+#endif /* NFQ */
+#ifdef IPFW
+        IPFWPacketVars ipfw_v;
+#endif /* IPFW */
+#ifdef AF_PACKET
+        AFPPacketVars afp_v;
+#endif
+#ifdef HAVE_NETMAP
+        NetmapPacketVars netmap_v;
+#endif
+#ifdef WINDIVERT
+        WinDivertPacketVars windivert_v;
+#endif /* WINDIVERT */
+#ifdef HAVE_DPDK
+        DPDKPacketVars dpdk_v;
+#endif
+#ifdef HAVE_AF_XDP
+        AFXDPPacketVars afxdp_v;
+#endif
+        /* A chunk of memory that a plugin can use for its packet vars. */
+        uint8_t plugin_v[PLUGIN_VAR_SIZE];
+
+        /** libpcap vars: shared by Pcap Live mode and Pcap File mode */
+        PcapPacketVars pcap_v;
+    };
+
     /* things in the packet that live beyond a reinit */
     struct {
         /** lock to protect access to:
@@ -689,6 +690,33 @@ typedef struct Packet_
     uint8_t pkt_data[];
 } Packet;
 
+/** size of the hot part of the Packet: two cache lines of 64 bytes */
+#define PACKET_HOT_SIZE 128
+
+/** \brief guard that a Packet member stays in the hot part of the Packet */
+#define PACKET_HOT_FIELD(f)                                                                        \
+    _Static_assert(offsetof(Packet, f) + sizeof(((Packet *)0)->f) <= PACKET_HOT_SIZE,              \
+            "Packet::" #f " must be in the first two cache lines")
+
+PACKET_HOT_FIELD(src);
+PACKET_HOT_FIELD(dst);
+PACKET_HOT_FIELD(sp);
+PACKET_HOT_FIELD(dp);
+PACKET_HOT_FIELD(proto);
+PACKET_HOT_FIELD(flowflags);
+PACKET_HOT_FIELD(action);
+PACKET_HOT_FIELD(flags);
+PACKET_HOT_FIELD(flow);
+PACKET_HOT_FIELD(flow_hash);
+PACKET_HOT_FIELD(pktlen);
+PACKET_HOT_FIELD(ts);
+PACKET_HOT_FIELD(payload);
+PACKET_HOT_FIELD(ext_pkt);
+PACKET_HOT_FIELD(payload_len);
+PACKET_HOT_FIELD(ttype);
+PACKET_HOT_FIELD(root);
+PACKET_HOT_FIELD(ReleasePacket);
+
 static inline bool PacketIsIPv4(const Packet *p);
 static inline bool PacketIsIPv6(const Packet *p);
 
@@ -1326,6 +1354,7 @@ void DecodeUnregisterCounters(void);
 
 #define PKT_DEFAULT_MAX_DECODED_LAYERS 16
 extern uint8_t decoder_max_layers;
+extern bool decoder_fast_path;
 
 static inline bool PacketIncreaseCheckLayers(Packet *p)
 {
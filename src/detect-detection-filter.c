@@ -49,7 +49,8 @@
 #define PARSE_REGEX                                                                                \
     "^\\s*(track|count|seconds)\\s+(by_src|by_dst|by_flow|\\d+)\\s*,\\s*(track|count|seconds)\\s+" \
     "(by_src|"                                                                                     \
-    "by_dst|by_flow|\\d+)\\s*,\\s*(track|count|seconds)\\s+(by_src|by_dst|by_flow|\\d+)\\s*$"
+    "by_dst|by_flow|\\d+)\\s*,\\s*(track|count|seconds)\\s+(by_src|by_dst|by_flow|\\d+)\\s*"       \
+    "(?:,\\s*(exact)\\s*)?$"
 
 static DetectParseRegex parse_regex;
 
@@ -104,7 +105,7 @@ static DetectThresholdData *DetectDetectionFilterParse(const char *rawstr)
     int res = 0;
     size_t pcre2_len;
     const char *str_ptr = NULL;
-    char *args[6] = { NULL, NULL, NULL, NULL, NULL, NULL };
+    char *args[7] = { NULL, NULL, NULL, NULL, NULL, NULL, NULL };
     char *copy_str = NULL, *df_opt = NULL;
     int seconds_found = 0, count_found = 0, track_found = 0;
     int seconds_pos = 0, count_pos = 0;
@@ -165,6 +166,8 @@ static DetectThresholdData *DetectDetectionFilterParse(const char *rawstr)
             count_pos = i + 1;
         if (strncasecmp(args[i], "seconds", strlen("seconds")) == 0)
             seconds_pos = i + 1;
+        if (strcasecmp(args[i], "exact") == 0)
+            df->flags |= THRESHOLD_FLAG_EXACT;
     }
 
     if (args[count_pos] == NULL || args[seconds_pos] == NULL) {
@@ -367,6 +370,21 @@ static int DetectDetectionFilterTestParse06(void)
     PASS;
 }
 
+/** \test exact option */
+static int DetectDetectionFilterTestParse07(void)
+{
+    DetectThresholdData *df =
+            DetectDetectionFilterParse("track by_src, count 10, seconds 60, exact");
+    FAIL_IF_NULL(df);
+    FAIL_IF_NOT(df->track == TRACK_SRC);
+    FAIL_IF_NOT(df->count == 10);
+    FAIL_IF_NOT(df->seconds == 60);
+    FAIL_IF_NOT(df->flags & THRESHOLD_FLAG_EXACT);
+    DetectDetectionFilterFree(NULL, df);
+
+    PASS;
+}
+
 /**
  * \test DetectDetectionFilterTestSig1 is a test for checking the working of detection_filter
  * keyword by setting up the signature and later testing its working by matching the received packet
@@ -569,6 +587,7 @@ static void DetectDetectionFilterRegisterTests(void)
     UtRegisterTest("DetectDetectionFilterTestParse04", DetectDetectionFilterTestParse04);
     UtRegisterTest("DetectDetectionFilterTestParse05", DetectDetectionFilterTestParse05);
     UtRegisterTest("DetectDetectionFilterTestParse06", DetectDetectionFilterTestParse06);
+    UtRegisterTest("DetectDetectionFilterTestParse07", DetectDetectionFilterTestParse07);
     UtRegisterTest("DetectDetectionFilterTestSig1", DetectDetectionFilterTestSig1);
     UtRegisterTest("DetectDetectionFilterTestSig2", DetectDetectionFilterTestSig2);
     UtRegisterTest("DetectDetectionFilterTestSig3", DetectDetectionFilterTestSig3);
@@ -32,6 +32,7 @@
 #include "detect-parse.h"
 #include "detect-engine.h"
 #include "detect-engine-analyzer.h"
+#include "detect-engine-content-inspection.h"
 #include "detect-engine-mpm.h"
 #include "detect-engine-uint.h"
 #include "conf.h"
@@ -731,6 +732,10 @@ static void DumpMatches(RuleAnalyzer *ctx, SCJsonBuilder *js, const SigMatchData
     if (smd == NULL)
         return;
 
+    const char *fast_path = DetectEngineContentInspectionFastPathToString(smd);
+    if (fast_path != NULL) {
+        SCJbSetString(js, "fast_path", fast_path);
+    }
     SCJbOpenArray(js, "matches");
     do {
         SCJbStartObject(js);
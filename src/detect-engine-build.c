@@ -24,6 +24,7 @@
 #include "detect-engine-build.h"
 #include "detect-engine-address.h"
 #include "detect-engine-analyzer.h"
+#include "detect-engine-content-inspection.h"
 #include "detect-engine-iponly.h"
 #include "detect-engine-mpm.h"
 #include "detect-engine-siggroup.h"
@@ -37,6 +38,7 @@
 #include "detect-flow.h"
 #include "detect-config.h"
 #include "detect-flowbits.h"
+#include "detect-pcre-hs.h"
 
 #include "app-layer-events.h"
 
@@ -1877,6 +1879,16 @@ int SigPrepareStage2(DetectEngineCtx *de_ctx)
     de_ctx->flow_gh[1].udp = RulesGroupByPorts(de_ctx, IPPROTO_UDP, SIG_FLAG_TOSERVER);
     de_ctx->flow_gh[0].udp = RulesGroupByPorts(de_ctx, IPPROTO_UDP, SIG_FLAG_TOCLIENT);
 
+    /* flatten the port groups for the per packet rule group lookup */
+    for (int f = 0; f < FLOW_STATES; f++) {
+        DetectEngineLookupFlow *gh = &de_ctx->flow_gh[f];
+        if (DetectPortLookupTableBuild(&gh->tcp_table, gh->tcp) != 0 ||
+                DetectPortLookupTableBuild(&gh->udp_table, gh->udp) != 0) {
+            SCLogError("failed to build port group lookup tables");
+            return -1;
+        }
+    }
+
     /* Setup the other IP Protocols (so not TCP/UDP) */
     RulesGroupByIPProto(de_ctx);
 
@@ -1980,6 +1992,8 @@ int SigAddressCleanupStage1(DetectEngineCtx *de_ctx)
         }
 
         /* free lookup lists */
+        DetectPortLookupTableFree(&de_ctx->flow_gh[f].tcp_table);
+        DetectPortLookupTableFree(&de_ctx->flow_gh[f].udp_table);
         DetectPortCleanupList(de_ctx, de_ctx->flow_gh[f].tcp);
         de_ctx->flow_gh[f].tcp = NULL;
         DetectPortCleanupList(de_ctx, de_ctx->flow_gh[f].udp);
@@ -2054,8 +2068,10 @@ int SigPrepareStage4(DetectEngineCtx *de_ctx)
 
         SigGroupHeadSetupFiles(de_ctx, sgh);
         SCLogDebug("filestore count %u", sgh->filestore_cnt);
+        SigGroupHeadSetupPktDigest(de_ctx, sgh);
 
         PrefilterSetupRuleGroup(de_ctx, sgh);
+        DetectPcreHsSetupRuleGroup(de_ctx, sgh);
 
         sgh->id = idx;
         cnt++;
@@ -2063,6 +2079,7 @@ int SigPrepareStage4(DetectEngineCtx *de_ctx)
     SCLogPerf("Unique rule groups: %u", cnt);
 
     MpmStoreReportStats(de_ctx);
+    DetectPcreHsReportStats(de_ctx);
 
     if (de_ctx->decoder_event_sgh != NULL) {
         /* no need to set filestore count here as that would make a
@@ -2099,12 +2116,31 @@ int SigPrepareStage4(DetectEngineCtx *de_ctx)
     SCReturnInt(0);
 }
 
+/** \internal
+ *  \brief select the specialized content inspection routines for the
+ *         buffers of a signature
+ */
+static void SigSetupContentInspection(Signature *s)
+{
+    DetectEngineContentInspectionSpecialize(s->sm_arrays[DETECT_SM_LIST_PMATCH]);
+    for (DetectEnginePktInspectionEngine *e = s->pkt_inspect; e != NULL; e = e->next) {
+        DetectEngineContentInspectionSpecialize(e->smd);
+    }
+    for (DetectEngineFrameInspectionEngine *e = s->frame_inspect; e != NULL; e = e->next) {
+        DetectEngineContentInspectionSpecialize(e->smd);
+    }
+    for (DetectEngineAppInspectionEngine *e = s->app_inspect; e != NULL; e = e->next) {
+        DetectEngineContentInspectionSpecialize(e->smd);
+    }
+}
+
 extern bool rule_engine_analysis_set;
 /** \internal
  *  \brief perform final per signature setup tasks
  *
  *  - Create SigMatchData arrays from the init only SigMatch lists
  *  - Setup per signature inspect engines
+ *  - Select specialized content inspection routines
  *  - remove signature init data.
  */
 static int SigMatchPrepare(DetectEngineCtx *de_ctx)
@@ -2126,6 +2162,7 @@ static int SigMatchPrepare(DetectEngineCtx *de_ctx)
         }
         /* set up the pkt inspection engines */
         DetectEnginePktInspectionSetup(s);
+        SigSetupContentInspection(s);
 
         if (rule_engine_analysis_set) {
             EngineAnalysisAddAllRulePatterns(de_ctx, s);
@@ -76,6 +76,176 @@ struct DetectEngineContentInspectionCtx {
     } recursion;
 };
 
+/** \internal
+ *  \brief get the window of the buffer to search for content 'cd'
+ *
+ *  \param prev_buffer_offset end of the previous match for relative matching
+ *  \param prev_offset if non-zero, offset to continue searching from after
+ *                     a previous occurrence of this content
+ *  \param offset_out start of the search window
+ *  \param depth_out end of the search window, capped to buffer_len
+ *
+ *  \retval false the content can't match in this part of the stream
+ */
+static inline bool ContentGetWindow(const DetectEngineThreadCtx *det_ctx,
+        const DetectContentData *cd, const uint32_t buffer_len, const uint64_t stream_start_offset,
+        const uint32_t prev_buffer_offset, const uint32_t prev_offset, uint32_t *offset_out,
+        uint32_t *depth_out)
+{
+    uint32_t depth = buffer_len;
+    uint32_t offset = 0;
+    if ((cd->flags & DETECT_CONTENT_DISTANCE) ||
+        (cd->flags & DETECT_CONTENT_WITHIN)) {
+        SCLogDebug("det_ctx->buffer_offset %" PRIu32, det_ctx->buffer_offset);
+        offset = prev_buffer_offset;
+
+        int distance = cd->distance;
+        if (cd->flags & DETECT_CONTENT_DISTANCE) {
+            if (cd->flags & DETECT_CONTENT_DISTANCE_VAR) {
+                // This cast is wrong if a 64-bit value was extracted
+                distance = (uint32_t)det_ctx->byte_values[cd->distance];
+            }
+            if (distance < 0 && (uint32_t)(abs(distance)) > offset)
+                offset = 0;
+            else
+                offset += distance;
+
+            SCLogDebug("cd->distance %"PRIi32", offset %"PRIu32", depth %"PRIu32,
+                       distance, offset, depth);
+        }
+
+        if (cd->flags & DETECT_CONTENT_WITHIN) {
+            if (cd->flags & DETECT_CONTENT_WITHIN_VAR) {
+                // This cast is wrong if a 64-bit value was extracted for within
+                if ((int32_t)depth > (int32_t)(prev_buffer_offset + det_ctx->byte_values[cd->within] + distance)) {
+                    depth = prev_buffer_offset +
+                            (uint32_t)det_ctx->byte_values[cd->within] + distance;
+                }
+            } else {
+                if ((int32_t)depth > (int32_t)(prev_buffer_offset + cd->within + distance)) {
+                    depth = prev_buffer_offset + cd->within + distance;
+                }
+
+                SCLogDebug("cd->within %"PRIi32", det_ctx->buffer_offset %"PRIu32", depth %"PRIu32,
+                           cd->within, prev_buffer_offset, depth);
+            }
+
+            if (stream_start_offset != 0 && prev_buffer_offset == 0) {
+                if (depth <= stream_start_offset) {
+                    return false;
+                } else if (depth >= (stream_start_offset + buffer_len)) {
+                    ;
+                } else {
+                    depth = depth - (uint32_t)stream_start_offset;
+                }
+            }
+        }
+
+        if (cd->flags & DETECT_CONTENT_DEPTH_VAR) {
+            if ((det_ctx->byte_values[cd->depth] + prev_buffer_offset) < depth) {
+                // ok to cast as we checked the byte value fits in a u32
+                depth = prev_buffer_offset + (uint32_t)det_ctx->byte_values[cd->depth];
+            }
+        } else {
+            if (cd->depth != 0) {
+                if ((cd->depth + prev_buffer_offset) < depth) {
+                    depth = prev_buffer_offset + cd->depth;
+                }
+
+                SCLogDebug("cd->depth %"PRIu32", depth %"PRIu32, cd->depth, depth);
+            }
+        }
+
+        if (cd->flags & DETECT_CONTENT_OFFSET_VAR) {
+            if (det_ctx->byte_values[cd->offset] > offset) {
+                // This cast is wrong if a 64-bit value was extracted
+                offset = (uint32_t)det_ctx->byte_values[cd->offset];
+            }
+        } else {
+            if (cd->offset > offset) {
+                offset = cd->offset;
+                SCLogDebug("setting offset %"PRIu32, offset);
+            }
+        }
+    } else { /* implied no relative matches */
+        /* set depth */
+        if (cd->flags & DETECT_CONTENT_DEPTH_VAR) {
+            // This cast is wrong if a 64-bit value was extracted
+            depth = (uint32_t)det_ctx->byte_values[cd->depth];
+        } else {
+            if (cd->depth != 0) {
+                depth = cd->depth;
+            }
+        }
+
+        if (stream_start_offset != 0 && cd->flags & DETECT_CONTENT_DEPTH) {
+            if (depth <= stream_start_offset) {
+                return false;
+            } else if (depth >= (stream_start_offset + buffer_len)) {
+                ;
+            } else {
+                depth = (uint32_t)(depth - stream_start_offset);
+            }
+        }
+
+        /* set offset */
+        if (cd->flags & DETECT_CONTENT_OFFSET_VAR) {
+            // This cast is wrong if a 64-bit value was extracted
+            offset = (uint32_t)det_ctx->byte_values[cd->offset];
+        } else {
+            offset = cd->offset;
+        }
+    }
+
+    /* If the value came from a variable, make sure to adjust the depth so it's relative
+     * to the offset value.
+     */
+    if (cd->flags & (DETECT_CONTENT_OFFSET_VAR | DETECT_CONTENT_DEPTH_VAR)) {
+        depth += offset;
+    }
+
+    /* update offset with prev_offset if we're searching for
+     * matches after the first occurrence. */
+    SCLogDebug("offset %"PRIu32", prev_offset %"PRIu32, offset, prev_offset);
+    if (prev_offset != 0)
+        offset = prev_offset;
+
+    SCLogDebug("offset %"PRIu32", depth %"PRIu32, offset, depth);
+
+    if (depth > buffer_len)
+        depth = buffer_len;
+
+    *offset_out = offset;
+    *depth_out = depth;
+    return true;
+}
+
+/** \internal
+ *  \brief search for content 'cd' in the window [offset, depth) of the buffer
+ *
+ *  \retval found start of the match or NULL
+ */
+static inline const uint8_t *ContentSearch(DetectEngineThreadCtx *det_ctx,
+        const DetectContentData *cd, const uint8_t *buffer, const uint32_t buffer_len,
+        const uint32_t offset, const uint32_t depth)
+{
+    const uint8_t *sbuffer = buffer + offset;
+    uint32_t sbuffer_len = depth - offset;
+    SCLogDebug("sbuffer_len %" PRIu32 " depth: %" PRIu32 ", buffer_len: %" PRIu32,
+            sbuffer_len, depth, buffer_len);
+#ifdef DEBUG
+    BUG_ON(sbuffer_len > buffer_len);
+#endif
+    if (cd->flags & DETECT_CONTENT_ENDS_WITH && depth < buffer_len) {
+        SCLogDebug("depth < buffer_len while DETECT_CONTENT_ENDS_WITH is set. Can't possibly match.");
+        return NULL;
+    } else if (cd->content_len > sbuffer_len) {
+        return NULL;
+    }
+    /* do the actual search */
+    return SpmScan(cd->spm_ctx, det_ctx->spm_thread_ctx, sbuffer, sbuffer_len);
+}
+
 /**
  * \brief Run the actual payload match functions
  *
@@ -147,130 +317,13 @@ static int DetectEngineContentInspectionInternal(DetectEngineThreadCtx *det_ctx,
         uint32_t prev_buffer_offset = det_ctx->buffer_offset;
 
         do {
-            uint32_t depth = buffer_len;
-            uint32_t offset = 0;
-            if ((cd->flags & DETECT_CONTENT_DISTANCE) ||
-                (cd->flags & DETECT_CONTENT_WITHIN)) {
-                SCLogDebug("det_ctx->buffer_offset %" PRIu32, det_ctx->buffer_offset);
-                offset = prev_buffer_offset;
-
-                int distance = cd->distance;
-                if (cd->flags & DETECT_CONTENT_DISTANCE) {
-                    if (cd->flags & DETECT_CONTENT_DISTANCE_VAR) {
-                        // This cast is wrong if a 64-bit value was extracted
-                        distance = (uint32_t)det_ctx->byte_values[cd->distance];
-                    }
-                    if (distance < 0 && (uint32_t)(abs(distance)) > offset)
-                        offset = 0;
-                    else
-                        offset += distance;
-
-                    SCLogDebug("cd->distance %"PRIi32", offset %"PRIu32", depth %"PRIu32,
-                               distance, offset, depth);
-                }
-
-                if (cd->flags & DETECT_CONTENT_WITHIN) {
-                    if (cd->flags & DETECT_CONTENT_WITHIN_VAR) {
-                        // This cast is wrong if a 64-bit value was extracted for within
-                        if ((int32_t)depth > (int32_t)(prev_buffer_offset + det_ctx->byte_values[cd->within] + distance)) {
-                            depth = prev_buffer_offset +
-                                    (uint32_t)det_ctx->byte_values[cd->within] + distance;
-                        }
-                    } else {
-                        if ((int32_t)depth > (int32_t)(prev_buffer_offset + cd->within + distance)) {
-                            depth = prev_buffer_offset + cd->within + distance;
-                        }
-
-                        SCLogDebug("cd->within %"PRIi32", det_ctx->buffer_offset %"PRIu32", depth %"PRIu32,
-                                   cd->within, prev_buffer_offset, depth);
-                    }
-
-                    if (stream_start_offset != 0 && prev_buffer_offset == 0) {
-                        if (depth <= stream_start_offset) {
-                            goto no_match;
-                        } else if (depth >= (stream_start_offset + buffer_len)) {
-                            ;
-                        } else {
-                            depth = depth - (uint32_t)stream_start_offset;
-                        }
-                    }
-                }
-
-                if (cd->flags & DETECT_CONTENT_DEPTH_VAR) {
-                    if ((det_ctx->byte_values[cd->depth] + prev_buffer_offset) < depth) {
-                        // ok to cast as we checked the byte value fits in a u32
-                        depth = prev_buffer_offset + (uint32_t)det_ctx->byte_values[cd->depth];
-                    }
-                } else {
-                    if (cd->depth != 0) {
-                        if ((cd->depth + prev_buffer_offset) < depth) {
-                            depth = prev_buffer_offset + cd->depth;
-                        }
-
-                        SCLogDebug("cd->depth %"PRIu32", depth %"PRIu32, cd->depth, depth);
-                    }
-                }
-
-                if (cd->flags & DETECT_CONTENT_OFFSET_VAR) {
-                    if (det_ctx->byte_values[cd->offset] > offset) {
-                        // This cast is wrong if a 64-bit value was extracted
-                        offset = (uint32_t)det_ctx->byte_values[cd->offset];
-                    }
-                } else {
-                    if (cd->offset > offset) {
-                        offset = cd->offset;
-                        SCLogDebug("setting offset %"PRIu32, offset);
-                    }
-                }
-            } else { /* implied no relative matches */
-                /* set depth */
-                if (cd->flags & DETECT_CONTENT_DEPTH_VAR) {
-                    // This cast is wrong if a 64-bit value was extracted
-                    depth = (uint32_t)det_ctx->byte_values[cd->depth];
-                } else {
-                    if (cd->depth != 0) {
-                        depth = cd->depth;
-                    }
-                }
-
-                if (stream_start_offset != 0 && cd->flags & DETECT_CONTENT_DEPTH) {
-                    if (depth <= stream_start_offset) {
-                        goto no_match;
-                    } else if (depth >= (stream_start_offset + buffer_len)) {
-                        ;
-                    } else {
-                        depth = (uint32_t)(depth - stream_start_offset);
-                    }
-                }
-
-                /* set offset */
-                if (cd->flags & DETECT_CONTENT_OFFSET_VAR) {
-                    // This cast is wrong if a 64-bit value was extracted
-                    offset = (uint32_t)det_ctx->byte_values[cd->offset];
-                } else {
-                    offset = cd->offset;
-                }
-                prev_buffer_offset = 0;
-            }
-
-            /* If the value came from a variable, make sure to adjust the depth so it's relative
-             * to the offset value.
-             */
-            if (cd->flags & (DETECT_CONTENT_OFFSET_VAR | DETECT_CONTENT_DEPTH_VAR)) {
-                depth += offset;
+            uint32_t depth;
+            uint32_t offset;
+            if (!ContentGetWindow(det_ctx, cd, buffer_len, stream_start_offset,
+                        prev_buffer_offset, prev_offset, &offset, &depth)) {
+                goto no_match;
             }
 
-            /* update offset with prev_offset if we're searching for
-             * matches after the first occurrence. */
-            SCLogDebug("offset %"PRIu32", prev_offset %"PRIu32, offset, prev_offset);
-            if (prev_offset != 0)
-                offset = prev_offset;
-
-            SCLogDebug("offset %"PRIu32", depth %"PRIu32, offset, depth);
-
-            if (depth > buffer_len)
-                depth = buffer_len;
-
             /* if offset is bigger than depth we can never match on a pattern.
              * We can however, "match" on a negated pattern. */
             if (offset > depth || depth == 0) {
@@ -281,24 +334,8 @@ static int DetectEngineContentInspectionInternal(DetectEngineThreadCtx *det_ctx,
                 }
             }
 
-            const uint8_t *sbuffer = buffer + offset;
-            uint32_t sbuffer_len = depth - offset;
-            SCLogDebug("sbuffer_len %" PRIu32 " depth: %" PRIu32 ", buffer_len: %" PRIu32,
-                    sbuffer_len, depth, buffer_len);
-#ifdef DEBUG
-            BUG_ON(sbuffer_len > buffer_len);
-#endif
-            const uint8_t *found;
-            if (cd->flags & DETECT_CONTENT_ENDS_WITH && depth < buffer_len) {
-                SCLogDebug("depth < buffer_len while DETECT_CONTENT_ENDS_WITH is set. Can't possibly match.");
-                found = NULL;
-            } else if (cd->content_len > sbuffer_len) {
-                found = NULL;
-            } else {
-                /* do the actual search */
-                found = SpmScan(cd->spm_ctx, det_ctx->spm_thread_ctx, sbuffer,
-                        sbuffer_len);
-            }
+            const uint32_t sbuffer_len = depth - offset;
+            const uint8_t *found = ContentSearch(det_ctx, cd, buffer, buffer_len, offset, depth);
 
             /* next we evaluate the result in combination with the
              * negation flag. */
@@ -742,6 +779,192 @@ final_match:
     SCReturnInt(1);
 }
 
+/** \internal
+ *  \brief DETECT_CI_FAST_CONTENT: single, independent content
+ *
+ *  \retval 1 match
+ *  \retval -1 no match
+ */
+static int DetectEngineContentInspectionFastContent(DetectEngineThreadCtx *det_ctx,
+        struct DetectEngineContentInspectionCtx *ctx, const SigMatchData *smd,
+        const uint8_t *buffer, const uint32_t buffer_len, const uint64_t stream_start_offset)
+{
+    const DetectContentData *cd = (const DetectContentData *)smd->ctx;
+    ctx->recursion.count++;
+    if (unlikely(ctx->recursion.count == ctx->recursion.limit)) {
+        return -1;
+    }
+
+    uint32_t offset, depth;
+    if (buffer == NULL || !ContentGetWindow(det_ctx, cd, buffer_len, stream_start_offset, 0, 0,
+                                  &offset, &depth)) {
+        return -1;
+    }
+    if (offset > depth || depth == 0)
+        return -1;
+
+    const uint8_t *found = ContentSearch(det_ctx, cd, buffer, buffer_len, offset, depth);
+    if (found == NULL)
+        return -1;
+
+    det_ctx->buffer_offset = (uint32_t)((found - buffer) + cd->content_len);
+    return 1;
+}
+
+/** \internal
+ *  \brief DETECT_CI_FAST_CONTENT_CHAIN: contents and isdataat
+ *
+ *  Iterative version of DetectEngineContentInspectionInternal for lists
+ *  of only content and isdataat keywords, without variables or replace.
+ *  The results, including det_ctx->buffer_offset and the recursion
+ *  accounting, are the same as the generic engine's.
+ *
+ *  Matching contents that the next keywords depend on are put on a stack.
+ *  If the rest of the list doesn't match, the last of them is searched
+ *  for again after its previous occurrence, as the recursive engine does
+ *  when the call for the next keyword returns.
+ *
+ *  \retval -1 no match and give up
+ *  \retval 0 no match
+ *  \retval 1 match
+ */
+static int DetectEngineContentInspectionFastChain(DetectEngineThreadCtx *det_ctx,
+        struct DetectEngineContentInspectionCtx *ctx, const SigMatchData *smd,
+        const uint8_t *buffer, const uint32_t buffer_len, const uint64_t stream_start_offset)
+{
+    struct {
+        const SigMatchData *smd;
+        uint32_t prev_buffer_offset;
+        uint32_t match_offset;
+    } stack[DETECT_CI_FAST_CHAIN_MAX];
+    uint32_t sp = 0;
+    const DetectContentData *cd;
+    const uint8_t *found;
+    uint32_t prev_buffer_offset, prev_offset;
+    uint32_t offset, depth, match_offset;
+    int r;
+
+    if (buffer == NULL) {
+        ctx->recursion.count++;
+        return 0;
+    }
+
+next:
+    ctx->recursion.count++;
+    if (unlikely(ctx->recursion.count == ctx->recursion.limit)) {
+        return -1;
+    }
+
+    if (smd->type == DETECT_ISDATAAT) {
+        const DetectIsdataatData *id = (const DetectIsdataatData *)smd->ctx;
+        if (id->flags & ISDATAAT_RELATIVE) {
+            const bool has_data = !(det_ctx->buffer_offset + id->dataat > buffer_len);
+            if (has_data == !(id->flags & ISDATAAT_NEGATED))
+                goto match;
+            r = has_data ? 0 : -1;
+        } else {
+            const bool has_data = id->dataat < buffer_len;
+            if (has_data == !(id->flags & ISDATAAT_NEGATED))
+                goto match;
+            r = -1;
+        }
+        goto unwind;
+    }
+
+    DEBUG_VALIDATE_BUG_ON(smd->type != DETECT_CONTENT);
+    cd = (const DetectContentData *)smd->ctx;
+    prev_buffer_offset = det_ctx->buffer_offset;
+    prev_offset = 0;
+
+search:
+    if (!ContentGetWindow(det_ctx, cd, buffer_len, stream_start_offset, prev_buffer_offset,
+                prev_offset, &offset, &depth)) {
+        r = 0;
+        goto unwind;
+    }
+    if (offset > depth || depth == 0) {
+        if (cd->flags & DETECT_CONTENT_NEGATED)
+            goto match;
+        r = 0;
+        goto unwind;
+    }
+
+    found = ContentSearch(det_ctx, cd, buffer, buffer_len, offset, depth);
+    if (found == NULL) {
+        if (cd->flags & DETECT_CONTENT_NEGATED)
+            goto match;
+        r = (cd->flags & (DETECT_CONTENT_DISTANCE | DETECT_CONTENT_WITHIN)) ? 0 : -1;
+        goto unwind;
+    }
+
+    match_offset = (uint32_t)((found - buffer) + cd->content_len);
+    if (cd->flags & DETECT_CONTENT_NEGATED) {
+        if ((cd->flags & DETECT_CONTENT_ENDS_WITH) && depth - offset != match_offset)
+            goto match;
+        r = DETECT_CONTENT_IS_SINGLE(cd) ? -1 : 0;
+        goto unwind;
+    }
+
+    det_ctx->buffer_offset = match_offset;
+    if ((cd->flags & DETECT_CONTENT_ENDS_WITH) == 0 || match_offset == buffer_len) {
+        if (smd->is_last)
+            return 1;
+
+        stack[sp].smd = smd;
+        stack[sp].prev_buffer_offset = prev_buffer_offset;
+        stack[sp].match_offset = match_offset;
+        sp++;
+        smd++;
+        goto next;
+    }
+    prev_offset = match_offset - (cd->content_len - 1);
+    goto search;
+
+unwind:
+    /* 1 and -1 end the inspection, on 0 the last matching content looks
+     * for its next occurrence if the keywords after it depend on it */
+    if (r != 0 || sp == 0)
+        return r;
+    sp--;
+    smd = stack[sp].smd;
+    cd = (const DetectContentData *)smd->ctx;
+    if ((cd->flags & DETECT_CONTENT_WITHIN_NEXT) == 0)
+        return -1;
+    prev_buffer_offset = stack[sp].prev_buffer_offset;
+    prev_offset = stack[sp].match_offset - (cd->content_len - 1);
+    goto search;
+
+match:
+    if (smd->is_last)
+        return 1;
+    smd++;
+    goto next;
+}
+
+/** \internal
+ *  \brief run the specialized routine for the list if it has one */
+static inline int DetectEngineContentInspectionRun(DetectEngineThreadCtx *det_ctx,
+        struct DetectEngineContentInspectionCtx *ctx, const Signature *s, const SigMatchData *smd,
+        Packet *p, Flow *f, const uint8_t *buffer, const uint32_t buffer_len,
+        const uint64_t stream_start_offset, const uint8_t flags,
+        const enum DetectContentInspectionType inspection_mode)
+{
+    if (smd != NULL) {
+        switch (smd->ci_fast) {
+            case DETECT_CI_FAST_CONTENT:
+                return DetectEngineContentInspectionFastContent(
+                        det_ctx, ctx, smd, buffer, buffer_len, stream_start_offset);
+            case DETECT_CI_FAST_CONTENT_CHAIN:
+                return DetectEngineContentInspectionFastChain(
+                        det_ctx, ctx, smd, buffer, buffer_len, stream_start_offset);
+            default:
+                break;
+        }
+    }
+    return DetectEngineContentInspectionInternal(det_ctx, ctx, s, smd, p, f, buffer, buffer_len,
+            stream_start_offset, flags, inspection_mode);
+}
+
 /** \brief wrapper around DetectEngineContentInspectionInternal to return true/false only
  *
  *  \param smd sigmatches to evaluate
@@ -755,7 +978,7 @@ bool DetectEngineContentInspection(DetectEngineCtx *de_ctx, DetectEngineThreadCt
         .recursion.limit = de_ctx->inspection_recursion_limit };
     det_ctx->buffer_offset = 0;
 
-    int r = DetectEngineContentInspectionInternal(det_ctx, &ctx, s, smd, p, f, buffer, buffer_len,
+    int r = DetectEngineContentInspectionRun(det_ctx, &ctx, s, smd, p, f, buffer, buffer_len,
             stream_start_offset, flags, inspection_mode);
 #ifdef UNITTESTS
     ut_inspection_recursion_counter = ctx.recursion.count;
@@ -779,7 +1002,7 @@ bool DetectEngineContentInspectionBuffer(DetectEngineCtx *de_ctx, DetectEngineTh
 
     det_ctx->buffer_offset = 0;
 
-    int r = DetectEngineContentInspectionInternal(det_ctx, &ctx, s, smd, p, f, b->inspect,
+    int r = DetectEngineContentInspectionRun(det_ctx, &ctx, s, smd, p, f, b->inspect,
             b->inspect_len, b->inspect_offset, b->flags, inspection_mode);
 #ifdef UNITTESTS
     ut_inspection_recursion_counter = ctx.recursion.count;
@@ -808,6 +1031,67 @@ bool DetectContentInspectionMatchOnAbsentBuffer(const SigMatchData *smd)
     return absent_data;
 }
 
+/** \brief select a specialized inspection routine for a list
+ *
+ *  Lists of only content and isdataat keywords without byte variables
+ *  or 'replace' can be inspected without the generic engine.
+ *
+ *  \param smd array of content inspection matches
+ */
+void DetectEngineContentInspectionSpecialize(SigMatchData *smd)
+{
+    if (smd == NULL)
+        return;
+
+    smd->ci_fast = DETECT_CI_FAST_NONE;
+    uint32_t cnt = 0;
+    for (const SigMatchData *m = smd;; m++) {
+        if (++cnt > DETECT_CI_FAST_CHAIN_MAX)
+            return;
+
+        if (m->type == DETECT_CONTENT) {
+            const DetectContentData *cd = (const DetectContentData *)m->ctx;
+            if (cd->flags & (DETECT_CONTENT_OFFSET_VAR | DETECT_CONTENT_DEPTH_VAR |
+                                    DETECT_CONTENT_DISTANCE_VAR | DETECT_CONTENT_WITHIN_VAR |
+                                    DETECT_CONTENT_REPLACE))
+                return;
+        } else if (m->type == DETECT_ISDATAAT) {
+            const DetectIsdataatData *id = (const DetectIsdataatData *)m->ctx;
+            if (id->flags & ISDATAAT_OFFSET_VAR)
+                return;
+        } else {
+            return;
+        }
+        if (m->is_last)
+            break;
+    }
+
+    if (cnt == 1 && smd->type == DETECT_CONTENT &&
+            (((const DetectContentData *)smd->ctx)->flags &
+                    (DETECT_CONTENT_DISTANCE | DETECT_CONTENT_WITHIN | DETECT_CONTENT_NEGATED |
+                            DETECT_CONTENT_ENDS_WITH)) == 0) {
+        smd->ci_fast = DETECT_CI_FAST_CONTENT;
+    } else {
+        smd->ci_fast = DETECT_CI_FAST_CONTENT_CHAIN;
+    }
+}
+
+/** \brief get the name of the specialized inspection routine of a list
+ *  \retval name or NULL if the list uses the generic inspection */
+const char *DetectEngineContentInspectionFastPathToString(const SigMatchData *smd)
+{
+    if (smd == NULL)
+        return NULL;
+    switch (smd->ci_fast) {
+        case DETECT_CI_FAST_CONTENT:
+            return "content";
+        case DETECT_CI_FAST_CONTENT_CHAIN:
+            return "content_chain";
+        default:
+            return NULL;
+    }
+}
+
 #ifdef UNITTESTS
 #include "tests/detect-engine-content-inspection.c"
 #endif
@@ -48,6 +48,22 @@ enum DetectContentInspectionType {
  *  inspection function contains both start and end of the data. */
 #define DETECT_CI_FLAGS_SINGLE  (DETECT_CI_FLAGS_START|DETECT_CI_FLAGS_END)
 
+/** specialized inspection routines for common keyword lists, used
+ *  instead of the generic recursive inspection */
+enum DetectContentInspectionFastPath {
+    DETECT_CI_FAST_NONE = 0,
+    /** single content without relative or negation modifiers */
+    DETECT_CI_FAST_CONTENT,
+    /** contents with distance/within/negation and isdataat */
+    DETECT_CI_FAST_CONTENT_CHAIN,
+};
+
+/** max number of keywords in a list using DETECT_CI_FAST_CONTENT_CHAIN */
+#define DETECT_CI_FAST_CHAIN_MAX 16
+
+void DetectEngineContentInspectionSpecialize(SigMatchData *smd);
+const char *DetectEngineContentInspectionFastPathToString(const SigMatchData *smd);
+
 /* implicit "public" just returns true match, false no match */
 bool DetectEngineContentInspection(DetectEngineCtx *de_ctx, DetectEngineThreadCtx *det_ctx,
         const Signature *s, const SigMatchData *smd, Packet *p, Flow *f, const uint8_t *buffer,
@@ -24,11 +24,25 @@
 #include "suricata-common.h"
 #include "detect-engine-inspect-buffer.h"
 #include "detect.h"
+#include "detect-pcre-hs.h"
 
 #include "util-validate.h"
 
+/** \internal
+ *  \brief drop results that other modules keep for the previous data of
+ *         the buffer
+ */
+static inline void InspectionBufferUpdated(
+        DetectEngineThreadCtx *det_ctx, const InspectionBuffer *buffer)
+{
+    if (det_ctx != NULL && buffer->inspect != NULL)
+        DetectPcreHsCacheInvalidate(det_ctx, buffer->inspect);
+}
+
 void InspectionBufferClean(DetectEngineThreadCtx *det_ctx)
 {
+    DetectPcreHsCacheClear(det_ctx);
+
     /* single buffers */
     for (uint32_t i = 0; i < det_ctx->inspect.to_clear_idx; i++) {
         const uint32_t idx = det_ctx->inspect.to_clear_queue[i];
@@ -129,6 +143,7 @@ void InspectionBufferApplyTransforms(DetectEngineThreadCtx *det_ctx, InspectionB
         const DetectEngineTransforms *transforms)
 {
     InspectionBufferApplyTransformsInternal(det_ctx, buffer, transforms);
+    InspectionBufferUpdated(det_ctx, buffer);
 }
 
 void InspectionBufferInit(InspectionBuffer *buffer, uint32_t initial_size)
@@ -166,6 +181,7 @@ void InspectionBufferSetupMulti(DetectEngineThreadCtx *det_ctx, InspectionBuffer
     buffer->initialized = true;
 
     InspectionBufferApplyTransformsInternal(det_ctx, buffer, transforms);
+    InspectionBufferUpdated(det_ctx, buffer);
 }
 
 static inline void InspectionBufferSetupInternal(DetectEngineThreadCtx *det_ctx, const int list_id,
@@ -191,6 +207,7 @@ void InspectionBufferSetup(DetectEngineThreadCtx *det_ctx, const int list_id,
         InspectionBuffer *buffer, const uint8_t *data, const uint32_t data_len)
 {
     InspectionBufferSetupInternal(det_ctx, list_id, buffer, data, data_len);
+    InspectionBufferUpdated(det_ctx, buffer);
 }
 
 /** \brief setup the buffer with our initial data */
@@ -200,6 +217,7 @@ void InspectionBufferSetupAndApplyTransforms(DetectEngineThreadCtx *det_ctx, con
 {
     InspectionBufferSetupInternal(det_ctx, list_id, buffer, data, data_len);
     InspectionBufferApplyTransformsInternal(det_ctx, buffer, transforms);
+    InspectionBufferUpdated(det_ctx, buffer);
 }
 
 void InspectionBufferFree(InspectionBuffer *buffer)
@@ -547,15 +547,176 @@ static void IPOnlyCIDRListPrint(IPOnlyCIDRItem *tmphead)
 }
 #endif
 
+/* Signature id sets are split in chunks of 4096 sig nums. A chunk is either
+ * a sorted array of 16 bit offsets while it is sparse, or a bitmap once the
+ * array would be larger than the 512 byte bitmap.
+ *
+ * Radix nodes start out as a copy of the set of their best matching parent,
+ * so copies share the chunks and a chunk is only cloned when it is modified.
+ * With large block lists most nodes differ from their parent in a single
+ * chunk, so the memory use no longer scales with nodes * signatures. */
+#define SNA_CHUNK_BITS  12
+#define SNA_CHUNK_SIZE  (1U << SNA_CHUNK_BITS)
+#define SNA_CHUNK_MASK  (SNA_CHUNK_SIZE - 1)
+#define SNA_CHUNK_WORDS (SNA_CHUNK_SIZE / 64)
+/** max entries in an array chunk: beyond this a bitmap is smaller */
+#define SNA_ARRAY_MAX (SNA_CHUNK_WORDS * sizeof(uint64_t) / sizeof(uint16_t))
+
+typedef struct SigNumChunk_ {
+    uint32_t refcnt; /**< number of SigNumArrays sharing this chunk */
+    uint16_t cnt;    /**< number of sig nums set */
+    uint16_t cap;    /**< array capacity, 0 for a bitmap chunk */
+    /** bitmap of SNA_CHUNK_WORDS words or array of 'cap' uint16_t's */
+    uint64_t data[];
+} SigNumChunk;
+
+#define SNA_CHUNK_IS_BITMAP(c) ((c)->cap == 0)
+#define SNA_CHUNK_ARRAY(c)     ((uint16_t *)(c)->data)
+
 /** \brief user data for storing signature id's in the radix tree
  *
- *  Bit array representing signature internal id's (Signature::num).
+ *  Set of signature internal id's (Signature::num), see above.
  */
 typedef struct SigNumArray_ {
-    uint8_t *array; /* bit array of sig nums */
-    uint32_t size;  /* size in bytes of the array */
+    SigNumChunk **chunks; /* indexed by sig num >> SNA_CHUNK_BITS, NULL if empty */
+    uint32_t size;        /* number of chunk slots */
 } SigNumArray;
 
+static SigNumChunk *SigNumChunkAllocArray(uint16_t cap)
+{
+    SigNumChunk *c = SCCalloc(1, sizeof(*c) + (cap * sizeof(uint16_t) + 7) / 8 * 8);
+    if (unlikely(c == NULL)) {
+        FatalError("Fatal error encountered in SigNumChunkAllocArray. Exiting...");
+    }
+    c->refcnt = 1;
+    c->cap = cap;
+    return c;
+}
+
+static SigNumChunk *SigNumChunkAllocBitmap(void)
+{
+    SigNumChunk *c = SCCalloc(1, sizeof(*c) + SNA_CHUNK_WORDS * sizeof(uint64_t));
+    if (unlikely(c == NULL)) {
+        FatalError("Fatal error encountered in SigNumChunkAllocBitmap. Exiting...");
+    }
+    c->refcnt = 1;
+    return c;
+}
+
+static void SigNumChunkRelease(SigNumChunk *c)
+{
+    if (c != NULL && --c->refcnt == 0)
+        SCFree(c);
+}
+
+static SigNumChunk *SigNumChunkClone(const SigNumChunk *c)
+{
+    SigNumChunk *n;
+    if (SNA_CHUNK_IS_BITMAP(c)) {
+        n = SigNumChunkAllocBitmap();
+        memcpy(n->data, c->data, SNA_CHUNK_WORDS * sizeof(uint64_t));
+    } else {
+        n = SigNumChunkAllocArray(c->cap);
+        memcpy(n->data, c->data, c->cnt * sizeof(uint16_t));
+    }
+    n->cnt = c->cnt;
+    return n;
+}
+
+static SigNumChunk *SigNumChunkArrayToBitmap(SigNumChunk *c)
+{
+    SigNumChunk *n = SigNumChunkAllocBitmap();
+    const uint16_t *a = SNA_CHUNK_ARRAY(c);
+    for (uint16_t i = 0; i < c->cnt; i++) {
+        n->data[a[i] / 64] |= BIT_U64(a[i] % 64);
+    }
+    n->cnt = c->cnt;
+    SigNumChunkRelease(c);
+    return n;
+}
+
+static SigNumChunk *SigNumChunkBitmapToArray(SigNumChunk *c)
+{
+    SigNumChunk *n = SigNumChunkAllocArray(c->cnt);
+    uint16_t *a = SNA_CHUNK_ARRAY(n);
+    for (uint32_t w = 0; w < SNA_CHUNK_WORDS; w++) {
+        for (uint64_t bits = c->data[w]; bits != 0; bits &= bits - 1) {
+            a[n->cnt++] = (uint16_t)(w * 64 + __builtin_ctzll(bits));
+        }
+    }
+    SigNumChunkRelease(c);
+    return n;
+}
+
+/** \internal
+ *  \brief set or unset 'signum' in the set, unsharing the chunk if needed */
+static void SigNumArrayUpdate(SigNumArray *sna, const uint32_t signum, const bool set)
+{
+    const uint32_t k = signum >> SNA_CHUNK_BITS;
+    const uint16_t v = (uint16_t)(signum & SNA_CHUNK_MASK);
+    DEBUG_VALIDATE_BUG_ON(k >= sna->size);
+
+    SigNumChunk *c = sna->chunks[k];
+    if (c == NULL) {
+        if (!set)
+            return;
+        c = SigNumChunkAllocArray(4);
+    } else if (c->refcnt > 1) {
+        SigNumChunk *n = SigNumChunkClone(c);
+        c->refcnt--;
+        c = n;
+    }
+
+    if (SNA_CHUNK_IS_BITMAP(c)) {
+        const uint64_t bit = BIT_U64(v % 64);
+        const bool isset = (c->data[v / 64] & bit) != 0;
+        if (set && !isset) {
+            c->data[v / 64] |= bit;
+            c->cnt++;
+        } else if (!set && isset) {
+            c->data[v / 64] &= ~bit;
+            c->cnt--;
+            if (c->cnt <= SNA_ARRAY_MAX / 2)
+                c = SigNumChunkBitmapToArray(c);
+        }
+    } else {
+        uint16_t *a = SNA_CHUNK_ARRAY(c);
+        uint16_t i = 0;
+        while (i < c->cnt && a[i] < v)
+            i++;
+        const bool isset = (i < c->cnt && a[i] == v);
+        if (set && !isset) {
+            if (c->cnt == SNA_ARRAY_MAX) {
+                c = SigNumChunkArrayToBitmap(c);
+                c->data[v / 64] |= BIT_U64(v % 64);
+                c->cnt++;
+            } else {
+                if (c->cnt == c->cap) {
+                    uint16_t cap = (uint16_t)MIN(c->cap * 2, SNA_ARRAY_MAX);
+                    SigNumChunk *n = SigNumChunkAllocArray(cap);
+                    memcpy(n->data, c->data, c->cnt * sizeof(uint16_t));
+                    n->cnt = c->cnt;
+                    SigNumChunkRelease(c);
+                    c = n;
+                    a = SNA_CHUNK_ARRAY(c);
+                }
+                memmove(&a[i + 1], &a[i], (c->cnt - i) * sizeof(uint16_t));
+                a[i] = v;
+                c->cnt++;
+            }
+        } else if (!set && isset) {
+            memmove(&a[i], &a[i + 1], (c->cnt - i - 1) * sizeof(uint16_t));
+            c->cnt--;
+        }
+    }
+
+    if (c->cnt == 0) {
+        SigNumChunkRelease(c);
+        c = NULL;
+    }
+    sna->chunks[k] = c;
+}
+
 /**
  * \brief This function print a SigNumArray, it's used with the
  *        radix tree print function to help debugging
@@ -564,19 +725,28 @@ typedef struct SigNumArray_ {
 static void SigNumArrayPrint(void *tmp)
 {
     SigNumArray *sna = (SigNumArray *)tmp;
-    for (uint32_t u = 0; u < sna->size; u++) {
-        uint8_t bitarray = sna->array[u];
-        for (uint8_t i = 0; i < 8; i++) {
-            if (bitarray & 0x01)
-                printf("%" PRIu32 " ", u * 8 + i);
-            bitarray = bitarray >> 1;
+    for (uint32_t k = 0; k < sna->size; k++) {
+        const SigNumChunk *c = sna->chunks[k];
+        if (c == NULL)
+            continue;
+        const uint32_t base = k << SNA_CHUNK_BITS;
+        if (SNA_CHUNK_IS_BITMAP(c)) {
+            for (uint32_t w = 0; w < SNA_CHUNK_WORDS; w++) {
+                for (uint64_t bits = c->data[w]; bits != 0; bits &= bits - 1) {
+                    printf("%" PRIu32 " ", base + w * 64 + __builtin_ctzll(bits));
+                }
+            }
+        } else {
+            for (uint16_t i = 0; i < c->cnt; i++) {
+                printf("%" PRIu32 " ", base + SNA_CHUNK_ARRAY(c)[i]);
+            }
         }
     }
 }
 
 /**
- * \brief This function creates a new SigNumArray with the
- *        size fixed to the io_ctx->max_idx
+ * \brief This function creates a new empty SigNumArray able to hold
+ *        sig nums up to io_ctx->max_idx
  * \param de_ctx Pointer to the current detection context
  * \param io_ctx Pointer to the current ip only context
  *
@@ -591,13 +761,12 @@ static SigNumArray *SigNumArrayNew(DetectEngineCtx *de_ctx,
         FatalError("Fatal error encountered in SigNumArrayNew. Exiting...");
     }
 
-    new->array = SCCalloc(1, io_ctx->max_idx / 8 + 1);
-    if (new->array == NULL) {
+    new->size = (io_ctx->max_idx >> SNA_CHUNK_BITS) + 1;
+    new->chunks = SCCalloc(new->size, sizeof(SigNumChunk *));
+    if (new->chunks == NULL) {
        exit(EXIT_FAILURE);
     }
 
-    new->size = io_ctx->max_idx / 8 + 1;
-
     SCLogDebug("max idx= %u", io_ctx->max_idx);
 
     return new;
@@ -605,7 +774,8 @@ static SigNumArray *SigNumArrayNew(DetectEngineCtx *de_ctx,
 
 /**
  * \brief This function creates a new SigNumArray with the
- *        same data as the argument
+ *        same data as the argument. The chunks are shared
+ *        until one of the copies modifies them.
  *
  * \param orig Pointer to the original SigNumArray to copy
  *
@@ -621,12 +791,16 @@ static SigNumArray *SigNumArrayCopy(SigNumArray *orig)
 
     new->size = orig->size;
 
-    new->array = SCMalloc(orig->size);
-    if (new->array == NULL) {
+    new->chunks = SCMalloc(orig->size * sizeof(SigNumChunk *));
+    if (new->chunks == NULL) {
         exit(EXIT_FAILURE);
     }
 
-    memcpy(new->array, orig->array, orig->size);
+    for (uint32_t k = 0; k < orig->size; k++) {
+        new->chunks[k] = orig->chunks[k];
+        if (new->chunks[k] != NULL)
+            new->chunks[k]->refcnt++;
+    }
     return new;
 }
 
@@ -641,8 +815,12 @@ static void SigNumArrayFree(void *tmp)
     if (sna == NULL)
         return;
 
-    if (sna->array != NULL)
-        SCFree(sna->array);
+    if (sna->chunks != NULL) {
+        for (uint32_t k = 0; k < sna->size; k++) {
+            SigNumChunkRelease(sna->chunks[k]);
+        }
+        SCFree(sna->chunks);
+    }
 
     SCFree(sna);
 }
@@ -987,6 +1165,84 @@ static inline int IPOnlyMatchCompatSMs(
     return 1;
 }
 
+/**
+ * \brief check a candidate signature from the address lookups and queue
+ *        an alert if the rest of the signature matches
+ */
+static void IPOnlyMatchSig(ThreadVars *tv, const DetectEngineCtx *de_ctx,
+        DetectEngineThreadCtx *det_ctx, const DetectEngineIPOnlyCtx *io_ctx, Packet *p,
+        const uint32_t signum)
+{
+    const Signature *s = de_ctx->sig_array[io_ctx->sig_mapping[signum]];
+
+    if ((s->proto.flags & DETECT_PROTO_IPV4) && !PacketIsIPv4(p)) {
+        SCLogDebug("ip version didn't match");
+        return;
+    }
+    if ((s->proto.flags & DETECT_PROTO_IPV6) && !PacketIsIPv6(p)) {
+        SCLogDebug("ip version didn't match");
+        return;
+    }
+    if (DetectProtoContainsProto(&s->proto, PacketGetIPProto(p)) == 0) {
+        SCLogDebug("proto didn't match");
+        return;
+    }
+
+    /* check the source & dst port in the sig */
+    if (p->proto == IPPROTO_TCP || p->proto == IPPROTO_UDP ||
+            p->proto == IPPROTO_SCTP) {
+        if (!(s->flags & SIG_FLAG_DP_ANY)) {
+            if (p->flags & PKT_IS_FRAGMENT)
+                return;
+
+            const DetectPort *dport = DetectPortLookupGroup(s->dp, p->dp);
+            if (dport == NULL) {
+                SCLogDebug("dport didn't match.");
+                return;
+            }
+        }
+        if (!(s->flags & SIG_FLAG_SP_ANY)) {
+            if (p->flags & PKT_IS_FRAGMENT)
+                return;
+
+            const DetectPort *sport = DetectPortLookupGroup(s->sp, p->sp);
+            if (sport == NULL) {
+                SCLogDebug("sport didn't match.");
+                return;
+            }
+        }
+    } else if ((s->flags & (SIG_FLAG_DP_ANY | SIG_FLAG_SP_ANY)) !=
+               (SIG_FLAG_DP_ANY | SIG_FLAG_SP_ANY)) {
+        SCLogDebug("port-less protocol and sig needs ports");
+        return;
+    }
+
+    if (!IPOnlyMatchCompatSMs(tv, det_ctx, s, p)) {
+        return;
+    }
+
+    SCLogDebug("Signum %" PRIu32 " match (sid: %" PRIu32 ", msg: %s)", signum, s->id, s->msg);
+
+    if (s->sm_arrays[DETECT_SM_LIST_POSTMATCH] != NULL) {
+        KEYWORD_PROFILING_SET_LIST(det_ctx, DETECT_SM_LIST_POSTMATCH);
+        const SigMatchData *smd = s->sm_arrays[DETECT_SM_LIST_POSTMATCH];
+
+        SCLogDebug("running match functions, sm %p", smd);
+
+        if (smd != NULL) {
+            while (1) {
+                KEYWORD_PROFILING_START;
+                (void)sigmatch_table[smd->type].Match(det_ctx, p, s, smd->ctx);
+                KEYWORD_PROFILING_END(det_ctx, smd->type, 1);
+                if (smd->is_last)
+                    break;
+                smd++;
+            }
+        }
+    }
+    AlertQueueAppend(det_ctx, s, p, 0, 0);
+}
+
 /**
  * \brief Match a packet against the IP Only detection engine contexts
  *
@@ -1026,90 +1282,58 @@ void IPOnlyMatchPacket(ThreadVars *tv, const DetectEngineCtx *de_ctx,
     if (src == NULL || dst == NULL)
         SCReturn;
 
-    for (uint32_t u = 0; u < src->size; u++) {
-        SCLogDebug("And %"PRIu8" & %"PRIu8, src->array[u], dst->array[u]);
-
-        uint8_t bitarray = dst->array[u] & src->array[u];
-
-        /* We have to move the logic of the signature checking
-         * to the main detect loop, in order to apply the
-         * priority of actions (pass, drop, reject, alert) */
-        if (!bitarray)
+    /* We have to move the logic of the signature checking
+     * to the main detect loop, in order to apply the
+     * priority of actions (pass, drop, reject, alert) */
+    const uint32_t size = MIN(src->size, dst->size);
+    for (uint32_t k = 0; k < size; k++) {
+        const SigNumChunk *a = src->chunks[k];
+        const SigNumChunk *b = dst->chunks[k];
+        if (a == NULL || b == NULL)
             continue;
 
-        /* We have a match :) Let's see from which signum's */
-
-        for (uint8_t i = 0; i < 8; i++, bitarray = bitarray >> 1) {
-            if (bitarray & 0x01) {
-                const Signature *s = de_ctx->sig_array[io_ctx->sig_mapping[u * 8 + i]];
-
-                if ((s->proto.flags & DETECT_PROTO_IPV4) && !PacketIsIPv4(p)) {
-                    SCLogDebug("ip version didn't match");
-                    continue;
-                }
-                if ((s->proto.flags & DETECT_PROTO_IPV6) && !PacketIsIPv6(p)) {
-                    SCLogDebug("ip version didn't match");
-                    continue;
-                }
-                if (DetectProtoContainsProto(&s->proto, PacketGetIPProto(p)) == 0) {
-                    SCLogDebug("proto didn't match");
-                    continue;
-                }
-
-                /* check the source & dst port in the sig */
-                if (p->proto == IPPROTO_TCP || p->proto == IPPROTO_UDP ||
-                        p->proto == IPPROTO_SCTP) {
-                    if (!(s->flags & SIG_FLAG_DP_ANY)) {
-                        if (p->flags & PKT_IS_FRAGMENT)
-                            continue;
-
-                        const DetectPort *dport = DetectPortLookupGroup(s->dp, p->dp);
-                        if (dport == NULL) {
-                            SCLogDebug("dport didn't match.");
-                            continue;
-                        }
-                    }
-                    if (!(s->flags & SIG_FLAG_SP_ANY)) {
-                        if (p->flags & PKT_IS_FRAGMENT)
-                            continue;
-
-                        const DetectPort *sport = DetectPortLookupGroup(s->sp, p->sp);
-                        if (sport == NULL) {
-                            SCLogDebug("sport didn't match.");
-                            continue;
-                        }
-                    }
-                } else if ((s->flags & (SIG_FLAG_DP_ANY | SIG_FLAG_SP_ANY)) !=
-                           (SIG_FLAG_DP_ANY | SIG_FLAG_SP_ANY)) {
-                    SCLogDebug("port-less protocol and sig needs ports");
-                    continue;
-                }
-
-                if (!IPOnlyMatchCompatSMs(tv, det_ctx, s, p)) {
-                    continue;
+        const uint32_t base = k << SNA_CHUNK_BITS;
+        if (SNA_CHUNK_IS_BITMAP(a) && SNA_CHUNK_IS_BITMAP(b)) {
+            /* branchless AND of the whole chunk so the compiler can
+             * vectorize it, then walk the set bits */
+            uint64_t and[SNA_CHUNK_WORDS];
+            uint64_t any = 0;
+            for (uint32_t w = 0; w < SNA_CHUNK_WORDS; w++) {
+                and[w] = a->data[w] & b->data[w];
+                any |= and[w];
+            }
+            if (any == 0)
+                continue;
+            for (uint32_t w = 0; w < SNA_CHUNK_WORDS; w++) {
+                for (uint64_t bits = and[w]; bits != 0; bits &= bits - 1) {
+                    IPOnlyMatchSig(tv, de_ctx, det_ctx, io_ctx, p,
+                            base + w * 64 + __builtin_ctzll(bits));
                 }
-
-                SCLogDebug("Signum %" PRIu32 " match (sid: %" PRIu32 ", msg: %s)", u * 8 + i, s->id,
-                        s->msg);
-
-                if (s->sm_arrays[DETECT_SM_LIST_POSTMATCH] != NULL) {
-                    KEYWORD_PROFILING_SET_LIST(det_ctx, DETECT_SM_LIST_POSTMATCH);
-                    const SigMatchData *smd = s->sm_arrays[DETECT_SM_LIST_POSTMATCH];
-
-                    SCLogDebug("running match functions, sm %p", smd);
-
-                    if (smd != NULL) {
-                        while (1) {
-                            KEYWORD_PROFILING_START;
-                            (void)sigmatch_table[smd->type].Match(det_ctx, p, s, smd->ctx);
-                            KEYWORD_PROFILING_END(det_ctx, smd->type, 1);
-                            if (smd->is_last)
-                                break;
-                            smd++;
-                        }
-                    }
+            }
+        } else if (SNA_CHUNK_IS_BITMAP(a) || SNA_CHUNK_IS_BITMAP(b)) {
+            /* probe the bitmap for each entry of the array */
+            const SigNumChunk *arr = SNA_CHUNK_IS_BITMAP(a) ? b : a;
+            const SigNumChunk *bm = SNA_CHUNK_IS_BITMAP(a) ? a : b;
+            const uint16_t *av = SNA_CHUNK_ARRAY(arr);
+            for (uint16_t i = 0; i < arr->cnt; i++) {
+                if (bm->data[av[i] / 64] & BIT_U64(av[i] % 64))
+                    IPOnlyMatchSig(tv, de_ctx, det_ctx, io_ctx, p, base + av[i]);
+            }
+        } else {
+            /* merge the sorted arrays */
+            const uint16_t *av = SNA_CHUNK_ARRAY(a);
+            const uint16_t *bv = SNA_CHUNK_ARRAY(b);
+            uint16_t i = 0, j = 0;
+            while (i < a->cnt && j < b->cnt) {
+                if (av[i] < bv[j]) {
+                    i++;
+                } else if (av[i] > bv[j]) {
+                    j++;
+                } else {
+                    IPOnlyMatchSig(tv, de_ctx, det_ctx, io_ctx, p, base + av[i]);
+                    i++;
+                    j++;
                 }
-                AlertQueueAppend(det_ctx, s, p, 0, 0);
             }
         }
     }
@@ -1118,13 +1342,8 @@ void IPOnlyMatchPacket(ThreadVars *tv, const DetectEngineCtx *de_ctx,
 
 static void IPOnlyPrepareUpdateBitarray(const IPOnlyCIDRItem *src, SigNumArray *sna)
 {
-    uint8_t tmp = (uint8_t)(1 << (src->signum % 8));
-    if (src->negated > 0)
-        /* Unset it */
-        sna->array[src->signum / 8] &= ~tmp;
-    else
-        /* Set it */
-        sna->array[src->signum / 8] |= tmp;
+    /* set it, or unset it if negated */
+    SigNumArrayUpdate(sna, src->signum, src->negated == 0);
 }
 
 /**
@@ -2345,6 +2564,90 @@ static int IPOnlyTestBug5168v2(void)
     PASS;
 }
 
+static bool IPOnlyTestSigNumArrayIsSet(const SigNumArray *sna, uint32_t signum)
+{
+    const SigNumChunk *c = sna->chunks[signum >> SNA_CHUNK_BITS];
+    const uint16_t v = (uint16_t)(signum & SNA_CHUNK_MASK);
+    if (c == NULL)
+        return false;
+    if (SNA_CHUNK_IS_BITMAP(c))
+        return (c->data[v / 64] & BIT_U64(v % 64)) != 0;
+    for (uint16_t i = 0; i < c->cnt; i++) {
+        if (SNA_CHUNK_ARRAY(c)[i] == v)
+            return true;
+    }
+    return false;
+}
+
+/** \test sig num set: array/bitmap conversion and copy on write */
+static int IPOnlyTestSigNumArray01(void)
+{
+    DetectEngineIPOnlyCtx io_ctx;
+    memset(&io_ctx, 0, sizeof(io_ctx));
+    io_ctx.max_idx = 3 * SNA_CHUNK_SIZE - 1;
+
+    SigNumArray *sna = SigNumArrayNew(NULL, &io_ctx);
+    FAIL_IF_NOT(sna->size == 3);
+
+    /* unsetting in an empty chunk doesn't allocate it */
+    SigNumArrayUpdate(sna, 5, false);
+    FAIL_IF_NOT_NULL(sna->chunks[0]);
+
+    for (uint32_t i = 0; i < SNA_ARRAY_MAX; i++) {
+        SigNumArrayUpdate(sna, SNA_CHUNK_SIZE + (SNA_ARRAY_MAX - i) * 7, true);
+    }
+    const SigNumChunk *c = sna->chunks[1];
+    FAIL_IF_NULL(c);
+    FAIL_IF(SNA_CHUNK_IS_BITMAP(c));
+    FAIL_IF_NOT(c->cnt == SNA_ARRAY_MAX);
+    /* sorted */
+    for (uint16_t i = 1; i < c->cnt; i++) {
+        FAIL_IF_NOT(SNA_CHUNK_ARRAY(c)[i - 1] < SNA_CHUNK_ARRAY(c)[i]);
+    }
+    /* setting twice doesn't change the count */
+    SigNumArrayUpdate(sna, SNA_CHUNK_SIZE + 7, true);
+    FAIL_IF_NOT(sna->chunks[1]->cnt == SNA_ARRAY_MAX);
+
+    /* one more turns it into a bitmap */
+    SigNumArrayUpdate(sna, SNA_CHUNK_SIZE + 1, true);
+    c = sna->chunks[1];
+    FAIL_IF_NOT(SNA_CHUNK_IS_BITMAP(c));
+    FAIL_IF_NOT(c->cnt == SNA_ARRAY_MAX + 1);
+    FAIL_IF_NOT(IPOnlyTestSigNumArrayIsSet(sna, SNA_CHUNK_SIZE + 1));
+    FAIL_IF_NOT(IPOnlyTestSigNumArrayIsSet(sna, SNA_CHUNK_SIZE + 14));
+    FAIL_IF(IPOnlyTestSigNumArrayIsSet(sna, SNA_CHUNK_SIZE + 15));
+
+    /* copies share the chunks until modified */
+    SigNumArray *copy = SigNumArrayCopy(sna);
+    FAIL_IF_NOT(copy->chunks[1] == sna->chunks[1]);
+    FAIL_IF_NOT(c->refcnt == 2);
+    SigNumArrayUpdate(copy, SNA_CHUNK_SIZE + 1, false);
+    FAIL_IF(copy->chunks[1] == sna->chunks[1]);
+    FAIL_IF_NOT(c->refcnt == 1);
+    FAIL_IF_NOT(IPOnlyTestSigNumArrayIsSet(sna, SNA_CHUNK_SIZE + 1));
+    FAIL_IF(IPOnlyTestSigNumArrayIsSet(copy, SNA_CHUNK_SIZE + 1));
+
+    /* unsetting most of them turns it back into an array */
+    for (uint32_t i = 0; i < SNA_ARRAY_MAX / 2 + 1; i++) {
+        SigNumArrayUpdate(copy, SNA_CHUNK_SIZE + (SNA_ARRAY_MAX - i) * 7, false);
+    }
+    c = copy->chunks[1];
+    FAIL_IF(SNA_CHUNK_IS_BITMAP(c));
+    FAIL_IF_NOT(c->cnt == SNA_ARRAY_MAX / 2 - 1);
+    FAIL_IF_NOT(IPOnlyTestSigNumArrayIsSet(copy, SNA_CHUNK_SIZE + 7));
+    FAIL_IF(IPOnlyTestSigNumArrayIsSet(copy, SNA_CHUNK_SIZE + SNA_ARRAY_MAX * 7));
+
+    /* removing the last one frees the chunk */
+    SigNumArrayUpdate(sna, 2 * SNA_CHUNK_SIZE + 3, true);
+    FAIL_IF_NULL(sna->chunks[2]);
+    SigNumArrayUpdate(sna, 2 * SNA_CHUNK_SIZE + 3, false);
+    FAIL_IF_NOT_NULL(sna->chunks[2]);
+
+    SigNumArrayFree(copy);
+    SigNumArrayFree(sna);
+    PASS;
+}
+
 #endif /* UNITTESTS */
 
 void IPOnlyRegisterTests(void)
@@ -2390,5 +2693,6 @@ void IPOnlyRegisterTests(void)
 
     UtRegisterTest("IPOnlyTestBug5168v1", IPOnlyTestBug5168v1);
     UtRegisterTest("IPOnlyTestBug5168v2", IPOnlyTestBug5168v2);
+    UtRegisterTest("IPOnlyTestSigNumArray01", IPOnlyTestSigNumArray01);
 #endif
 }
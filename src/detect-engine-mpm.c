@@ -303,9 +303,7 @@ int DetectMpmPrepareAppMpms(DetectEngineCtx *de_ctx)
         {
             MpmCtx *mpm_ctx = MpmFactoryGetMpmCtxForProfile(de_ctx, am->sgh_mpm_context, dir);
             if (mpm_ctx != NULL) {
-                if (mpm_table[de_ctx->mpm_matcher].Prepare != NULL) {
-                    r |= mpm_table[de_ctx->mpm_matcher].Prepare(de_ctx->mpm_cfg, mpm_ctx);
-                }
+                r |= MpmPrepareCtx(de_ctx->mpm_cfg, mpm_ctx);
             }
         }
         am = am->next;
@@ -532,10 +530,8 @@ int DetectMpmPrepareFrameMpms(DetectEngineCtx *de_ctx)
             MpmCtx *mpm_ctx = MpmFactoryGetMpmCtxForProfile(de_ctx, am->sgh_mpm_context, dir);
             SCLogDebug("%s: %d mpm_Ctx %p", am->name, r, mpm_ctx);
             if (mpm_ctx != NULL) {
-                if (mpm_table[de_ctx->mpm_matcher].Prepare != NULL) {
-                    r |= mpm_table[de_ctx->mpm_matcher].Prepare(de_ctx->mpm_cfg, mpm_ctx);
-                    SCLogDebug("%s: %d", am->name, r);
-                }
+                r |= MpmPrepareCtx(de_ctx->mpm_cfg, mpm_ctx);
+                SCLogDebug("%s: %d", am->name, r);
             }
         }
         am = am->next;
@@ -695,10 +691,8 @@ int DetectMpmPreparePktMpms(DetectEngineCtx *de_ctx)
         {
             MpmCtx *mpm_ctx = MpmFactoryGetMpmCtxForProfile(de_ctx, am->sgh_mpm_context, 0);
             if (mpm_ctx != NULL) {
-                if (mpm_table[de_ctx->mpm_matcher].Prepare != NULL) {
-                    r |= mpm_table[de_ctx->mpm_matcher].Prepare(de_ctx->mpm_cfg, mpm_ctx);
-                    SCLogDebug("%s: %d", am->name, r);
-                }
+                r |= MpmPrepareCtx(de_ctx->mpm_cfg, mpm_ctx);
+                SCLogDebug("%s: %d", am->name, r);
             }
         }
         am = am->next;
@@ -750,42 +744,28 @@ int DetectMpmPrepareBuiltinMpms(DetectEngineCtx *de_ctx)
 
     if (de_ctx->sgh_mpm_context_proto_tcp_packet != MPM_CTX_FACTORY_UNIQUE_CONTEXT) {
         mpm_ctx = MpmFactoryGetMpmCtxForProfile(de_ctx, de_ctx->sgh_mpm_context_proto_tcp_packet, 0);
-        if (mpm_table[de_ctx->mpm_matcher].Prepare != NULL) {
-            r |= mpm_table[de_ctx->mpm_matcher].Prepare(de_ctx->mpm_cfg, mpm_ctx);
-        }
+        r |= MpmPrepareCtx(de_ctx->mpm_cfg, mpm_ctx);
         mpm_ctx = MpmFactoryGetMpmCtxForProfile(de_ctx, de_ctx->sgh_mpm_context_proto_tcp_packet, 1);
-        if (mpm_table[de_ctx->mpm_matcher].Prepare != NULL) {
-            r |= mpm_table[de_ctx->mpm_matcher].Prepare(de_ctx->mpm_cfg, mpm_ctx);
-        }
+        r |= MpmPrepareCtx(de_ctx->mpm_cfg, mpm_ctx);
     }
 
     if (de_ctx->sgh_mpm_context_proto_udp_packet != MPM_CTX_FACTORY_UNIQUE_CONTEXT) {
         mpm_ctx = MpmFactoryGetMpmCtxForProfile(de_ctx, de_ctx->sgh_mpm_context_proto_udp_packet, 0);
-        if (mpm_table[de_ctx->mpm_matcher].Prepare != NULL) {
-            r |= mpm_table[de_ctx->mpm_matcher].Prepare(de_ctx->mpm_cfg, mpm_ctx);
-        }
+        r |= MpmPrepareCtx(de_ctx->mpm_cfg, mpm_ctx);
         mpm_ctx = MpmFactoryGetMpmCtxForProfile(de_ctx, de_ctx->sgh_mpm_context_proto_udp_packet, 1);
-        if (mpm_table[de_ctx->mpm_matcher].Prepare != NULL) {
-            r |= mpm_table[de_ctx->mpm_matcher].Prepare(de_ctx->mpm_cfg, mpm_ctx);
-        }
+        r |= MpmPrepareCtx(de_ctx->mpm_cfg, mpm_ctx);
     }
 
     if (de_ctx->sgh_mpm_context_proto_other_packet != MPM_CTX_FACTORY_UNIQUE_CONTEXT) {
         mpm_ctx = MpmFactoryGetMpmCtxForProfile(de_ctx, de_ctx->sgh_mpm_context_proto_other_packet, 0);
-        if (mpm_table[de_ctx->mpm_matcher].Prepare != NULL) {
-            r |= mpm_table[de_ctx->mpm_matcher].Prepare(de_ctx->mpm_cfg, mpm_ctx);
-        }
+        r |= MpmPrepareCtx(de_ctx->mpm_cfg, mpm_ctx);
     }
 
     if (de_ctx->sgh_mpm_context_stream != MPM_CTX_FACTORY_UNIQUE_CONTEXT) {
         mpm_ctx = MpmFactoryGetMpmCtxForProfile(de_ctx, de_ctx->sgh_mpm_context_stream, 0);
-        if (mpm_table[de_ctx->mpm_matcher].Prepare != NULL) {
-            r |= mpm_table[de_ctx->mpm_matcher].Prepare(de_ctx->mpm_cfg, mpm_ctx);
-        }
+        r |= MpmPrepareCtx(de_ctx->mpm_cfg, mpm_ctx);
         mpm_ctx = MpmFactoryGetMpmCtxForProfile(de_ctx, de_ctx->sgh_mpm_context_stream, 1);
-        if (mpm_table[de_ctx->mpm_matcher].Prepare != NULL) {
-            r |= mpm_table[de_ctx->mpm_matcher].Prepare(de_ctx->mpm_cfg, mpm_ctx);
-        }
+        r |= MpmPrepareCtx(de_ctx->mpm_cfg, mpm_ctx);
     }
 
     return r;
@@ -907,7 +887,7 @@ uint8_t PatternMatchDefaultMatcher(void)
 void PatternMatchDestroy(MpmCtx *mpm_ctx, uint16_t mpm_matcher)
 {
     SCLogDebug("mpm_ctx %p, mpm_matcher %"PRIu16"", mpm_ctx, mpm_matcher);
-    mpm_table[mpm_matcher].DestroyCtx(mpm_ctx);
+    MpmDestroyCtx(mpm_ctx);
 }
 
 void PatternMatchThreadDestroy(MpmThreadCtx *mpm_thread_ctx, uint16_t mpm_matcher)
@@ -1384,7 +1364,7 @@ static void MpmStoreFreeFunc(void *ptr)
         if (ms->mpm_ctx != NULL && !(ms->mpm_ctx->flags & MPMCTX_FLAGS_GLOBAL))
         {
             SCLogDebug("destroying mpm_ctx %p", ms->mpm_ctx);
-            mpm_table[ms->mpm_ctx->mpm_type].DestroyCtx(ms->mpm_ctx);
+            MpmDestroyCtx(ms->mpm_ctx);
             SCFree(ms->mpm_ctx);
         }
         ms->mpm_ctx = NULL;
@@ -1663,9 +1643,7 @@ static void MpmStoreSetup(const DetectEngineCtx *de_ctx, MpmStore *ms)
         ms->mpm_ctx = NULL;
     } else {
         if (ms->sgh_mpm_context == MPM_CTX_FACTORY_UNIQUE_CONTEXT) {
-            if (mpm_table[ms->mpm_ctx->mpm_type].Prepare != NULL) {
-                mpm_table[ms->mpm_ctx->mpm_type].Prepare(de_ctx->mpm_cfg, ms->mpm_ctx);
-            }
+            MpmPrepareCtx(de_ctx->mpm_cfg, ms->mpm_ctx);
         }
     }
 }
@@ -50,23 +50,170 @@
 #include "util-profiling.h"
 #include "util-mpm-ac.h"
 
+/** max matches tracked per direction by the inline stream mpm. If more
+ *  are needed the state is reset and the next window is scanned in full. */
+#define STREAM_MPM_MAX_SIDS 256
+
 struct StreamMpmData {
     DetectEngineThreadCtx *det_ctx;
     const MpmCtx *mpm_ctx;
+    DetectStreamMpmState *state;
 };
 
+void DetectStreamMpmStateFree(DetectStreamMpmState *state)
+{
+    if (state == NULL)
+        return;
+    StreamTcpDecrMemuse(
+            (uint64_t)(sizeof(*state) + state->sids_size * sizeof(DetectStreamMpmSid)));
+    SCFree(state->sids);
+    SCFree(state);
+}
+
+/** \internal
+ *  \brief forget all tracked data, so that the next window is scanned in full */
+static void StreamMpmStateReset(DetectStreamMpmState *state)
+{
+    state->sids_cnt = 0;
+    state->scan_start = UINT64_MAX;
+    state->scanned = UINT64_MAX;
+}
+
+static DetectStreamMpmState *StreamMpmStateGet(
+        DetectEngineThreadCtx *det_ctx, const MpmCtx *mpm_ctx, Packet *p)
+{
+    TcpSession *ssn = p->flow->protoctx;
+    TcpStream *stream = PKT_IS_TOSERVER(p) ? &ssn->client : &ssn->server;
+
+    DetectStreamMpmState *state = stream->mpm_state;
+    if (state == NULL) {
+        if (StreamTcpCheckMemcap((uint64_t)sizeof(*state)) == 0)
+            return NULL;
+        state = SCCalloc(1, sizeof(*state));
+        if (state == NULL)
+            return NULL;
+        StreamTcpIncrMemuse((uint64_t)sizeof(*state));
+        StreamMpmStateReset(state);
+        stream->mpm_state = state;
+    }
+    /* matches of another rule group or of a reloaded ruleset are useless */
+    if (state->mpm_ctx != mpm_ctx || state->de_version != det_ctx->de_ctx->version) {
+        state->mpm_ctx = mpm_ctx;
+        state->de_version = det_ctx->de_ctx->version;
+        StreamMpmStateReset(state);
+    }
+    return state;
+}
+
+/** \internal
+ *  \brief prepare the state for scanning the window [offset, offset + len)
+ *
+ *  A window that doesn't connect to the data scanned before (gap, or data
+ *  left of what we track) resets the state. Otherwise the matches left of
+ *  the window are dropped.
+ *
+ *  \retval skip number of bytes at the start of the window that don't need
+ *                to be scanned again. The last 'maxlen - 1' bytes scanned
+ *                before are scanned again to find the patterns that cross
+ *                into the new data.
+ */
+static uint32_t StreamMpmStateSkip(DetectStreamMpmState *state, const uint64_t offset,
+        const uint32_t len, const uint16_t maxlen)
+{
+    if (offset < state->scan_start || offset > state->scanned) {
+        state->sids_cnt = 0;
+        state->scan_start = offset;
+        state->scanned = offset;
+        return 0;
+    }
+
+    uint32_t keep = 0;
+    for (uint32_t i = 0; i < state->sids_cnt; i++) {
+        if (state->sids[i].edge > offset)
+            state->sids[keep++] = state->sids[i];
+    }
+    state->sids_cnt = keep;
+    state->scan_start = offset;
+
+    const uint64_t overlap = maxlen > 0 ? maxlen - 1 : 0;
+    const uint64_t from = state->scanned > overlap ? state->scanned - overlap : 0;
+    if (from <= offset)
+        return 0;
+    if (from - offset >= len)
+        return len;
+    return (uint32_t)(from - offset);
+}
+
+/** \internal
+ *  \brief track the matches found in the data up to 'edge' */
+static void StreamMpmStateAddSids(DetectStreamMpmState *state, const SigIntId *sids,
+        const uint32_t sids_cnt, const uint64_t edge)
+{
+    for (uint32_t i = 0; i < sids_cnt; i++) {
+        uint32_t x = 0;
+        for (; x < state->sids_cnt; x++) {
+            if (state->sids[x].id == sids[i])
+                break;
+        }
+        if (x < state->sids_cnt) {
+            state->sids[x].edge = edge;
+            continue;
+        }
+
+        if (state->sids_cnt == state->sids_size) {
+            const uint32_t new_size = state->sids_size ? state->sids_size * 2 : 16;
+            const uint64_t grow = (new_size - state->sids_size) * sizeof(DetectStreamMpmSid);
+            DetectStreamMpmSid *ptr = NULL;
+            if (new_size <= STREAM_MPM_MAX_SIDS && StreamTcpCheckMemcap(grow) == 1) {
+                ptr = SCRealloc(state->sids, new_size * sizeof(DetectStreamMpmSid));
+            }
+            if (ptr == NULL) {
+                StreamMpmStateReset(state);
+                return;
+            }
+            StreamTcpIncrMemuse(grow);
+            state->sids = ptr;
+            state->sids_size = new_size;
+        }
+        state->sids[state->sids_cnt].id = sids[i];
+        state->sids[state->sids_cnt].edge = edge;
+        state->sids_cnt++;
+    }
+}
+
 static int StreamMpmFunc(
-        void *cb_data, const uint8_t *data, const uint32_t data_len, const uint64_t _offset)
+        void *cb_data, const uint8_t *data, const uint32_t data_len, const uint64_t offset)
 {
     struct StreamMpmData *smd = cb_data;
-    if (data_len >= smd->mpm_ctx->minlen) {
+    DetectStreamMpmState *state = smd->state;
+    uint32_t skip = 0;
+    uint32_t pmq_cnt = 0;
+
+    if (state != NULL) {
+        skip = StreamMpmStateSkip(state, offset, data_len, smd->mpm_ctx->maxlen);
+        for (uint32_t i = 0; i < state->sids_cnt; i++) {
+            PrefilterAddSids(&smd->det_ctx->pmq, &state->sids[i].id, 1);
+        }
+        pmq_cnt = smd->det_ctx->pmq.rule_id_array_cnt;
+    }
+
+    const uint32_t scan_len = data_len - skip;
+    if (scan_len >= smd->mpm_ctx->minlen) {
 #ifdef DEBUG
         smd->det_ctx->stream_mpm_cnt++;
-        smd->det_ctx->stream_mpm_size += data_len;
+        smd->det_ctx->stream_mpm_size += scan_len;
 #endif
         (void)mpm_table[smd->mpm_ctx->mpm_type].Search(
-                smd->mpm_ctx, &smd->det_ctx->mtc, &smd->det_ctx->pmq, data, data_len);
-        PREFILTER_PROFILING_ADD_BYTES(smd->det_ctx, data_len);
+                smd->mpm_ctx, &smd->det_ctx->mtc, &smd->det_ctx->pmq, data + skip, scan_len);
+        PREFILTER_PROFILING_ADD_BYTES(smd->det_ctx, scan_len);
+    }
+
+    if (state != NULL && skip < data_len) {
+        const uint64_t edge = offset + data_len;
+        StreamMpmStateAddSids(state, smd->det_ctx->pmq.rule_id_array + pmq_cnt,
+                smd->det_ctx->pmq.rule_id_array_cnt - pmq_cnt, edge);
+        if (state->scan_start != UINT64_MAX)
+            state->scanned = MAX(state->scanned, edge);
     }
     return 0;
 }
@@ -82,7 +229,15 @@ static void PrefilterPktStream(DetectEngineThreadCtx *det_ctx,
     if (p->flags & PKT_DETECT_HAS_STREAMDATA) {
         SCLogDebug("PRE det_ctx->raw_stream_progress %"PRIu64,
                 det_ctx->raw_stream_progress);
-        struct StreamMpmData stream_mpm_data = { det_ctx, mpm_ctx };
+        /* in inline mode the window around each packet overlaps with the
+         * windows of the packets before it, so use the streaming state to
+         * only scan the new data. In IDS mode the raw progress already makes
+         * sure each byte is scanned only once. */
+        DetectStreamMpmState *state = NULL;
+        if (det_ctx->de_ctx->prefilter_stream && StreamTcpInlineMode()) {
+            state = StreamMpmStateGet(det_ctx, mpm_ctx, p);
+        }
+        struct StreamMpmData stream_mpm_data = { det_ctx, mpm_ctx, state };
         StreamReassembleRaw(p->flow->protoctx, p,
                 StreamMpmFunc, &stream_mpm_data,
                 &det_ctx->raw_stream_progress,
@@ -1137,6 +1292,71 @@ static int PayloadTestSig34(void)
     PASS;
 }
 
+/** \test inline stream mpm: only new data is scanned, with overlap */
+static int PayloadTestStreamMpm01(void)
+{
+    DetectStreamMpmState *state = SCCalloc(1, sizeof(*state));
+    FAIL_IF_NULL(state);
+    StreamTcpIncrMemuse((uint64_t)sizeof(*state));
+    StreamMpmStateReset(state);
+
+    /* first window is scanned in full */
+    FAIL_IF_NOT(StreamMpmStateSkip(state, 0, 100, 4) == 0);
+    SigIntId sids[] = { 1, 2 };
+    StreamMpmStateAddSids(state, sids, 2, 100);
+    state->scanned = 100;
+
+    /* overlapping window: skip up to 'scanned - (maxlen - 1)' */
+    FAIL_IF_NOT(StreamMpmStateSkip(state, 50, 100, 4) == 47);
+    FAIL_IF_NOT(state->sids_cnt == 2);
+    /* sid 2 found again further on, sid 3 is new */
+    SigIntId sids2[] = { 2, 3 };
+    StreamMpmStateAddSids(state, sids2, 2, 150);
+    state->scanned = 150;
+    FAIL_IF_NOT(state->sids_cnt == 3);
+
+    /* window moved beyond the first scan: sid 1 is dropped */
+    FAIL_IF_NOT(StreamMpmStateSkip(state, 120, 10, 4) == 10);
+    FAIL_IF_NOT(state->sids_cnt == 2);
+    FAIL_IF_NOT(state->sids[0].id == 2 && state->sids[1].id == 3);
+
+    /* data left of what we track: reset */
+    FAIL_IF_NOT(StreamMpmStateSkip(state, 100, 60, 4) == 0);
+    FAIL_IF_NOT(state->sids_cnt == 0);
+    state->scanned = 160;
+
+    /* gap: reset */
+    FAIL_IF_NOT(StreamMpmStateSkip(state, 200, 60, 4) == 0);
+    FAIL_IF_NOT(state->scan_start == 200);
+
+    DetectStreamMpmStateFree(state);
+    PASS;
+}
+
+/** \test inline stream mpm: too many matches resets the state */
+static int PayloadTestStreamMpm02(void)
+{
+    DetectStreamMpmState *state = SCCalloc(1, sizeof(*state));
+    FAIL_IF_NULL(state);
+    StreamTcpIncrMemuse((uint64_t)sizeof(*state));
+    StreamMpmStateReset(state);
+
+    FAIL_IF_NOT(StreamMpmStateSkip(state, 0, 100, 4) == 0);
+    SigIntId sids[STREAM_MPM_MAX_SIDS + 1];
+    for (uint32_t i = 0; i < STREAM_MPM_MAX_SIDS + 1; i++) {
+        sids[i] = i;
+    }
+    StreamMpmStateAddSids(state, sids, STREAM_MPM_MAX_SIDS, 100);
+    FAIL_IF_NOT(state->sids_cnt == STREAM_MPM_MAX_SIDS);
+    StreamMpmStateAddSids(state, sids, STREAM_MPM_MAX_SIDS + 1, 100);
+    FAIL_IF_NOT(state->sids_cnt == 0);
+    FAIL_IF_NOT(state->scanned == UINT64_MAX);
+    /* so the next window is scanned in full */
+    FAIL_IF_NOT(StreamMpmStateSkip(state, 50, 100, 4) == 0);
+
+    DetectStreamMpmStateFree(state);
+    PASS;
+}
 #endif /* UNITTESTS */
 
 void PayloadRegisterTests(void)
@@ -1178,5 +1398,7 @@ void PayloadRegisterTests(void)
     UtRegisterTest("PayloadTestSig32", PayloadTestSig32);
     UtRegisterTest("PayloadTestSig33", PayloadTestSig33);
     UtRegisterTest("PayloadTestSig34", PayloadTestSig34);
+    UtRegisterTest("PayloadTestStreamMpm01", PayloadTestStreamMpm01);
+    UtRegisterTest("PayloadTestStreamMpm02", PayloadTestStreamMpm02);
 #endif /* UNITTESTS */
 }
@@ -38,6 +38,31 @@ uint8_t DetectEngineInspectStream(DetectEngineCtx *de_ctx, DetectEngineThreadCtx
         const struct DetectEngineAppInspectionEngine_ *engine, const Signature *s, Flow *f,
         uint8_t flags, void *alstate, void *txv, uint64_t tx_id);
 
+/** match of the inline stream mpm that may still be in the inspection window */
+typedef struct DetectStreamMpmSid_ {
+    SigIntId id;
+    uint64_t edge; /**< right edge of the data scanned when the match was found */
+} DetectStreamMpmSid;
+
+/** \brief per direction state of the inline stream mpm
+ *
+ *  In inline mode the stream mpm runs over a window around each packet,
+ *  so most of the window was scanned for the previous packets already.
+ *  With detect.prefilter.streaming enabled only the data beyond 'scanned'
+ *  is searched, and the matches found in the earlier data that is still
+ *  in the window are added to the prefilter results again. */
+typedef struct DetectStreamMpmState_ {
+    const MpmCtx *mpm_ctx; /**< mpm the matches belong to */
+    uint32_t de_version;   /**< detect engine version the matches belong to */
+    uint32_t sids_cnt;
+    uint32_t sids_size;
+    uint64_t scan_start; /**< left edge of the data scanned without gaps */
+    uint64_t scanned;    /**< right edge of the data scanned so far */
+    DetectStreamMpmSid *sids;
+} DetectStreamMpmState;
+
+void DetectStreamMpmStateFree(DetectStreamMpmState *state);
+
 void PayloadRegisterTests(void);
 
 #endif /* SURICATA_DETECT_ENGINE_PAYLOAD_H */
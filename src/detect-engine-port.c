@@ -626,6 +626,67 @@ DetectPort *DetectPortLookupGroup(DetectPort *dp, uint16_t port)
     return NULL;
 }
 
+/**
+ * \brief Flatten a port group list into a lookup table
+ *
+ * \param t table to fill, freed by DetectPortLookupTableFree()
+ * \param head port group list. Groups may not overlap.
+ *
+ * \retval 0 on success
+ * \retval -1 on memory error or overlapping groups
+ */
+int DetectPortLookupTableBuild(DetectPortLookupTable *t, const DetectPort *head)
+{
+    memset(t, 0, sizeof(*t));
+
+    uint32_t cnt = 0;
+    for (const DetectPort *p = head; p != NULL; p = p->next)
+        cnt++;
+    if (cnt == 0)
+        return 0;
+
+    t->sh = SCCalloc(cnt, sizeof(t->sh[0]));
+    t->port = SCCalloc(cnt, sizeof(t->port[0]));
+    t->port2 = SCCalloc(cnt, sizeof(t->port2[0]));
+    if (t->sh == NULL || t->port == NULL || t->port2 == NULL) {
+        DetectPortLookupTableFree(t);
+        return -1;
+    }
+
+    /* insertion sort on the low port: the lists are normally sorted
+     * already, so this is a single pass */
+    for (const DetectPort *p = head; p != NULL; p = p->next) {
+        uint32_t i = t->cnt++;
+        while (i > 0 && t->port[i - 1] > p->port) {
+            t->port[i] = t->port[i - 1];
+            t->port2[i] = t->port2[i - 1];
+            t->sh[i] = t->sh[i - 1];
+            i--;
+        }
+        t->port[i] = p->port;
+        t->port2[i] = p->port2;
+        t->sh[i] = p->sh;
+    }
+
+    for (uint32_t i = 1; i < t->cnt; i++) {
+        if (t->port[i] <= t->port2[i - 1]) {
+            SCLogDebug("port groups %u-%u and %u-%u overlap", t->port[i - 1], t->port2[i - 1],
+                    t->port[i], t->port2[i]);
+            DetectPortLookupTableFree(t);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+void DetectPortLookupTableFree(DetectPortLookupTable *t)
+{
+    SCFree(t->sh);
+    SCFree(t->port);
+    SCFree(t->port2);
+    memset(t, 0, sizeof(*t));
+}
+
 /**
  * \brief Checks if two port group lists are equal.
  *
@@ -1953,6 +2014,43 @@ static int PortTestFunctions07(void)
     PASS;
 }
 
+/**
+ * \test the lookup table finds the same groups as the list walk
+ */
+static int PortTestLookupTable01(void)
+{
+    DetectPort *dd = NULL;
+    DetectPortLookupTable t;
+
+    FAIL_IF_NOT(DetectPortParse(NULL, &dd, "[1:80,![2,4],443,1024:2048,8080,65535]") == 0);
+    FAIL_IF_NOT(DetectPortLookupTableBuild(&t, dd) == 0);
+    uint32_t cnt = 0;
+    for (const DetectPort *p = dd; p != NULL; p = p->next)
+        cnt++;
+    FAIL_IF_NOT(t.cnt == cnt);
+
+    for (uint32_t port = 0; port <= UINT16_MAX; port++) {
+        const DetectPort *p = DetectPortLookupGroup(dd, (uint16_t)port);
+        const int32_t idx = DetectPortLookupTableIdx(&t, (uint16_t)port);
+        if (p == NULL) {
+            FAIL_IF_NOT(idx == -1);
+        } else {
+            FAIL_IF(idx < 0);
+            FAIL_IF_NOT(t.port[idx] == p->port);
+            FAIL_IF_NOT(t.port2[idx] == p->port2);
+        }
+    }
+
+    DetectPortLookupTableFree(&t);
+    FAIL_IF_NOT(DetectPortLookupTableIdx(&t, 80) == -1);
+    DetectPortCleanupList(NULL, dd);
+
+    /* empty list gives an empty table */
+    FAIL_IF_NOT(DetectPortLookupTableBuild(&t, NULL) == 0);
+    FAIL_IF_NOT(DetectPortLookupTableGet(&t, 80) == NULL);
+    PASS;
+}
+
 /**
  * \test Test packet Matches
  * \param raw_eth_pkt pointer to the ethernet packet
@@ -2367,6 +2465,7 @@ void DetectPortTests(void)
     UtRegisterTest("PortTestMatchDoubleNegation", PortTestMatchDoubleNegation);
     UtRegisterTest("DetectPortParseDoTest", DetectPortParseDoTest);
     UtRegisterTest("DetectPortParseDoTest2", DetectPortParseDoTest2);
+    UtRegisterTest("PortTestLookupTable01", PortTestLookupTable01);
     UtRegisterTest("PortParseTestLessThan14Spaces", PortParseTestLessThan14Spaces);
     UtRegisterTest("PortParseTest14Spaces", PortParseTest14Spaces);
     UtRegisterTest("PortParseTestMoreThan14Spaces", PortParseTestMoreThan14Spaces);
@@ -50,6 +50,42 @@ void DetectPortCleanupList (const DetectEngineCtx *de_ctx, DetectPort *head);
 
 DetectPort *DetectPortLookupGroup(DetectPort *dp, uint16_t port);
 
+int DetectPortLookupTableBuild(DetectPortLookupTable *t, const DetectPort *head);
+void DetectPortLookupTableFree(DetectPortLookupTable *t);
+
+/**
+ * \brief find the index of the port group in a lookup table
+ *
+ * Branchless binary search for the last group starting at or below
+ * port, followed by a check that the port is inside that group.
+ *
+ * \retval idx index of the group or -1 if port is not in a group
+ */
+static inline int32_t DetectPortLookupTableIdx(const DetectPortLookupTable *t, const uint16_t port)
+{
+    if (t->cnt == 0)
+        return -1;
+
+    const uint16_t *base = t->port;
+    uint32_t n = t->cnt;
+    while (n > 1) {
+        const uint32_t half = n / 2;
+        base = (base[half] <= port) ? base + half : base;
+        n -= half;
+    }
+    const int32_t idx = (int32_t)(base - t->port);
+    if (port >= t->port[idx] && port <= t->port2[idx])
+        return idx;
+    return -1;
+}
+
+static inline struct SigGroupHead_ *DetectPortLookupTableGet(
+        const DetectPortLookupTable *t, const uint16_t port)
+{
+    const int32_t idx = DetectPortLookupTableIdx(t, port);
+    return idx >= 0 ? t->sh[idx] : NULL;
+}
+
 bool DetectPortListsAreEqual(DetectPort *list1, DetectPort *list2);
 
 void DetectPortPrint(DetectPort *);
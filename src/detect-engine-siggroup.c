@@ -40,6 +40,7 @@
 #include "detect-engine-prefilter.h"
 
 #include "detect-content.h"
+#include "detect-pcre-hs.h"
 #include "detect-uricontent.h"
 #include "detect-tcp-flags.h"
 
@@ -173,6 +174,7 @@ void SigGroupHeadFree(const DetectEngineCtx *de_ctx, SigGroupHead *sgh)
     }
 
     PrefilterCleanupRuleGroup(de_ctx, sgh);
+    DetectPcreHsRuleGroupFree(sgh);
     SCFree(sgh);
 }
 
@@ -605,6 +607,68 @@ void SigGroupHeadSetupFiles(const DetectEngineCtx *de_ctx, SigGroupHead *sgh)
     }
 }
 
+/**
+ *  \brief Check if a signature can only affect the packet rule digest
+ *         outcome through the properties stored in the digest.
+ *
+ *  Rules that are inspected outside of the packet rules, or that can't
+ *  match a packet without payload and events, are fine regardless of
+ *  their keywords.
+ */
+static bool SignatureIsPktDigestSafe(const Signature *s)
+{
+    if (s->type == SIG_TYPE_APP_TX)
+        return true;
+    if (s->mask & (SIG_MASK_REQUIRE_PAYLOAD | SIG_MASK_REQUIRE_ENGINE_EVENT))
+        return true;
+
+    if (s->init_data->buffer_index > 0 || s->init_data->smlists[DETECT_SM_LIST_PMATCH] != NULL)
+        return false;
+
+    for (const SigMatch *sm = s->init_data->smlists[DETECT_SM_LIST_MATCH]; sm != NULL;
+            sm = sm->next) {
+        switch (sm->type) {
+            case DETECT_FLAGS:
+            case DETECT_DSIZE:
+            case DETECT_TTL:
+            case DETECT_ITYPE:
+            case DETECT_ICODE:
+            case DETECT_FLOW:
+            case DETECT_IPPROTO:
+            /* flowbit changes reset the digest */
+            case DETECT_FLOWBITS:
+                break;
+            default:
+                SCLogDebug("sid %u: keyword %s prevents packet digest", s->id,
+                        sigmatch_table[sm->type].name);
+                return false;
+        }
+    }
+    return true;
+}
+
+/**
+ *  \brief Set the packet digest flag in the sgh if all its rules allow it.
+ *
+ *  \param de_ctx detection engine ctx for the signatures
+ *  \param sgh sig group head to update
+ */
+void SigGroupHeadSetupPktDigest(const DetectEngineCtx *de_ctx, SigGroupHead *sgh)
+{
+    if (sgh == NULL || !de_ctx->pkt_digest)
+        return;
+
+    for (uint32_t sig = 0; sig < sgh->init->sig_cnt; sig++) {
+        const Signature *s = sgh->init->match_array[sig];
+        if (s == NULL)
+            continue;
+        if (!SignatureIsPktDigestSafe(s))
+            return;
+    }
+    sgh->flags |= SIG_GROUP_HEAD_PKT_DIGEST;
+    SCLogDebug("sgh %p supports the packet digest", sgh);
+}
+
 /**
  * \brief Check if a SigGroupHead contains a Signature, whose sid is sent as an
  *        argument.
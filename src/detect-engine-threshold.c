@@ -56,8 +56,20 @@
 #include "util-thash.h"
 #include "util-hash-lookup3.h"
 
+/** default number of hits a thread counts locally before merging them */
+#define THRESHOLD_SHARD_SYNC_COUNT 16
+/** default max time in msecs between merges of a threads local hits */
+#define THRESHOLD_SHARD_SYNC_INTERVAL 100
+/** max number of entries in a threads local table */
+#define THRESHOLD_SHARD_MAX_ITEMS 65536
+
 struct Thresholds {
     THashTableContext *thash;
+
+    /** count hits per thread and merge them into thash in batches */
+    bool sharded;
+    uint32_t sync_count;
+    uint32_t sync_interval; /**< msecs */
 } ctx;
 
 static int ThresholdsInit(struct Thresholds *t);
@@ -213,6 +225,36 @@ static int ThresholdsInit(struct Thresholds *t)
         hashsize = (uint32_t)value;
     }
 
+    t->sharded = false;
+    t->sync_count = THRESHOLD_SHARD_SYNC_COUNT;
+    t->sync_interval = THRESHOLD_SHARD_SYNC_INTERVAL;
+
+    int sharded = 0;
+    (void)SCConfGetBool("detect.thresholds.sharded.enabled", &sharded);
+    if (sharded) {
+        if ((SCConfGetInt("detect.thresholds.sharded.sync-count", &value)) == 1) {
+            if (value < 1 || value > UINT16_MAX) {
+                SCLogError("'detect.thresholds.sharded.sync-count' value %" PRIiMAX
+                           " out of range. Valid range 1-65535.",
+                        value);
+                return -1;
+            }
+            t->sync_count = (uint32_t)value;
+        }
+        if ((SCConfGetInt("detect.thresholds.sharded.sync-interval", &value)) == 1) {
+            if (value < 0 || value > 60000) {
+                SCLogError("'detect.thresholds.sharded.sync-interval' value %" PRIiMAX
+                           " out of range. Valid range 0-60000.",
+                        value);
+                return -1;
+            }
+            t->sync_interval = (uint32_t)value;
+        }
+        t->sharded = true;
+        SCLogConfig("thresholds: per thread counting, merging every %u hits or %u msecs",
+                t->sync_count, t->sync_interval);
+    }
+
     t->thash = THashInit("thresholds", sizeof(ThresholdEntry), ThresholdEntrySet,
             ThresholdEntryFree, ThresholdEntryHash, ThresholdEntryCompare, ThresholdEntryExpire,
             NULL, 0, memcap, hashsize);
@@ -451,6 +493,97 @@ static int CheckCache(const Packet *p, const int8_t track, const uint32_t sid, c
     return -1; // cache miss - not found
 }
 
+/* thread local counters for sharded thresholds. Each item holds the state of
+ * the global entry as of the last merge, plus the hits the thread has seen
+ * since then. */
+
+typedef struct ThresholdShardItem {
+    ThresholdEntry e;   /**< key, plus window start and count at last merge */
+    uint32_t pending;   /**< hits not yet merged into the global entry */
+    SCTime_t synced_at; /**< time of the last merge */
+    SCTime_t expires_at;
+    RB_ENTRY(ThresholdShardItem) rb;
+} ThresholdShardItem;
+
+static thread_local HashTable *threshold_shard_ht = NULL;
+static thread_local uint32_t threshold_shard_cnt = 0;
+
+static thread_local uint64_t shard_hit_cnt = 0;
+static thread_local uint64_t shard_sync_cnt = 0;
+static thread_local uint64_t shard_full_cnt = 0;
+static thread_local uint64_t shard_expired_cnt = 0;
+
+static int ThresholdShardTreeCompareFunc(ThresholdShardItem *a, ThresholdShardItem *b)
+{
+    if (SCTIME_CMP_GTE(a->expires_at, b->expires_at)) {
+        return 1;
+    } else {
+        return -1;
+    }
+}
+
+RB_HEAD(THRESHOLD_SHARD, ThresholdShardItem);
+RB_PROTOTYPE(THRESHOLD_SHARD, ThresholdShardItem, rb, ThresholdShardTreeCompareFunc);
+RB_GENERATE(THRESHOLD_SHARD, ThresholdShardItem, rb, ThresholdShardTreeCompareFunc);
+static thread_local struct THRESHOLD_SHARD threshold_shard_tree;
+static thread_local uint64_t threshold_shard_housekeeping_ts = 0;
+
+/** \internal
+ *  \brief remove items for which the window ended. Hits that were not merged
+ *         yet belong to the expired window, so they are dropped as well. */
+static void ThresholdShardExpire(SCTime_t now)
+{
+    ThresholdShardItem *iter, *safe = NULL;
+    int cnt = 0;
+    threshold_shard_housekeeping_ts = SCTIME_SECS(now);
+
+    RB_FOREACH_SAFE (iter, THRESHOLD_SHARD, &threshold_shard_tree, safe) {
+        if (!SCTIME_CMP_LT(iter->expires_at, now))
+            break;
+
+        THRESHOLD_SHARD_RB_REMOVE(&threshold_shard_tree, iter);
+        HashTableRemove(threshold_shard_ht, iter, 0);
+        threshold_shard_cnt--;
+        shard_expired_cnt++;
+
+        if (++cnt >= 64)
+            break;
+    }
+}
+
+static uint32_t ThresholdShardHashFunc(HashTable *ht, void *data, uint16_t datalen)
+{
+    ThresholdShardItem *item = data;
+    return ThresholdEntryHash(0, &item->e) % ht->array_size;
+}
+
+static char ThresholdShardHashCompareFunc(
+        void *data1, uint16_t datalen1, void *data2, uint16_t datalen2)
+{
+    ThresholdShardItem *item1 = data1;
+    ThresholdShardItem *item2 = data2;
+    return ThresholdEntryCompare(&item1->e, &item2->e);
+}
+
+static void ThresholdShardHashFreeFunc(void *data)
+{
+    SCFree(data);
+}
+
+static void ThresholdShardThreadFree(void)
+{
+    if (threshold_shard_ht) {
+        HashTableFree(threshold_shard_ht);
+        threshold_shard_ht = NULL;
+
+        SCLogPerf("threshold thread shard stats: hits:%" PRIu64 " merges:%" PRIu64
+                  " full:%" PRIu64 " expired:%" PRIu64,
+                shard_hit_cnt, shard_sync_cnt, shard_full_cnt, shard_expired_cnt);
+    }
+    threshold_shard_cnt = 0;
+    RB_INIT(&threshold_shard_tree);
+}
+
 void ThresholdCacheThreadFree(void)
 {
     if (threshold_cache_ht) {
@@ -459,6 +592,7 @@ void ThresholdCacheThreadFree(void)
     }
     RB_INIT(&threshold_cache_tree);
     DumpCacheStats();
+    ThresholdShardThreadFree();
 }
 
 /**
@@ -855,6 +989,251 @@ static int ThresholdCheckUpdate(const DetectEngineCtx *de_ctx, const DetectThres
     return ret;
 }
 
+/** \internal
+ *  \brief check if a threshold can be evaluated with per thread counters
+ *
+ *  Only types that are decided by the number of hits in the window are
+ *  supported. rate_filter has timeout state that can't be merged.
+ */
+static inline bool ThresholdShardSupported(const DetectThresholdData *td)
+{
+    if (td->flags & THRESHOLD_FLAG_EXACT)
+        return false;
+
+    switch (td->type) {
+        case TYPE_LIMIT:
+        case TYPE_THRESHOLD:
+        case TYPE_BOTH:
+        case TYPE_DETECTION:
+            return td->count > 0;
+    }
+    return false;
+}
+
+/** \internal
+ *  \brief verdict for a hit that brings the count in the window from
+ *         prev to cur
+ *
+ *  cur - prev can be larger than 1 if hits of this thread are merged. Only
+ *  the last of them is decided here, the others were decided locally.
+ *
+ *  \retval 2 silent match (no alert but apply actions)
+ *  \retval 1 normal match
+ *  \retval 0 no match
+ */
+static int ThresholdShardVerdict(
+        const DetectThresholdData *td, const uint32_t prev, const uint32_t cur)
+{
+    switch (td->type) {
+        case TYPE_LIMIT:
+            return cur <= td->count ? 1 : 2;
+        case TYPE_THRESHOLD:
+            /* alert once every count hits */
+            return (prev / td->count) != (cur / td->count) ? 1 : 0;
+        case TYPE_BOTH:
+            if (prev < td->count && cur >= td->count)
+                return 1;
+            return cur > td->count ? 2 : 0;
+        case TYPE_DETECTION:
+            return cur > td->count ? 1 : 0;
+    }
+    return 0;
+}
+
+/** \internal
+ *  \brief check if a local hit would change the verdict compared to what
+ *         the last merge returned. If so the hits are merged first so the
+ *         transition is decided on the global count.
+ */
+static inline bool ThresholdShardCrossed(
+        const DetectThresholdData *td, const uint32_t synced, const uint32_t cur)
+{
+    switch (td->type) {
+        case TYPE_THRESHOLD:
+            return (synced / td->count) != (cur / td->count);
+        case TYPE_BOTH:
+            return synced < td->count && cur >= td->count;
+        default:
+            return synced <= td->count && cur > td->count;
+    }
+}
+
+/** \internal
+ *  \brief add the current hit and 'pending' earlier local hits to the
+ *         global entry
+ *
+ *  In sharded mode all updates of the global entries of the supported
+ *  types go through here, so the count is always the number of hits in
+ *  the window, as ThresholdShardVerdict expects.
+ *
+ *  \param state if not NULL, set to the window start and count of the
+ *               global entry after the merge
+ */
+static int ThresholdShardMerge(struct Thresholds *tctx, const Packet *p, const Signature *s,
+        const DetectThresholdData *td, ThresholdEntry *lookup, const uint32_t pending,
+        ThresholdEntry *state)
+{
+    shard_sync_cnt++;
+
+    struct THashDataGetResult res = THashGetFromHash(tctx->thash, lookup);
+    if (res.data == NULL)
+        return 0;
+
+    int r;
+    ThresholdEntry *te = res.data->data;
+    if (res.is_new) {
+        r = ThresholdSetup(td, te, p->ts, s->id, s->gid, s->rev, p->tenant_id);
+    } else if (SCTIME_CMP_GT(p->ts, SCTIME_ADD_SECS(te->tv1, td->seconds))) {
+        /* window expired: local hits that weren't merged yet belonged to it */
+        te->tv1 = p->ts;
+        te->current_count = 1;
+        r = ThresholdShardVerdict(td, 0, 1);
+    } else {
+        const uint32_t prev = te->current_count;
+        const uint64_t cur = (uint64_t)prev + pending + 1;
+        te->current_count = cur > UINT32_MAX ? UINT32_MAX : (uint32_t)cur;
+        r = ThresholdShardVerdict(td, prev, te->current_count);
+    }
+
+    if (state != NULL) {
+        state->tv1 = te->tv1;
+        state->current_count = te->current_count;
+    }
+    (void)THashDecrUsecnt(res.data);
+    THashDataUnlock(res.data);
+    return r;
+}
+
+/** \internal
+ *  \brief merge the local hits of an item into the global entry
+ *
+ *  The current hit is counted as well. Updates the item with the global state.
+ */
+static int ThresholdShardSync(struct Thresholds *tctx, const Packet *p, const Signature *s,
+        const DetectThresholdData *td, ThresholdShardItem *item, ThresholdEntry *lookup)
+{
+    const int r = ThresholdShardMerge(tctx, p, s, td, lookup, item->pending, &item->e);
+
+    item->pending = 0;
+    item->synced_at = p->ts;
+    const SCTime_t expires = SCTIME_ADD_SECS(item->e.tv1, td->seconds);
+    if (SCTIME_CMP_NEQ(expires, item->expires_at)) {
+        THRESHOLD_SHARD_RB_REMOVE(&threshold_shard_tree, item);
+        item->expires_at = expires;
+        THRESHOLD_SHARD_RB_INSERT(&threshold_shard_tree, item);
+    }
+    return r;
+}
+
+/** \internal
+ *  \brief remove the item whose window ends first, to make room for a new one
+ *
+ *  Its hits that were not merged yet are added to the global entry, if that
+ *  is still in the same window. They were decided locally already, so no
+ *  verdict is needed.
+ *
+ *  \retval true if an item was removed
+ */
+static bool ThresholdShardEvict(struct Thresholds *tctx, const Packet *p)
+{
+    ThresholdShardItem *item = RB_MIN(THRESHOLD_SHARD, &threshold_shard_tree);
+    if (item == NULL)
+        return false;
+
+    if (item->pending > 0 && !SCTIME_CMP_GT(p->ts, item->expires_at)) {
+        THashData *h = THashLookupFromHash(tctx->thash, &item->e);
+        if (h != NULL) {
+            ThresholdEntry *te = h->data;
+            if (SCTIME_CMP_EQ(te->tv1, item->e.tv1)) {
+                const uint64_t cur = (uint64_t)te->current_count + item->pending;
+                te->current_count = cur > UINT32_MAX ? UINT32_MAX : (uint32_t)cur;
+            }
+            (void)THashDecrUsecnt(h);
+            THashDataUnlock(h);
+            shard_sync_cnt++;
+        }
+    }
+
+    THRESHOLD_SHARD_RB_REMOVE(&threshold_shard_tree, item);
+    HashTableRemove(threshold_shard_ht, item, 0);
+    threshold_shard_cnt--;
+    return true;
+}
+
+/** \internal
+ *  \brief evaluate a threshold using the threads local counters
+ *
+ *  Hits are counted locally and merged into the global entry every
+ *  sync_count hits, after sync_interval msecs, when the window expires or
+ *  when the local count would change the verdict. Until then each thread
+ *  decides on the global count as of its last merge plus its own hits, so
+ *  with N threads the count used can be off by N * (sync_count - 1).
+ *
+ *  If the local table is full, the item whose window ends first is evicted.
+ *  If no local item can be allocated at all, the hit is merged into the
+ *  global entry right away. The global entries of the sharded types are
+ *  never updated by ThresholdCheckUpdate, which counts differently.
+ */
+static int ThresholdShardGet(struct Thresholds *tctx, const Packet *p, const Signature *s,
+        const DetectThresholdData *td, ThresholdEntry *lookup)
+{
+    if (threshold_shard_ht == NULL) {
+        threshold_shard_ht = HashTableInit(4096, ThresholdShardHashFunc,
+                ThresholdShardHashCompareFunc, ThresholdShardHashFreeFunc);
+        if (threshold_shard_ht == NULL)
+            return ThresholdShardMerge(tctx, p, s, td, lookup, 0, NULL);
+    }
+    if (SCTIME_SECS(p->ts) > threshold_shard_housekeeping_ts) {
+        ThresholdShardExpire(p->ts);
+    }
+    shard_hit_cnt++;
+
+    /* the entry is the first member of the item, so it can be used as the key */
+    ThresholdShardItem *item = HashTableLookup(threshold_shard_ht, lookup, 0);
+    int r;
+    if (item == NULL) {
+        if (threshold_shard_cnt >= THRESHOLD_SHARD_MAX_ITEMS) {
+            shard_full_cnt++;
+            (void)ThresholdShardEvict(tctx, p);
+        }
+        item = SCCalloc(1, sizeof(*item));
+        if (item == NULL && ThresholdShardEvict(tctx, p)) {
+            item = SCCalloc(1, sizeof(*item));
+        }
+        if (item == NULL) {
+            return ThresholdShardMerge(tctx, p, s, td, lookup, 0, NULL);
+        }
+        item->e = *lookup;
+        item->expires_at = SCTIME_ADD_SECS(p->ts, td->seconds);
+        if (HashTableAdd(threshold_shard_ht, item, 0) != 0) {
+            SCFree(item);
+            return ThresholdShardMerge(tctx, p, s, td, lookup, 0, NULL);
+        }
+        THRESHOLD_SHARD_RB_INSERT(&threshold_shard_tree, item);
+        threshold_shard_cnt++;
+        r = ThresholdShardSync(tctx, p, s, td, item, lookup);
+    } else {
+        const uint32_t synced = item->e.current_count;
+        const uint32_t cur = synced + item->pending + 1;
+        if (SCTIME_CMP_GT(p->ts, item->expires_at) || item->pending + 1 >= tctx->sync_count ||
+                (tctx->sync_interval &&
+                        SCTIME_CMP_GTE(p->ts, SCTIME_ADD_USECS(item->synced_at,
+                                                      (uint64_t)tctx->sync_interval * 1000))) ||
+                cur < synced || ThresholdShardCrossed(td, synced, cur)) {
+            r = ThresholdShardSync(tctx, p, s, td, item, lookup);
+        } else {
+            item->pending++;
+            r = ThresholdShardVerdict(td, cur - 1, cur);
+        }
+    }
+
+    /* over the limit until the window expires */
+    if (r == 2 && PacketIsIPv4(p) && (td->type == TYPE_LIMIT || td->type == TYPE_BOTH)) {
+        SetupCache(p, td->track, (int8_t)r, s->id, s->gid, s->rev, item->expires_at);
+    }
+    return r;
+}
+
 static int ThresholdGetFromHash(const DetectEngineCtx *de_ctx, struct Thresholds *tctx,
         const Packet *p, const Signature *s, const DetectThresholdData *td, PacketAlert *pa)
 {
@@ -895,6 +1274,10 @@ static int ThresholdGetFromHash(const DetectEngineCtx *de_ctx, struct Thresholds
         }
     }
 
+    if (tctx->sharded && ThresholdShardSupported(td)) {
+        return ThresholdShardGet(tctx, p, s, td, &lookup);
+    }
+
     struct THashDataGetResult res = THashGetFromHash(tctx->thash, &lookup);
     if (res.data) {
         SCLogDebug("found %p, is_new %s", res.data, BOOL2STR(res.is_new));
@@ -78,6 +78,7 @@
 #include "util-magic.h"
 #include "util-signal.h"
 #include "util-spm.h"
+#include "detect-pcre-hs.h"
 #include "util-device-private.h"
 #include "util-var-name.h"
 #include "util-path.h"
@@ -739,6 +740,10 @@ static void AppendAppInspectEngine(DetectEngineCtx *de_ctx,
     new_engine->sm_list_base = t->sm_list_base;
     new_engine->smd = smd;
     new_engine->match_on_null = smd ? DetectContentInspectionMatchOnAbsentBuffer(smd) : false;
+    if (new_engine->mpm && de_ctx->prefilter_stream) {
+        const DetectBufferType *map = DetectEngineBufferTypeGetById(de_ctx, t->sm_list_base);
+        new_engine->mpm_stream = (map != NULL && map->mpm_stream);
+    }
     new_engine->progress = t->progress;
     new_engine->v2 = t->v2;
     SCLogDebug("sm_list %d new_engine->v2 %p/%p/%p", new_engine->sm_list, new_engine->v2.Callback,
@@ -1235,6 +1240,18 @@ void DetectBufferTypeSupportsMultiInstance(const char *name)
     SCLogDebug("%p %s -- %d supports multi instance", exists, name, exists->id);
 }
 
+/** \brief the buffer grows over time and its prefilter can be set up to
+ *         scan only the data added since the last run */
+void DetectBufferTypeSupportsMpmStream(const char *name)
+{
+    BUG_ON(g_buffer_type_reg_closed);
+    DetectBufferTypeRegister(name);
+    DetectBufferType *exists = DetectBufferTypeLookupByName(name);
+    BUG_ON(!exists);
+    exists->mpm_stream = true;
+    SCLogDebug("%p %s -- %d supports mpm streaming", exists, name, exists->id);
+}
+
 void DetectBufferTypeSupportsFrames(const char *name)
 {
     BUG_ON(g_buffer_type_reg_closed);
@@ -2684,6 +2701,7 @@ void DetectEngineCtxFree(DetectEngineCtx *de_ctx)
     SCRConfDeInitContext(de_ctx);
 
     SigGroupCleanup(de_ctx);
+    DetectPcreHsFree(de_ctx);
 
     SpmDestroyGlobalThreadCtx(de_ctx->spm_global_thread_ctx);
     SCFree(de_ctx->sm_types_prefilter);
@@ -2966,6 +2984,9 @@ static int DetectEngineCtxLoadConf(DetectEngineCtx *de_ctx)
             de_ctx->guess_applayer = true;
         }
     }
+    int pkt_digest = 1;
+    (void)SCConfGetBool("detect.packet-digest", &pkt_digest);
+    de_ctx->pkt_digest = pkt_digest != 0;
 
     /* parse port grouping priority settings */
 
@@ -3047,6 +3068,12 @@ static int DetectEngineCtxLoadConf(DetectEngineCtx *de_ctx)
             SCLogConfig("prefilter engines: MPM and keywords");
             break;
     }
+    int prefilter_stream = 0;
+    if (SCConfGetBool("detect.prefilter.streaming", &prefilter_stream) == 1 &&
+            prefilter_stream == 1) {
+        de_ctx->prefilter_stream = true;
+        SCLogConfig("prefilter engines: only scan new data of streaming buffers");
+    }
 
     return 0;
 }
@@ -3280,6 +3307,9 @@ static TmEcode ThreadCtxDoInit (DetectEngineCtx *de_ctx, DetectEngineThreadCtx *
     if (det_ctx->spm_thread_ctx == NULL) {
         return TM_ECODE_FAILED;
     }
+    if (DetectPcreHsThreadInit(de_ctx, det_ctx) < 0) {
+        return TM_ECODE_FAILED;
+    }
 
     /* DeState */
     if (de_ctx->sig_array_len > 0) {
@@ -3401,6 +3431,7 @@ TmEcode DetectEngineThreadCtxInit(ThreadVars *tv, void *initdata, void **data)
     det_ctx->counter_alerts = StatsRegisterCounter("detect.alert", tv);
     det_ctx->counter_alerts_overflow = StatsRegisterCounter("detect.alert_queue_overflow", tv);
     det_ctx->counter_alerts_suppressed = StatsRegisterCounter("detect.alerts_suppressed", tv);
+    det_ctx->counter_pkt_digest_skip = StatsRegisterCounter("detect.pkt_digest_skipped", tv);
 
     /* Register counter for Lua rule errors. */
     det_ctx->lua_rule_errors = StatsRegisterCounter("detect.lua.errors", tv);
@@ -3481,6 +3512,7 @@ DetectEngineThreadCtx *DetectEngineThreadCtxInitForReload(
     det_ctx->counter_alerts = StatsRegisterCounter("detect.alert", tv);
     det_ctx->counter_alerts_overflow = StatsRegisterCounter("detect.alert_queue_overflow", tv);
     det_ctx->counter_alerts_suppressed = StatsRegisterCounter("detect.alerts_suppressed", tv);
+    det_ctx->counter_pkt_digest_skip = StatsRegisterCounter("detect.pkt_digest_skipped", tv);
 #ifdef PROFILING
     det_ctx->counter_mpm_list = StatsRegisterAvgCounter("detect.mpm_list", tv);
     det_ctx->counter_match_list = StatsRegisterAvgCounter("detect.match_list", tv);
@@ -3533,6 +3565,7 @@ static void DetectEngineThreadCtxFree(DetectEngineThreadCtx *det_ctx)
     if (det_ctx->spm_thread_ctx != NULL) {
         SpmDestroyThreadCtx(det_ctx->spm_thread_ctx);
     }
+    DetectPcreHsThreadFree(det_ctx);
     if (det_ctx->match_array != NULL)
         SCFree(det_ctx->match_array);
 
@@ -4349,6 +4382,14 @@ int DetectEngineMultiTenantSetup(const bool unix_socket)
         SCMutexUnlock(&master->lock);
         SCLogConfig("multi-detect is enabled (multi tenancy). Selector: %s", handler);
 
+        /* tenants with the same patterns share the mpm matcher state */
+        int share_mpm = 1;
+        (void)SCConfGetBool("multi-detect.share-mpm", &share_mpm);
+        if (share_mpm) {
+            MpmShareEnable();
+            SCLogConfig("multi-detect: sharing identical mpm contexts between tenants");
+        }
+
         /* traffic -- tenant mappings */
         SCConfNode *mappings_root_node = SCConfGetNode("multi-detect.mappings");
 
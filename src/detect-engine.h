@@ -38,6 +38,7 @@ void DetectBufferTypeSupportsPacket(const char *name);
 void DetectBufferTypeSupportsFrames(const char *name);
 void DetectBufferTypeSupportsTransformations(const char *name);
 void DetectBufferTypeSupportsMultiInstance(const char *name);
+void DetectBufferTypeSupportsMpmStream(const char *name);
 int DetectBufferTypeMaxId(void);
 void DetectBufferTypeCloseRegistration(void);
 void DetectBufferTypeSetDescriptionByName(const char *name, const char *desc);
@@ -118,6 +118,7 @@ void DetectHttpClientBodyRegister(void)
 
     DetectBufferTypeSetDescriptionByName("http_client_body",
             "http request body");
+    DetectBufferTypeSupportsMpmStream("http_client_body");
 
     DetectBufferTypeRegisterSetupCallback("http_client_body",
             DetectHttpClientBodySetupCallback);
@@ -375,10 +376,27 @@ static void PrefilterTxHttpRequestBody(DetectEngineThreadCtx *det_ctx, const voi
     if (buffer == NULL)
         return;
 
-    if (buffer->inspect_len >= mpm_ctx->minlen) {
+    const uint8_t *data = buffer->inspect;
+    uint32_t data_len = buffer->inspect_len;
+    if (det_ctx->de_ctx->prefilter_stream && list_id == ctx->base_list_id) {
+        /* only scan what we didn't scan before, plus enough of the old
+         * data to find the patterns crossing into the new data */
+        HtpBody *body = GetRequestBody(txv);
+        if (body->body_mpm_scanned > buffer->inspect_offset) {
+            const uint64_t overlap = mpm_ctx->maxlen > 0 ? mpm_ctx->maxlen - 1 : 0;
+            uint64_t skip = body->body_mpm_scanned - buffer->inspect_offset;
+            skip = (skip > overlap) ? MIN(skip - overlap, data_len) : 0;
+            data += skip;
+            data_len -= (uint32_t)skip;
+        }
+        body->body_mpm_scanned =
+                MAX(body->body_mpm_scanned, buffer->inspect_offset + buffer->inspect_len);
+    }
+
+    if (data_len >= mpm_ctx->minlen) {
         (void)mpm_table[mpm_ctx->mpm_type].Search(
-                mpm_ctx, &det_ctx->mtc, &det_ctx->pmq, buffer->inspect, buffer->inspect_len);
-        PREFILTER_PROFILING_ADD_BYTES(det_ctx, buffer->inspect_len);
+                mpm_ctx, &det_ctx->mtc, &det_ctx->pmq, data, data_len);
+        PREFILTER_PROFILING_ADD_BYTES(det_ctx, data_len);
     }
 }
 
@@ -42,6 +42,7 @@
 #include "flow-util.h"
 
 #include "util-byte.h"
+#include "util-profiling.h"
 
 #include "util-unittest.h"
 #include "util-unittest-helper.h"
@@ -169,13 +170,25 @@ static void LuaStateSetDetectLuaData(lua_State *state, DetectLuaData *data)
  * \brief Common function to run the Lua match function and process
  *     the return value.
  */
-static int DetectLuaRunMatch(
-        DetectEngineThreadCtx *det_ctx, const DetectLuaData *lua, DetectLuaThreadData *tlua)
+static int DetectLuaRunMatch(DetectEngineThreadCtx *det_ctx, const Signature *s,
+        const DetectLuaData *lua, DetectLuaThreadData *tlua)
 {
     /* Reset instruction count. */
     SCLuaSbResetInstructionCounter(tlua->luastate);
 
-    if (lua_pcall(tlua->luastate, 1, 1, 0) != 0) {
+#ifdef PROFILE_RULES
+    /* account the time spent in the interpreter to the rule */
+    const bool profile = profiling_rules_enabled && profiling_rules_entered > 0;
+    const uint64_t ticks_start = profile ? UtilCpuGetTicks() : 0;
+#endif
+    const int status = lua_pcall(tlua->luastate, 1, 1, 0);
+#ifdef PROFILE_RULES
+    if (profile) {
+        SCProfilingRuleUpdateLuaTicks(
+                det_ctx, s->profiling_id, UtilCpuGetTicks() - ticks_start);
+    }
+#endif
+    if (status != 0) {
         const char *reason = lua_tostring(tlua->luastate, -1);
         SCLuaSbState *context = SCLuaSbGetContext(tlua->luastate);
         uint32_t flag = 0;
@@ -269,7 +282,7 @@ int DetectLuaMatchBuffer(DetectEngineThreadCtx *det_ctx, const Signature *s,
     LuaPushStringBuffer(tlua->luastate, (const uint8_t *)buffer, (size_t)buffer_len);
     lua_settable(tlua->luastate, -3);
 
-    SCReturnInt(DetectLuaRunMatch(det_ctx, lua, tlua));
+    SCReturnInt(DetectLuaRunMatch(det_ctx, s, lua, tlua));
 }
 
 /**
@@ -315,7 +328,7 @@ static int DetectLuaMatch (DetectEngineThreadCtx *det_ctx,
     lua_getglobal(tlua->luastate, "match");
     lua_newtable(tlua->luastate); /* stack at -1 */
 
-    SCReturnInt(DetectLuaRunMatch(det_ctx, lua, tlua));
+    SCReturnInt(DetectLuaRunMatch(det_ctx, s, lua, tlua));
 }
 
 static int DetectLuaAppMatchCommon (DetectEngineThreadCtx *det_ctx,
@@ -337,7 +350,7 @@ static int DetectLuaAppMatchCommon (DetectEngineThreadCtx *det_ctx,
     lua_getglobal(tlua->luastate, "match");
     lua_newtable(tlua->luastate); /* stack at -1 */
 
-    SCReturnInt(DetectLuaRunMatch(det_ctx, lua, tlua));
+    SCReturnInt(DetectLuaRunMatch(det_ctx, s, lua, tlua));
 }
 
 /**
@@ -394,24 +407,13 @@ static void *DetectLuaThreadInit(void *data)
 
     LuaStateSetDetectLuaData(t->luastate, lua);
 
-    /* hackish, needed to allow unittests to pass buffers as scripts instead of files */
-#ifdef UNITTESTS
-    if (ut_script != NULL) {
-        status = luaL_loadbuffer(t->luastate, ut_script, strlen(ut_script), "unittest");
-        if (status) {
-            SCLogError("couldn't load file: %s", lua_tostring(t->luastate, -1));
-            goto error;
-        }
-    } else {
-#endif
-        status = luaL_loadfile(t->luastate, lua->filename);
-        if (status) {
-            SCLogError("couldn't load file: %s", lua_tostring(t->luastate, -1));
-            goto error;
-        }
-#ifdef UNITTESTS
+    /* load the script compiled at rule load, so each thread doesn't
+     * have to read and parse the file again */
+    status = luaL_loadbufferx(t->luastate, lua->bytecode, lua->bytecode_len, lua->filename, "b");
+    if (status) {
+        SCLogError("couldn't load file: %s", lua_tostring(t->luastate, -1));
+        goto error;
     }
-#endif
 
     /* prime the script (or something) */
     if (lua_pcall(t->luastate, 0, 0, 0) != 0) {
@@ -487,6 +489,21 @@ error:
     return NULL;
 }
 
+/** \internal
+ *  \brief lua_Writer appending the dumped bytecode to DetectLuaData::bytecode
+ */
+static int DetectLuaBytecodeWriter(lua_State *L, const void *p, size_t sz, void *ud)
+{
+    DetectLuaData *ld = (DetectLuaData *)ud;
+    char *ptr = SCRealloc(ld->bytecode, ld->bytecode_len + sz);
+    if (ptr == NULL)
+        return 1;
+    memcpy(ptr + ld->bytecode_len, p, sz);
+    ld->bytecode = ptr;
+    ld->bytecode_len += sz;
+    return 0;
+}
+
 static int DetectLuaSetupPrime(DetectEngineCtx *de_ctx, DetectLuaData *ld, const Signature *s)
 {
     int status;
@@ -521,6 +538,13 @@ static int DetectLuaSetupPrime(DetectEngineCtx *de_ctx, DetectLuaData *ld, const
     }
 #endif
 
+    /* keep the compiled script for the threads. Debug info is kept
+     * so errors still report the script name and line. */
+    if (lua_dump(luastate, DetectLuaBytecodeWriter, ld, 0) != 0 || ld->bytecode_len == 0) {
+        SCLogError("couldn't compile file: %s", ld->filename);
+        goto error;
+    }
+
     /* prime the script (or something) */
     if (lua_pcall(luastate, 0, 0, 0) != 0) {
         SCLogError("couldn't prime file: %s", lua_tostring(luastate, -1));
@@ -757,6 +781,8 @@ static void DetectLuaFree(DetectEngineCtx *de_ctx, void *ptr)
             SCFree(lua->buffername);
         if (lua->filename)
             SCFree(lua->filename);
+        if (lua->bytecode)
+            SCFree(lua->bytecode);
 
         for (uint16_t i = 0; i < lua->flowints; i++) {
             VarNameStoreUnregister(lua->flowint[i], VAR_TYPE_FLOW_INT);
@@ -56,6 +56,9 @@ typedef struct DetectLuaData {
     uint64_t alloc_limit;
     uint64_t instruction_limit;
     int allow_restricted_functions;
+    /* script compiled at rule load, loaded by each thread */
+    char *bytecode;
+    size_t bytecode_len;
 } DetectLuaData;
 
 /* prototypes */
@@ -0,0 +1,1064 @@
+/* Copyright (C) 2026 Open Information Security Foundation
+ *
+ * You can copy, redistribute or modify this Program under the terms of
+ * the GNU General Public License version 2 as published by the Free
+ * Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * version 2 along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+/**
+ * \file
+ *
+ * Hyperscan evaluation of the pcre keywords of a rule group.
+ *
+ * The regexes of the pcre keywords that inspect the same buffer in a rule
+ * group are compiled into a single hyperscan database. The first time one
+ * of them is evaluated, the whole buffer is scanned once and the result for
+ * every regex of the database is kept in the detect thread. The pcre
+ * keywords then use that result:
+ *
+ * - regex not found: pcre2 doesn't need to run, it can't match either.
+ * - regex found: pcre2 runs to get the match offsets and captures, unless
+ *   the result is exact and nothing depends on the offsets.
+ *
+ * Regexes hyperscan can't compile exactly, e.g. ones with back references,
+ * are compiled in prefilter mode. Hyperscan then reports a superset of the
+ * matches, so only a miss is used. Regexes it can't handle at all are left
+ * to pcre2.
+ *
+ * The results are keyed by the buffer pointer and length. They are cleared
+ * for each packet and when the inspection buffers are cleaned up, and the
+ * result for a buffer is dropped when an inspection buffer is set up with
+ * the same data pointer.
+ */
+
+#include "suricata-common.h"
+#include "detect.h"
+#include "detect-pcre.h"
+#include "detect-pcre-hs.h"
+#include "detect-engine.h"
+#include "detect-engine-build.h"
+#include "conf.h"
+#include "util-hashlist.h"
+#include "util-debug.h"
+#include "util-unittest.h"
+#include "util-unittest-helper.h"
+
+#ifdef BUILD_HYPERSCAN
+
+#include <hs.h>
+
+/** use hyperscan for the pcre keywords */
+static bool pcre_hs_enabled = true;
+
+/** take an exact hyperscan hit as the pcre result, without running pcre2 */
+bool g_pcre_hs_exact_match = false;
+
+/** database for the regexes on a buffer */
+typedef struct DetectPcreHsGroup_ {
+    int list_id;
+    /** hs_id of the candidate regexes, sorted. Lookup key. */
+    uint32_t *key_ids;
+    uint32_t key_cnt;
+    /** hs_id of the regexes in the database, indexed by the hyperscan
+     *  expression id */
+    uint32_t *ids;
+    uint32_t cnt;
+    /** NULL if the candidates couldn't be compiled */
+    hs_database_t *db;
+} DetectPcreHsGroup;
+
+typedef struct DetectPcreHsMapEntry_ {
+    uint32_t hs_id;
+    uint32_t idx; /**< hyperscan expression id in the group */
+    const DetectPcreHsGroup *group;
+} DetectPcreHsMapEntry;
+
+/** per rule group lookup of the hyperscan database of a regex */
+typedef struct DetectPcreHsRuleGroup_ {
+    uint32_t cnt;
+    DetectPcreHsMapEntry *map; /**< sorted by hs_id */
+} DetectPcreHsRuleGroup;
+
+typedef struct DetectPcreHsCtx_ {
+    HashListTable *groups;
+    /** scratch prototype, large enough for all databases */
+    hs_scratch_t *scratch;
+    /** largest number of regexes in a database */
+    uint32_t max_cnt;
+    uint32_t next_id;
+
+    /* stats */
+    uint32_t db_cnt;
+    uint32_t prefilter_cnt;
+    uint32_t unsupported_cnt;
+} DetectPcreHsCtx;
+
+typedef struct DetectPcreHsCacheEntry_ {
+    const DetectPcreHsGroup *group;
+    const uint8_t *buf;
+    uint32_t buf_len;
+    uint8_t *matches; /**< bit per hyperscan expression id */
+} DetectPcreHsCacheEntry;
+
+typedef struct DetectPcreHsThreadCtx_ {
+    hs_scratch_t *scratch;
+    /** lookup of the rule group of the packet being inspected */
+    const DetectPcreHsRuleGroup *rg;
+    uint32_t cache_cnt;
+    uint32_t cache_next;
+    DetectPcreHsCacheEntry cache[DETECT_PCRE_HS_CACHE_SIZE];
+} DetectPcreHsThreadCtx;
+
+void DetectPcreHsRegister(void)
+{
+    int enabled = 1;
+    if (SCConfGetBool("pcre.hyperscan", &enabled) == 1 && !enabled) {
+        SCLogConfig("pcre: hyperscan disabled");
+        pcre_hs_enabled = false;
+        return;
+    }
+#ifdef HAVE_HS_VALID_PLATFORM
+    if (hs_valid_platform() != HS_SUCCESS) {
+        SCLogInfo("SSSE3 support not detected, disabling Hyperscan for pcre");
+        pcre_hs_enabled = false;
+        return;
+    }
+#endif
+    int exact = 0;
+    if (SCConfGetBool("pcre.hyperscan-exact-match", &exact) == 1 && exact) {
+        SCLogConfig("pcre: hyperscan exact matches bypass the pcre2 match limits");
+        g_pcre_hs_exact_match = true;
+    }
+}
+
+/**
+ *  \brief check if the regex can be passed to hyperscan
+ *
+ *  Hyperscan has no equivalent of the anchored, dollar end only and extended
+ *  options. Whether the regex itself is supported is found out when the
+ *  databases are built.
+ */
+void DetectPcreHsSetup(DetectPcreData *pd, const char *re, const int opts)
+{
+    if (!pcre_hs_enabled)
+        return;
+    if (opts & (PCRE2_ANCHORED | PCRE2_DOLLAR_ENDONLY | PCRE2_EXTENDED))
+        return;
+    /* start of pattern options like (*UTF) */
+    if (strncmp(re, "(*", 2) == 0)
+        return;
+
+    pd->hs_re = SCStrdup(re);
+    if (pd->hs_re == NULL)
+        return;
+    pd->hs_flags = HS_FLAG_SINGLEMATCH;
+    if (opts & PCRE2_CASELESS)
+        pd->hs_flags |= HS_FLAG_CASELESS;
+    if (opts & PCRE2_DOTALL)
+        pd->hs_flags |= HS_FLAG_DOTALL;
+    if (opts & PCRE2_MULTILINE)
+        pd->hs_flags |= HS_FLAG_MULTILINE;
+    pd->hs_mode = DETECT_PCRE_HS_EXACT;
+}
+
+void DetectPcreHsFreeData(DetectPcreData *pd)
+{
+    if (pd->hs_re != NULL) {
+        SCFree(pd->hs_re);
+        pd->hs_re = NULL;
+    }
+}
+
+static uint32_t DetectPcreHsGroupHash(HashListTable *ht, void *data, uint16_t datalen)
+{
+    const DetectPcreHsGroup *g = data;
+    uint32_t hash = (uint32_t)g->list_id;
+    for (uint32_t i = 0; i < g->key_cnt; i++) {
+        hash = hash * 31 + g->key_ids[i];
+    }
+    return hash % ht->array_size;
+}
+
+static char DetectPcreHsGroupCompare(void *data1, uint16_t len1, void *data2, uint16_t len2)
+{
+    const DetectPcreHsGroup *g1 = data1;
+    const DetectPcreHsGroup *g2 = data2;
+    return g1->list_id == g2->list_id && g1->key_cnt == g2->key_cnt &&
+           memcmp(g1->key_ids, g2->key_ids, g1->key_cnt * sizeof(uint32_t)) == 0;
+}
+
+static void DetectPcreHsGroupFree(void *data)
+{
+    DetectPcreHsGroup *g = data;
+    if (g == NULL)
+        return;
+    if (g->db != NULL)
+        hs_free_database(g->db);
+    SCFree(g->key_ids);
+    SCFree(g->ids);
+    SCFree(g);
+}
+
+static DetectPcreHsCtx *DetectPcreHsGetCtx(DetectEngineCtx *de_ctx)
+{
+    if (de_ctx->pcre_hs_ctx != NULL)
+        return de_ctx->pcre_hs_ctx;
+
+    DetectPcreHsCtx *ctx = SCCalloc(1, sizeof(*ctx));
+    if (ctx == NULL)
+        return NULL;
+    ctx->groups = HashListTableInit(
+            256, DetectPcreHsGroupHash, DetectPcreHsGroupCompare, DetectPcreHsGroupFree);
+    if (ctx->groups == NULL) {
+        SCFree(ctx);
+        return NULL;
+    }
+    de_ctx->pcre_hs_ctx = ctx;
+    return ctx;
+}
+
+/** \internal
+ *  \brief lower the hyperscan mode of a regex hyperscan failed to compile */
+static void DetectPcreHsDemote(DetectPcreHsCtx *ctx, DetectPcreData *pd, const char *msg)
+{
+    if (pd->hs_mode == DETECT_PCRE_HS_EXACT) {
+        SCLogDebug("regex \"%s\" not supported by hyperscan (%s), using prefilter mode", pd->hs_re,
+                msg);
+        pd->hs_mode = DETECT_PCRE_HS_PREFILTER;
+        ctx->prefilter_cnt++;
+    } else {
+        SCLogDebug("regex \"%s\" not supported by hyperscan (%s)", pd->hs_re, msg);
+        pd->hs_mode = DETECT_PCRE_HS_NONE;
+        ctx->prefilter_cnt--;
+        ctx->unsupported_cnt++;
+    }
+}
+
+/** \internal
+ *  \brief compile the database for a group
+ *
+ *  Regexes hyperscan rejects are moved to prefilter mode first and dropped
+ *  if that fails as well. As the mode is kept in the keyword, this only
+ *  happens the first time a regex is compiled.
+ */
+static void DetectPcreHsGroupCompile(
+        DetectPcreHsCtx *ctx, DetectPcreHsGroup *g, DetectPcreData **pds, const uint32_t n)
+{
+    const char **exprs = SCCalloc(n, sizeof(char *));
+    unsigned int *flags = SCCalloc(n, sizeof(unsigned int));
+    unsigned int *expr_ids = SCCalloc(n, sizeof(unsigned int));
+    uint32_t *pd_idx = SCCalloc(n, sizeof(uint32_t));
+    if (exprs == NULL || flags == NULL || expr_ids == NULL || pd_idx == NULL)
+        goto end;
+
+    while (1) {
+        uint32_t cnt = 0;
+        for (uint32_t i = 0; i < n; i++) {
+            if (pds[i]->hs_mode == DETECT_PCRE_HS_NONE)
+                continue;
+            exprs[cnt] = pds[i]->hs_re;
+            flags[cnt] = pds[i]->hs_flags;
+            if (pds[i]->hs_mode == DETECT_PCRE_HS_PREFILTER)
+                flags[cnt] |= HS_FLAG_PREFILTER;
+            expr_ids[cnt] = cnt;
+            pd_idx[cnt] = i;
+            cnt++;
+        }
+        if (cnt < DETECT_PCRE_HS_GROUP_MIN)
+            goto end;
+
+        hs_database_t *db = NULL;
+        hs_compile_error_t *compile_err = NULL;
+        hs_error_t err = hs_compile_multi(
+                exprs, flags, expr_ids, cnt, HS_MODE_BLOCK, NULL, &db, &compile_err);
+        if (err == HS_SUCCESS) {
+            g->ids = SCCalloc(cnt, sizeof(uint32_t));
+            if (g->ids == NULL || hs_alloc_scratch(db, &ctx->scratch) != HS_SUCCESS) {
+                SCLogError("failed to set up hyperscan database for pcre");
+                hs_free_database(db);
+                SCFree(g->ids);
+                g->ids = NULL;
+                goto end;
+            }
+            for (uint32_t i = 0; i < cnt; i++) {
+                g->ids[i] = pds[pd_idx[i]]->hs_id;
+            }
+            g->cnt = cnt;
+            g->db = db;
+            ctx->max_cnt = MAX(ctx->max_cnt, cnt);
+            ctx->db_cnt++;
+            goto end;
+        }
+
+        if (compile_err == NULL || compile_err->expression < 0) {
+            SCLogWarning("hyperscan failed to compile the pcre database for %u regexes: %s", cnt,
+                    compile_err ? compile_err->message : "unknown error");
+            if (compile_err)
+                hs_free_compile_error(compile_err);
+            goto end;
+        }
+        DetectPcreHsDemote(ctx, pds[pd_idx[compile_err->expression]], compile_err->message);
+        hs_free_compile_error(compile_err);
+    }
+
+end:
+    SCFree(exprs);
+    SCFree(flags);
+    SCFree(expr_ids);
+    SCFree(pd_idx);
+}
+
+/** \internal
+ *  \brief get the group for the regexes, compiling it if needed
+ *
+ *  \param pds regexes on the buffer, sorted by hs_id
+ *
+ *  \retval g group, NULL on error. The group has no database if the regexes
+ *            couldn't be compiled.
+ */
+static const DetectPcreHsGroup *DetectPcreHsGroupGet(
+        DetectPcreHsCtx *ctx, const int list_id, DetectPcreData **pds, const uint32_t n)
+{
+    uint32_t key_ids[n];
+    for (uint32_t i = 0; i < n; i++) {
+        key_ids[i] = pds[i]->hs_id;
+    }
+    DetectPcreHsGroup lookup = { .list_id = list_id, .key_ids = key_ids, .key_cnt = n };
+    DetectPcreHsGroup *g = HashListTableLookup(ctx->groups, &lookup, 0);
+    if (g != NULL)
+        return g;
+
+    g = SCCalloc(1, sizeof(*g));
+    if (g == NULL)
+        return NULL;
+    g->list_id = list_id;
+    g->key_ids = SCMalloc(n * sizeof(uint32_t));
+    if (g->key_ids == NULL) {
+        SCFree(g);
+        return NULL;
+    }
+    memcpy(g->key_ids, key_ids, n * sizeof(uint32_t));
+    g->key_cnt = n;
+
+    DetectPcreHsGroupCompile(ctx, g, pds, n);
+
+    if (HashListTableAdd(ctx->groups, g, 0) != 0) {
+        DetectPcreHsGroupFree(g);
+        return NULL;
+    }
+    return g;
+}
+
+typedef struct DetectPcreHsCandidate_ {
+    int list_id;
+    DetectPcreData *pd;
+} DetectPcreHsCandidate;
+
+static int DetectPcreHsCandidateCompare(const void *a, const void *b)
+{
+    const DetectPcreHsCandidate *c1 = a;
+    const DetectPcreHsCandidate *c2 = b;
+    if (c1->list_id != c2->list_id)
+        return c1->list_id < c2->list_id ? -1 : 1;
+    if (c1->pd->hs_id != c2->pd->hs_id)
+        return c1->pd->hs_id < c2->pd->hs_id ? -1 : 1;
+    return 0;
+}
+
+static int DetectPcreHsMapCompare(const void *a, const void *b)
+{
+    const DetectPcreHsMapEntry *e1 = a;
+    const DetectPcreHsMapEntry *e2 = b;
+    if (e1->hs_id != e2->hs_id)
+        return e1->hs_id < e2->hs_id ? -1 : 1;
+    return 0;
+}
+
+/** \internal
+ *  \brief add the pcre keywords of a list to the candidates
+ */
+static int DetectPcreHsCollect(DetectPcreHsCtx *ctx, DetectPcreHsCandidate **cands,
+        uint32_t *cands_cnt, uint32_t *cands_size, const int list_id, const SigMatch *sm)
+{
+    for (; sm != NULL; sm = sm->next) {
+        if (sm->type != DETECT_PCRE)
+            continue;
+        DetectPcreData *pd = (DetectPcreData *)sm->ctx;
+        if (pd->hs_re == NULL || pd->hs_mode == DETECT_PCRE_HS_NONE)
+            continue;
+
+        if (*cands_cnt == *cands_size) {
+            uint32_t new_size = *cands_size ? *cands_size * 2 : 32;
+            void *ptr = SCRealloc(*cands, new_size * sizeof(DetectPcreHsCandidate));
+            if (ptr == NULL)
+                return -1;
+            *cands = ptr;
+            *cands_size = new_size;
+        }
+        if (pd->hs_id == 0) {
+            pd->hs_id = ++ctx->next_id;
+        }
+        (*cands)[*cands_cnt].list_id = list_id;
+        (*cands)[*cands_cnt].pd = pd;
+        (*cands_cnt)++;
+    }
+    return 0;
+}
+
+/**
+ *  \brief set up the hyperscan databases for the pcre keywords of a rule group
+ *
+ *  Uses the init data of the rule group and its signatures.
+ */
+void DetectPcreHsSetupRuleGroup(DetectEngineCtx *de_ctx, SigGroupHead *sgh)
+{
+    if (!pcre_hs_enabled || sgh->init == NULL)
+        return;
+
+    DetectPcreHsCtx *ctx = DetectPcreHsGetCtx(de_ctx);
+    if (ctx == NULL)
+        return;
+
+    DetectPcreHsCandidate *cands = NULL;
+    uint32_t cands_cnt = 0, cands_size = 0;
+    DetectPcreData **pds = NULL;
+    DetectPcreHsMapEntry *map = NULL;
+    uint32_t map_cnt = 0;
+
+    for (uint32_t i = 0; i < sgh->init->sig_cnt; i++) {
+        const Signature *s = sgh->init->match_array[i];
+        if (s == NULL || s->init_data == NULL)
+            continue;
+        if (DetectPcreHsCollect(ctx, &cands, &cands_cnt, &cands_size, DETECT_SM_LIST_PMATCH,
+                    s->init_data->smlists[DETECT_SM_LIST_PMATCH]) < 0)
+            goto end;
+        /* builtin lists like base64_data are filled outside of the
+         * inspection buffers, so only the dynamic buffers are used */
+        for (uint32_t x = 0; x < s->init_data->buffer_index; x++) {
+            const int list_id = (int)s->init_data->buffers[x].id;
+            if (list_id < DETECT_SM_LIST_DYNAMIC_START)
+                continue;
+            if (DetectPcreHsCollect(ctx, &cands, &cands_cnt, &cands_size, list_id,
+                        s->init_data->buffers[x].head) < 0)
+                goto end;
+        }
+    }
+    if (cands_cnt < DETECT_PCRE_HS_GROUP_MIN)
+        goto end;
+
+    qsort(cands, cands_cnt, sizeof(DetectPcreHsCandidate), DetectPcreHsCandidateCompare);
+
+    pds = SCCalloc(cands_cnt, sizeof(DetectPcreData *));
+    map = SCCalloc(cands_cnt, sizeof(DetectPcreHsMapEntry));
+    if (pds == NULL || map == NULL)
+        goto end;
+
+    for (uint32_t i = 0; i < cands_cnt;) {
+        const int list_id = cands[i].list_id;
+        uint32_t n = 0;
+        for (; i < cands_cnt && cands[i].list_id == list_id; i++) {
+            pds[n++] = cands[i].pd;
+        }
+        if (n < DETECT_PCRE_HS_GROUP_MIN)
+            continue;
+
+        const DetectPcreHsGroup *g = DetectPcreHsGroupGet(ctx, list_id, pds, n);
+        if (g == NULL || g->db == NULL)
+            continue;
+        for (uint32_t x = 0; x < g->cnt; x++) {
+            map[map_cnt].hs_id = g->ids[x];
+            map[map_cnt].idx = x;
+            map[map_cnt].group = g;
+            map_cnt++;
+        }
+    }
+    if (map_cnt == 0)
+        goto end;
+
+    qsort(map, map_cnt, sizeof(DetectPcreHsMapEntry), DetectPcreHsMapCompare);
+
+    DetectPcreHsRuleGroup *rg = SCCalloc(1, sizeof(*rg));
+    if (rg == NULL)
+        goto end;
+    rg->map = map;
+    rg->cnt = map_cnt;
+    sgh->pcre_hs = rg;
+    map = NULL;
+
+end:
+    SCFree(cands);
+    SCFree(pds);
+    SCFree(map);
+}
+
+static int DetectPcreHsIdCompare(const void *a, const void *b)
+{
+    const uint32_t id1 = *(const uint32_t *)a;
+    const uint32_t id2 = *(const uint32_t *)b;
+    if (id1 != id2)
+        return id1 < id2 ? -1 : 1;
+    return 0;
+}
+
+/** \internal
+ *  \brief count the regexes that are in a database
+ *
+ *  A regex can be in the databases of several groups, so the ids of all
+ *  databases are collected and the unique ones counted.
+ */
+static uint32_t DetectPcreHsCountRegexes(const DetectPcreHsCtx *ctx)
+{
+    uint32_t total = 0;
+    for (HashListTableBucket *b = HashListTableGetListHead(ctx->groups); b != NULL;
+            b = HashListTableGetListNext(b)) {
+        const DetectPcreHsGroup *g = HashListTableGetListData(b);
+        if (g->db != NULL)
+            total += g->cnt;
+    }
+    if (total == 0)
+        return 0;
+
+    uint32_t *ids = SCCalloc(total, sizeof(uint32_t));
+    if (ids == NULL)
+        return 0;
+    uint32_t n = 0;
+    for (HashListTableBucket *b = HashListTableGetListHead(ctx->groups); b != NULL;
+            b = HashListTableGetListNext(b)) {
+        const DetectPcreHsGroup *g = HashListTableGetListData(b);
+        if (g->db == NULL)
+            continue;
+        memcpy(ids + n, g->ids, g->cnt * sizeof(uint32_t));
+        n += g->cnt;
+    }
+    qsort(ids, n, sizeof(uint32_t), DetectPcreHsIdCompare);
+    uint32_t cnt = 1;
+    for (uint32_t i = 1; i < n; i++) {
+        if (ids[i] != ids[i - 1])
+            cnt++;
+    }
+    SCFree(ids);
+    return cnt;
+}
+
+void DetectPcreHsReportStats(const DetectEngineCtx *de_ctx)
+{
+    const DetectPcreHsCtx *ctx = de_ctx->pcre_hs_ctx;
+    if (ctx == NULL || ctx->db_cnt == 0)
+        return;
+    SCLogPerf("pcre: %u hyperscan databases for %u regexes, %u in prefilter mode, "
+              "%u not supported",
+            ctx->db_cnt, DetectPcreHsCountRegexes(ctx), ctx->prefilter_cnt,
+            ctx->unsupported_cnt);
+}
+
+void DetectPcreHsRuleGroupFree(SigGroupHead *sgh)
+{
+    DetectPcreHsRuleGroup *rg = sgh->pcre_hs;
+    if (rg == NULL)
+        return;
+    SCFree(rg->map);
+    SCFree(rg);
+    sgh->pcre_hs = NULL;
+}
+
+void DetectPcreHsFree(DetectEngineCtx *de_ctx)
+{
+    DetectPcreHsCtx *ctx = de_ctx->pcre_hs_ctx;
+    if (ctx == NULL)
+        return;
+    HashListTableFree(ctx->groups);
+    if (ctx->scratch != NULL)
+        hs_free_scratch(ctx->scratch);
+    SCFree(ctx);
+    de_ctx->pcre_hs_ctx = NULL;
+}
+
+int DetectPcreHsThreadInit(const DetectEngineCtx *de_ctx, DetectEngineThreadCtx *det_ctx)
+{
+    det_ctx->pcre_hs = NULL;
+
+    const DetectPcreHsCtx *ctx = de_ctx->pcre_hs_ctx;
+    if (ctx == NULL || ctx->scratch == NULL)
+        return 0;
+
+    DetectPcreHsThreadCtx *td = SCCalloc(1, sizeof(*td));
+    if (td == NULL)
+        return -1;
+    if (hs_clone_scratch(ctx->scratch, &td->scratch) != HS_SUCCESS) {
+        SCLogError("unable to clone hyperscan scratch for pcre");
+        SCFree(td);
+        return -1;
+    }
+    const uint32_t matches_size = (ctx->max_cnt + 7) / 8;
+    for (int i = 0; i < DETECT_PCRE_HS_CACHE_SIZE; i++) {
+        td->cache[i].matches = SCCalloc(1, matches_size);
+        if (td->cache[i].matches == NULL) {
+            det_ctx->pcre_hs = td;
+            DetectPcreHsThreadFree(det_ctx);
+            return -1;
+        }
+    }
+    det_ctx->pcre_hs = td;
+    return 0;
+}
+
+void DetectPcreHsThreadFree(DetectEngineThreadCtx *det_ctx)
+{
+    DetectPcreHsThreadCtx *td = det_ctx->pcre_hs;
+    if (td == NULL)
+        return;
+    if (td->scratch != NULL)
+        hs_free_scratch(td->scratch);
+    for (int i = 0; i < DETECT_PCRE_HS_CACHE_SIZE; i++) {
+        SCFree(td->cache[i].matches);
+    }
+    SCFree(td);
+    det_ctx->pcre_hs = NULL;
+}
+
+/**
+ *  \brief set the rule group of the packet that is about to be inspected
+ *
+ *  Also drops the scan results of the previous packet.
+ */
+void DetectPcreHsRuleGroupSet(DetectEngineThreadCtx *det_ctx, const SigGroupHead *sgh)
+{
+    DetectPcreHsThreadCtx *td = det_ctx->pcre_hs;
+    if (td == NULL)
+        return;
+    td->rg = sgh ? sgh->pcre_hs : NULL;
+    td->cache_cnt = 0;
+    td->cache_next = 0;
+}
+
+void DetectPcreHsCacheClear(DetectEngineThreadCtx *det_ctx)
+{
+    DetectPcreHsThreadCtx *td = det_ctx->pcre_hs;
+    if (td == NULL)
+        return;
+    td->cache_cnt = 0;
+    td->cache_next = 0;
+}
+
+/**
+ *  \brief drop the scan results for a buffer whose data is being replaced
+ */
+void DetectPcreHsCacheInvalidate(DetectEngineThreadCtx *det_ctx, const uint8_t *buf)
+{
+    DetectPcreHsThreadCtx *td = det_ctx->pcre_hs;
+    if (td == NULL)
+        return;
+    for (uint32_t i = 0; i < td->cache_cnt;) {
+        if (td->cache[i].buf == buf) {
+            /* keep the used entries at the start of the array */
+            td->cache_cnt--;
+            DetectPcreHsCacheEntry tmp = td->cache[i];
+            td->cache[i] = td->cache[td->cache_cnt];
+            td->cache[td->cache_cnt] = tmp;
+        } else {
+            i++;
+        }
+    }
+}
+
+static int DetectPcreHsOnMatch(unsigned int id, unsigned long long from, unsigned long long to,
+        unsigned int flags, void *context)
+{
+    uint8_t *matches = context;
+    matches[id / 8] |= (uint8_t)(1 << (id % 8));
+    return 0;
+}
+
+static const DetectPcreHsMapEntry *DetectPcreHsLookup(
+        const DetectPcreHsRuleGroup *rg, const uint32_t hs_id)
+{
+    uint32_t lo = 0, hi = rg->cnt;
+    while (lo < hi) {
+        const uint32_t mid = lo + (hi - lo) / 2;
+        const DetectPcreHsMapEntry *e = &rg->map[mid];
+        if (e->hs_id == hs_id)
+            return e;
+        if (e->hs_id < hs_id)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return NULL;
+}
+
+/**
+ *  \brief get the hyperscan result for a regex on a buffer
+ *
+ *  The buffer is scanned for all the regexes of the database the regex is
+ *  in, unless that was done already.
+ *
+ *  \retval 1 regex matches the buffer. Exact only if the regex' mode is
+ *            DETECT_PCRE_HS_EXACT.
+ *  \retval 0 regex doesn't match anywhere in the buffer
+ *  \retval -1 no result, pcre2 needs to run
+ */
+int DetectPcreHsMatch(DetectEngineThreadCtx *det_ctx, const DetectPcreData *pd, const uint8_t *buf,
+        const uint32_t buf_len)
+{
+    DetectPcreHsThreadCtx *td = det_ctx->pcre_hs;
+    if (td->rg == NULL || buf == NULL || buf_len == 0)
+        return -1;
+
+    const DetectPcreHsMapEntry *e = DetectPcreHsLookup(td->rg, pd->hs_id);
+    if (e == NULL)
+        return -1;
+
+    DetectPcreHsCacheEntry *c = NULL;
+    for (uint32_t i = 0; i < td->cache_cnt; i++) {
+        if (td->cache[i].group == e->group && td->cache[i].buf == buf &&
+                td->cache[i].buf_len == buf_len) {
+            c = &td->cache[i];
+            break;
+        }
+    }
+    if (c == NULL) {
+        uint32_t slot;
+        if (td->cache_cnt < DETECT_PCRE_HS_CACHE_SIZE) {
+            slot = td->cache_cnt;
+        } else {
+            slot = td->cache_next;
+            td->cache_next = (td->cache_next + 1) % DETECT_PCRE_HS_CACHE_SIZE;
+        }
+        c = &td->cache[slot];
+        memset(c->matches, 0, (e->group->cnt + 7) / 8);
+        hs_error_t err = hs_scan(e->group->db, (const char *)buf, buf_len, 0, td->scratch,
+                DetectPcreHsOnMatch, c->matches);
+        if (err != HS_SUCCESS) {
+            SCLogDebug("hyperscan returned error %d", err);
+            /* the slot may have been in use */
+            c->group = NULL;
+            c->buf = NULL;
+            return -1;
+        }
+        c->group = e->group;
+        c->buf = buf;
+        c->buf_len = buf_len;
+        if (slot == td->cache_cnt)
+            td->cache_cnt++;
+    }
+    return (c->matches[e->idx / 8] & (1 << (e->idx % 8))) != 0;
+}
+
+#ifdef UNITTESTS
+#include "detect-parse.h"
+#include "detect-engine-alert.h"
+
+static const DetectPcreData *DetectPcreHsTestGetData(const Signature *s)
+{
+    return (const DetectPcreData *)s->init_data->smlists[DETECT_SM_LIST_PMATCH]->ctx;
+}
+
+static int DetectPcreHsTestPcre2(const DetectPcreData *pd, const uint8_t *buf, uint32_t buf_len)
+{
+    pcre2_match_data *match = pcre2_match_data_create_from_pattern(pd->parse_regex.regex, NULL);
+    if (match == NULL)
+        return -1;
+    int ret = pcre2_match(pd->parse_regex.regex, buf, buf_len, 0, 0, match, NULL);
+    pcre2_match_data_free(match);
+    return ret >= 0;
+}
+
+/** \test a group hit gives the same result as pcre2 on the same buffer */
+static int DetectPcreHsTest01(void)
+{
+    if (!pcre_hs_enabled)
+        PASS;
+
+    DetectEngineCtx *de_ctx = DetectEngineCtxInit();
+    FAIL_IF_NULL(de_ctx);
+    Signature *s1 = DetectEngineAppendSig(
+            de_ctx, "alert tcp any any -> any any (pcre:\"/abc[0-9]+def/\"; sid:1;)");
+    FAIL_IF_NULL(s1);
+    Signature *s2 = DetectEngineAppendSig(
+            de_ctx, "alert tcp any any -> any any (pcre:\"/xyz[a-z]+uvw/\"; sid:2;)");
+    FAIL_IF_NULL(s2);
+    const DetectPcreData *pd1 = DetectPcreHsTestGetData(s1);
+    const DetectPcreData *pd2 = DetectPcreHsTestGetData(s2);
+    SigGroupBuild(de_ctx);
+
+    /* both are in the database of the rule group */
+    FAIL_IF(pd1->hs_id == 0);
+    FAIL_IF(pd2->hs_id == 0);
+    FAIL_IF_NOT(pd1->hs_mode == DETECT_PCRE_HS_EXACT);
+    FAIL_IF_NOT(pd2->hs_mode == DETECT_PCRE_HS_EXACT);
+
+    DetectEngineThreadCtx *det_ctx = NULL;
+    ThreadVars th_v;
+    memset(&th_v, 0, sizeof(th_v));
+    DetectEngineThreadCtxInit(&th_v, (void *)de_ctx, (void *)&det_ctx);
+    FAIL_IF_NULL(det_ctx);
+    FAIL_IF_NULL(det_ctx->pcre_hs);
+
+    uint8_t buf[] = "foo abc123def bar";
+    Packet *p = UTHBuildPacket(buf, sizeof(buf) - 1, IPPROTO_TCP);
+    FAIL_IF_NULL(p);
+    SigMatchSignatures(&th_v, de_ctx, det_ctx, p);
+    FAIL_IF_NOT(PacketAlertCheck(p, 1));
+    FAIL_IF(PacketAlertCheck(p, 2));
+
+    /* the cached scan of the packet agrees with pcre2 */
+    FAIL_IF_NOT(DetectPcreHsMatch(det_ctx, pd1, p->payload, p->payload_len) ==
+                DetectPcreHsTestPcre2(pd1, p->payload, p->payload_len));
+    FAIL_IF_NOT(DetectPcreHsMatch(det_ctx, pd2, p->payload, p->payload_len) ==
+                DetectPcreHsTestPcre2(pd2, p->payload, p->payload_len));
+    UTHFreePackets(&p, 1);
+
+    /* same result if the exact hits skip pcre2 */
+    g_pcre_hs_exact_match = true;
+    p = UTHBuildPacket(buf, sizeof(buf) - 1, IPPROTO_TCP);
+    FAIL_IF_NULL(p);
+    SigMatchSignatures(&th_v, de_ctx, det_ctx, p);
+    g_pcre_hs_exact_match = false;
+    FAIL_IF_NOT(PacketAlertCheck(p, 1));
+    FAIL_IF(PacketAlertCheck(p, 2));
+    UTHFreePackets(&p, 1);
+
+    DetectEngineThreadCtxDeinit(&th_v, (void *)det_ctx);
+    DetectEngineCtxFree(de_ctx);
+    PASS;
+}
+
+/** \test a relative pcre is not decided by the scan of the whole buffer */
+static int DetectPcreHsTest02(void)
+{
+    if (!pcre_hs_enabled)
+        PASS;
+
+    DetectEngineCtx *de_ctx = DetectEngineCtxInit();
+    FAIL_IF_NULL(de_ctx);
+    Signature *s1 = DetectEngineAppendSig(de_ctx,
+            "alert tcp any any -> any any (content:\"abc\"; pcre:\"/^[0-9]+def/R\"; sid:1;)");
+    FAIL_IF_NULL(s1);
+    Signature *s2 = DetectEngineAppendSig(de_ctx,
+            "alert tcp any any -> any any (content:\"abc\"; pcre:\"/xyz/R\"; sid:2;)");
+    FAIL_IF_NULL(s2);
+    Signature *s3 = DetectEngineAppendSig(
+            de_ctx, "alert tcp any any -> any any (pcre:\"/xyz/\"; sid:3;)");
+    FAIL_IF_NULL(s3);
+    const DetectPcreData *pd1 = DetectPcreHsTestGetData(s1);
+    SigGroupBuild(de_ctx);
+    FAIL_IF(pd1->hs_id == 0);
+
+    DetectEngineThreadCtx *det_ctx = NULL;
+    ThreadVars th_v;
+    memset(&th_v, 0, sizeof(th_v));
+    DetectEngineThreadCtxInit(&th_v, (void *)de_ctx, (void *)&det_ctx);
+    FAIL_IF_NULL(det_ctx);
+    FAIL_IF_NULL(det_ctx->pcre_hs);
+
+    /* both relative regexes match the buffer, but not after "abc" */
+    uint8_t buf[] = "123def xyz abc";
+    Packet *p = UTHBuildPacket(buf, sizeof(buf) - 1, IPPROTO_TCP);
+    FAIL_IF_NULL(p);
+    SigMatchSignatures(&th_v, de_ctx, det_ctx, p);
+    FAIL_IF(PacketAlertCheck(p, 1));
+    FAIL_IF(PacketAlertCheck(p, 2));
+    FAIL_IF_NOT(PacketAlertCheck(p, 3));
+    FAIL_IF_NOT(DetectPcreHsMatch(det_ctx, pd1, p->payload, p->payload_len) == 1);
+    UTHFreePackets(&p, 1);
+
+    DetectEngineThreadCtxDeinit(&th_v, (void *)det_ctx);
+    DetectEngineCtxFree(de_ctx);
+    PASS;
+}
+
+/** \test a regex hyperscan can't compile exactly is demoted to prefilter mode */
+static int DetectPcreHsTest03(void)
+{
+    if (!pcre_hs_enabled)
+        PASS;
+
+    DetectEngineCtx *de_ctx = DetectEngineCtxInit();
+    FAIL_IF_NULL(de_ctx);
+    /* back references are only supported in prefilter mode */
+    Signature *s1 = DetectEngineAppendSig(
+            de_ctx, "alert tcp any any -> any any (pcre:\"/(a|b)\\1c/\"; sid:1;)");
+    FAIL_IF_NULL(s1);
+    Signature *s2 = DetectEngineAppendSig(
+            de_ctx, "alert tcp any any -> any any (pcre:\"/xyz[a-z]+uvw/\"; sid:2;)");
+    FAIL_IF_NULL(s2);
+    const DetectPcreData *pd1 = DetectPcreHsTestGetData(s1);
+    const DetectPcreData *pd2 = DetectPcreHsTestGetData(s2);
+    SigGroupBuild(de_ctx);
+
+    FAIL_IF_NOT(pd1->hs_mode == DETECT_PCRE_HS_PREFILTER);
+    FAIL_IF_NOT(pd2->hs_mode == DETECT_PCRE_HS_EXACT);
+    const DetectPcreHsCtx *ctx = de_ctx->pcre_hs_ctx;
+    FAIL_IF_NULL(ctx);
+    FAIL_IF_NOT(ctx->prefilter_cnt == 1);
+    FAIL_IF_NOT(ctx->unsupported_cnt == 0);
+    FAIL_IF_NOT(DetectPcreHsCountRegexes(ctx) == 2);
+
+    DetectEngineThreadCtx *det_ctx = NULL;
+    ThreadVars th_v;
+    memset(&th_v, 0, sizeof(th_v));
+    DetectEngineThreadCtxInit(&th_v, (void *)de_ctx, (void *)&det_ctx);
+    FAIL_IF_NULL(det_ctx);
+
+    uint8_t buf1[] = "foo aac bar";
+    Packet *p = UTHBuildPacket(buf1, sizeof(buf1) - 1, IPPROTO_TCP);
+    FAIL_IF_NULL(p);
+    SigMatchSignatures(&th_v, de_ctx, det_ctx, p);
+    FAIL_IF_NOT(PacketAlertCheck(p, 1));
+    UTHFreePackets(&p, 1);
+
+    /* a prefilter hit is confirmed by pcre2 */
+    uint8_t buf2[] = "foo abc bar";
+    p = UTHBuildPacket(buf2, sizeof(buf2) - 1, IPPROTO_TCP);
+    FAIL_IF_NULL(p);
+    SigMatchSignatures(&th_v, de_ctx, det_ctx, p);
+    FAIL_IF(PacketAlertCheck(p, 1));
+    UTHFreePackets(&p, 1);
+
+    DetectEngineThreadCtxDeinit(&th_v, (void *)det_ctx);
+    DetectEngineCtxFree(de_ctx);
+    PASS;
+}
+
+/** \test the results are kept per buffer and dropped per buffer */
+static int DetectPcreHsTest04(void)
+{
+    if (!pcre_hs_enabled)
+        PASS;
+
+    DetectEngineCtx *de_ctx = DetectEngineCtxInit();
+    FAIL_IF_NULL(de_ctx);
+    Signature *s1 = DetectEngineAppendSig(
+            de_ctx, "alert tcp any any -> any any (pcre:\"/abc[0-9]+def/\"; sid:1;)");
+    FAIL_IF_NULL(s1);
+    Signature *s2 = DetectEngineAppendSig(
+            de_ctx, "alert tcp any any -> any any (pcre:\"/xyz[a-z]+uvw/\"; sid:2;)");
+    FAIL_IF_NULL(s2);
+    const DetectPcreData *pd1 = DetectPcreHsTestGetData(s1);
+    const DetectPcreData *pd2 = DetectPcreHsTestGetData(s2);
+    SigGroupBuild(de_ctx);
+
+    DetectEngineThreadCtx *det_ctx = NULL;
+    ThreadVars th_v;
+    memset(&th_v, 0, sizeof(th_v));
+    DetectEngineThreadCtxInit(&th_v, (void *)de_ctx, (void *)&det_ctx);
+    FAIL_IF_NULL(det_ctx);
+    FAIL_IF_NULL(det_ctx->pcre_hs);
+
+    /* inspect a packet to set the rule group */
+    uint8_t pkt[] = "abc123def";
+    Packet *p = UTHBuildPacket(pkt, sizeof(pkt) - 1, IPPROTO_TCP);
+    FAIL_IF_NULL(p);
+    SigMatchSignatures(&th_v, de_ctx, det_ctx, p);
+    FAIL_IF_NOT(PacketAlertCheck(p, 1));
+    UTHFreePackets(&p, 1);
+
+    uint8_t buf1[] = "abc123def";
+    uint8_t buf2[] = "xyzfoouvw";
+    const uint32_t len = sizeof(buf1) - 1;
+    FAIL_IF_NOT(DetectPcreHsMatch(det_ctx, pd1, buf1, len) == 1);
+    FAIL_IF_NOT(DetectPcreHsMatch(det_ctx, pd2, buf1, len) == 0);
+    FAIL_IF_NOT(DetectPcreHsMatch(det_ctx, pd1, buf2, len) == 0);
+    FAIL_IF_NOT(DetectPcreHsMatch(det_ctx, pd2, buf2, len) == 1);
+
+    /* swap the data: the cached results are used until invalidated */
+    memcpy(buf1, "xyzfoouvw", len);
+    memcpy(buf2, "abc123def", len);
+    FAIL_IF_NOT(DetectPcreHsMatch(det_ctx, pd1, buf1, len) == 1);
+    FAIL_IF_NOT(DetectPcreHsMatch(det_ctx, pd1, buf2, len) == 0);
+
+    /* only the invalidated buffer is scanned again */
+    DetectPcreHsCacheInvalidate(det_ctx, buf1);
+    FAIL_IF_NOT(DetectPcreHsMatch(det_ctx, pd1, buf1, len) == 0);
+    FAIL_IF_NOT(DetectPcreHsMatch(det_ctx, pd2, buf1, len) == 1);
+    FAIL_IF_NOT(DetectPcreHsMatch(det_ctx, pd1, buf2, len) == 0);
+
+    DetectPcreHsCacheInvalidate(det_ctx, buf2);
+    FAIL_IF_NOT(DetectPcreHsMatch(det_ctx, pd1, buf2, len) == 1);
+    FAIL_IF_NOT(DetectPcreHsMatch(det_ctx, pd2, buf2, len) == 0);
+
+    DetectEngineThreadCtxDeinit(&th_v, (void *)det_ctx);
+    DetectEngineCtxFree(de_ctx);
+    PASS;
+}
+#endif /* UNITTESTS */
+
+#else /* BUILD_HYPERSCAN */
+
+void DetectPcreHsRegister(void)
+{
+}
+
+void DetectPcreHsSetup(DetectPcreData *pd, const char *re, const int opts)
+{
+}
+
+void DetectPcreHsFreeData(DetectPcreData *pd)
+{
+}
+
+void DetectPcreHsSetupRuleGroup(DetectEngineCtx *de_ctx, SigGroupHead *sgh)
+{
+}
+
+void DetectPcreHsReportStats(const DetectEngineCtx *de_ctx)
+{
+}
+
+void DetectPcreHsRuleGroupFree(SigGroupHead *sgh)
+{
+}
+
+void DetectPcreHsFree(DetectEngineCtx *de_ctx)
+{
+}
+
+int DetectPcreHsThreadInit(const DetectEngineCtx *de_ctx, DetectEngineThreadCtx *det_ctx)
+{
+    det_ctx->pcre_hs = NULL;
+    return 0;
+}
+
+void DetectPcreHsThreadFree(DetectEngineThreadCtx *det_ctx)
+{
+}
+
+void DetectPcreHsRuleGroupSet(DetectEngineThreadCtx *det_ctx, const SigGroupHead *sgh)
+{
+}
+
+void DetectPcreHsCacheClear(DetectEngineThreadCtx *det_ctx)
+{
+}
+
+void DetectPcreHsCacheInvalidate(DetectEngineThreadCtx *det_ctx, const uint8_t *buf)
+{
+}
+
+int DetectPcreHsMatch(DetectEngineThreadCtx *det_ctx, const DetectPcreData *pd, const uint8_t *buf,
+        const uint32_t buf_len)
+{
+    return -1;
+}
+
+#endif /* BUILD_HYPERSCAN */
+
+void DetectPcreHsRegisterTests(void)
+{
+#if defined(BUILD_HYPERSCAN) && defined(UNITTESTS)
+    UtRegisterTest("DetectPcreHsTest01", DetectPcreHsTest01);
+    UtRegisterTest("DetectPcreHsTest02", DetectPcreHsTest02);
+    UtRegisterTest("DetectPcreHsTest03", DetectPcreHsTest03);
+    UtRegisterTest("DetectPcreHsTest04", DetectPcreHsTest04);
+#endif
+}
@@ -0,0 +1,69 @@
+/* Copyright (C) 2026 Open Information Security Foundation
+ *
+ * You can copy, redistribute or modify this Program under the terms of
+ * the GNU General Public License version 2 as published by the Free
+ * Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * version 2 along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+/**
+ * \file
+ *
+ * Hyperscan evaluation of the pcre keywords of a rule group.
+ */
+
+#ifndef SURICATA_DETECT_PCRE_HS_H
+#define SURICATA_DETECT_PCRE_HS_H
+
+#include "detect-pcre.h"
+
+/** how far the hyperscan result of a regex can be trusted */
+enum DetectPcreHsMode {
+    /** not supported by hyperscan, pcre2 only */
+    DETECT_PCRE_HS_NONE = 0,
+    /** hyperscan reports the same matches as pcre2 */
+    DETECT_PCRE_HS_EXACT,
+    /** hyperscan may report matches pcre2 won't, only a miss is exact */
+    DETECT_PCRE_HS_PREFILTER,
+};
+
+/** minimal number of regexes on a buffer in a rule group to use hyperscan */
+#define DETECT_PCRE_HS_GROUP_MIN 2
+
+/** number of buffers the per thread scan results are kept for */
+#define DETECT_PCRE_HS_CACHE_SIZE 8
+
+#ifdef BUILD_HYPERSCAN
+extern bool g_pcre_hs_exact_match;
+#endif
+
+void DetectPcreHsRegister(void);
+void DetectPcreHsSetup(DetectPcreData *pd, const char *re, const int opts);
+void DetectPcreHsFreeData(DetectPcreData *pd);
+
+void DetectPcreHsSetupRuleGroup(DetectEngineCtx *de_ctx, SigGroupHead *sgh);
+void DetectPcreHsReportStats(const DetectEngineCtx *de_ctx);
+void DetectPcreHsRuleGroupFree(SigGroupHead *sgh);
+void DetectPcreHsFree(DetectEngineCtx *de_ctx);
+
+int DetectPcreHsThreadInit(const DetectEngineCtx *de_ctx, DetectEngineThreadCtx *det_ctx);
+void DetectPcreHsThreadFree(DetectEngineThreadCtx *det_ctx);
+
+void DetectPcreHsRuleGroupSet(DetectEngineThreadCtx *det_ctx, const SigGroupHead *sgh);
+void DetectPcreHsCacheClear(DetectEngineThreadCtx *det_ctx);
+void DetectPcreHsCacheInvalidate(DetectEngineThreadCtx *det_ctx, const uint8_t *buf);
+int DetectPcreHsMatch(DetectEngineThreadCtx *det_ctx, const DetectPcreData *pd, const uint8_t *buf,
+        const uint32_t buf_len);
+
+void DetectPcreHsRegisterTests(void);
+
+#endif /* SURICATA_DETECT_PCRE_HS_H */
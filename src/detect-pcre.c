@@ -32,6 +32,7 @@
 #include "flow-util.h"
 
 #include "detect-pcre.h"
+#include "detect-pcre-hs.h"
 #include "detect-flowvar.h"
 
 #include "detect-parse.h"
@@ -60,6 +61,9 @@
 #include "app-layer-protos.h"
 #include "app-layer-parser.h"
 #include "util-pages.h"
+#include "util-memcmp.h"
+#include "util-misc.h"
+#include "util-profiling.h"
 
 /* pcre named substring capture supports only 32byte names, A-z0-9 plus _
  * and needs to start with non-numeric. */
@@ -74,9 +78,34 @@ static DetectParseRegex *parse_capture_regex;
 
 #ifdef PCRE2_HAVE_JIT
 static int pcre2_use_jit = 1;
-#endif
+/** max size of the per thread JIT stacks, 0 to use the default
+ *  32k stack of pcre2 */
+static uint32_t pcre_jit_stack_size = DETECT_PCRE_JIT_STACK_SIZE_DEFAULT;
+static int g_pcre_jit_stack_thread_id = -1;
+/** JIT stack of the detect thread running the regex. Set before each
+ *  match as the match contexts are shared between the threads. */
+static thread_local pcre2_jit_stack *pcre_jit_stack = NULL;
+
+static pcre2_jit_stack *DetectPcreJitStackGet(void *data)
+{
+    /* NULL makes pcre2 use its default stack */
+    return pcre_jit_stack;
+}
+
+static void *DetectPcreJitStackThreadInit(void *data)
+{
+    return pcre2_jit_stack_create(MIN(32 * 1024, pcre_jit_stack_size), pcre_jit_stack_size, NULL);
+}
 
-// TODOpcre2 pcre2_jit_stack_create ?
+static void DetectPcreJitStackThreadFree(void *ctx)
+{
+    if (ctx != NULL) {
+        if (pcre_jit_stack == ctx)
+            pcre_jit_stack = NULL;
+        pcre2_jit_stack_free((pcre2_jit_stack *)ctx);
+    }
+}
+#endif
 
 /* \brief Helper function for using pcre2_match with/without JIT
  */
@@ -84,10 +113,49 @@ static inline int DetectPcreExec(DetectEngineThreadCtx *det_ctx, const DetectPcr
         const char *str, const size_t strlen, int start_offset, int options,
         pcre2_match_data *match)
 {
+#ifdef PCRE2_HAVE_JIT
+    if (g_pcre_jit_stack_thread_id != -1) {
+        pcre_jit_stack = (pcre2_jit_stack *)DetectThreadCtxGetGlobalKeywordThreadCtx(
+                det_ctx, g_pcre_jit_stack_thread_id);
+    }
+#endif
     return pcre2_match(pd->parse_regex.regex, (PCRE2_SPTR8)str, strlen, start_offset, options,
             match, pd->parse_regex.context);
 }
 
+/** \internal
+ *  \brief check if the literal the regex requires is in the buffer
+ *
+ *  The checks and the skipped regex executions are counted per rule by
+ *  the rule profiling.
+ *
+ *  \retval false regex can't match, no need to run it
+ */
+static inline bool DetectPcreGuardCheck(DetectEngineThreadCtx *det_ctx, const Signature *s,
+        const DetectPcreData *pe, const uint8_t *ptr, const uint32_t len,
+        const uint32_t start_offset)
+{
+    const DetectPcreGuard *g = pe->guard;
+    bool found;
+    if (len - start_offset < g->literal_len) {
+        found = false;
+    } else if (g->anchored && start_offset == 0) {
+        if (g->nocase)
+            found = SCMemcmpLowercase(g->literal, ptr, g->literal_len) == 0;
+        else
+            found = SCMemcmp(g->literal, ptr, g->literal_len) == 0;
+    } else {
+        found = SpmScan(g->spm_ctx, det_ctx->spm_thread_ctx, ptr + start_offset,
+                        len - start_offset) != NULL;
+    }
+
+#ifdef PROFILE_RULES
+    if (profiling_rules_enabled && profiling_rules_entered > 0)
+        SCProfilingRuleUpdatePcreGuard(det_ctx, s->profiling_id, !found);
+#endif
+    return found;
+}
+
 static int DetectPcreSetup (DetectEngineCtx *, Signature *, const char *);
 static void DetectPcreFree(DetectEngineCtx *, void *);
 #ifdef UNITTESTS
@@ -152,7 +220,22 @@ void DetectPcreRegister (void)
         SCLogConfig("PCRE2 won't use JIT as OS doesn't allow RWX pages");
         pcre2_use_jit = 0;
     }
+
+    const char *jit_stack_size = NULL;
+    if (SCConfGet("pcre.jit-stack-size", &jit_stack_size) == 1 && jit_stack_size != NULL) {
+        if (ParseSizeStringU32(jit_stack_size, &pcre_jit_stack_size) < 0) {
+            SCLogError("invalid pcre.jit-stack-size value %s, using default", jit_stack_size);
+            pcre_jit_stack_size = DETECT_PCRE_JIT_STACK_SIZE_DEFAULT;
+        }
+    }
+    if (pcre2_use_jit && pcre_jit_stack_size > 0) {
+        SCLogConfig("Using PCRE2 JIT stacks of up to %" PRIu32 " bytes", pcre_jit_stack_size);
+        g_pcre_jit_stack_thread_id = DetectRegisterThreadCtxGlobalFuncs("pcre_jit_stack",
+                DetectPcreJitStackThreadInit, NULL, DetectPcreJitStackThreadFree);
+    }
 #endif
+
+    DetectPcreHsRegister();
 }
 
 static void DetectAlertStoreMatch(DetectEngineThreadCtx *det_ctx, const Signature *s, uint32_t idx,
@@ -244,11 +327,38 @@ int DetectPcrePayloadMatch(DetectEngineThreadCtx *det_ctx, const Signature *s,
         start_offset = (uint32_t)(payload - ptr) + det_ctx->pcre_match_start_offset;
     }
 
-    /* run the actual pcre detection */
     pcre2_match_data *match =
             (pcre2_match_data *)DetectThreadCtxGetKeywordThreadCtx(det_ctx, pe->thread_ctx_id);
 
-    ret = DetectPcreExec(det_ctx, pe, (char *)ptr, len, start_offset, 0, match);
+    int hs_ret = -1;
+#ifdef BUILD_HYPERSCAN
+    /* a regex hyperscan doesn't find in the buffer can't match from any
+     * start offset, but only if it runs on the whole buffer: assertions
+     * like ^ depend on where the subject starts. */
+    if (pe->hs_id != 0 && det_ctx->pcre_hs != NULL && ptr == payload) {
+        hs_ret = DetectPcreHsMatch(det_ctx, pe, payload, payload_len);
+        /* if enabled, an exact match is all we need if there are no
+         * captures and no keyword depends on the match offsets. It isn't
+         * subject to the pcre2 match limits, unless 'O' asks for them. */
+        if (hs_ret == 1 && g_pcre_hs_exact_match && pe->hs_mode == DETECT_PCRE_HS_EXACT &&
+                start_offset == 0 && pe->idx == 0 &&
+                !(pe->flags & (DETECT_PCRE_RELATIVE_NEXT | DETECT_PCRE_MATCH_LIMIT))) {
+            SCReturnInt((pe->flags & DETECT_PCRE_NEGATE) ? 0 : 1);
+        }
+    }
+#endif
+
+    if (hs_ret == 0) {
+        ret = PCRE2_ERROR_NOMATCH;
+    } else if (pe->guard != NULL && start_offset >= 0 && (uint32_t)start_offset <= len &&
+               !DetectPcreGuardCheck(det_ctx, s, pe, ptr, len, (uint32_t)start_offset)) {
+        /* the literal the regex requires isn't there. An invalid start
+         * offset is left to pcre2 to report. */
+        ret = PCRE2_ERROR_NOMATCH;
+    } else {
+        /* run the actual pcre detection */
+        ret = DetectPcreExec(det_ctx, pe, (char *)ptr, len, start_offset, 0, match);
+    }
     SCLogDebug("ret %d (negating %s)", ret, (pe->flags & DETECT_PCRE_NEGATE) ? "set" : "not set");
 
     if (ret == PCRE2_ERROR_NOMATCH) {
@@ -398,6 +508,289 @@ static int DetectPcreHasUpperCase(const char *re)
     return 0;
 }
 
+/** \internal
+ *  \brief skip a character class
+ *  \param i index of the '['
+ *  \retval i index after the class or 0 if it can't be parsed */
+static size_t DetectPcreSkipClass(const char *re, size_t i)
+{
+    i++;
+    if (re[i] == '^')
+        i++;
+    if (re[i] == ']')
+        i++;
+    while (re[i] != '\0') {
+        if (re[i] == '\\') {
+            if (re[i + 1] == '\0' || re[i + 1] == 'Q')
+                return 0;
+            i += 2;
+        } else if (re[i] == '[' && re[i + 1] == ':') {
+            const char *end = strstr(re + i + 2, ":]");
+            if (end == NULL)
+                return 0;
+            i = (end - re) + 2;
+        } else if (re[i] == ']') {
+            return i + 1;
+        } else {
+            i++;
+        }
+    }
+    return 0;
+}
+
+/** \internal
+ *  \brief skip a group
+ *  \param i index of the '('
+ *  \retval i index after the group or 0 if it can't be parsed */
+static size_t DetectPcreSkipGroup(const char *re, size_t i)
+{
+    uint32_t depth = 0;
+    while (re[i] != '\0') {
+        if (re[i] == '\\') {
+            if (re[i + 1] == '\0' || re[i + 1] == 'Q')
+                return 0;
+            i += 2;
+            continue;
+        } else if (re[i] == '[') {
+            i = DetectPcreSkipClass(re, i);
+            if (i == 0)
+                return 0;
+            continue;
+        } else if (re[i] == '(') {
+            /* comments don't nest */
+            if (re[i + 1] == '?' && re[i + 2] == '#')
+                return 0;
+            depth++;
+        } else if (re[i] == ')') {
+            if (--depth == 0)
+                return i + 1;
+        }
+        i++;
+    }
+    return 0;
+}
+
+/** \internal
+ *  \brief get the literal the regex requires to match
+ *
+ *  Looks at the top level of the pattern only: groups, classes, optional
+ *  characters and escapes that are not a single character end a literal.
+ *  Patterns with a top level alternation or constructs that change how
+ *  the rest of the pattern is parsed (extended mode, inline options,
+ *  verbs, quoting) are not used.
+ *
+ *  \param lit buffer of at least strlen(re) bytes to store the literal
+ *  \param anchored set if the literal starts the match
+ *
+ *  \retval len length of the literal, 0 if there is none
+ */
+static size_t DetectPcreGetLiteral(const char *re, const int opts, uint8_t *lit, bool *anchored)
+{
+    if (opts & PCRE2_EXTENDED)
+        return 0;
+
+    const size_t re_len = strlen(re);
+    uint8_t cur[re_len + 1];
+    size_t cur_len = 0, best_len = 0, first_len = 0;
+    bool cur_anchored = false;
+    size_t i = 0;
+
+    /* a literal found before any other part of the pattern is anchored */
+    bool start = (opts & PCRE2_ANCHORED) != 0;
+    if (re[0] == '^' && !(opts & PCRE2_MULTILINE)) {
+        start = true;
+        i++;
+    }
+    uint8_t first[re_len + 1];
+
+#define END_LITERAL                                                                                \
+    do {                                                                                           \
+        if (cur_anchored) {                                                                        \
+            memcpy(first, cur, cur_len);                                                           \
+            first_len = cur_len;                                                                   \
+        }                                                                                          \
+        if (cur_len > best_len) {                                                                  \
+            memcpy(lit, cur, cur_len);                                                             \
+            best_len = cur_len;                                                                    \
+        }                                                                                          \
+        cur_len = 0;                                                                               \
+        cur_anchored = false;                                                                      \
+        start = false;                                                                             \
+    } while (0)
+
+    while (i < re_len) {
+        int ch = -1; /* literal byte or -1 for another part of the pattern */
+        size_t next = i + 1;
+
+        switch (re[i]) {
+            case '|':
+                return 0;
+            case ')':
+            case '*':
+            case '+':
+            case '?':
+                return 0;
+            case '(':
+                if (re[i + 1] == '*')
+                    return 0;
+                if (re[i + 1] == '?' && strchr(":=!<>P|'", re[i + 2]) == NULL)
+                    return 0;
+                next = DetectPcreSkipGroup(re, i);
+                if (next == 0)
+                    return 0;
+                break;
+            case '[':
+                next = DetectPcreSkipClass(re, i);
+                if (next == 0)
+                    return 0;
+                break;
+            case '.':
+            case '^':
+            case '$':
+                break;
+            case '\\': {
+                const char e = re[i + 1];
+                next = i + 2;
+                if (e == '\0') {
+                    return 0;
+                } else if (!isalnum((unsigned char)e)) {
+                    ch = (uint8_t)e;
+                } else if (e == 't') {
+                    ch = '\t';
+                } else if (e == 'n') {
+                    ch = '\n';
+                } else if (e == 'r') {
+                    ch = '\r';
+                } else if (e == 'f') {
+                    ch = '\f';
+                } else if (e == 'e') {
+                    ch = 0x1b;
+                } else if (e == 'a') {
+                    ch = 0x07;
+                } else if (e == 'x') {
+                    if (!isxdigit((unsigned char)re[i + 2]) || !isxdigit((unsigned char)re[i + 3]))
+                        return 0;
+                    char hex[3] = { re[i + 2], re[i + 3], '\0' };
+                    ch = (int)strtol(hex, NULL, 16);
+                    next = i + 4;
+                } else if (strchr("dDwWsShHvVRXbBAzZGKC", e) == NULL) {
+                    /* back references, octal, \Q, \c, \p{..}, \g{..}, etc */
+                    return 0;
+                }
+                break;
+            }
+            default:
+                if ((uint8_t)re[i] >= 0x80)
+                    return 0;
+                ch = (uint8_t)re[i];
+                break;
+        }
+        i = next;
+
+        /* quantifier */
+        bool quantified = false, optional = false;
+        if (re[i] == '*' || re[i] == '?') {
+            quantified = optional = true;
+            i++;
+        } else if (re[i] == '+') {
+            quantified = true;
+            i++;
+        } else if (re[i] == '{') {
+            if (re[i + 1] == ',')
+                return 0;
+            size_t q = i + 1;
+            uint32_t min = 0;
+            while (isdigit((unsigned char)re[q])) {
+                min = min * 10 + (re[q] - '0');
+                if (min > 65535)
+                    return 0;
+                q++;
+            }
+            if (q > i + 1) {
+                if (re[q] == ',') {
+                    q++;
+                    while (isdigit((unsigned char)re[q]))
+                        q++;
+                }
+                if (re[q] == '}') {
+                    quantified = true;
+                    optional = (min == 0);
+                    i = q + 1;
+                }
+            }
+            /* otherwise a literal '{' */
+        }
+        if (quantified && (re[i] == '?' || re[i] == '+'))
+            i++;
+
+        if (ch < 0 || optional) {
+            END_LITERAL;
+        } else {
+            if (cur_len == 0)
+                cur_anchored = start;
+            cur[cur_len++] = (uint8_t)ch;
+            /* repeated: the next part isn't directly after this one */
+            if (quantified)
+                END_LITERAL;
+        }
+    }
+    END_LITERAL;
+#undef END_LITERAL
+
+    /* a short anchored literal is as good as a longer one elsewhere */
+    *anchored = false;
+    if (first_len > 0 && (first_len >= 2 || first_len >= best_len)) {
+        memcpy(lit, first, first_len);
+        *anchored = true;
+        return first_len;
+    }
+    return best_len;
+}
+
+/** \internal
+ *  \brief set up the literal guard for the regex if it has a literal */
+static void DetectPcreSetupGuard(
+        DetectEngineCtx *de_ctx, DetectPcreData *pd, const char *re, const int opts)
+{
+    uint8_t lit[strlen(re) + 1];
+    bool anchored = false;
+    size_t len = DetectPcreGetLiteral(re, opts, lit, &anchored);
+    /* single bytes don't filter enough to be worth it */
+    if (len < 2 || len > UINT16_MAX)
+        return;
+
+    DetectPcreGuard *g = SCCalloc(1, sizeof(*g));
+    if (unlikely(g == NULL))
+        return;
+    g->nocase = (opts & PCRE2_CASELESS) != 0;
+    if (g->nocase) {
+        for (size_t i = 0; i < len; i++)
+            lit[i] = u8_tolower(lit[i]);
+    }
+    g->literal = SCMalloc(len);
+    if (unlikely(g->literal == NULL)) {
+        SCFree(g);
+        return;
+    }
+    memcpy(g->literal, lit, len);
+    g->literal_len = (uint16_t)len;
+    g->anchored = anchored;
+    g->spm_ctx = SpmInitCtx(g->literal, g->literal_len, g->nocase, de_ctx->spm_global_thread_ctx);
+    if (g->spm_ctx == NULL) {
+        SCFree(g->literal);
+        SCFree(g);
+        return;
+    }
+    pd->guard = g;
+}
+
+static void DetectPcreFreeGuard(DetectPcreGuard *g)
+{
+    SpmDestroyCtx(g->spm_ctx);
+    SCFree(g->literal);
+    SCFree(g);
+}
+
 static DetectPcreData *DetectPcreParse (DetectEngineCtx *de_ctx,
         const char *regexstr, int *sm_list, char *capture_names,
         size_t capture_names_size, bool negate, AppProto *alproto)
@@ -539,6 +932,7 @@ static DetectPcreData *DetectPcreParse (DetectEngineCtx *de_ctx,
 
                 case 'O':
                     apply_match_limit = true;
+                    pd->flags |= DETECT_PCRE_MATCH_LIMIT;
                     break;
 
                 case 'B': /* snort's option */
@@ -742,6 +1136,13 @@ static DetectPcreData *DetectPcreParse (DetectEngineCtx *de_ctx,
         SCLogError("pcre2 could not create match context");
         goto error;
     }
+#ifdef PCRE2_HAVE_JIT
+    if (g_pcre_jit_stack_thread_id != -1) {
+        pcre2_jit_stack_assign(pd->parse_regex.context, DetectPcreJitStackGet, NULL);
+    }
+#endif
+    DetectPcreSetupGuard(de_ctx, pd, re, opts);
+    DetectPcreHsSetup(pd, re, opts);
 
     if (apply_match_limit) {
         if (pcre_match_limit >= -1) {
@@ -1041,6 +1442,9 @@ static void DetectPcreFree(DetectEngineCtx *de_ctx, void *ptr)
     DetectPcreData *pd = (DetectPcreData *)ptr;
     DetectParseFreeRegex(&pd->parse_regex);
     DetectUnregisterThreadCtxFuncs(de_ctx, pd, "pcre");
+    if (pd->guard != NULL)
+        DetectPcreFreeGuard(pd->guard);
+    DetectPcreHsFreeData(pd);
 
     for (uint8_t i = 0; i < pd->idx; i++) {
         VarNameStoreUnregister(pd->capids[i], pd->captypes[i]);
@@ -2091,6 +2495,94 @@ static int DetectPcreParseCaptureTest(void)
     PASS;
 }
 
+static int DetectPcreGetLiteralTest(void)
+{
+    static const struct {
+        const char *re;
+        int opts;
+        const char *lit;
+        bool anchored;
+    } tests[] = {
+        { "^GET \\/index\\.php\\?id=\\d+", 0, "GET /index.php?id=", true },
+        { "abc", 0, "abc", false },
+        { "abc", PCRE2_ANCHORED, "abc", true },
+        { "^abc", PCRE2_MULTILINE, "abc", false },
+        { "\\x2Esuricata$", 0, ".suricata", false },
+        { "ab?cdef", 0, "cdef", false },
+        { "abc+de", 0, "abc", false },
+        { "a{3}bc", 0, "bc", false },
+        { "[a-z]+foobar(ab|cd)x", 0, "foobar", false },
+        { "ab|cd", 0, "", false },
+        { "a b c", PCRE2_EXTENDED, "", false },
+        { "(?i)abc", 0, "", false },
+        { "\\Qabc\\E", 0, "", false },
+        /* too short for a guard, DetectPcreSetupGuard() skips it */
+        { "a.c", 0, "a", false },
+    };
+
+    for (size_t i = 0; i < ARRAY_SIZE(tests); i++) {
+        uint8_t lit[64];
+        bool anchored = false;
+        size_t len = DetectPcreGetLiteral(tests[i].re, tests[i].opts, lit, &anchored);
+        if (len != strlen(tests[i].lit) || memcmp(lit, tests[i].lit, len) != 0 ||
+                (len > 0 && anchored != tests[i].anchored)) {
+            SCLogNotice("pattern %s: got \"%.*s\" anchored %s", tests[i].re, (int)len, lit,
+                    anchored ? "true" : "false");
+            FAIL;
+        }
+    }
+    PASS;
+}
+
+/** \test the guard must not prevent matches, but skip the regex if the
+ *         literal is missing */
+static int DetectPcreGuardTest01(void)
+{
+    DetectEngineCtx *de_ctx = DetectEngineCtxInit();
+    FAIL_IF_NULL(de_ctx);
+    de_ctx->flags |= DE_QUIET;
+
+    Signature *s = DetectEngineAppendSig(de_ctx,
+            "alert tcp any any -> any any (pcre:\"/^USER [a-z]+ (admin|root)/i\"; sid:1;)");
+    FAIL_IF_NULL(s);
+    const DetectPcreData *pd =
+            (const DetectPcreData *)s->init_data->smlists[DETECT_SM_LIST_PMATCH]->ctx;
+    FAIL_IF_NULL(pd->guard);
+    FAIL_IF_NOT(pd->guard->literal_len == 5);
+    FAIL_IF_NOT(memcmp(pd->guard->literal, "user ", 5) == 0);
+    FAIL_IF_NOT(pd->guard->anchored);
+
+    s = DetectEngineAppendSig(de_ctx, "alert tcp any any -> any any (pcre:\"/a.b/\"; sid:2;)");
+    FAIL_IF_NULL(s);
+    pd = (const DetectPcreData *)s->init_data->smlists[DETECT_SM_LIST_PMATCH]->ctx;
+    FAIL_IF_NOT_NULL(pd->guard);
+    SigGroupBuild(de_ctx);
+
+    DetectEngineThreadCtx *det_ctx = NULL;
+    ThreadVars th_v;
+    memset(&th_v, 0, sizeof(th_v));
+    DetectEngineThreadCtxInit(&th_v, (void *)de_ctx, (void *)&det_ctx);
+    FAIL_IF_NULL(det_ctx);
+
+    uint8_t buf1[] = "user joe admin";
+    Packet *p = UTHBuildPacket(buf1, sizeof(buf1) - 1, IPPROTO_TCP);
+    FAIL_IF_NULL(p);
+    SigMatchSignatures(&th_v, de_ctx, det_ctx, p);
+    FAIL_IF_NOT(PacketAlertCheck(p, 1));
+    UTHFreePackets(&p, 1);
+
+    uint8_t buf2[] = "pass joe admin";
+    p = UTHBuildPacket(buf2, sizeof(buf2) - 1, IPPROTO_TCP);
+    FAIL_IF_NULL(p);
+    SigMatchSignatures(&th_v, de_ctx, det_ctx, p);
+    FAIL_IF(PacketAlertCheck(p, 1));
+    UTHFreePackets(&p, 1);
+
+    DetectEngineThreadCtxDeinit(&th_v, (void *)det_ctx);
+    DetectEngineCtxFree(de_ctx);
+    PASS;
+}
+
 /**
  * \brief this function registers unit tests for DetectPcre
  */
@@ -2138,5 +2630,9 @@ static void DetectPcreRegisterTests(void)
 
     UtRegisterTest("DetectPcreParseHttpHost", DetectPcreParseHttpHost);
     UtRegisterTest("DetectPcreParseCaptureTest", DetectPcreParseCaptureTest);
+    UtRegisterTest("DetectPcreGetLiteralTest", DetectPcreGetLiteralTest);
+    UtRegisterTest("DetectPcreGuardTest01", DetectPcreGuardTest01);
+
+    DetectPcreHsRegisterTests();
 }
 #endif /* UNITTESTS */
@@ -25,6 +25,7 @@
 #define SURICATA_DETECT_PCRE_H
 
 #include "detect-parse.h"
+#include "util-spm.h"
 
 #define DETECT_PCRE_RELATIVE            0x00001
 /* no-op other than in parsing */
@@ -33,6 +34,8 @@
 
 #define DETECT_PCRE_RELATIVE_NEXT       0x00040
 #define DETECT_PCRE_NEGATE              0x00080
+/* 'O' modifier: the configured match limits apply */
+#define DETECT_PCRE_MATCH_LIMIT         0x00100
 
 #define DETECT_PCRE_CAPTURE_MAX         8
 
@@ -44,9 +47,32 @@
 #define SC_MATCH_LIMIT_RECURSION_DEFAULT 1500
 #endif
 
+/** default max size of the per thread pcre2 JIT stacks */
+#define DETECT_PCRE_JIT_STACK_SIZE_DEFAULT (256 * 1024)
+
+/** literal the regex requires to match, checked before running the regex */
+typedef struct DetectPcreGuard_ {
+    SpmCtx *spm_ctx;
+    uint8_t *literal; /**< lowercase if nocase is set */
+    uint16_t literal_len;
+    bool nocase;
+    /** literal is at the start of the match if it starts at the start
+     *  of the buffer */
+    bool anchored;
+} DetectPcreGuard;
+
 typedef struct DetectPcreData_ {
     DetectParseRegex parse_regex;
     int thread_ctx_id;
+    DetectPcreGuard *guard;
+#ifdef BUILD_HYPERSCAN
+    /** regex to compile with hyperscan, NULL if hyperscan can't be used */
+    char *hs_re;
+    uint32_t hs_flags; /**< HS_FLAG_* to compile the regex with */
+    /** engine wide id, 0 until the regex is in a hyperscan database */
+    uint32_t hs_id;
+    uint8_t hs_mode; /**< DetectPcreHsMode */
+#endif
 
     uint16_t flags;
     uint8_t idx;
@@ -67,7 +67,7 @@
 #define PARSE_REGEX                                                                                \
     "^\\s*" PARSE_REGEX_NAME "\\s+" PARSE_REGEX_VALUE "\\s*,\\s*" PARSE_REGEX_NAME                 \
     "\\s+" PARSE_REGEX_VALUE "\\s*,\\s*" PARSE_REGEX_NAME "\\s+" PARSE_REGEX_VALUE                 \
-    "\\s*,\\s*" PARSE_REGEX_NAME "\\s+" PARSE_REGEX_VALUE "\\s*"
+    "\\s*,\\s*" PARSE_REGEX_NAME "\\s+" PARSE_REGEX_VALUE "\\s*(?:,\\s*(exact)\\s*)?"
 
 static DetectParseRegex parse_regex;
 
@@ -121,7 +121,7 @@ static DetectThresholdData *DetectThresholdParse(const char *rawstr)
     int ret = 0, res = 0;
     size_t pcre2_len;
     const char *str_ptr = NULL;
-    char *args[9] = { NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL };
+    char *args[10] = { NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL };
     char *copy_str = NULL, *threshold_opt = NULL;
     int second_found = 0, count_found = 0;
     int type_found = 0, track_found = 0;
@@ -160,7 +160,7 @@ static DetectThresholdData *DetectThresholdParse(const char *rawstr)
     }
 
     ret = DetectParsePcreExec(&parse_regex, &match, rawstr, 0, 0);
-    if (ret < 5 || ret > 9) {
+    if (ret < 5 || ret > 10) {
         SCLogError("pcre_exec parse error, ret %" PRId32 ", string %s", ret, rawstr);
         goto error;
     }
@@ -204,6 +204,8 @@ static DetectThresholdData *DetectThresholdParse(const char *rawstr)
             second_pos = i + 1;
         if (strcasecmp(args[i], "multiplier") == 0)
             multiplier_pos = i + 1;
+        if (strcasecmp(args[i], "exact") == 0)
+            de->flags |= THRESHOLD_FLAG_EXACT;
     }
 
     if (de->type != TYPE_BACKOFF) {
@@ -393,6 +395,7 @@ error:
 #include "util-hashlist.h"
 #include "packet.h"
 #include "action-globals.h"
+#include "conf-yaml-loader.h"
 
 /**
  * \test ThresholdTestParse01 is a test for a valid threshold options
@@ -553,6 +556,26 @@ static int ThresholdTestParse08(void)
     PASS;
 }
 
+/** \test exact option */
+static int ThresholdTestParse09(void)
+{
+    DetectThresholdData *de =
+            DetectThresholdParse("type limit, track by_src, count 10, seconds 60, exact");
+    FAIL_IF_NULL(de);
+    FAIL_IF_NOT(de->type == TYPE_LIMIT);
+    FAIL_IF_NOT(de->track == TRACK_SRC);
+    FAIL_IF_NOT(de->count == 10);
+    FAIL_IF_NOT(de->seconds == 60);
+    FAIL_IF_NOT(de->flags & THRESHOLD_FLAG_EXACT);
+    DetectThresholdFree(NULL, de);
+
+    de = DetectThresholdParse("type limit, track by_src, count 10, seconds 60");
+    FAIL_IF_NULL(de);
+    FAIL_IF(de->flags & THRESHOLD_FLAG_EXACT);
+    DetectThresholdFree(NULL, de);
+    PASS;
+}
+
 /**
  * \test DetectThresholdTestSig1 is a test for checking the working of limit keyword
  *       by setting up the signature and later testing its working by matching
@@ -1716,6 +1739,66 @@ static int DetectThresholdTestSig14(void)
     PASS;
 }
 
+/**
+ * \test sharded thresholds give the same result as the global table for a
+ *       single thread
+ */
+static int DetectThresholdTestSig15(void)
+{
+    static const char *conf = "%YAML 1.1\n"
+                              "---\n"
+                              "detect:\n"
+                              "  thresholds:\n"
+                              "    sharded:\n"
+                              "      enabled: yes\n"
+                              "      sync-count: 4\n";
+    ThreadVars th_v;
+    DetectEngineThreadCtx *det_ctx;
+    int alerts[3] = { 0, 0, 0 };
+
+    SCConfCreateContextBackup();
+    SCConfInit();
+    SCConfYamlLoadString(conf, strlen(conf));
+    ThresholdInit();
+
+    memset(&th_v, 0, sizeof(th_v));
+    Packet *p = UTHBuildPacketReal((uint8_t *)"A", 1, IPPROTO_TCP, "1.1.1.1", "2.2.2.2", 1024, 80);
+    FAIL_IF_NULL(p);
+
+    DetectEngineCtx *de_ctx = DetectEngineCtxInit();
+    FAIL_IF_NULL(de_ctx);
+    de_ctx->flags |= DE_QUIET;
+
+    FAIL_IF_NULL(DetectEngineAppendSig(de_ctx,
+            "alert tcp any any -> any 80 (content:\"A\"; "
+            "threshold: type limit, track by_dst, count 5, seconds 60; sid:1;)"));
+    FAIL_IF_NULL(DetectEngineAppendSig(de_ctx,
+            "alert tcp any any -> any 80 (content:\"A\"; "
+            "threshold: type threshold, track by_src, count 3, seconds 60; sid:2;)"));
+    FAIL_IF_NULL(DetectEngineAppendSig(de_ctx,
+            "alert tcp any any -> any 80 (content:\"A\"; "
+            "threshold: type both, track by_src, count 3, seconds 60; sid:3;)"));
+    SigGroupBuild(de_ctx);
+    DetectEngineThreadCtxInit(&th_v, (void *)de_ctx, (void *)&det_ctx);
+
+    for (int i = 0; i < 9; i++) {
+        SigMatchSignatures(&th_v, de_ctx, det_ctx, p);
+        for (uint32_t sid = 1; sid <= 3; sid++)
+            alerts[sid - 1] += PacketAlertCheck(p, sid);
+    }
+    FAIL_IF_NOT(alerts[0] == 5);
+    FAIL_IF_NOT(alerts[1] == 3);
+    FAIL_IF_NOT(alerts[2] == 1);
+
+    DetectEngineThreadCtxDeinit(&th_v, (void *)det_ctx);
+    DetectEngineCtxFree(de_ctx);
+    UTHFreePackets(&p, 1);
+    ThresholdDestroy();
+    SCConfDeInit();
+    SCConfRestoreContextBackup();
+    PASS;
+}
+
 static void ThresholdRegisterTests(void)
 {
     UtRegisterTest("ThresholdTestParse01", ThresholdTestParse01);
@@ -1727,6 +1810,7 @@ static void ThresholdRegisterTests(void)
     UtRegisterTest("ThresholdTestParse06", ThresholdTestParse06);
     UtRegisterTest("ThresholdTestParse07", ThresholdTestParse07);
     UtRegisterTest("ThresholdTestParse08", ThresholdTestParse08);
+    UtRegisterTest("ThresholdTestParse09", ThresholdTestParse09);
     UtRegisterTest("DetectThresholdTestSig1", DetectThresholdTestSig1);
     UtRegisterTest("DetectThresholdTestSig2", DetectThresholdTestSig2);
     UtRegisterTest("DetectThresholdTestSig3", DetectThresholdTestSig3);
@@ -1741,6 +1825,7 @@ static void ThresholdRegisterTests(void)
     UtRegisterTest("DetectThresholdTestSig12", DetectThresholdTestSig12);
     UtRegisterTest("DetectThresholdTestSig13", DetectThresholdTestSig13);
     UtRegisterTest("DetectThresholdTestSig14", DetectThresholdTestSig14);
+    UtRegisterTest("DetectThresholdTestSig15", DetectThresholdTestSig15);
 }
 #endif /* UNITTESTS */
 
@@ -39,6 +39,10 @@
 #define TRACK_BOTH     5 /* used by rate_filter to match detections by both src and dst addresses */
 #define TRACK_FLOW     6 /**< track by flow */
 
+/** always evaluate on the global threshold table, even if sharded
+ *  thresholds are enabled */
+#define THRESHOLD_FLAG_EXACT BIT_U32(0)
+
 /* Get the new action to take */
 #define TH_ACTION_ALERT     0x01
 #define TH_ACTION_DROP      0x02
@@ -128,6 +128,7 @@ static int DetectTlsFingerprintSetup(DetectEngineCtx *de_ctx, Signature *s,
     if (SCDetectSignatureSetAppProto(s, ALPROTO_TLS) < 0)
         return -1;
 
+    SSLEnableCertFingerprint();
     return 0;
 }
 
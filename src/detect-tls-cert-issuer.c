@@ -117,6 +117,7 @@ static int DetectTlsIssuerSetup(DetectEngineCtx *de_ctx, Signature *s, const cha
     if (SCDetectSignatureSetAppProto(s, ALPROTO_TLS) < 0)
         return -1;
 
+    SSLEnableCertDecoding();
     return 0;
 }
 
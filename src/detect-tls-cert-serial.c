@@ -126,6 +126,7 @@ static int DetectTlsSerialSetup(DetectEngineCtx *de_ctx, Signature *s, const cha
     if (SCDetectSignatureSetAppProto(s, ALPROTO_TLS) < 0)
         return -1;
 
+    SSLEnableCertDecoding();
     return 0;
 }
 
@@ -116,6 +116,7 @@ static int DetectTlsSubjectSetup(DetectEngineCtx *de_ctx, Signature *s, const ch
     if (SCDetectSignatureSetAppProto(s, ALPROTO_TLS) < 0)
         return -1;
 
+    SSLEnableCertDecoding();
     return 0;
 }
 
@@ -417,6 +417,8 @@ static int DetectTlsExpiredSetup (DetectEngineCtx *de_ctx, Signature *s,
     if (SCDetectSignatureSetAppProto(s, ALPROTO_TLS) != 0)
         return -1;
 
+    SSLEnableCertDecoding();
+
     dd = SCCalloc(1, sizeof(DetectTlsValidityData));
     if (dd == NULL) {
         SCLogError("Allocation \'%s\' failed", rawstr);
@@ -462,6 +464,8 @@ static int DetectTlsValidSetup (DetectEngineCtx *de_ctx, Signature *s,
     if (SCDetectSignatureSetAppProto(s, ALPROTO_TLS) != 0)
         return -1;
 
+    SSLEnableCertDecoding();
+
     dd = SCCalloc(1, sizeof(DetectTlsValidityData));
     if (dd == NULL) {
         SCLogError("Allocation \'%s\' failed", rawstr);
@@ -546,6 +550,8 @@ static int DetectTlsValiditySetup (DetectEngineCtx *de_ctx, Signature *s,
     if (SCDetectSignatureSetAppProto(s, ALPROTO_TLS) != 0)
         return -1;
 
+    SSLEnableCertDecoding();
+
     dd = DetectTlsValidityParse(rawstr);
     if (dd == NULL) {
         SCLogError("Parsing \'%s\' failed", rawstr);
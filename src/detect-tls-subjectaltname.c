@@ -113,5 +113,6 @@ static int DetectTlsSubjectAltNameSetup(DetectEngineCtx *de_ctx, Signature *s, c
     if (SCDetectSignatureSetAppProto(s, ALPROTO_TLS) < 0)
         return -1;
 
+    SSLEnableCertDecoding();
     return 0;
 }
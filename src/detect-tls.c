@@ -304,6 +304,8 @@ static int DetectTlsSubjectSetup (DetectEngineCtx *de_ctx, Signature *s, const c
     if (SCDetectSignatureSetAppProto(s, ALPROTO_TLS) != 0)
         return -1;
 
+    SSLEnableCertDecoding();
+
     tls = DetectTlsSubjectParse(de_ctx, str, s->init_data->negated);
     if (tls == NULL)
         goto error;
@@ -494,6 +496,8 @@ static int DetectTlsIssuerDNSetup (DetectEngineCtx *de_ctx, Signature *s, const
     if (SCDetectSignatureSetAppProto(s, ALPROTO_TLS) != 0)
         return -1;
 
+    SSLEnableCertDecoding();
+
     tls = DetectTlsIssuerDNParse(de_ctx, str, s->init_data->negated);
     if (tls == NULL)
         goto error;
@@ -557,6 +561,7 @@ static int DetectTlsFingerprintSetup (DetectEngineCtx *de_ctx, Signature *s, con
                 g_tls_cert_fingerprint_list_id, ALPROTO_TLS) < 0)
         return -1;
 
+    SSLEnableCertFingerprint();
     return 0;
 }
 
@@ -33,6 +33,8 @@
 #include "app-layer.h"
 #include "app-layer-parser.h"
 #include "app-layer-frames.h"
+#include "app-layer-events.h"
+#include "app-layer-htp.h"
 
 #include "detect.h"
 #include "detect-dsize.h"
@@ -59,6 +61,7 @@
 #include "detect-filestore.h"
 #include "detect-flowvar.h"
 #include "detect-replace.h"
+#include "detect-pcre-hs.h"
 
 #include "util-validate.h"
 #include "util-detect.h"
@@ -90,6 +93,8 @@ static inline void DetectRunGetRuleGroup(const DetectEngineCtx *de_ctx,
         Packet * const p, Flow * const pflow, DetectRunScratchpad *scratch);
 static inline void DetectRunPrefilterPkt(ThreadVars *tv, const DetectEngineCtx *de_ctx,
         DetectEngineThreadCtx *det_ctx, Packet *p, DetectRunScratchpad *scratch);
+static inline uint64_t DetectRunPktDigest(
+        const Packet *p, const Flow *pflow, const DetectRunScratchpad *scratch);
 static inline uint8_t DetectRulePacketRules(ThreadVars *const tv,
         const DetectEngineCtx *const de_ctx, DetectEngineThreadCtx *const det_ctx, Packet *const p,
         Flow *const pflow, const DetectRunScratchpad *scratch);
@@ -128,6 +133,7 @@ static void DetectRun(ThreadVars *th_v,
 
     /* get our rule group */
     DetectRunGetRuleGroup(de_ctx, p, pflow, &scratch);
+    DetectPcreHsRuleGroupSet(det_ctx, scratch.sgh);
     /* if we didn't get a sig group head, we
      * have nothing to do.... */
     if (scratch.sgh == NULL) {
@@ -135,13 +141,29 @@ static void DetectRun(ThreadVars *th_v,
         goto end;
     }
 
-    /* run the prefilters for packets */
-    DetectRunPrefilterPkt(th_v, de_ctx, det_ctx, p, &scratch);
+    uint8_t pkt_policy = 0;
+    const uint64_t pkt_digest = DetectRunPktDigest(p, pflow, &scratch);
+    const int pkt_digest_dir = (p->flowflags & FLOW_PKT_TOCLIENT) != 0;
+    if (pkt_digest != 0 && pflow->pkt_digest[pkt_digest_dir] == pkt_digest) {
+        /* the packet rules didn't match a packet like this one before */
+        SCLogDebug("packet %" PRIu64 ": skipping packet rules, digest %" PRIx64, p->pcap_cnt,
+                pkt_digest);
+        PacketCreateMask(p, &p->sig_mask, scratch.alproto, scratch.app_decoder_events);
+        StatsIncr(th_v, det_ctx->counter_pkt_digest_skip);
+    } else {
+        /* run the prefilters for packets */
+        DetectRunPrefilterPkt(th_v, de_ctx, det_ctx, p, &scratch);
 
-    PACKET_PROFILING_DETECT_START(p, PROF_DETECT_RULES);
-    /* inspect the rules against the packet */
-    const uint8_t pkt_policy = DetectRulePacketRules(th_v, de_ctx, det_ctx, p, pflow, &scratch);
-    PACKET_PROFILING_DETECT_END(p, PROF_DETECT_RULES);
+        const uint16_t alert_cnt = det_ctx->alert_queue_size;
+        PACKET_PROFILING_DETECT_START(p, PROF_DETECT_RULES);
+        /* inspect the rules against the packet */
+        pkt_policy = DetectRulePacketRules(th_v, de_ctx, det_ctx, p, pflow, &scratch);
+        PACKET_PROFILING_DETECT_END(p, PROF_DETECT_RULES);
+
+        if (pkt_digest != 0 && det_ctx->alert_queue_size == alert_cnt) {
+            pflow->pkt_digest[pkt_digest_dir] = pkt_digest;
+        }
+    }
 
     /* Only FW rules will already have set the action, IDS rules go through PacketAlertFinalize
      *
@@ -223,6 +245,7 @@ static void DetectRunPacketHook(ThreadVars *th_v, const DetectEngineCtx *de_ctx,
 
     DetectRunScratchpad scratch = DetectRunSetup(de_ctx, det_ctx, p, pflow, ACTION_ACCEPT);
     scratch.sgh = sgh;
+    DetectPcreHsRuleGroupSet(det_ctx, scratch.sgh);
 
     /* if we didn't get a sig group head, we
      * have nothing to do.... */
@@ -301,24 +324,14 @@ const SigGroupHead *SigMatchSignaturesGetSgh(const DetectEngineCtx *de_ctx,
 
     int proto = PacketGetIPProto(p);
     if (proto == IPPROTO_TCP) {
-        DetectPort *list = de_ctx->flow_gh[dir].tcp;
-        SCLogDebug("tcp toserver %p, tcp toclient %p: going to use %p", de_ctx->flow_gh[1].tcp,
-                de_ctx->flow_gh[0].tcp, de_ctx->flow_gh[dir].tcp);
         const uint16_t port = dir ? p->dp : p->sp;
         SCLogDebug("tcp port %u -> %u:%u", port, p->sp, p->dp);
-        DetectPort *sghport = DetectPortLookupGroup(list, port);
-        if (sghport != NULL)
-            sgh = sghport->sh;
-        SCLogDebug("TCP list %p, port %u, direction %s, sghport %p, sgh %p", list, port,
-                dir ? "toserver" : "toclient", sghport, sgh);
+        sgh = DetectPortLookupTableGet(&de_ctx->flow_gh[dir].tcp_table, port);
+        SCLogDebug("TCP port %u, direction %s, sgh %p", port, dir ? "toserver" : "toclient", sgh);
     } else if (proto == IPPROTO_UDP) {
-        DetectPort *list = de_ctx->flow_gh[dir].udp;
-        uint16_t port = dir ? p->dp : p->sp;
-        DetectPort *sghport = DetectPortLookupGroup(list, port);
-        if (sghport != NULL)
-            sgh = sghport->sh;
-        SCLogDebug("UDP list %p, port %u, direction %s, sghport %p, sgh %p", list, port,
-                dir ? "toserver" : "toclient", sghport, sgh);
+        const uint16_t port = dir ? p->dp : p->sp;
+        sgh = DetectPortLookupTableGet(&de_ctx->flow_gh[dir].udp_table, port);
+        SCLogDebug("UDP port %u, direction %s, sgh %p", port, dir ? "toserver" : "toclient", sgh);
     } else {
         sgh = de_ctx->flow_gh[dir].sgh[proto];
     }
@@ -609,6 +622,64 @@ static inline void DetectRunPrefilterPkt(ThreadVars *tv, const DetectEngineCtx *
     }
 }
 
+/** \internal
+ *  \brief get the packet rule digest for a packet
+ *
+ *  The digest holds the packet properties the packet rules of a rule group
+ *  with SIG_GROUP_HEAD_PKT_DIGEST can depend on. Everything else they look
+ *  at is fixed for a flow direction: addresses, ports and the rule group.
+ *  Flowbit changes and rule reloads clear the digest stored in the flow.
+ *
+ *  \retval digest non-zero digest, or 0 if the packet is not eligible
+ */
+static inline uint64_t DetectRunPktDigest(
+        const Packet *p, const Flow *pflow, const DetectRunScratchpad *scratch)
+{
+    if (pflow == NULL || !(scratch->sgh->flags & SIG_GROUP_HEAD_PKT_DIGEST))
+        return 0;
+    if (PKT_IS_PSEUDOPKT(p) || p->payload_len > 0 || PacketGetIPProto(p) != pflow->proto)
+        return 0;
+    if (p->flags & (PKT_DETECT_HAS_STREAMDATA | PKT_IS_FRAGMENT | PKT_REBUILT_FRAGMENT))
+        return 0;
+    if (p->events.cnt > 0 || scratch->app_decoder_events ||
+            (p->app_layer_events != NULL && p->app_layer_events->cnt))
+        return 0;
+    if (EngineModeIsFirewall())
+        return 0;
+
+    uint8_t ttl = 0;
+    if (PacketIsIPv4(p)) {
+        ttl = IPV4_GET_RAW_IPTTL(PacketGetIPv4(p));
+    } else if (PacketIsIPv6(p)) {
+        ttl = IPV6_GET_RAW_HLIM(PacketGetIPv6(p));
+    }
+    uint8_t l4[3] = { 0, 0, 0 };
+    if (PacketIsTCP(p)) {
+        l4[0] = PacketGetTCP(p)->th_flags;
+    } else if (PacketIsICMPv4(p)) {
+        l4[1] = p->icmp_s.type;
+        l4[2] = p->icmp_s.code;
+    } else if (PacketIsICMPv6(p)) {
+        const ICMPV6Hdr *icmpv6h = PacketGetICMPv6(p);
+        l4[1] = ICMPV6_GET_TYPE(icmpv6h);
+        l4[2] = ICMPV6_GET_CODE(icmpv6h);
+    }
+    /* top bit keeps the digest non-zero */
+    uint8_t state = BIT_U8(7);
+    if (p->flags & PKT_STREAM_ADD)
+        state |= BIT_U8(0);
+    if (p->flags & PKT_STREAM_EST)
+        state |= BIT_U8(1);
+    if (p->flags & PKT_NOPAYLOAD_INSPECTION)
+        state |= BIT_U8(2);
+    if (pflow->flowvar != NULL)
+        state |= BIT_U8(3);
+
+    return (uint64_t)l4[0] | (uint64_t)l4[1] << 8 | (uint64_t)l4[2] << 16 | (uint64_t)ttl << 24 |
+           (uint64_t)p->flowflags << 32 | (uint64_t)state << 40 |
+           (uint64_t)scratch->alproto << 48;
+}
+
 /** \internal
  *  \brief check if the tx whose id is given is the only one
  *  live transaction for the flow in the given direction
@@ -982,12 +1053,15 @@ static DetectRunScratchpad DetectRunSetup(const DetectEngineCtx *de_ctx,
             pflow->flags &= ~FLOW_SGH_TOCLIENT;
             pflow->sgh_toserver = NULL;
             pflow->sgh_toclient = NULL;
+            pflow->pkt_digest[0] = pflow->pkt_digest[1] = 0;
 
             pflow->de_ctx_version = de_ctx->version;
             GenericVarFree(pflow->flowvar);
             pflow->flowvar = NULL;
 
             DetectEngineStateResetTxs(pflow);
+            if (pflow->alproto == ALPROTO_HTTP1 && pflow->alstate != NULL)
+                HTPStateResetBodyMpmScanned(pflow->alstate);
         }
 
         /* Retrieve the app layer state and protocol and the tcp reassembled
@@ -1196,6 +1270,7 @@ static bool DetectRunTxInspectRule(ThreadVars *tv,
     bool retval = false;
     bool mpm_before_progress = false;   // is mpm engine before progress?
     bool mpm_in_progress = false;       // is mpm engine in a buffer we will revisit?
+    bool mpm_stream_in_progress = false; // mpm engine in a buffer we only scan new data of
 
     TRACE_SID_TXS(s->id, tx, "starting %s", direction ? "toclient" : "toserver");
 
@@ -1251,6 +1326,14 @@ static bool DetectRunTxInspectRule(ThreadVars *tv,
                             "mpm_before_progress",
                             tx->tx_progress, engine->progress);
                     mpm_before_progress = true;
+                } else if (tx->tx_progress == engine->progress && engine->mpm_stream) {
+                    /* mpm won't see the current data again, so we need to
+                     * keep state to revisit the sig */
+                    TRACE_SID_TXS(s->id, tx,
+                            "engine->mpm: t->tx_progress %u == engine->progress %u, so set "
+                            "mpm_stream_in_progress",
+                            tx->tx_progress, engine->progress);
+                    mpm_stream_in_progress = true;
                 } else if (tx->tx_progress == engine->progress) {
                     TRACE_SID_TXS(s->id, tx,
                             "engine->mpm: t->tx_progress %u == engine->progress %u, so set "
@@ -1380,7 +1463,7 @@ static bool DetectRunTxInspectRule(ThreadVars *tv,
         } else if ((inspect_flags & DE_STATE_FLAG_FULL_INSPECT) == 0 && mpm_in_progress) {
             TRACE_SID_TXS(s->id, tx, "no need to store no-match sig, "
                     "mpm will revisit it");
-        } else if (inspect_flags != 0 || file_no_match != 0) {
+        } else if (inspect_flags != 0 || file_no_match != 0 || mpm_stream_in_progress) {
             TRACE_SID_TXS(s->id, tx, "storing state: flags %08x", inspect_flags);
             DetectRunStoreStateTx(scratch->sgh, f, tx->tx_ptr, tx->tx_id, s,
                     inspect_flags, flow_flags, file_no_match);
@@ -365,6 +365,10 @@ typedef struct SigMatch_ {
 typedef struct SigMatchData_ {
     uint16_t type;   /**< match type */
     bool is_last;    /**< Last element of the list */
+    /** specialized content inspection routine for the list starting
+     *  here (DetectContentInspectionFastPath), only set on the first
+     *  element */
+    uint8_t ci_fast;
     SigMatchCtx *ctx; /**< plugin specific data */
 } SigMatchData;
 
@@ -421,6 +425,8 @@ typedef struct DetectEngineAppInspectionEngine_ {
     bool stream;
     /** will match on a NULL buffer (so an absent buffer) */
     bool match_on_null;
+    /** mpm engine on a buffer where the prefilter only scans new data */
+    bool mpm_stream;
     uint16_t sm_list;
     uint16_t sm_list_base; /**< base buffer being transformed */
     int16_t progress;
@@ -456,6 +462,7 @@ typedef struct DetectBufferType_ {
     bool frame;  /**< is about Frame inspection */
     bool supports_transforms;
     bool multi_instance; /**< buffer supports multiple buffer instances per tx */
+    bool mpm_stream;     /**< prefilter can scan only the new data of the buffer */
     void (*SetupCallback)(const struct DetectEngineCtx_ *, struct Signature_ *);
     bool (*ValidateCallback)(
             const struct Signature_ *, const char **sigerror, const struct DetectBufferType_ *);
@@ -858,9 +865,20 @@ typedef struct DetectEngineIPOnlyCtx_ {
     uint32_t sig_mapping_size;
 } DetectEngineIPOnlyCtx;
 
+/** port groups of a DetectEngineLookupFlow list flattened into sorted
+ *  arrays, so the rule group can be found with a binary search */
+typedef struct DetectPortLookupTable_ {
+    uint32_t cnt;
+    uint16_t *port;  /**< low port of each group, sorted */
+    uint16_t *port2; /**< high port of each group */
+    struct SigGroupHead_ **sh;
+} DetectPortLookupTable;
+
 typedef struct DetectEngineLookupFlow_ {
     DetectPort *tcp;
     DetectPort *udp;
+    DetectPortLookupTable tcp_table;
+    DetectPortLookupTable udp_table;
     struct SigGroupHead_ *sgh[256];
 } DetectEngineLookupFlow;
 
@@ -978,6 +996,10 @@ typedef struct DetectEngineCtx_ {
     /* force app-layer tx finding for alerts with signatures not having app-layer keywords */
     bool guess_applayer;
 
+    /* skip the packet rules for payloadless packets that have been evaluated
+     * already in the flow, see SIG_GROUP_HEAD_PKT_DIGEST */
+    bool pkt_digest;
+
     /* registration id for per thread ctx for the filemagic/file.magic keywords */
     int filemagic_thread_ctx_id;
 
@@ -985,6 +1007,9 @@ typedef struct DetectEngineCtx_ {
      * later used to construct thread context for each thread. */
     SpmGlobalThreadCtx *spm_global_thread_ctx;
 
+    /* hyperscan databases of the pcre keywords, built with the rule groups */
+    struct DetectPcreHsCtx_ *pcre_hs_ctx;
+
     /* Config options */
 
     uint16_t max_uniq_toclient_groups;
@@ -1062,6 +1087,8 @@ typedef struct DetectEngineCtx_ {
 
     /** are we using just mpm or also other prefilters */
     enum DetectEnginePrefilterSetting prefilter_setting;
+    /** scan only the new data of streaming buffers in the prefilter */
+    bool prefilter_stream;
 
     HashListTable *dport_hash_table;
 
@@ -1275,6 +1302,10 @@ typedef struct DetectEngineThreadCtx_ {
      * prototype held by DetectEngineCtx. */
     SpmThreadCtx *spm_thread_ctx;
 
+    /** hyperscan scratch and scan results for the pcre keywords. NULL if
+     *  there are no pcre hyperscan databases. */
+    struct DetectPcreHsThreadCtx_ *pcre_hs;
+
     /* byte_* values */
     uint64_t *byte_values;
 
@@ -1291,6 +1322,8 @@ typedef struct DetectEngineThreadCtx_ {
     uint16_t counter_alerts_overflow;
     /** id for suppressed alerts counter */
     uint16_t counter_alerts_suppressed;
+    /** id for packets that skipped the packet rules by digest */
+    uint16_t counter_pkt_digest_skip;
 #ifdef PROFILING
     uint16_t counter_mpm_list;
     uint16_t counter_match_list;
@@ -1491,6 +1524,8 @@ enum {
 // vacancy
 #define SIG_GROUP_HEAD_HAVEFILESHA1   BIT_U16(4)
 #define SIG_GROUP_HEAD_HAVEFILESHA256 BIT_U16(5)
+/** packet rules only depend on what is in the packet rule digest */
+#define SIG_GROUP_HEAD_PKT_DIGEST BIT_U16(6)
 
 enum MpmBuiltinBuffers {
     MPMB_TCP_PKT_TS,
@@ -1640,6 +1675,9 @@ typedef struct SigGroupHead_ {
     PrefilterEngine *frame_engines;
     PrefilterEngine *post_rule_match_engines; /**< engines to run after rules modified a state */
 
+    /** hyperscan databases of the pcre keywords, see detect-pcre-hs.c */
+    struct DetectPcreHsRuleGroup_ *pcre_hs;
+
     /* ptr to our init data we only use at... init :) */
     SigGroupHeadInitData *init;
 
@@ -71,6 +71,8 @@ static int FlowBitAdd(Flow *f, uint32_t idx)
         fb->idx = idx;
         fb->next = NULL;
         GenericVarAppend(&f->flowvar, (GenericVar *)fb);
+        /* packet rules may check the flowbit, so forget what we know */
+        f->pkt_digest[0] = f->pkt_digest[1] = 0;
         return 1;
     } else {
         return 0;
@@ -85,6 +87,7 @@ static void FlowBitRemove(Flow *f, uint32_t idx)
 
     GenericVarRemove(&f->flowvar, (GenericVar *)fb);
     FlowBitFree(fb);
+    f->pkt_digest[0] = f->pkt_digest[1] = 0;
 }
 
 /** \brief add a flowbit to the flow
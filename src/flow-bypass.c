@@ -114,15 +114,12 @@ static TmEcode BypassedFlowManager(ThreadVars *th_v, void *thread_data)
         }
 
         if (TmThreadsCheckFlag(th_v, THV_KILL)) {
-            StatsSyncCounters(th_v);
             return TM_ECODE_OK;
         }
         for (i = 0; i < FLOW_BYPASS_DELAY * 100; i++) {
             if (TmThreadsCheckFlag(th_v, THV_KILL)) {
-                StatsSyncCounters(th_v);
                 return TM_ECODE_OK;
             }
-            StatsSyncCountersIfSignalled(th_v);
             SleepMsec(10);
         }
     }
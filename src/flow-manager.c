@@ -960,7 +960,6 @@ static TmEcode FlowManager(ThreadVars *th_v, void *thread_data)
         }
 
         if (TmThreadsCheckFlag(th_v, THV_KILL)) {
-            StatsSyncCounters(th_v);
             break;
         }
 
@@ -990,8 +989,6 @@ static TmEcode FlowManager(ThreadVars *th_v, void *thread_data)
         }
 
         SCLogDebug("woke up... %s", SC_ATOMIC_GET(flow_flags) & FLOW_EMERGENCY ? "emergency":"");
-
-        StatsSyncCountersIfSignalled(th_v);
     }
     return TM_ECODE_OK;
 }
@@ -1170,10 +1167,7 @@ static TmEcode FlowRecycler(ThreadVars *th_v, void *thread_data)
         }
 
         SCLogDebug("woke up...");
-
-        StatsSyncCountersIfSignalled(th_v);
     }
-    StatsSyncCounters(th_v);
     SCLogPerf("%"PRIu64" flows processed", recycled_cnt);
     return TM_ECODE_OK;
 }
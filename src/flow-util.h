@@ -68,6 +68,8 @@
         (f)->alstate = NULL;                                                                       \
         (f)->sgh_toserver = NULL;                                                                  \
         (f)->sgh_toclient = NULL;                                                                  \
+        (f)->pkt_digest[0] = 0;                                                                    \
+        (f)->pkt_digest[1] = 0;                                                                    \
         (f)->flowvar = NULL;                                                                       \
         RESET_COUNTERS((f));                                                                       \
     } while (0)
@@ -111,6 +113,8 @@
         (f)->thread_id[1] = 0;                                                                     \
         (f)->sgh_toserver = NULL;                                                                  \
         (f)->sgh_toclient = NULL;                                                                  \
+        (f)->pkt_digest[0] = 0;                                                                    \
+        (f)->pkt_digest[1] = 0;                                                                    \
         GenericVarFree((f)->flowvar);                                                              \
         (f)->flowvar = NULL;                                                                       \
         RESET_COUNTERS((f));                                                                       \
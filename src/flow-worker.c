@@ -46,6 +46,7 @@
 #include "app-layer-frames.h"
 
 #include "util-profiling.h"
+#include "util-latency.h"
 #include "util-validate.h"
 #include "util-time.h"
 #include "tmqh-packetpool.h"
@@ -355,6 +356,20 @@ static inline void UpdateCounters(ThreadVars *tv,
     }
 }
 
+/** \internal
+ *  \brief run detection, timing it if the packet is sampled for latency */
+static inline void FlowWorkerDetect(ThreadVars *tv, Packet *p, DetectEngineThreadCtx *det_ctx)
+{
+    if (unlikely(SCLatencyIsSampled(tv))) {
+        const uint64_t start = UtilCpuGetTicks();
+        Detect(tv, p, det_ctx);
+        SCLatencyRecordDetect(
+                tv, p->flow ? p->flow->alproto : ALPROTO_UNKNOWN, UtilCpuGetTicks() - start);
+    } else {
+        Detect(tv, p, det_ctx);
+    }
+}
+
 /** \brief update stream engine
  *
  *  We can be called from both the flow timeout path as well as from the
@@ -400,7 +415,7 @@ static inline void FlowWorkerStreamTCPUpdate(ThreadVars *tv, FlowWorkerThreadDat
 
         if (det_ctx != NULL) {
             FLOWWORKER_PROFILING_START(x, PROFILE_FLOWWORKER_DETECT);
-            Detect(tv, x, det_ctx);
+            FlowWorkerDetect(tv, x, det_ctx);
             FLOWWORKER_PROFILING_END(x, PROFILE_FLOWWORKER_DETECT);
         }
 
@@ -449,7 +464,7 @@ static void FlowWorkerFlowTimeout(
     SCLogDebug("packet %"PRIu64" calling Detect", p->pcap_cnt);
     if (det_ctx != NULL) {
         FLOWWORKER_PROFILING_START(p, PROFILE_FLOWWORKER_DETECT);
-        Detect(tv, p, det_ctx);
+        FlowWorkerDetect(tv, p, det_ctx);
         FLOWWORKER_PROFILING_END(p, PROFILE_FLOWWORKER_DETECT);
     }
 
@@ -664,7 +679,7 @@ static TmEcode FlowWorker(ThreadVars *tv, Packet *p, void *data)
     SCLogDebug("packet %"PRIu64" calling Detect", p->pcap_cnt);
     if (det_ctx != NULL) {
         FLOWWORKER_PROFILING_START(p, PROFILE_FLOWWORKER_DETECT);
-        Detect(tv, p, det_ctx);
+        FlowWorkerDetect(tv, p, det_ctx);
         FLOWWORKER_PROFILING_END(p, PROFILE_FLOWWORKER_DETECT);
     }
 
@@ -821,3 +836,67 @@ void TmModuleFlowWorkerRegister (void)
     tmm_modules[TMM_FLOWWORKER].cap_flags = 0;
     tmm_modules[TMM_FLOWWORKER].flags = TM_FLAG_FLOWWORKER_TM;
 }
+
+#ifdef UNITTESTS
+#include "util-unittest.h"
+#include "util-unittest-helper.h"
+#include "detect-parse.h"
+#include "detect-engine-build.h"
+#include "detect-engine-alert.h"
+
+/** \test detection of a sampled packet runs Detect and is timed */
+static int FlowWorkerTestDetectLatency01(void)
+{
+    ThreadVars tv;
+    memset(&tv, 0, sizeof(tv));
+    DetectEngineThreadCtx *det_ctx = NULL;
+
+    SCLatencyThreadCtx *lctx = SCCalloc(1, sizeof(*lctx));
+    FAIL_IF_NULL(lctx);
+    lctx->app = SCCalloc(g_alproto_max, sizeof(SCLatencyHistogram *));
+    FAIL_IF_NULL(lctx->app);
+    lctx->detect_app = SCCalloc(g_alproto_max, sizeof(SCLatencyHistogram *));
+    FAIL_IF_NULL(lctx->detect_app);
+    tv.latency_ctx = lctx;
+
+    DetectEngineCtx *de_ctx = DetectEngineCtxInit();
+    FAIL_IF_NULL(de_ctx);
+    de_ctx->flags |= DE_QUIET;
+    FAIL_IF_NULL(DetectEngineAppendSig(de_ctx, "alert ip any any -> any any (sid:1;)"));
+    SigGroupBuild(de_ctx);
+    DetectEngineThreadCtxInit(&tv, (void *)de_ctx, (void *)&det_ctx);
+
+    Packet *p = UTHBuildPacket(NULL, 0, IPPROTO_TCP);
+    FAIL_IF_NULL(p);
+
+    /* sampled: detection runs and is added to the histogram */
+    lctx->sampled = true;
+    FlowWorkerDetect(&tv, p, det_ctx);
+    FAIL_IF_NOT(PacketAlertCheck(p, 1));
+    FAIL_IF_NULL(lctx->detect);
+    FAIL_IF_NOT(lctx->detect->count == 1);
+    /* no flow: counted as unknown app-layer protocol */
+    FAIL_IF_NULL(lctx->detect_app[ALPROTO_UNKNOWN]);
+    FAIL_IF_NOT(lctx->detect_app[ALPROTO_UNKNOWN]->count == 1);
+
+    /* not sampled: detection runs, nothing recorded */
+    p->alerts.cnt = 0;
+    lctx->sampled = false;
+    FlowWorkerDetect(&tv, p, det_ctx);
+    FAIL_IF_NOT(PacketAlertCheck(p, 1));
+    FAIL_IF_NOT(lctx->detect->count == 1);
+
+    UTHFreePackets(&p, 1);
+    DetectEngineThreadCtxDeinit(&tv, det_ctx);
+    DetectEngineCtxFree(de_ctx);
+    SCLatencyThreadFree(&tv);
+    PASS;
+}
+#endif /* UNITTESTS */
+
+void FlowWorkerRegisterTests(void)
+{
+#ifdef UNITTESTS
+    UtRegisterTest("FlowWorkerTestDetectLatency01", FlowWorkerTestDetectLatency01);
+#endif
+}
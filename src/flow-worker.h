@@ -37,5 +37,6 @@ bool FlowWorkerGetFlushAck(void *flow_worker);
 void FlowWorkerSetFlushAck(void *flow_worker);
 
 void TmModuleFlowWorkerRegister (void);
+void FlowWorkerRegisterTests(void);
 
 #endif /* SURICATA_FLOW_WORKER_H */
@@ -265,6 +265,7 @@ void FlowSwap(Flow *f)
     /* not touching Flow::alparser and Flow::alstate */
 
     SWAP_VARS(const void *, f->sgh_toclient, f->sgh_toserver);
+    SWAP_VARS(uint64_t, f->pkt_digest[0], f->pkt_digest[1]);
 
     SWAP_VARS(uint32_t, f->todstpktcnt, f->tosrcpktcnt);
     SWAP_VARS(uint64_t, f->todstbytecnt, f->tosrcbytecnt);
@@ -476,6 +476,9 @@ typedef struct Flow_
     /** toserver sgh for this flow. Only use when FLOW_SGH_TOSERVER flow flag
      *  has been set. */
     const struct SigGroupHead_ *sgh_toserver;
+    /** packet rule digest of the last payloadless packet that didn't match
+     *  any packet rule, per direction: 0 toserver, 1 toclient. 0 if unset. */
+    uint64_t pkt_digest[2];
 
     /* pointer to the var list */
     GenericVar *flowvar;
@@ -241,6 +241,8 @@ static OutputInitResult LogTlsLogInitCtx(SCConfNode *conf)
 
     /* Enable the logger for the app layer */
     SCAppLayerParserRegisterLogger(IPPROTO_TCP, ALPROTO_TLS);
+    SSLEnableCertDecoding();
+    SSLEnableCertFingerprint();
 
     result.ctx = output_ctx;
     result.ok = true;
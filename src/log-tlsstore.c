@@ -428,6 +428,9 @@ static OutputInitResult LogTlsStoreLogInitCtx(SCConfNode *conf)
 
     /* enable the logger for the app layer */
     SCAppLayerParserRegisterLogger(IPPROTO_TCP, ALPROTO_TLS);
+    /* the meta file has the subject, issuer and fingerprint */
+    SSLEnableCertDecoding();
+    SSLEnableCertFingerprint();
 
     result.ctx = output_ctx;
     result.ok = true;
@@ -25,10 +25,15 @@
 #include "output.h"
 #include "output-json-file.h"
 
+#include "runmodes.h"
+#include "tm-threads.h"
+
 #include "util-conf.h"
 #include "util-misc.h"
 #include "util-path.h"
 #include "util-print.h"
+#include "util-privs.h"
+#include "util-time.h"
 
 #define MODULE_NAME "OutputFilestore"
 
@@ -45,19 +50,93 @@ static const char *default_log_dir = "filestore";
 /* Atomic counter of simultaneously open files. */
 static SC_ATOMIC_DECLARE(uint32_t, filestore_open_file_cnt);
 
+/* Default settings of the asynchronous writer. */
+#define FILESTORE_WRITER_THREADS_MAX  16
+#define FILESTORE_WRITER_QUEUE_SIZE   (64 * 1024 * 1024)
+#define FILESTORE_WRITER_DEDUP_SIZE   (1024 * 1024)
+#define FILESTORE_WRITER_HASH_SIZE    1024
+
+enum FilestoreJobType {
+    FILESTORE_JOB_OPEN,
+    FILESTORE_JOB_DATA,
+    FILESTORE_JOB_CLOSE,
+    FILESTORE_JOB_ABORT,
+};
+
+/** work item handed from the packet threads to a writer thread */
+typedef struct FilestoreJob_ {
+    struct FilestoreJob_ *next;
+    uint32_t file_store_id;
+    uint8_t type;
+    uint8_t sha256[SC_SHA256_LEN]; /**< CLOSE: digest used as the file name */
+    uint64_t ts;                   /**< CLOSE: packet time in seconds, for the fileinfo name */
+    uint32_t len;
+    uint8_t data[];                /**< DATA: file data, CLOSE: fileinfo record */
+} FilestoreJob;
+
+/** file being written by a writer thread */
+typedef struct FilestoreWriterFile_ {
+    struct FilestoreWriterFile_ *next;
+    uint32_t file_store_id;
+    int fd;
+    /** the temporary file was created. If not, the data is still in
+     *  'buf_head' so it doesn't need to be written if the file turns
+     *  out to be stored already. */
+    bool on_disk;
+    uint32_t buf_len;
+    FilestoreJob *buf_head;
+    FilestoreJob *buf_tail;
+} FilestoreWriterFile;
+
+typedef struct FilestoreWriterQueue_ {
+    SCCtrlMutex mutex;
+    SCCtrlCondT cond;       /**< signaled when jobs are queued */
+    SCCtrlCondT space_cond; /**< broadcast when the writer released queued data */
+    FilestoreJob *head;
+    FilestoreJob *tail;
+    /** file data queued or held back for deduplication by the writer
+     *  thread, limited by queue_size */
+    SC_ATOMIC_DECLARE(uint64_t, bytes);
+    /** part of 'bytes' held back for deduplication, limited to half of
+     *  queue_size so the queue can't fill up with incomplete files */
+    SC_ATOMIC_DECLARE(uint64_t, buffered);
+
+    /* only used by the writer thread */
+    FilestoreWriterFile *files[FILESTORE_WRITER_HASH_SIZE];
+} FilestoreWriterQueue;
+
+typedef struct FilestoreWriter_ {
+    const struct OutputFilestoreCtx_ *ctx;
+    uint32_t threads;
+    bool drop;           /**< drop files instead of waiting if the queue is full */
+    uint32_t dedup_size; /**< max size of a file kept in memory until it's closed */
+    uint64_t queue_size; /**< max file data queued per writer thread */
+    FilestoreWriterQueue *queues;
+    SC_ATOMIC_DECLARE(uint32_t, thread_id);
+} FilestoreWriter;
+
 typedef struct OutputFilestoreCtx_ {
     char prefix[FILESTORE_PREFIX_MAX];
     char tmpdir[FILESTORE_PREFIX_MAX];
     bool fileinfo;
     HttpXFFCfg *xff_cfg;
+    FilestoreWriter *writer; /**< NULL if files are written by the packet threads */
 } OutputFilestoreCtx;
 
 typedef struct OutputFilestoreLogThread_ {
     OutputFilestoreCtx *ctx;
     uint16_t counter_max_hits;
     uint16_t fs_error_counter;
+    uint16_t counter_writer_queue_full;
+    uint16_t counter_writer_drops;
 } OutputFilestoreLogThread;
 
+/* Writer used by the writer threads. There can be only one filestore. */
+static FilestoreWriter *g_filestore_writer = NULL;
+
+static SC_ATOMIC_DECLARE(uint64_t, filestore_writer_dedup_cnt);
+static SC_ATOMIC_DECLARE(uint64_t, filestore_writer_fs_errors);
+
 enum WarnOnceTypes {
     WOT_OPEN,
     WOT_WRITE,
@@ -122,66 +201,758 @@ static void OutputFilestoreUpdateFileTime(const char *src_filename,
     }
 }
 
-static void OutputFilestoreFinalizeFiles(ThreadVars *tv, const OutputFilestoreLogThread *oft,
-        const OutputFilestoreCtx *ctx, const Packet *p, File *ff, void *tx, const uint64_t tx_id,
-        uint8_t dir)
+static void OutputFilestoreTmpFilename(
+        const OutputFilestoreCtx *ctx, const uint32_t file_store_id, char *out, size_t out_size)
+{
+    snprintf(out, out_size, "%s/file.%u", ctx->tmpdir, file_store_id);
+}
+
+static void OutputFilestoreFinalFilename(
+        const OutputFilestoreCtx *ctx, const uint8_t *sha256, char *out, size_t out_size)
 {
     /* Stringify the SHA256 which will be used in the final
      * filename. */
     char sha256string[(SC_SHA256_LEN * 2) + 1];
-    PrintHexString(sha256string, sizeof(sha256string), ff->sha256,
-            sizeof(ff->sha256));
+    PrintHexString(sha256string, sizeof(sha256string), (uint8_t *)sha256, SC_SHA256_LEN);
 
-    char tmp_filename[PATH_MAX] = "";
-    snprintf(tmp_filename, sizeof(tmp_filename), "%s/file.%u", ctx->tmpdir,
-            ff->file_store_id);
-
-    char final_filename[PATH_MAX] = "";
-    snprintf(final_filename, sizeof(final_filename), "%s/%c%c/%s",
-            ctx->prefix, sha256string[0], sha256string[1], sha256string);
+    snprintf(out, out_size, "%s/%c%c/%s", ctx->prefix, sha256string[0], sha256string[1],
+            sha256string);
+}
 
+/**
+ * \brief Move a temporary file to its final location.
+ *
+ * If the final file exists already, the temporary file is removed and
+ * the timestamps of the final file are updated.
+ *
+ * \param errors incremented for each file system error
+ * \retval true if the final file is in place
+ */
+static bool OutputFilestoreMoveFile(
+        const char *tmp_filename, const char *final_filename, uint32_t *errors)
+{
     if (SCPathExists(final_filename)) {
         OutputFilestoreUpdateFileTime(tmp_filename, final_filename);
         if (unlink(tmp_filename) != 0) {
-            StatsIncr(tv, oft->fs_error_counter);
+            (*errors)++;
             WARN_ONCE(WOT_UNLINK, "Failed to remove temporary file %s: %s", tmp_filename,
                     strerror(errno));
         }
     } else if (rename(tmp_filename, final_filename) != 0) {
-        StatsIncr(tv, oft->fs_error_counter);
+        (*errors)++;
         WARN_ONCE(WOT_RENAME, "Failed to rename %s to %s: %s", tmp_filename, final_filename,
                 strerror(errno));
         if (unlink(tmp_filename) != 0) {
             /* Just increment, don't log as has_fs_errors would
              * already be set above. */
-            StatsIncr(tv, oft->fs_error_counter);
+            (*errors)++;
         }
+        return false;
+    }
+    return true;
+}
+
+static void OutputFilestoreWriteFileinfo(const char *final_filename, const uint64_t ts,
+        const uint32_t file_store_id, const uint8_t *record, const size_t record_len)
+{
+    char js_metadata_filename[PATH_MAX];
+    if (snprintf(js_metadata_filename, sizeof(js_metadata_filename), "%s.%" PRIuMAX ".%u.json",
+                final_filename, (uintmax_t)ts,
+                file_store_id) == (int)sizeof(js_metadata_filename)) {
+        WARN_ONCE(WOT_SNPRINTF, "Failed to write file info record. Output filename truncated.");
+        return;
+    }
+    FILE *out = fopen(js_metadata_filename, "w");
+    if (out != NULL) {
+        fwrite(record, record_len, 1, out);
+        fclose(out);
+    }
+}
+
+static void OutputFilestoreFinalizeFiles(ThreadVars *tv, const OutputFilestoreLogThread *oft,
+        const OutputFilestoreCtx *ctx, const Packet *p, File *ff, void *tx, const uint64_t tx_id,
+        uint8_t dir)
+{
+    char tmp_filename[PATH_MAX] = "";
+    OutputFilestoreTmpFilename(ctx, ff->file_store_id, tmp_filename, sizeof(tmp_filename));
+
+    char final_filename[PATH_MAX] = "";
+    OutputFilestoreFinalFilename(ctx, ff->sha256, final_filename, sizeof(final_filename));
+
+    uint32_t errors = 0;
+    const bool stored = OutputFilestoreMoveFile(tmp_filename, final_filename, &errors);
+    if (errors > 0) {
+        StatsAddUI64(tv, oft->fs_error_counter, errors);
+    }
+    if (!stored) {
         return;
     }
 
     if (ctx->fileinfo) {
-        char js_metadata_filename[PATH_MAX];
-        if (snprintf(js_metadata_filename, sizeof(js_metadata_filename), "%s.%" PRIuMAX ".%u.json",
-                    final_filename, (uintmax_t)SCTIME_SECS(p->ts),
-                    ff->file_store_id) == (int)sizeof(js_metadata_filename)) {
-            WARN_ONCE(WOT_SNPRINTF, "Failed to write file info record. Output filename truncated.");
-        } else {
-            SCJsonBuilder *js_fileinfo =
-                    JsonBuildFileInfoRecord(p, ff, tx, tx_id, true, dir, ctx->xff_cfg, NULL);
+        SCJsonBuilder *js_fileinfo =
+                JsonBuildFileInfoRecord(p, ff, tx, tx_id, true, dir, ctx->xff_cfg, NULL);
+        if (likely(js_fileinfo != NULL)) {
+            SCJbClose(js_fileinfo);
+            OutputFilestoreWriteFileinfo(final_filename, SCTIME_SECS(p->ts), ff->file_store_id,
+                    SCJbPtr(js_fileinfo), SCJbLen(js_fileinfo));
+            SCJbFree(js_fileinfo);
+        }
+    }
+}
+
+/* Asynchronous writer
+ *
+ * The packet threads hand file data to the writer threads through a
+ * queue per writer thread. All jobs of a file go to the same writer
+ * thread, so they are handled in order. Files up to 'dedup-buffer' bytes
+ * are kept in memory until they are closed, so that they are not written
+ * at all if a file with the same SHA256 was stored before.
+ */
+
+static FilestoreJob *FilestoreJobAlloc(
+        const uint8_t type, const uint32_t file_store_id, const uint8_t *data, const uint32_t len)
+{
+    FilestoreJob *job = SCMalloc(sizeof(*job) + len);
+    if (unlikely(job == NULL))
+        return NULL;
+    memset(job, 0, sizeof(*job));
+    job->type = type;
+    job->file_store_id = file_store_id;
+    job->len = len;
+    if (len > 0) {
+        memcpy(job->data, data, len);
+    }
+    return job;
+}
+
+static void FilestoreJobFreeList(FilestoreJob *job)
+{
+    while (job != NULL) {
+        FilestoreJob *next = job->next;
+        SCFree(job);
+        job = next;
+    }
+}
+
+static void FilestoreWriterEnqueue(FilestoreWriterQueue *q, FilestoreJob *job)
+{
+    SCCtrlMutexLock(&q->mutex);
+    if (q->tail != NULL) {
+        q->tail->next = job;
+    } else {
+        q->head = job;
+    }
+    q->tail = job;
+    SCCtrlCondSignal(&q->cond);
+    SCCtrlMutexUnlock(&q->mutex);
+}
+
+/**
+ * \brief Reserve room in the queue for 'len' bytes of file data.
+ *
+ * Waits for the writer thread to make room, unless the writer is set
+ * to drop. A chunk is always accepted if no data is waiting in the queue,
+ * even if it's larger than the queue or the queue is filled by data held
+ * back for deduplication. This way the writer always has work to make
+ * progress on.
+ *
+ * \retval true if the data can be queued
+ */
+static bool FilestoreWriterReserve(ThreadVars *tv, const OutputFilestoreLogThread *aft,
+        const FilestoreWriter *w, FilestoreWriterQueue *q, const uint32_t len)
+{
+    bool waited = false;
+    SCCtrlMutexLock(&q->mutex);
+    while (1) {
+        const uint64_t bytes = SC_ATOMIC_GET(q->bytes);
+        const uint64_t buffered = SC_ATOMIC_GET(q->buffered);
+        if (bytes <= buffered || bytes + len <= w->queue_size)
+            break;
+        if (w->drop) {
+            SCCtrlMutexUnlock(&q->mutex);
+            return false;
+        }
+        if (!waited) {
+            StatsIncr(tv, aft->counter_writer_queue_full);
+            waited = true;
+        }
+        SCCtrlCondWait(&q->space_cond, &q->mutex);
+    }
+    SC_ATOMIC_ADD(q->bytes, len);
+    SCCtrlMutexUnlock(&q->mutex);
+    return true;
+}
+
+/**
+ * \brief Drop a file: have the writer discard what it has of it, and stop
+ *        handing it data.
+ */
+static void FilestoreWriterDropFile(
+        ThreadVars *tv, OutputFilestoreLogThread *aft, FilestoreWriterQueue *q, File *ff)
+{
+    StatsIncr(tv, aft->counter_writer_drops);
+    ff->flags |= FILE_STORE_DROPPED;
+    FilestoreJob *job = FilestoreJobAlloc(FILESTORE_JOB_ABORT, ff->file_store_id, NULL, 0);
+    if (job != NULL) {
+        FilestoreWriterEnqueue(q, job);
+    }
+}
+
+/**
+ * \brief Hand the file data and events to the writer thread of the file.
+ */
+static int OutputFilestoreLoggerAsync(ThreadVars *tv, OutputFilestoreLogThread *aft,
+        const Packet *p, File *ff, void *tx, const uint64_t tx_id, const uint8_t *data,
+        uint32_t data_len, uint8_t flags, uint8_t dir)
+{
+    OutputFilestoreCtx *ctx = aft->ctx;
+    FilestoreWriter *w = ctx->writer;
+    FilestoreWriterQueue *q = &w->queues[ff->file_store_id % w->threads];
+    FilestoreJob *job;
+
+    /* In asynchronous mode the writer threads own the files, File::fd is
+     * not used. Data of a dropped file is no longer handed to the writer. */
+    if (ff->flags & FILE_STORE_DROPPED) {
+        return -1;
+    }
+
+    if (flags & OUTPUT_FILEDATA_FLAG_OPEN) {
+        job = FilestoreJobAlloc(FILESTORE_JOB_OPEN, ff->file_store_id, NULL, 0);
+        if (job == NULL) {
+            StatsIncr(tv, aft->counter_writer_drops);
+            ff->flags |= FILE_STORE_DROPPED;
+            return -1;
+        }
+        FilestoreWriterEnqueue(q, job);
+    }
+
+    if (data != NULL && data_len > 0) {
+        job = NULL;
+        if (FilestoreWriterReserve(tv, aft, w, q, data_len)) {
+            job = FilestoreJobAlloc(FILESTORE_JOB_DATA, ff->file_store_id, data, data_len);
+            if (job == NULL) {
+                SC_ATOMIC_SUB(q->bytes, data_len);
+            }
+        }
+        if (job == NULL) {
+            /* the file is incomplete now */
+            FilestoreWriterDropFile(tv, aft, q, ff);
+            return -1;
+        }
+        FilestoreWriterEnqueue(q, job);
+    }
+
+    if (flags & OUTPUT_FILEDATA_FLAG_CLOSE) {
+        SCJsonBuilder *js_fileinfo = NULL;
+        if (ctx->fileinfo) {
+            js_fileinfo = JsonBuildFileInfoRecord(p, ff, tx, tx_id, true, dir, ctx->xff_cfg, NULL);
             if (likely(js_fileinfo != NULL)) {
                 SCJbClose(js_fileinfo);
-                FILE *out = fopen(js_metadata_filename, "w");
-                if (out != NULL) {
-                    size_t js_len = SCJbLen(js_fileinfo);
-                    fwrite(SCJbPtr(js_fileinfo), js_len, 1, out);
-                    fclose(out);
-                }
-                SCJbFree(js_fileinfo);
             }
         }
+        if (js_fileinfo != NULL) {
+            job = FilestoreJobAlloc(FILESTORE_JOB_CLOSE, ff->file_store_id, SCJbPtr(js_fileinfo),
+                    (uint32_t)SCJbLen(js_fileinfo));
+            SCJbFree(js_fileinfo);
+        } else {
+            job = FilestoreJobAlloc(FILESTORE_JOB_CLOSE, ff->file_store_id, NULL, 0);
+        }
+        if (job == NULL) {
+            FilestoreWriterDropFile(tv, aft, q, ff);
+            return -1;
+        }
+        memcpy(job->sha256, ff->sha256, sizeof(job->sha256));
+        job->ts = (uint64_t)SCTIME_SECS(p->ts);
+        FilestoreWriterEnqueue(q, job);
+    }
+    return 0;
+}
+
+static FilestoreWriterFile *FilestoreWriterFileLookup(
+        FilestoreWriterQueue *q, const uint32_t file_store_id)
+{
+    FilestoreWriterFile *wf = q->files[file_store_id % FILESTORE_WRITER_HASH_SIZE];
+    while (wf != NULL && wf->file_store_id != file_store_id) {
+        wf = wf->next;
+    }
+    return wf;
+}
+
+static void FilestoreWriterFileAdd(FilestoreWriterQueue *q, const uint32_t file_store_id)
+{
+    FilestoreWriterFile *wf = SCCalloc(1, sizeof(*wf));
+    if (unlikely(wf == NULL)) {
+        /* jobs for this file will be ignored */
+        SC_ATOMIC_ADD(filestore_writer_fs_errors, 1);
+        return;
+    }
+    wf->file_store_id = file_store_id;
+    wf->fd = -1;
+    const uint32_t idx = file_store_id % FILESTORE_WRITER_HASH_SIZE;
+    wf->next = q->files[idx];
+    q->files[idx] = wf;
+}
+
+/** \brief free the data held back for deduplication */
+static void FilestoreWriterFileRelease(FilestoreWriterQueue *q, FilestoreWriterFile *wf)
+{
+    FilestoreJobFreeList(wf->buf_head);
+    wf->buf_head = wf->buf_tail = NULL;
+    if (wf->buf_len > 0) {
+        SC_ATOMIC_SUB(q->buffered, wf->buf_len);
+        SC_ATOMIC_SUB(q->bytes, wf->buf_len);
+        wf->buf_len = 0;
+    }
+}
+
+static void FilestoreWriterFileRemove(FilestoreWriterQueue *q, FilestoreWriterFile *wf)
+{
+    FilestoreWriterFile **pwf = &q->files[wf->file_store_id % FILESTORE_WRITER_HASH_SIZE];
+    while (*pwf != wf) {
+        pwf = &(*pwf)->next;
+    }
+    *pwf = wf->next;
+
+    if (wf->fd != -1) {
+        close(wf->fd);
+        SC_ATOMIC_SUB(filestore_open_file_cnt, 1);
+    }
+    FilestoreWriterFileRelease(q, wf);
+    SCFree(wf);
+}
+
+/**
+ * \brief Append data to the temporary file, creating it if needed.
+ *
+ * Like the synchronous logger, the file is kept open if we're below
+ * 'max-open-files' and reopened for each write otherwise.
+ */
+static void FilestoreWriterFileWrite(const OutputFilestoreCtx *ctx, FilestoreWriterFile *wf,
+        const uint8_t *data, const uint32_t len)
+{
+    char filename[PATH_MAX] = "";
+    int file_fd = wf->fd;
+
+    if (file_fd == -1) {
+        OutputFilestoreTmpFilename(ctx, wf->file_store_id, filename, sizeof(filename));
+        if (!wf->on_disk) {
+            file_fd = open(filename, O_CREAT | O_TRUNC | O_NOFOLLOW | O_WRONLY, 0644);
+            if (file_fd == -1) {
+                SC_ATOMIC_ADD(filestore_writer_fs_errors, 1);
+                WARN_ONCE(WOT_OPEN, "Filestore (v2) failed to create %s: %s", filename,
+                        strerror(errno));
+                return;
+            }
+            wf->on_disk = true;
+            if (SC_ATOMIC_GET(filestore_open_file_cnt) < FileGetMaxOpenFiles()) {
+                SC_ATOMIC_ADD(filestore_open_file_cnt, 1);
+                wf->fd = file_fd;
+            }
+        } else {
+            file_fd = open(filename, O_APPEND | O_NOFOLLOW | O_WRONLY);
+            if (file_fd == -1) {
+                SC_ATOMIC_ADD(filestore_writer_fs_errors, 1);
+                WARN_ONCE(WOT_OPEN, "Filestore (v2) failed to open file %s: %s", filename,
+                        strerror(errno));
+                return;
+            }
+        }
+    }
+
+    if (len > 0 && write(file_fd, (const void *)data, (size_t)len) == -1) {
+        OutputFilestoreTmpFilename(ctx, wf->file_store_id, filename, sizeof(filename));
+        SC_ATOMIC_ADD(filestore_writer_fs_errors, 1);
+        WARN_ONCE(WOT_WRITE, "Filestore (v2) failed to write to %s: %s", filename,
+                strerror(errno));
+        if (wf->fd != -1) {
+            SC_ATOMIC_SUB(filestore_open_file_cnt, 1);
+        }
+        wf->fd = -1;
+    }
+    if (wf->fd == -1) {
+        close(file_fd);
+    }
+}
+
+/** \brief write the data held back for deduplication to disk */
+static void FilestoreWriterFileFlush(
+        const OutputFilestoreCtx *ctx, FilestoreWriterQueue *q, FilestoreWriterFile *wf)
+{
+    if (!wf->on_disk && wf->buf_head == NULL) {
+        /* empty file */
+        FilestoreWriterFileWrite(ctx, wf, NULL, 0);
+    }
+    for (FilestoreJob *job = wf->buf_head; job != NULL; job = job->next) {
+        FilestoreWriterFileWrite(ctx, wf, job->data, job->len);
+    }
+    FilestoreWriterFileRelease(q, wf);
+}
+
+/**
+ * \retval true if the job was kept to be written later
+ */
+static bool FilestoreWriterFileData(const FilestoreWriter *w, FilestoreWriterQueue *q,
+        FilestoreWriterFile *wf, FilestoreJob *job)
+{
+    if (!wf->on_disk && wf->buf_len + job->len <= w->dedup_size &&
+            SC_ATOMIC_GET(q->buffered) + job->len <= w->queue_size / 2) {
+        if (wf->buf_tail != NULL) {
+            wf->buf_tail->next = job;
+        } else {
+            wf->buf_head = job;
+        }
+        wf->buf_tail = job;
+        wf->buf_len += job->len;
+        /* the data stays accounted in q->bytes until it's released */
+        SC_ATOMIC_ADD(q->buffered, job->len);
+        return true;
+    }
+
+    FilestoreWriterFileFlush(w->ctx, q, wf);
+    FilestoreWriterFileWrite(w->ctx, wf, job->data, job->len);
+    return false;
+}
+
+static void FilestoreWriterFileClose(const FilestoreWriter *w, FilestoreWriterQueue *q,
+        FilestoreWriterFile *wf, const FilestoreJob *job)
+{
+    char final_filename[PATH_MAX] = "";
+    OutputFilestoreFinalFilename(w->ctx, job->sha256, final_filename, sizeof(final_filename));
+
+    if (!wf->on_disk && SCPathExists(final_filename)) {
+        /* stored before: don't write it again, only update the timestamps */
+        SC_ATOMIC_ADD(filestore_writer_dedup_cnt, 1);
+        if (utime(final_filename, NULL) != 0) {
+            SCLogDebug("Failed to update file timestamps: %s: %s", final_filename,
+                    strerror(errno));
+        }
+    } else {
+        FilestoreWriterFileFlush(w->ctx, q, wf);
+        if (wf->fd != -1) {
+            close(wf->fd);
+            wf->fd = -1;
+            SC_ATOMIC_SUB(filestore_open_file_cnt, 1);
+        }
+
+        char tmp_filename[PATH_MAX] = "";
+        OutputFilestoreTmpFilename(w->ctx, wf->file_store_id, tmp_filename, sizeof(tmp_filename));
+        uint32_t errors = 0;
+        const bool stored = OutputFilestoreMoveFile(tmp_filename, final_filename, &errors);
+        if (errors > 0) {
+            SC_ATOMIC_ADD(filestore_writer_fs_errors, errors);
+        }
+        if (!stored) {
+            FilestoreWriterFileRemove(q, wf);
+            return;
+        }
+    }
+
+    if (job->len > 0) {
+        OutputFilestoreWriteFileinfo(
+                final_filename, job->ts, wf->file_store_id, job->data, job->len);
+    }
+    FilestoreWriterFileRemove(q, wf);
+}
+
+static void FilestoreWriterFileAbort(
+        const FilestoreWriter *w, FilestoreWriterQueue *q, FilestoreWriterFile *wf)
+{
+    if (wf->on_disk) {
+        if (wf->fd != -1) {
+            close(wf->fd);
+            wf->fd = -1;
+            SC_ATOMIC_SUB(filestore_open_file_cnt, 1);
+        }
+        char tmp_filename[PATH_MAX] = "";
+        OutputFilestoreTmpFilename(w->ctx, wf->file_store_id, tmp_filename, sizeof(tmp_filename));
+        if (unlink(tmp_filename) != 0) {
+            SC_ATOMIC_ADD(filestore_writer_fs_errors, 1);
+        }
+    }
+    FilestoreWriterFileRemove(q, wf);
+}
+
+static void FilestoreWriterProcess(
+        const FilestoreWriter *w, FilestoreWriterQueue *q, FilestoreJob *jobs)
+{
+    uint64_t bytes = 0;
+    while (jobs != NULL) {
+        FilestoreJob *job = jobs;
+        jobs = jobs->next;
+        job->next = NULL;
+
+        bool keep = false;
+        FilestoreWriterFile *wf = FilestoreWriterFileLookup(q, job->file_store_id);
+        switch (job->type) {
+            case FILESTORE_JOB_OPEN:
+                if (wf == NULL) {
+                    FilestoreWriterFileAdd(q, job->file_store_id);
+                }
+                break;
+            case FILESTORE_JOB_DATA:
+                if (wf != NULL) {
+                    keep = FilestoreWriterFileData(w, q, wf, job);
+                }
+                if (!keep) {
+                    bytes += job->len;
+                }
+                break;
+            case FILESTORE_JOB_CLOSE:
+                if (wf != NULL) {
+                    FilestoreWriterFileClose(w, q, wf, job);
+                }
+                break;
+            case FILESTORE_JOB_ABORT:
+                if (wf != NULL) {
+                    FilestoreWriterFileAbort(w, q, wf);
+                }
+                break;
+        }
+        if (!keep) {
+            SCFree(job);
+        }
+    }
+
+    /* wake up the packet threads waiting for room */
+    SCCtrlMutexLock(&q->mutex);
+    if (bytes > 0) {
+        SC_ATOMIC_SUB(q->bytes, bytes);
+    }
+    pthread_cond_broadcast(&q->space_cond);
+    SCCtrlMutexUnlock(&q->mutex);
+}
+
+/**
+ * \brief Handle what is left in a queue at shutdown.
+ *
+ * Jobs still queued are processed. Files that were never closed are left
+ * as temporary files, like the packet thread logger does. The data held
+ * back for dedup is written out first, so these files aren't lost.
+ */
+static void FilestoreWriterDrain(const FilestoreWriter *w, FilestoreWriterQueue *q)
+{
+    SCCtrlMutexLock(&q->mutex);
+    FilestoreJob *jobs = q->head;
+    q->head = q->tail = NULL;
+    SCCtrlMutexUnlock(&q->mutex);
+    if (jobs != NULL) {
+        FilestoreWriterProcess(w, q, jobs);
+    }
+
+    for (uint32_t i = 0; i < FILESTORE_WRITER_HASH_SIZE; i++) {
+        while (q->files[i] != NULL) {
+            FilestoreWriterFileFlush(w->ctx, q, q->files[i]);
+            FilestoreWriterFileRemove(q, q->files[i]);
+        }
+    }
+}
+
+static void *FilestoreWriterThread(void *arg)
+{
+    ThreadVars *tv_local = (ThreadVars *)arg;
+    FilestoreWriter *w = g_filestore_writer;
+    FilestoreWriterQueue *q = &w->queues[SC_ATOMIC_ADD(w->thread_id, 1) % w->threads];
+
+    SCSetThreadName(tv_local->name);
+
+    if (tv_local->thread_setup_flags != 0)
+        TmThreadSetupOptions(tv_local);
+
+    /* Set the threads capability */
+    tv_local->cap_flags = 0;
+    SCDropCaps(tv_local);
+
+    TmThreadsSetFlag(tv_local, THV_INIT_DONE | THV_RUNNING);
+    bool run = TmThreadsWaitForUnpause(tv_local);
+    while (1) {
+        SCCtrlMutexLock(&q->mutex);
+        if (q->head == NULL && run) {
+            struct timeval cond_tv;
+            gettimeofday(&cond_tv, NULL);
+            cond_tv.tv_sec += 1;
+            struct timespec cond_time = FROM_TIMEVAL(cond_tv);
+            SCCtrlCondTimedwait(&q->cond, &q->mutex, &cond_time);
+        }
+        FilestoreJob *jobs = q->head;
+        q->head = q->tail = NULL;
+        SCCtrlMutexUnlock(&q->mutex);
+
+        if (jobs != NULL) {
+            FilestoreWriterProcess(w, q, jobs);
+            continue;
+        }
+        /* only exit once the queue is empty, the packet threads are done
+         * by the time the management threads are killed */
+        if (!run || TmThreadsCheckFlag(tv_local, THV_KILL)) {
+            break;
+        }
+    }
+
+    FilestoreWriterDrain(w, q);
+
+    TmThreadsSetFlag(tv_local, THV_RUNNING_DONE);
+    TmThreadWaitForFlag(tv_local, THV_DEINIT);
+    TmThreadsSetFlag(tv_local, THV_CLOSED);
+    return NULL;
+}
+
+/**
+ * \brief Spawn the filestore writer threads, if enabled.
+ */
+void OutputFilestoreWriterThreadsSpawn(void)
+{
+    FilestoreWriter *w = g_filestore_writer;
+    if (w == NULL)
+        return;
+
+    for (uint32_t u = 0; u < w->threads; u++) {
+        char name[TM_THREAD_NAME_MAX];
+        snprintf(name, sizeof(name), "%s#%02u", thread_name_filestore_writer, u + 1);
+        ThreadVars *tv = TmThreadCreateMgmtThread(name, FilestoreWriterThread, 0);
+        if (tv == NULL || TmThreadSpawn(tv) != 0) {
+            FatalError("Unable to create and start filestore writer thread");
+        }
     }
 }
 
+static uint64_t FilestoreWriterQueuedCounter(void)
+{
+    FilestoreWriter *w = g_filestore_writer;
+    uint64_t bytes = 0;
+    for (uint32_t u = 0; w != NULL && u < w->threads; u++) {
+        bytes += SC_ATOMIC_GET(w->queues[u].bytes);
+    }
+    return bytes;
+}
+
+static uint64_t FilestoreWriterDedupCounter(void)
+{
+    return SC_ATOMIC_GET(filestore_writer_dedup_cnt);
+}
+
+static uint64_t FilestoreWriterFsErrorsCounter(void)
+{
+    return SC_ATOMIC_GET(filestore_writer_fs_errors);
+}
+
+static void FilestoreWriterFree(FilestoreWriter *w)
+{
+    if (w == NULL)
+        return;
+    for (uint32_t u = 0; w->queues != NULL && u < w->threads; u++) {
+        FilestoreWriterQueue *q = &w->queues[u];
+        FilestoreJobFreeList(q->head);
+        SCCtrlMutexDestroy(&q->mutex);
+        SCCtrlCondDestroy(&q->cond);
+        SCCtrlCondDestroy(&q->space_cond);
+    }
+    SCFree(w->queues);
+    SCFree(w);
+}
+
+static FilestoreWriter *FilestoreWriterAlloc(const OutputFilestoreCtx *ctx,
+        const uint32_t threads, const uint64_t queue_size, const uint32_t dedup_size,
+        const bool drop)
+{
+    FilestoreWriter *w = SCCalloc(1, sizeof(*w));
+    if (unlikely(w == NULL)) {
+        return NULL;
+    }
+    w->queues = SCCalloc(threads, sizeof(FilestoreWriterQueue));
+    if (unlikely(w->queues == NULL)) {
+        SCFree(w);
+        return NULL;
+    }
+    w->ctx = ctx;
+    w->threads = threads;
+    w->queue_size = queue_size;
+    w->dedup_size = dedup_size;
+    w->drop = drop;
+    SC_ATOMIC_INIT(w->thread_id);
+    for (uint32_t u = 0; u < w->threads; u++) {
+        FilestoreWriterQueue *q = &w->queues[u];
+        SCCtrlMutexInit(&q->mutex, NULL);
+        SCCtrlCondInit(&q->cond, NULL);
+        SCCtrlCondInit(&q->space_cond, NULL);
+        SC_ATOMIC_INIT(q->bytes);
+        SC_ATOMIC_INIT(q->buffered);
+    }
+    return w;
+}
+
+/**
+ * \brief Set up the asynchronous writer from the file-store.writer config.
+ *
+ * \retval w writer, or NULL if not enabled or on error
+ * \retval error set to true on error
+ */
+static FilestoreWriter *FilestoreWriterSetup(
+        const SCConfNode *conf, const OutputFilestoreCtx *ctx, bool *error)
+{
+    *error = false;
+    const SCConfNode *wconf = SCConfNodeLookupChild(conf, "writer");
+    int enabled = 0;
+    if (wconf == NULL || !SCConfGetChildValueBool(wconf, "enabled", &enabled) || !enabled) {
+        return NULL;
+    }
+
+    intmax_t threads = 1;
+    if (SCConfGetChildValueInt(wconf, "threads", &threads) &&
+            (threads < 1 || threads > FILESTORE_WRITER_THREADS_MAX)) {
+        SCLogError("Filestore (v2) invalid writer.threads setting %" PRIdMAX
+                   ", must be between 1 and %d",
+                threads, FILESTORE_WRITER_THREADS_MAX);
+        *error = true;
+        return NULL;
+    }
+
+    uint64_t queue_size = FILESTORE_WRITER_QUEUE_SIZE;
+    const char *str = SCConfNodeLookupChildValue(wconf, "queue-size");
+    if (str != NULL && (ParseSizeStringU64(str, &queue_size) < 0 || queue_size == 0)) {
+        SCLogError("Filestore (v2) invalid writer.queue-size setting %s", str);
+        *error = true;
+        return NULL;
+    }
+
+    uint32_t dedup_size = FILESTORE_WRITER_DEDUP_SIZE;
+    str = SCConfNodeLookupChildValue(wconf, "dedup-buffer");
+    if (str != NULL && ParseSizeStringU32(str, &dedup_size) < 0) {
+        SCLogError("Filestore (v2) invalid writer.dedup-buffer setting %s", str);
+        *error = true;
+        return NULL;
+    }
+
+    bool drop = false;
+    str = SCConfNodeLookupChildValue(wconf, "queue-full");
+    if (str != NULL) {
+        if (strcmp(str, "drop") == 0) {
+            drop = true;
+        } else if (strcmp(str, "block") != 0) {
+            SCLogError("Filestore (v2) invalid writer.queue-full setting %s, "
+                       "expected block or drop",
+                    str);
+            *error = true;
+            return NULL;
+        }
+    }
+
+    FilestoreWriter *w =
+            FilestoreWriterAlloc(ctx, (uint32_t)threads, queue_size, dedup_size, drop);
+    if (unlikely(w == NULL)) {
+        *error = true;
+        return NULL;
+    }
+
+    StatsRegisterGlobalCounter("file_store.writer.queued_bytes", FilestoreWriterQueuedCounter);
+    StatsRegisterGlobalCounter("file_store.writer.dedup", FilestoreWriterDedupCounter);
+    StatsRegisterGlobalCounter("file_store.writer.fs_errors", FilestoreWriterFsErrorsCounter);
+
+    SCLogConfig("Filestore (v2) using %u writer thread(s), queue size %" PRIu64
+                ", dedup buffer %u, %s when the queue is full",
+            w->threads, w->queue_size, w->dedup_size, w->drop ? "drop" : "block");
+    return w;
+}
+
 static int OutputFilestoreLogger(ThreadVars *tv, void *thread_data, const Packet *p, File *ff,
         void *tx, const uint64_t tx_id, const uint8_t *data, uint32_t data_len, uint8_t flags,
         uint8_t dir)
@@ -194,6 +965,11 @@ static int OutputFilestoreLogger(ThreadVars *tv, void *thread_data, const Packet
 
     SCLogDebug("ff %p, data %p, data_len %u", ff, data, data_len);
 
+    if (ctx->writer != NULL) {
+        return OutputFilestoreLoggerAsync(
+                tv, aft, p, ff, tx, tx_id, data, data_len, flags, dir);
+    }
+
     if (flags & OUTPUT_FILEDATA_FLAG_OPEN) {
         snprintf(filename, sizeof(filename), "%s/file.%u", ctx->tmpdir, ff->file_store_id);
         file_fd = open(filename, O_CREAT | O_TRUNC | O_NOFOLLOW | O_WRONLY,
@@ -282,6 +1058,15 @@ static TmEcode OutputFilestoreLogThreadInit(ThreadVars *t, const void *initdata,
      * occurrence. */
     aft->fs_error_counter = StatsRegisterCounter("file_store.fs_errors", t);
 
+    if (ctx->writer != NULL) {
+        /* times a packet thread had to wait for room in the writer queue */
+        aft->counter_writer_queue_full =
+                StatsRegisterCounter("file_store.writer.queue_full", t);
+        /* files dropped because the writer queue was full or on allocation
+         * errors, counted once per file */
+        aft->counter_writer_drops = StatsRegisterCounter("file_store.writer.drops", t);
+    }
+
     *data = (void *)aft;
     return TM_ECODE_OK;
 }
@@ -303,6 +1088,10 @@ static TmEcode OutputFilestoreLogThreadDeinit(ThreadVars *t, void *data)
 static void OutputFilestoreLogDeInitCtx(OutputCtx *output_ctx)
 {
     OutputFilestoreCtx *ctx = (OutputFilestoreCtx *)output_ctx->data;
+    if (ctx->writer != NULL) {
+        g_filestore_writer = NULL;
+        FilestoreWriterFree(ctx->writer);
+    }
     if (ctx->xff_cfg != NULL) {
         SCFree(ctx->xff_cfg);
     }
@@ -495,6 +1284,14 @@ static OutputInitResult OutputFilestoreLogInitCtx(SCConfNode *conf)
         }
     }
 
+    bool writer_error = false;
+    ctx->writer = FilestoreWriterSetup(conf, ctx, &writer_error);
+    if (writer_error) {
+        OutputFilestoreLogDeInitCtx(output_ctx);
+        return result;
+    }
+    g_filestore_writer = ctx->writer;
+
     result.ctx = output_ctx;
     result.ok = true;
     SCReturnCT(result, "OutputInitResult");
@@ -508,9 +1305,264 @@ void OutputFilestoreRegister(void)
 
     SC_ATOMIC_INIT(filestore_open_file_cnt);
     SC_ATOMIC_SET(filestore_open_file_cnt, 0);
+    SC_ATOMIC_INIT(filestore_writer_dedup_cnt);
+    SC_ATOMIC_INIT(filestore_writer_fs_errors);
 }
 
 void OutputFilestoreRegisterGlobalCounters(void)
 {
     StatsRegisterGlobalCounter("file_store.open_files", OutputFilestoreOpenFilesCounter);
 }
+
+#ifdef UNITTESTS
+#include "util-unittest.h"
+
+/** \internal
+ *  \brief set up a ctx storing in a new temporary directory, with the
+ *         '00' subdirectory used by the all zero test digests */
+static OutputFilestoreCtx *FilestoreTestCtxAlloc(void)
+{
+    OutputFilestoreCtx *ctx = SCCalloc(1, sizeof(*ctx));
+    if (ctx == NULL)
+        return NULL;
+    strlcpy(ctx->prefix, "/tmp/suricata-filestore-XXXXXX", sizeof(ctx->prefix));
+    if (mkdtemp(ctx->prefix) == NULL) {
+        SCFree(ctx);
+        return NULL;
+    }
+    char dir[PATH_MAX];
+    snprintf(dir, sizeof(dir), "%s/00", ctx->prefix);
+    snprintf(ctx->tmpdir, sizeof(ctx->tmpdir), "%s/tmp", ctx->prefix);
+    if (mkdir(dir, 0700) != 0 || mkdir(ctx->tmpdir, 0700) != 0) {
+        rmdir(dir);
+        rmdir(ctx->prefix);
+        SCFree(ctx);
+        return NULL;
+    }
+    return ctx;
+}
+
+static void FilestoreTestRemoveDir(const char *dir)
+{
+    DIR *d = opendir(dir);
+    if (d != NULL) {
+        struct dirent *de;
+        while ((de = readdir(d)) != NULL) {
+            if (strcmp(de->d_name, ".") == 0 || strcmp(de->d_name, "..") == 0)
+                continue;
+            char path[PATH_MAX];
+            snprintf(path, sizeof(path), "%s/%s", dir, de->d_name);
+            unlink(path);
+        }
+        closedir(d);
+    }
+    rmdir(dir);
+}
+
+static void FilestoreTestCtxFree(OutputFilestoreCtx *ctx)
+{
+    char dir[PATH_MAX];
+    snprintf(dir, sizeof(dir), "%s/00", ctx->prefix);
+    FilestoreTestRemoveDir(dir);
+    FilestoreTestRemoveDir(ctx->tmpdir);
+    rmdir(ctx->prefix);
+    FilestoreWriterFree(ctx->writer);
+    SCFree(ctx);
+}
+
+/** \internal
+ *  \brief run the writer thread loop once */
+static void FilestoreTestProcess(FilestoreWriter *w, FilestoreWriterQueue *q)
+{
+    FilestoreJob *jobs = q->head;
+    q->head = q->tail = NULL;
+    FilestoreWriterProcess(w, q, jobs);
+}
+
+static void FilestoreTestClose(FilestoreWriterQueue *q, const File *ff)
+{
+    FilestoreJob *job = FilestoreJobAlloc(FILESTORE_JOB_CLOSE, ff->file_store_id, NULL, 0);
+    BUG_ON(job == NULL);
+    memcpy(job->sha256, ff->sha256, sizeof(job->sha256));
+    FilestoreWriterEnqueue(q, job);
+}
+
+/** \internal
+ *  \retval size of the file, -1 if it doesn't exist */
+static off_t FilestoreTestFileSize(const char *filename)
+{
+    struct stat sb;
+    if (stat(filename, &sb) != 0)
+        return -1;
+    return sb.st_size;
+}
+
+/** \test a full queue drops the file in drop mode */
+static int OutputFilestoreWriterTest01(void)
+{
+    ThreadVars tv;
+    memset(&tv, 0, sizeof(tv));
+    OutputFilestoreCtx *ctx = FilestoreTestCtxAlloc();
+    FAIL_IF_NULL(ctx);
+    ctx->writer = FilestoreWriterAlloc(ctx, 1, 16, 0, true);
+    FAIL_IF_NULL(ctx->writer);
+    FilestoreWriterQueue *q = &ctx->writer->queues[0];
+    OutputFilestoreLogThread aft = { .ctx = ctx };
+
+    File ff;
+    memset(&ff, 0, sizeof(ff));
+    ff.file_store_id = 1;
+    ff.fd = -1;
+    uint8_t data[12];
+    memset(data, 'a', sizeof(data));
+
+    FAIL_IF_NOT(OutputFilestoreLoggerAsync(&tv, &aft, NULL, &ff, NULL, 0, data, sizeof(data),
+                        OUTPUT_FILEDATA_FLAG_OPEN, 0) == 0);
+    FAIL_IF_NOT(SC_ATOMIC_GET(q->bytes) == sizeof(data));
+
+    /* no room for the second chunk */
+    FAIL_IF_NOT(OutputFilestoreLoggerAsync(
+                        &tv, &aft, NULL, &ff, NULL, 0, data, sizeof(data), 0, 0) == -1);
+    FAIL_IF_NOT(ff.flags & FILE_STORE_DROPPED);
+    FAIL_IF_NOT(ff.fd == -1);
+    FAIL_IF_NOT(SC_ATOMIC_GET(q->bytes) == sizeof(data));
+
+    /* nothing more is handed to the writer */
+    FAIL_IF_NOT(OutputFilestoreLoggerAsync(&tv, &aft, NULL, &ff, NULL, 0, data, 1,
+                        OUTPUT_FILEDATA_FLAG_CLOSE, 0) == -1);
+    FAIL_IF_NULL(q->head);
+    FAIL_IF_NOT(q->head->type == FILESTORE_JOB_OPEN);
+    FAIL_IF_NULL(q->head->next);
+    FAIL_IF_NOT(q->head->next->type == FILESTORE_JOB_DATA);
+    FAIL_IF_NULL(q->head->next->next);
+    FAIL_IF_NOT(q->head->next->next->type == FILESTORE_JOB_ABORT);
+    FAIL_IF_NOT(q->head->next->next->next == NULL);
+
+    /* the writer removes what it wrote of the file */
+    FilestoreTestProcess(ctx->writer, q);
+    FAIL_IF_NOT(SC_ATOMIC_GET(q->bytes) == 0);
+    FAIL_IF_NOT(FilestoreWriterFileLookup(q, ff.file_store_id) == NULL);
+    char filename[PATH_MAX];
+    OutputFilestoreTmpFilename(ctx, ff.file_store_id, filename, sizeof(filename));
+    FAIL_IF(SCPathExists(filename));
+
+    FilestoreTestCtxFree(ctx);
+    PASS;
+}
+
+/** \test small files are held back and not written if stored before */
+static int OutputFilestoreWriterTest02(void)
+{
+    ThreadVars tv;
+    memset(&tv, 0, sizeof(tv));
+    OutputFilestoreCtx *ctx = FilestoreTestCtxAlloc();
+    FAIL_IF_NULL(ctx);
+    ctx->writer = FilestoreWriterAlloc(ctx, 1, 1024, 256, false);
+    FAIL_IF_NULL(ctx->writer);
+    FilestoreWriterQueue *q = &ctx->writer->queues[0];
+    OutputFilestoreLogThread aft = { .ctx = ctx };
+    char tmp_filename[PATH_MAX];
+    char final_filename[PATH_MAX];
+
+    File ff;
+    memset(&ff, 0, sizeof(ff));
+    ff.file_store_id = 2;
+    ff.fd = -1;
+    uint8_t data[100];
+    memset(data, 'a', sizeof(data));
+
+    FAIL_IF_NOT(OutputFilestoreLoggerAsync(&tv, &aft, NULL, &ff, NULL, 0, data, sizeof(data),
+                        OUTPUT_FILEDATA_FLAG_OPEN, 0) == 0);
+    FilestoreTestProcess(ctx->writer, q);
+    FilestoreWriterFile *wf = FilestoreWriterFileLookup(q, ff.file_store_id);
+    FAIL_IF_NULL(wf);
+    FAIL_IF(wf->on_disk);
+    FAIL_IF_NOT(wf->buf_len == sizeof(data));
+    FAIL_IF_NOT(SC_ATOMIC_GET(q->buffered) == sizeof(data));
+    FAIL_IF_NOT(SC_ATOMIC_GET(q->bytes) == sizeof(data));
+    OutputFilestoreTmpFilename(ctx, ff.file_store_id, tmp_filename, sizeof(tmp_filename));
+    FAIL_IF(SCPathExists(tmp_filename));
+
+    /* stored before: the held back data is dropped */
+    OutputFilestoreFinalFilename(ctx, ff.sha256, final_filename, sizeof(final_filename));
+    FILE *fp = fopen(final_filename, "w");
+    FAIL_IF_NULL(fp);
+    fclose(fp);
+    const uint64_t dedup = SC_ATOMIC_GET(filestore_writer_dedup_cnt);
+    FilestoreTestClose(q, &ff);
+    FilestoreTestProcess(ctx->writer, q);
+    FAIL_IF_NOT(SC_ATOMIC_GET(filestore_writer_dedup_cnt) == dedup + 1);
+    FAIL_IF_NOT(FilestoreWriterFileLookup(q, ff.file_store_id) == NULL);
+    FAIL_IF_NOT(SC_ATOMIC_GET(q->buffered) == 0);
+    FAIL_IF_NOT(SC_ATOMIC_GET(q->bytes) == 0);
+    FAIL_IF(SCPathExists(tmp_filename));
+    FAIL_IF_NOT(FilestoreTestFileSize(final_filename) == 0);
+
+    /* new file: written on close */
+    memset(&ff, 0, sizeof(ff));
+    ff.file_store_id = 3;
+    ff.fd = -1;
+    ff.sha256[SC_SHA256_LEN - 1] = 1;
+    FAIL_IF_NOT(OutputFilestoreLoggerAsync(&tv, &aft, NULL, &ff, NULL, 0, data, sizeof(data),
+                        OUTPUT_FILEDATA_FLAG_OPEN, 0) == 0);
+    FilestoreTestClose(q, &ff);
+    FilestoreTestProcess(ctx->writer, q);
+    FAIL_IF_NOT(SC_ATOMIC_GET(filestore_writer_dedup_cnt) == dedup + 1);
+    FAIL_IF_NOT(SC_ATOMIC_GET(q->bytes) == 0);
+    OutputFilestoreFinalFilename(ctx, ff.sha256, final_filename, sizeof(final_filename));
+    FAIL_IF_NOT(FilestoreTestFileSize(final_filename) == sizeof(data));
+
+    FilestoreTestCtxFree(ctx);
+    PASS;
+}
+
+/** \test at shutdown queued jobs are handled and open files are written
+ *        out as temporary files */
+static int OutputFilestoreWriterTest03(void)
+{
+    ThreadVars tv;
+    memset(&tv, 0, sizeof(tv));
+    OutputFilestoreCtx *ctx = FilestoreTestCtxAlloc();
+    FAIL_IF_NULL(ctx);
+    ctx->writer = FilestoreWriterAlloc(ctx, 1, 1024, 256, false);
+    FAIL_IF_NULL(ctx->writer);
+    FilestoreWriterQueue *q = &ctx->writer->queues[0];
+    OutputFilestoreLogThread aft = { .ctx = ctx };
+
+    File ff;
+    memset(&ff, 0, sizeof(ff));
+    ff.file_store_id = 4;
+    ff.fd = -1;
+    uint8_t data[100];
+    memset(data, 'a', sizeof(data));
+
+    /* held back for dedup */
+    FAIL_IF_NOT(OutputFilestoreLoggerAsync(&tv, &aft, NULL, &ff, NULL, 0, data, sizeof(data),
+                        OUTPUT_FILEDATA_FLAG_OPEN, 0) == 0);
+    FilestoreTestProcess(ctx->writer, q);
+    FAIL_IF_NOT(SC_ATOMIC_GET(q->buffered) == sizeof(data));
+    /* still queued */
+    FAIL_IF_NOT(
+            OutputFilestoreLoggerAsync(&tv, &aft, NULL, &ff, NULL, 0, data, 50, 0, 0) == 0);
+    FAIL_IF_NULL(q->head);
+
+    FilestoreWriterDrain(ctx->writer, q);
+    FAIL_IF_NOT(q->head == NULL);
+    FAIL_IF_NOT(FilestoreWriterFileLookup(q, ff.file_store_id) == NULL);
+    FAIL_IF_NOT(SC_ATOMIC_GET(q->buffered) == 0);
+    FAIL_IF_NOT(SC_ATOMIC_GET(q->bytes) == 0);
+    char filename[PATH_MAX];
+    OutputFilestoreTmpFilename(ctx, ff.file_store_id, filename, sizeof(filename));
+    FAIL_IF_NOT(FilestoreTestFileSize(filename) == sizeof(data) + 50);
+
+    FilestoreTestCtxFree(ctx);
+    PASS;
+}
+
+void OutputFilestoreRegisterTests(void)
+{
+    UtRegisterTest("OutputFilestoreWriterTest01", OutputFilestoreWriterTest01);
+    UtRegisterTest("OutputFilestoreWriterTest02", OutputFilestoreWriterTest02);
+    UtRegisterTest("OutputFilestoreWriterTest03", OutputFilestoreWriterTest03);
+}
+#endif /* UNITTESTS */
@@ -20,5 +20,10 @@
 
 void OutputFilestoreRegister(void);
 void OutputFilestoreRegisterGlobalCounters(void);
+void OutputFilestoreWriterThreadsSpawn(void);
+
+#ifdef UNITTESTS
+void OutputFilestoreRegisterTests(void);
+#endif
 
 #endif /* SURICATA_OUTPUT_FILESTORE_H */
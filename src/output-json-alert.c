@@ -44,6 +44,7 @@
 #include "app-layer-parser.h"
 #include "app-layer-htp-xff.h"
 #include "app-layer-ftp.h"
+#include "app-layer-ssl.h"
 #include "app-layer-frames.h"
 #include "log-pcap.h"
 
@@ -1046,6 +1047,12 @@ static void JsonAlertLogSetupMetadata(AlertJsonOutputCtx *json_output_ctx, SCCon
         DetectEngineSetParseMetadata();
     }
 
+    if (flags & LOG_JSON_APP_LAYER) {
+        /* the tls metadata has the certificate fields */
+        SSLEnableCertDecoding();
+        SSLEnableCertFingerprint();
+    }
+
     json_output_ctx->payload_buffer_size = payload_buffer_size;
     json_output_ctx->flags |= flags;
 }
@@ -31,6 +31,7 @@
 #include "app-layer.h"
 #include "app-layer-events.h"
 #include "app-layer-parser.h"
+#include "app-layer-ssl.h"
 
 #include "threads.h"
 #include "tm-threads.h"
@@ -396,6 +397,10 @@ static void JsonAnomalyLogConf(AnomalyJsonOutputCtx *json_output_ctx, SCConfNode
                      "have been selected. Select one or more logging types.");
         warn_no_flags = true;
     }
+    if (flags & LOG_JSON_APPLAYER_TYPE) {
+        /* the tls certificate events are set by the certificate decoder */
+        SSLEnableCertDecoding();
+    }
     json_output_ctx->flags |= flags;
 }
 
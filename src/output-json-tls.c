@@ -118,6 +118,18 @@ TlsFields tls_fields[] = {
      LOG_TLS_FIELD_SNI)
 // clang-format on
 
+/* fields that need the first certificate to be decoded */
+// clang-format off
+#define CERT_DECODE_FIELDS                      \
+    (LOG_TLS_FIELD_SUBJECT |                    \
+     LOG_TLS_FIELD_ISSUER |                     \
+     LOG_TLS_FIELD_SERIAL |                     \
+     LOG_TLS_FIELD_NOTBEFORE |                  \
+     LOG_TLS_FIELD_NOTAFTER |                   \
+     LOG_TLS_FIELD_SUBJECTALTNAME |             \
+     LOG_TLS_FIELD_CLIENT)
+// clang-format on
+
 typedef struct OutputTlsCtx_ {
     uint64_t fields; /** Store fields */
     bool session_resumed;
@@ -159,10 +171,9 @@ static void JsonTlsLogSessionResumed(SCJsonBuilder *js, SSLState *ssl_state)
     if (ssl_state->flags & SSL_AL_FLAG_SESSION_RESUMED) {
         /* Only log a session as 'resumed' if a certificate has not
            been seen, and the session is not TLSv1.3 or later. */
-        if ((ssl_state->server_connp.cert0_issuerdn == NULL &&
-               ssl_state->server_connp.cert0_subject == NULL) &&
-               (ssl_state->flags & SSL_AL_FLAG_STATE_SERVER_HELLO) &&
-               ((ssl_state->flags & SSL_AL_FLAG_LOG_WITHOUT_CERT) == 0)) {
+        if (!SSLCert0Done(&ssl_state->server_connp) &&
+                (ssl_state->flags & SSL_AL_FLAG_STATE_SERVER_HELLO) &&
+                ((ssl_state->flags & SSL_AL_FLAG_LOG_WITHOUT_CERT) == 0)) {
             SCJbSetBool(js, "session_resumed", true);
         }
     }
@@ -503,6 +514,22 @@ bool JsonTlsLogJSONExtended(void *vtx, SCJsonBuilder *tjs)
     return SCJbClose(tjs);
 }
 
+/** \brief check if a tls event should be logged
+ *
+ *  Use the certificate state rather than the decoded strings, as the
+ *  certificate is not decoded if no configured field needs it.
+ */
+static bool JsonTlsLogNeeded(const OutputTlsCtx *tls_ctx, const SSLState *ssl_state)
+{
+    if (SSLCert0Done(&ssl_state->server_connp))
+        return true;
+    if ((ssl_state->flags & SSL_AL_FLAG_SESSION_RESUMED) && tls_ctx->session_resumed)
+        return true;
+    if (ssl_state->flags & SSL_AL_FLAG_LOG_WITHOUT_CERT)
+        return true;
+    return false;
+}
+
 static int JsonTlsLogger(ThreadVars *tv, void *thread_data, const Packet *p,
                          Flow *f, void *state, void *txptr, uint64_t tx_id)
 {
@@ -514,11 +541,7 @@ static int JsonTlsLogger(ThreadVars *tv, void *thread_data, const Packet *p,
         return 0;
     }
 
-    if ((ssl_state->server_connp.cert0_issuerdn == NULL ||
-                ssl_state->server_connp.cert0_subject == NULL) &&
-            ((ssl_state->flags & SSL_AL_FLAG_SESSION_RESUMED) == 0 ||
-                    (!tls_ctx->session_resumed)) &&
-            ((ssl_state->flags & SSL_AL_FLAG_LOG_WITHOUT_CERT) == 0)) {
+    if (!JsonTlsLogNeeded(tls_ctx, ssl_state)) {
         return 0;
     }
 
@@ -698,6 +721,12 @@ static OutputInitResult OutputTlsLogInitSub(SCConfNode *conf, OutputCtx *parent_
     output_ctx->DeInit = OutputTlsLogDeinitSub;
 
     SCAppLayerParserRegisterLogger(IPPROTO_TCP, ALPROTO_TLS);
+    if (tls_ctx->fields & CERT_DECODE_FIELDS) {
+        SSLEnableCertDecoding();
+    }
+    if (tls_ctx->fields & (LOG_TLS_FIELD_FINGERPRINT | LOG_TLS_FIELD_CLIENT)) {
+        SSLEnableCertFingerprint();
+    }
 
     result.ctx = output_ctx;
     result.ok = true;
@@ -711,3 +740,75 @@ void JsonTlsLogRegister (void)
             OutputTlsLogInitSub, ALPROTO_TLS, JsonTlsLogger, TLS_STATE_SERVER_HANDSHAKE_DONE,
             TLS_STATE_CLIENT_HANDSHAKE_DONE, JsonTlsLogThreadInit, JsonTlsLogThreadDeinit);
 }
+
+#ifdef UNITTESTS
+#include "conf-yaml-loader.h"
+#include "util-unittest.h"
+
+/** \test custom field list without certificate fields: certificate decoding
+ *        is not needed, but the events are still logged */
+static int JsonTlsLogTest01(void)
+{
+    const char input[] = "\
+%YAML 1.1\n\
+---\n\
+tls:\n\
+  custom: [sni, version, ja3]\n\
+";
+
+    SCConfCreateContextBackup();
+    SCConfInit();
+    SCConfYamlLoadString(input, strlen(input));
+
+    OutputTlsCtx *tls_ctx = OutputTlsInitCtx(SCConfGetNode("tls"));
+    FAIL_IF_NULL(tls_ctx);
+    FAIL_IF(tls_ctx->fields & CERT_DECODE_FIELDS);
+
+    SSLState ssl_state;
+    memset(&ssl_state, 0, sizeof(ssl_state));
+    /* no certificate seen yet */
+    FAIL_IF(JsonTlsLogNeeded(tls_ctx, &ssl_state));
+
+    /* certificate seen, but not decoded */
+    ssl_state.server_connp.cert0_decode_skipped = true;
+    FAIL_IF_NOT(JsonTlsLogNeeded(tls_ctx, &ssl_state));
+
+    SCFree(tls_ctx);
+    SCConfDeInit();
+    SCConfRestoreContextBackup();
+    PASS;
+}
+
+/** \test a full handshake with a certificate that was not decoded is not
+ *        logged as resumed */
+static int JsonTlsLogTest02(void)
+{
+    SSLState ssl_state;
+    memset(&ssl_state, 0, sizeof(ssl_state));
+    ssl_state.flags = SSL_AL_FLAG_SESSION_RESUMED | SSL_AL_FLAG_STATE_SERVER_HELLO;
+    ssl_state.server_connp.cert0_decode_skipped = true;
+
+    SCJsonBuilder *js = SCJbNewObject();
+    FAIL_IF_NULL(js);
+    JsonTlsLogSessionResumed(js, &ssl_state);
+    SCJbClose(js);
+    FAIL_IF_NOT(SCJbLen(js) == 2);
+    SCJbFree(js);
+
+    /* no certificate: resumed */
+    ssl_state.server_connp.cert0_decode_skipped = false;
+    js = SCJbNewObject();
+    FAIL_IF_NULL(js);
+    JsonTlsLogSessionResumed(js, &ssl_state);
+    SCJbClose(js);
+    FAIL_IF(SCJbLen(js) == 2);
+    SCJbFree(js);
+    PASS;
+}
+
+void JsonTlsLogRegisterTests(void)
+{
+    UtRegisterTest("JsonTlsLogTest01", JsonTlsLogTest01);
+    UtRegisterTest("JsonTlsLogTest02", JsonTlsLogTest02);
+}
+#endif /* UNITTESTS */
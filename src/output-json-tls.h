@@ -31,4 +31,8 @@ void JsonTlsLogRegister(void);
 
 bool JsonTlsLogJSONExtended(void *vtx, SCJsonBuilder *js);
 
+#ifdef UNITTESTS
+void JsonTlsLogRegisterTests(void);
+#endif
+
 #endif /* SURICATA_OUTPUT_JSON_TLS_H */
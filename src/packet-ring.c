@@ -0,0 +1,252 @@
+/* Copyright (C) 2026 Open Information Security Foundation
+ *
+ * You can copy, redistribute or modify this Program under the terms of
+ * the GNU General Public License version 2 as published by the Free
+ * Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * version 2 along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+/**
+ * \file
+ *
+ * Bounded lock-free MPSC packet ring used by the autofp queue handler.
+ */
+
+#include "suricata-common.h"
+#include "decode.h"
+#include "packet-ring.h"
+#include "util-unittest.h"
+
+/**
+ *  \brief allocate a ring
+ *
+ *  \param size number of slots, rounded up to the next power of 2
+ *
+ *  \retval r ring or NULL on error
+ */
+PacketRing *PacketRingAlloc(uint32_t size)
+{
+    if (size < 2)
+        size = 2;
+    uint64_t rsize = 1;
+    while (rsize < size)
+        rsize <<= 1;
+
+    PacketRing *r = SCMallocAligned(sizeof(*r), CLS);
+    if (r == NULL)
+        return NULL;
+    memset(r, 0, sizeof(*r));
+
+    r->slots = SCMallocAligned(rsize * sizeof(PacketRingSlot), CLS);
+    if (r->slots == NULL) {
+        SCFreeAligned(r);
+        return NULL;
+    }
+    r->size = rsize;
+    r->mask = rsize - 1;
+    for (uint64_t i = 0; i < rsize; i++) {
+        SC_ATOMIC_INIT(r->slots[i].seq);
+        SC_ATOMIC_SET(r->slots[i].seq, i);
+        r->slots[i].p = NULL;
+    }
+    SC_ATOMIC_INIT(r->tail);
+    SC_ATOMIC_INIT(r->sleeping);
+    SC_ATOMIC_INIT(r->consumed);
+    return r;
+}
+
+void PacketRingFree(PacketRing *r)
+{
+    if (r == NULL)
+        return;
+    SCFreeAligned(r->slots);
+    SCFreeAligned(r);
+}
+
+/**
+ *  \brief reserve the next slot for a producer
+ *
+ *  \retval true if slot *pos was reserved
+ */
+static inline bool PacketRingReserve(PacketRing *r, uint64_t *pos)
+{
+    uint64_t tail = SC_ATOMIC_LOAD_EXPLICIT(r->tail, SC_ATOMIC_MEMORY_ORDER_RELAXED);
+    while (1) {
+        PacketRingSlot *s = &r->slots[tail & r->mask];
+        const uint64_t seq = SC_ATOMIC_LOAD_EXPLICIT(s->seq, SC_ATOMIC_MEMORY_ORDER_ACQUIRE);
+        const int64_t diff = (int64_t)(seq - tail);
+        if (diff == 0) {
+            uint64_t expected = tail;
+            if (SC_ATOMIC_CAS(&r->tail, expected, tail + 1)) {
+                *pos = tail;
+                return true;
+            }
+        } else if (diff < 0) {
+            /* full */
+            return false;
+        }
+        tail = SC_ATOMIC_LOAD_EXPLICIT(r->tail, SC_ATOMIC_MEMORY_ORDER_RELAXED);
+    }
+}
+
+static inline void PacketRingPublish(PacketRing *r, const uint64_t pos, Packet *p)
+{
+    PacketRingSlot *s = &r->slots[pos & r->mask];
+    s->p = p;
+    SC_ATOMIC_SET(s->seq, pos + 1);
+}
+
+/**
+ *  \brief add a packet to the ring
+ *
+ *  \retval true on success, false if the ring is full
+ */
+bool PacketRingEnqueue(PacketRing *r, Packet *p)
+{
+    uint64_t pos;
+    if (!PacketRingReserve(r, &pos))
+        return false;
+    PacketRingPublish(r, pos, p);
+    return true;
+}
+
+static inline uint32_t PacketRingPull(PacketRing *r, Packet **pkts, uint32_t n)
+{
+    uint32_t cnt = 0;
+    uint64_t head = r->head;
+    while (cnt < n) {
+        PacketRingSlot *s = &r->slots[head & r->mask];
+        const uint64_t seq = SC_ATOMIC_LOAD_EXPLICIT(s->seq, SC_ATOMIC_MEMORY_ORDER_ACQUIRE);
+        if (seq != head + 1)
+            break;
+        pkts[cnt++] = s->p;
+        s->p = NULL;
+        /* hand the slot back to the producers for the next lap */
+        SC_ATOMIC_SET(s->seq, head + r->size);
+        head++;
+    }
+    r->head = head;
+    return cnt;
+}
+
+/**
+ *  \brief get the next packet, refilling the consumer stash in batches
+ *
+ *  \warning only to be called from the single consumer thread
+ */
+Packet *PacketRingDequeue(PacketRing *r)
+{
+    if (r->stash_idx == r->stash_cnt) {
+        r->stash_idx = 0;
+        r->stash_cnt = (uint16_t)PacketRingPull(r, r->stash, PACKET_RING_BATCH);
+        if (r->stash_cnt == 0)
+            return NULL;
+    }
+    Packet *p = r->stash[r->stash_idx++];
+    /* single writer: a plain store is enough, no locked add */
+    const uint64_t consumed =
+            SC_ATOMIC_LOAD_EXPLICIT(r->consumed, SC_ATOMIC_MEMORY_ORDER_RELAXED);
+    SC_ATOMIC_STORE_EXPLICIT(r->consumed, consumed + 1, SC_ATOMIC_MEMORY_ORDER_RELAXED);
+    return p;
+}
+
+/** \brief check if the ring has packets the consumer hasn't taken yet
+ *
+ *  Uses sequentially consistent loads so it can be paired with the
+ *  'sleeping' flag to avoid lost wakeups.
+ */
+bool PacketRingIsEmpty(PacketRing *r)
+{
+    if (r->stash_idx != r->stash_cnt)
+        return false;
+    PacketRingSlot *s = &r->slots[r->head & r->mask];
+    return (SC_ATOMIC_GET(s->seq) != r->head + 1);
+}
+
+/** \brief number of packets in the ring, including the consumer stash
+ *
+ *  Safe to call from any thread, but only approximate while producers
+ *  and the consumer are active.
+ */
+uint64_t PacketRingLen(PacketRing *r)
+{
+    const uint64_t consumed =
+            SC_ATOMIC_LOAD_EXPLICIT(r->consumed, SC_ATOMIC_MEMORY_ORDER_RELAXED);
+    const uint64_t tail = SC_ATOMIC_GET(r->tail);
+    return tail - consumed;
+}
+
+#ifdef UNITTESTS
+static int PacketRingTest01(void)
+{
+    PacketRing *r = PacketRingAlloc(3);
+    FAIL_IF_NULL(r);
+    FAIL_IF_NOT(r->size == 4);
+    FAIL_IF_NOT(PacketRingIsEmpty(r));
+
+    Packet pkts[5];
+    for (int i = 0; i < 4; i++) {
+        FAIL_IF_NOT(PacketRingEnqueue(r, &pkts[i]));
+    }
+    /* full */
+    FAIL_IF(PacketRingEnqueue(r, &pkts[4]));
+    FAIL_IF_NOT(PacketRingLen(r) == 4);
+
+    FAIL_IF_NOT(PacketRingDequeue(r) == &pkts[0]);
+    FAIL_IF_NOT(PacketRingLen(r) == 3);
+    /* stash holds the rest, the ring slots are free again */
+    FAIL_IF_NOT(PacketRingEnqueue(r, &pkts[4]));
+    FAIL_IF_NOT(PacketRingDequeue(r) == &pkts[1]);
+    FAIL_IF_NOT(PacketRingDequeue(r) == &pkts[2]);
+    FAIL_IF_NOT(PacketRingDequeue(r) == &pkts[3]);
+    FAIL_IF_NOT(PacketRingDequeue(r) == &pkts[4]);
+    FAIL_IF_NOT(PacketRingDequeue(r) == NULL);
+    FAIL_IF_NOT(PacketRingIsEmpty(r));
+    FAIL_IF_NOT(PacketRingLen(r) == 0);
+
+    PacketRingFree(r);
+    PASS;
+}
+
+static int PacketRingTest02(void)
+{
+    PacketRing *r = PacketRingAlloc(8);
+    FAIL_IF_NULL(r);
+
+    Packet pkts[8];
+
+    /* wrap around a few laps, with the consumer stash pulling
+     * several packets at once */
+    for (int lap = 0; lap < 5; lap++) {
+        for (int i = 0; i < 6; i++) {
+            FAIL_IF_NOT(PacketRingEnqueue(r, &pkts[i]));
+        }
+        FAIL_IF_NOT(PacketRingLen(r) == 6);
+        for (int i = 0; i < 6; i++) {
+            FAIL_IF_NOT(PacketRingDequeue(r) == &pkts[i]);
+        }
+        FAIL_IF_NOT(PacketRingDequeue(r) == NULL);
+        FAIL_IF_NOT(PacketRingIsEmpty(r));
+    }
+
+    PacketRingFree(r);
+    PASS;
+}
+#endif /* UNITTESTS */
+
+void PacketRingRegisterTests(void)
+{
+#ifdef UNITTESTS
+    UtRegisterTest("PacketRingTest01", PacketRingTest01);
+    UtRegisterTest("PacketRingTest02", PacketRingTest02);
+#endif
+}
@@ -0,0 +1,80 @@
+/* Copyright (C) 2026 Open Information Security Foundation
+ *
+ * You can copy, redistribute or modify this Program under the terms of
+ * the GNU General Public License version 2 as published by the Free
+ * Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * version 2 along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+/**
+ * \file
+ *
+ * Bounded lock-free multi producer, single consumer packet ring.
+ *
+ * Each slot carries a sequence number that tells producers and the
+ * consumer whether the slot is free for the current lap or holds a
+ * published packet. Producers reserve slots by a CAS on the tail, the
+ * single consumer owns the head and never touches shared counters on
+ * the fast path. Producer and consumer state live on separate cache
+ * lines.
+ */
+
+#ifndef SURICATA_PACKET_RING_H
+#define SURICATA_PACKET_RING_H
+
+#include "threads.h"
+
+/** max packets the consumer pulls from the ring in one go */
+#define PACKET_RING_BATCH 32
+
+#define PACKET_RING_SIZE_DEFAULT 4096
+#define PACKET_RING_SPIN_DEFAULT 1000
+
+typedef struct PacketRingSlot_ {
+    SC_ATOMIC_DECLARE(uint64_t, seq);
+    struct Packet_ *p;
+} PacketRingSlot;
+
+typedef struct PacketRing_ {
+    /* read-only after setup */
+    uint64_t size;
+    uint64_t mask;
+    PacketRingSlot *slots;
+
+    /* producer side */
+    SC_ATOMIC_DECLARE(uint64_t, tail) __attribute__((aligned(CLS)));
+
+    /* set by the consumer before it parks on the queue cond */
+    SC_ATOMIC_DECLARE(bool, sleeping) __attribute__((aligned(CLS)));
+
+    /* consumer side, only written by the reading thread */
+    uint64_t head __attribute__((aligned(CLS)));
+    uint16_t stash_idx;
+    uint16_t stash_cnt;
+    /** packets handed out to the pipeline, used to get the ring len.
+     *  Written with relaxed stores by the consumer only, read by others. */
+    SC_ATOMIC_DECLARE(uint64_t, consumed);
+    struct Packet_ *stash[PACKET_RING_BATCH];
+} PacketRing;
+
+PacketRing *PacketRingAlloc(uint32_t size);
+void PacketRingFree(PacketRing *r);
+
+bool PacketRingEnqueue(PacketRing *r, struct Packet_ *p);
+struct Packet_ *PacketRingDequeue(PacketRing *r);
+
+bool PacketRingIsEmpty(PacketRing *r);
+uint64_t PacketRingLen(PacketRing *r);
+
+void PacketRingRegisterTests(void);
+
+#endif /* SURICATA_PACKET_RING_H */
@@ -133,6 +133,7 @@ void PacketReinit(Packet *p)
         p->alerts.cnt = 0;
     }
     p->pcap_cnt = 0;
+    p->latency_ticks = 0;
     p->tunnel_rtv_cnt = 0;
     p->tunnel_tpr_cnt = 0;
     p->events.cnt = 0;
@@ -100,6 +100,10 @@
 #include "conf.h"
 #include "conf-yaml-loader.h"
 #include "tmqh-flow.h"
+#include "packet-ring.h"
+#include "util-latency.h"
+#include "flow-worker.h"
+#include "util-slab.h"
 #include "defrag.h"
 #include "detect-engine-siggroup.h"
 
@@ -117,6 +121,9 @@
 #include "decode-pppoe.h"
 
 #include "output-json-stats.h"
+#include "output-json-tls.h"
+#include "output-filestore.h"
+#include "counters-openmetrics.h"
 
 #ifdef OS_WIN32
 #include "win32-syscall.h"
@@ -148,6 +155,7 @@ static void RegisterUnittests(void)
     HostBitRegisterTests();
     IPPairBitRegisterTests();
     StatsRegisterTests();
+    StatsOpenMetricsRegisterTests();
     DecodeEthernetRegisterTests();
     DecodeCHDLCRegisterTests();
     DecodePPPRegisterTests();
@@ -171,6 +179,10 @@ static void RegisterUnittests(void)
     SCConfRegisterTests();
     SCConfYamlRegisterTests();
     TmqhFlowRegisterTests();
+    PacketRingRegisterTests();
+    SCLatencyRegisterTests();
+    FlowWorkerRegisterTests();
+    SCSlabRegisterTests();
     FlowRegisterTests();
     HostRegisterUnittests();
     IPPairRegisterUnittests();
@@ -219,6 +231,8 @@ static void RegisterUnittests(void)
     SCProtoNameRegisterTests();
     UtilCIDRTests();
     OutputJsonStatsRegisterTests();
+    JsonTlsLogRegisterTests();
+    OutputFilestoreRegisterTests();
     CoredumpConfigRegisterTests();
 }
 #endif
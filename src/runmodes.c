@@ -49,6 +49,7 @@
 #include "util-plugin.h"
 
 #include "output.h"
+#include "output-filestore.h"
 
 #include "tmqh-flow.h"
 #include "flow-manager.h"
@@ -73,8 +74,9 @@ const char *thread_name_flow_bypass = "FB";
 const char *thread_name_unix_socket = "US";
 const char *thread_name_detect_loader = "DL";
 const char *thread_name_counter_stats = "CS";
-const char *thread_name_counter_wakeup = "CW";
+const char *thread_name_counter_openmetrics = "CO";
 const char *thread_name_heartbeat = "HB";
+const char *thread_name_filestore_writer = "FS";
 
 /**
  * \brief Holds description for a runmode.
@@ -456,6 +458,7 @@ void RunModeDispatch(int runmode, const char *custom_mode, const char *capture_p
         }
         StatsSpawnThreads();
         LogFlushThreads();
+        OutputFilestoreWriterThreadsSpawn();
         TmThreadsSealThreads();
     }
 }
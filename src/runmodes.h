@@ -74,7 +74,8 @@ extern const char *thread_name_flow_rec;
 extern const char *thread_name_unix_socket;
 extern const char *thread_name_detect_loader;
 extern const char *thread_name_counter_stats;
-extern const char *thread_name_counter_wakeup;
+extern const char *thread_name_counter_openmetrics;
+extern const char *thread_name_filestore_writer;
 extern const char *thread_name_heartbeat;
 
 char *RunmodeGetActive(void);
@@ -1457,11 +1457,9 @@ TmEcode ReceiveAFPLoop(ThreadVars *tv, void *data, void *slot)
             AFPSwitchState(ptv, AFP_STATE_DOWN);
             continue;
         }
-        StatsSyncCountersIfSignalled(tv);
     }
 
     AFPDumpCounters(ptv);
-    StatsSyncCountersIfSignalled(tv);
     SCReturnInt(TM_ECODE_OK);
 }
 
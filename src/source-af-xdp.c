@@ -562,8 +562,6 @@ static inline int DumpStatsEverySecond(AFXDPThreadVars *ptv, time_t *last_dump)
         stats_dumped = 1;
     }
 
-    StatsSyncCountersIfSignalled(ptv->tv);
-
     return stats_dumped;
 }
 
@@ -308,8 +308,6 @@ TmEcode ReceiveIPFWLoop(ThreadVars *tv, void *data, void *slot)
                 != TM_ECODE_OK) {
             SCReturnInt(TM_ECODE_FAILED);
         }
-
-        StatsSyncCountersIfSignalled(tv);
     }
 
     SCReturnInt(TM_ECODE_OK);
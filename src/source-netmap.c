@@ -825,7 +825,6 @@ static TmEcode ReceiveNetmapLoop(ThreadVars *tv, void *data, void *slot)
             /* no events, timeout */
             /* sync counters */
             NetmapDumpCounters(ntv);
-            StatsSyncCountersIfSignalled(tv);
 
             /* poll timed out, lets handle the timeout */
             TmThreadsCaptureHandleTimeout(tv, NULL);
@@ -848,11 +847,9 @@ static TmEcode ReceiveNetmapLoop(ThreadVars *tv, void *data, void *slot)
         }
 
         NetmapDumpCounters(ntv);
-        StatsSyncCountersIfSignalled(tv);
     }
 
     NetmapDumpCounters(ntv);
-    StatsSyncCountersIfSignalled(tv);
     SCReturnInt(TM_ECODE_OK);
 }
 
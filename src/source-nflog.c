@@ -469,8 +469,6 @@ TmEcode ReceiveNFLOGLoop(ThreadVars *tv, void *data, void *slot)
         ret = nflog_handle_packet(ntv->h, ntv->data, rv);
         if (ret != 0)
             SCLogWarning("nflog_handle_packet error %" PRId32 "", ret);
-
-        StatsSyncCountersIfSignalled(tv);
     }
 
     SCReturnInt(TM_ECODE_OK);
@@ -1036,8 +1036,6 @@ TmEcode ReceiveNFQLoop(ThreadVars *tv, void *data, void *slot)
             break;
         }
         NFQRecvPkt(nq, ntv);
-
-        StatsSyncCountersIfSignalled(tv);
     }
     SCReturnInt(TM_ECODE_OK);
 }
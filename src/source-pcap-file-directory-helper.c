@@ -531,8 +531,6 @@ TmEcode PcapDirectoryDispatch(PcapFileDirectoryVars *ptv)
         }
     }
 
-    StatsSyncCountersIfSignalled(ptv->shared->tv);
-
     if (status == TM_ECODE_FAILED) {
         SCLogError("Directory %s run mode failed", ptv->filename);
         status = PcapDirectoryFailure(ptv);
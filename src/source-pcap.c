@@ -436,12 +436,9 @@ static TmEcode ReceivePcapLoop(ThreadVars *tv, void *data, void *slot)
             SCLogError("Pcap callback PcapCallbackLoop failed");
             SCReturnInt(TM_ECODE_FAILED);
         }
-
-        StatsSyncCountersIfSignalled(tv);
     }
 
     PcapDumpCounters(ptv);
-    StatsSyncCountersIfSignalled(tv);
     SCReturnInt(TM_ECODE_OK);
 }
 
@@ -419,8 +419,6 @@ TmEcode ReceiveWinDivertLoop(ThreadVars *tv, void *data, void *slot)
         if (unlikely(WinDivertRecvHelper(tv, wd_tv) != TM_ECODE_OK)) {
             SCReturnInt(TM_ECODE_FAILED);
         }
-
-        StatsSyncCountersIfSignalled(tv);
     }
 
     SCReturnInt(TM_ECODE_OK);
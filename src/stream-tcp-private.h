@@ -132,6 +132,8 @@ typedef struct TcpStream_ {
                                      *   remains available for inspection together with app layer buffers */
     uint32_t data_required;         /**< data required from STREAM_APP_PROGRESS before calling app-layer again */
 
+    struct DetectStreamMpmState_ *mpm_state; /**< inline stream mpm state, if enabled */
+
     StreamingBuffer sb;
     struct TCPSEG seg_tree;         /**< red black tree of TCP segments. Data is stored in TcpStream::sb */
     uint32_t segs_right_edge;
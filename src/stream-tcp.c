@@ -31,6 +31,7 @@
 #include "packet.h"
 #include "decode.h"
 #include "detect.h"
+#include "detect-engine-payload.h"
 
 #include "flow.h"
 #include "flow-util.h"
@@ -303,6 +304,8 @@ void StreamTcpStreamCleanup(TcpStream *stream)
         StreamTcpSackFreeList(stream);
         StreamTcpReturnStreamSegments(stream);
         StreamingBufferClear(&stream->sb, &stream_config.sbcnf);
+        DetectStreamMpmStateFree(stream->mpm_state);
+        stream->mpm_state = NULL;
     }
 }
 
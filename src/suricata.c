@@ -126,6 +126,8 @@
 #include "util-hugepages.h"
 #include "util-ioctl.h"
 #include "util-landlock.h"
+#include "util-latency.h"
+#include "util-slab.h"
 #include "util-macset.h"
 #include "util-flow-rate.h"
 #include "util-misc.h"
@@ -406,6 +408,7 @@ void GlobalsDestroy(void)
     DetectEngineClearMaster();
 
     AppLayerDeSetup();
+    SCSlabShutdown();
     DatasetsSave();
     DatasetsDestroy();
     OutputTxShutdown();
@@ -2289,6 +2292,7 @@ void PreRunInit(const int runmode)
         return;
 
     StatsInit();
+    SCLatencyInit();
 #ifdef PROFILE_RULES
     SCProfilingRulesGlobalInit();
 #endif
@@ -314,6 +314,36 @@ static int DetectEngineContentInspectionTest17(void)
     TEST_FOOTER;
 }
 
+#define TEST_FAST_PATH(sig, fast)                                                                  \
+    {                                                                                              \
+        DetectEngineCtx *de_ctx = DetectEngineCtxInit();                                           \
+        FAIL_IF_NULL(de_ctx);                                                                      \
+        char rule[2048];                                                                           \
+        snprintf(rule, sizeof(rule), "alert tcp any any -> any any (%s sid:1; rev:1;)", (sig));    \
+        Signature *s = DetectEngineAppendSig(de_ctx, rule);                                        \
+        FAIL_IF_NULL(s);                                                                           \
+        SigGroupBuild(de_ctx);                                                                     \
+        FAIL_IF_NULL(s->sm_arrays[DETECT_SM_LIST_PMATCH]);                                         \
+        FAIL_IF_NOT(s->sm_arrays[DETECT_SM_LIST_PMATCH]->ci_fast == (fast));                       \
+        DetectEngineCtxFree(de_ctx);                                                               \
+    }
+
+/** \test selection of the specialized inspection routines */
+static int DetectEngineContentInspectionTest18(void)
+{
+    TEST_FAST_PATH("content:\"abc\"; nocase;", DETECT_CI_FAST_CONTENT);
+    TEST_FAST_PATH("content:\"abc\"; offset:2; depth:10;", DETECT_CI_FAST_CONTENT);
+    TEST_FAST_PATH("content:!\"abc\";", DETECT_CI_FAST_CONTENT_CHAIN);
+    TEST_FAST_PATH("content:\"abc\"; content:\"d\"; distance:0; within:4; isdataat:2,relative;",
+            DETECT_CI_FAST_CONTENT_CHAIN);
+    TEST_FAST_PATH("content:\"abc\"; pcre:\"/d/R\";", DETECT_CI_FAST_NONE);
+    TEST_FAST_PATH("content:\"abc\"; byte_extract:1,0,x,relative; content:\"d\"; distance:x;",
+            DETECT_CI_FAST_NONE);
+    TEST_FOOTER;
+}
+
+#undef TEST_FAST_PATH
+
 void DetectEngineContentInspectionRegisterTests(void)
 {
     UtRegisterTest("DetectEngineContentInspectionTest01",
@@ -346,6 +376,8 @@ void DetectEngineContentInspectionRegisterTests(void)
             DetectEngineContentInspectionTest14);
     UtRegisterTest("DetectEngineContentInspectionTest17 negative distance",
             DetectEngineContentInspectionTest17);
+    UtRegisterTest("DetectEngineContentInspectionTest18 fast path selection",
+            DetectEngineContentInspectionTest18);
 }
 
 #undef TEST_HEADER
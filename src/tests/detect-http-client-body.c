@@ -821,6 +821,65 @@ libhtp:\n\
     return RunTest(steps, sig, yaml);
 }
 
+static const char stream_yaml[] = "\
+%YAML 1.1\n\
+---\n\
+libhtp:\n\
+\n\
+  default-config:\n\
+    personality: IDS\n\
+    request-body-limit: 0\n\
+    request-body-inspect-window: 4096\n\
+    request-body-minimal-inspect-size: 0\n\
+\n\
+detect:\n\
+  prefilter:\n\
+    streaming: yes\n\
+";
+
+/** \test streaming prefilter: the fast pattern was in the data scanned
+ *        before, so the sig is revisited from the stored state */
+static int DetectEngineHttpClientBodyTest32(void)
+{
+    struct TestSteps steps[] = {
+        {   (const uint8_t *)"GET /index.html HTTP/1.1\r\n"
+            "Host: www.openinfosecfoundation.org\r\n"
+            "Content-Type: text/html\r\n"
+            "Content-Length: 46\r\n"
+            "\r\n"
+            "This is dummy body1",
+            0, STREAM_TOSERVER, 0 },
+        {   (const uint8_t *)"This is dummy message body2",
+            0, STREAM_TOSERVER, 1 },
+        {   NULL, 0, 0, 0 },
+    };
+
+    const char *sig = "alert http any any -> any any (http.request_body; "
+                      "content:\"body1\"; fast_pattern; content:\"body2\"; distance:0; sid:1;)";
+    return RunTest(steps, sig, stream_yaml);
+}
+
+/** \test streaming prefilter: fast pattern crossing the old and new data */
+static int DetectEngineHttpClientBodyTest33(void)
+{
+    struct TestSteps steps[] = {
+        {   (const uint8_t *)"GET /index.html HTTP/1.1\r\n"
+            "Host: www.openinfosecfoundation.org\r\n"
+            "Content-Type: text/html\r\n"
+            "Content-Length: 46\r\n"
+            "\r\n"
+            "This is dummy body1",
+            0, STREAM_TOSERVER, 0 },
+        {   (const uint8_t *)"This is dummy message body2",
+            0, STREAM_TOSERVER, 1 },
+        {   NULL, 0, 0, 0 },
+    };
+
+    const char *sig = "alert http any any -> any any (http.request_body; "
+                      "content:\"body1This\"; sid:1;)";
+    return RunTest(steps, sig, stream_yaml);
+}
+
 /**
  * \test Test that a signature containing a http_client_body is correctly parsed
  *       and the keyword is registered.
@@ -2948,6 +3007,8 @@ void DetectHttpClientBodyRegisterTests(void)
                    DetectEngineHttpClientBodyTest30);
     UtRegisterTest("DetectEngineHttpClientBodyTest31",
                    DetectEngineHttpClientBodyTest31);
+    UtRegisterTest("DetectEngineHttpClientBodyTest32", DetectEngineHttpClientBodyTest32);
+    UtRegisterTest("DetectEngineHttpClientBodyTest33", DetectEngineHttpClientBodyTest33);
 }
 
 #endif
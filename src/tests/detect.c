@@ -24,6 +24,7 @@
 #include "../detect-engine-build.h"
 #include "../pkt-var.h"
 #include "../flow-util.h"
+#include "../flow-bit.h"
 #include "../stream-tcp-reassemble.h"
 #include "../util-unittest.h"
 #include "../util-var-name.h"
@@ -4957,6 +4958,103 @@ end:
     return result;
 }
 
+/** \test payloadless packets skip the packet rules after the first
+ *        evaluation until a flowbit changes */
+static int SigTestPktDigest01(void)
+{
+    ThreadVars tv;
+    memset(&tv, 0, sizeof(tv));
+    DetectEngineThreadCtx *det_ctx = NULL;
+
+    Flow f;
+    memset(&f, 0, sizeof(f));
+    FLOW_INITIALIZE(&f);
+    f.proto = IPPROTO_TCP;
+
+    Packet *p = UTHBuildPacket(NULL, 0, IPPROTO_TCP);
+    FAIL_IF_NULL(p);
+    p->flow = &f;
+    p->flags |= PKT_HAS_FLOW | PKT_STREAM_EST;
+    p->flowflags |= FLOW_PKT_TOSERVER | FLOW_PKT_ESTABLISHED;
+
+    DetectEngineCtx *de_ctx = DetectEngineCtxInit();
+    FAIL_IF_NULL(de_ctx);
+    de_ctx->flags |= DE_QUIET;
+
+    FAIL_IF_NULL(DetectEngineAppendSig(de_ctx, "alert tcp any any -> any any "
+                                               "(flow:established; flags:A; "
+                                               "flowbits:isset,digest; sid:1;)"));
+    SigGroupBuild(de_ctx);
+    DetectEngineThreadCtxInit(&tv, (void *)de_ctx, (void *)&det_ctx);
+
+    SigMatchSignatures(&tv, de_ctx, det_ctx, p);
+    FAIL_IF(PacketAlertCheck(p, 1));
+    FAIL_IF_NOT(f.sgh_toserver != NULL);
+    FAIL_IF_NOT(f.sgh_toserver->flags & SIG_GROUP_HEAD_PKT_DIGEST);
+    const uint64_t digest = f.pkt_digest[0];
+    FAIL_IF(digest == 0);
+
+    /* same packet again: digest unchanged, no alert */
+    SigMatchSignatures(&tv, de_ctx, det_ctx, p);
+    FAIL_IF(PacketAlertCheck(p, 1));
+    FAIL_IF_NOT(f.pkt_digest[0] == digest);
+
+    /* setting the flowbit clears the digest, so the rule is evaluated */
+    const uint32_t idx = VarNameStoreLookupByName("digest", VAR_TYPE_FLOW_BIT);
+    FAIL_IF(idx == 0);
+    FAIL_IF_NOT(FlowBitSet(&f, idx) == 1);
+    FAIL_IF_NOT(f.pkt_digest[0] == 0);
+    SigMatchSignatures(&tv, de_ctx, det_ctx, p);
+    FAIL_IF_NOT(PacketAlertCheck(p, 1));
+    FAIL_IF_NOT(f.pkt_digest[0] == 0);
+
+    DetectEngineThreadCtxDeinit(&tv, det_ctx);
+    DetectEngineCtxFree(de_ctx);
+    UTHFreePackets(&p, 1);
+    FLOW_DESTROY(&f);
+    PASS;
+}
+
+/** \test rules with keywords outside of the digest disable it */
+static int SigTestPktDigest02(void)
+{
+    ThreadVars tv;
+    memset(&tv, 0, sizeof(tv));
+    DetectEngineThreadCtx *det_ctx = NULL;
+
+    Flow f;
+    memset(&f, 0, sizeof(f));
+    FLOW_INITIALIZE(&f);
+    f.proto = IPPROTO_TCP;
+
+    Packet *p = UTHBuildPacket(NULL, 0, IPPROTO_TCP);
+    FAIL_IF_NULL(p);
+    p->flow = &f;
+    p->flags |= PKT_HAS_FLOW | PKT_STREAM_EST;
+    p->flowflags |= FLOW_PKT_TOSERVER | FLOW_PKT_ESTABLISHED;
+
+    DetectEngineCtx *de_ctx = DetectEngineCtxInit();
+    FAIL_IF_NULL(de_ctx);
+    de_ctx->flags |= DE_QUIET;
+
+    FAIL_IF_NULL(DetectEngineAppendSig(de_ctx, "alert tcp any any -> any any "
+                                               "(flags:A; seq:12345678; sid:1;)"));
+    SigGroupBuild(de_ctx);
+    DetectEngineThreadCtxInit(&tv, (void *)de_ctx, (void *)&det_ctx);
+
+    SigMatchSignatures(&tv, de_ctx, det_ctx, p);
+    FAIL_IF(PacketAlertCheck(p, 1));
+    FAIL_IF_NOT(f.sgh_toserver != NULL);
+    FAIL_IF(f.sgh_toserver->flags & SIG_GROUP_HEAD_PKT_DIGEST);
+    FAIL_IF_NOT(f.pkt_digest[0] == 0);
+
+    DetectEngineThreadCtxDeinit(&tv, det_ctx);
+    DetectEngineCtxFree(de_ctx);
+    UTHFreePackets(&p, 1);
+    FLOW_DESTROY(&f);
+    PASS;
+}
+
 void SigRegisterTests(void)
 {
     SigParseRegisterTests();
@@ -5062,6 +5160,8 @@ void SigRegisterTests(void)
 
     UtRegisterTest("SigTestPorts01", SigTestPorts01);
     UtRegisterTest("SigTestBug01", SigTestBug01);
+    UtRegisterTest("SigTestPktDigest01", SigTestPktDigest01);
+    UtRegisterTest("SigTestPktDigest02", SigTestPktDigest02);
 
     DetectEngineContentInspectionRegisterTests();
 }
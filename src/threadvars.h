@@ -136,6 +136,9 @@ typedef struct ThreadVars_ {
     struct FlowQueue_ *flow_queue;
     bool break_loop;
 
+    /** sampled pipeline latency histograms, NULL if disabled */
+    struct SCLatencyThreadCtx_ *latency_ctx;
+
     /** Interface-specific thread affinity */
     char *iface_name;
 
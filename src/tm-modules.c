@@ -157,7 +157,6 @@ void TmModuleRegisterTests(void)
 #endif /* UNITTESTS */
 }
 
-#ifdef PROFILING
 #define CASE_CODE(E)  case E: return #E
 
 /**
@@ -214,4 +213,3 @@ const char * TmModuleTmmIdToString(TmmId id)
     }
     return "<unknown>";
 }
-#endif
@@ -89,6 +89,7 @@ void TmqResetQueues(void)
         if (tmq->pq) {
             PacketQueueFree(tmq->pq);
         }
+        PacketRingFree(tmq->ring);
         SCFree(tmq);
     }
     tmq_id = 0;
@@ -25,6 +25,7 @@
 #define SURICATA_TM_QUEUES_H
 
 #include "packet-queue.h"
+#include "packet-ring.h"
 
 typedef struct Tmq_ {
     char *name;
@@ -33,6 +34,9 @@ typedef struct Tmq_ {
     uint16_t reader_cnt;
     uint16_t writer_cnt;
     PacketQueue *pq;
+    /** lock-free ring used for packets by the autofp flow queue
+     *  handler in 'ring' mode. NULL otherwise. */
+    PacketRing *ring;
     TAILQ_ENTRY(Tmq_) next;
 } Tmq;
 
@@ -43,6 +43,7 @@
 #include "util-cpu.h"
 #include "util-optimize.h"
 #include "util-profiling.h"
+#include "util-latency.h"
 #include "util-signal.h"
 #include "queue.h"
 #include "util-validate.h"
@@ -132,9 +133,17 @@ TmEcode TmThreadsProcessDecodePseudoPackets(
  */
 TmEcode TmThreadsSlotVarRun(ThreadVars *tv, Packet *p, TmSlot *slot)
 {
+    bool prev_sampled;
+    const bool sampled = SCLatencySampleStart(tv, &prev_sampled);
+    const uint64_t start = sampled ? UtilCpuGetTicks() : 0;
+
     for (TmSlot *s = slot; s != NULL; s = s->slot_next) {
         PACKET_PROFILING_TMM_START(p, s->tm_id);
+        const uint64_t slot_start = sampled ? UtilCpuGetTicks() : 0;
         TmEcode r = s->SlotFunc(tv, p, SC_ATOMIC_GET(s->slot_data));
+        if (unlikely(sampled)) {
+            SCLatencyRecordSlot(tv, s->tm_id, UtilCpuGetTicks() - slot_start);
+        }
         PACKET_PROFILING_TMM_END(p, s->tm_id);
         DEBUG_VALIDATE_BUG_ON(p->flow != NULL);
 
@@ -142,16 +151,22 @@ TmEcode TmThreadsSlotVarRun(ThreadVars *tv, Packet *p, TmSlot *slot)
         if (unlikely(r == TM_ECODE_FAILED)) {
             /* Encountered error.  Return packets to packetpool and return */
             TmThreadsSlotProcessPktFail(tv, NULL);
+            SCLatencySampleEnd(tv, prev_sampled);
             return TM_ECODE_FAILED;
         }
         if (s->tm_flags & TM_FLAG_DECODE_TM) {
             if (TmThreadsProcessDecodePseudoPackets(tv, &tv->decode_pq, s->slot_next) !=
                     TM_ECODE_OK) {
+                SCLatencySampleEnd(tv, prev_sampled);
                 return TM_ECODE_FAILED;
             }
         }
     }
 
+    if (unlikely(sampled)) {
+        SCLatencyRecordPipeline(tv, UtilCpuGetTicks() - start);
+    }
+    SCLatencySampleEnd(tv, prev_sampled);
     return TM_ECODE_OK;
 }
 
@@ -199,7 +214,6 @@ int TmThreadTimeoutLoop(ThreadVars *tv, TmSlot *s)
         }
     }
     SCLogDebug("flow end loop complete");
-    StatsSyncCounters(tv);
 
     return r;
 }
@@ -260,6 +274,7 @@ static bool TmThreadsSlotPktAcqLoopInit(ThreadVars *tv)
         }
     }
 
+    SCLatencyThreadInit(tv);
     StatsSetupPrivate(tv);
 
     TmThreadsSetFlag(tv, THV_INIT_DONE);
@@ -275,8 +290,6 @@ bool SCTmThreadsSlotPacketLoopFinish(ThreadVars *tv)
     TmSlot *s = tv->tm_slots;
     bool rc = true;
 
-    StatsSyncCounters(tv);
-
     TmThreadsSetFlag(tv, THV_FLOW_LOOP);
 
     /* process all pseudo packets the flow timeout may throw at us */
@@ -475,6 +488,7 @@ static void *TmThreadsSlotVar(void *td)
         }
     }
 
+    SCLatencyThreadInit(tv);
     StatsSetupPrivate(tv);
 
     // Each 'worker' thread uses this func to process/decode the packet read.
@@ -524,7 +538,6 @@ static void *TmThreadsSlotVar(void *td)
     if (!SCTmThreadsSlotPacketLoopFinish(tv)) {
         goto error;
     }
-    StatsSyncCounters(tv);
 
     pthread_exit(NULL);
     return NULL;
@@ -574,10 +587,6 @@ static void *TmThreadsManagement(void *td)
         TmThreadsSetFlag(tv, THV_FAILED);
     }
 
-    if (TmThreadsCheckFlag(tv, THV_KILL)) {
-        StatsSyncCounters(tv);
-    }
-
     TmThreadsSetFlag(tv, THV_RUNNING_DONE);
     TmThreadWaitForFlag(tv, THV_DEINIT);
 
@@ -1222,6 +1231,9 @@ static bool ThreadStillHasPackets(ThreadVars *tv)
         if (len != 0) {
             return true;
         }
+        if (tv->inq->ring != NULL && PacketRingLen(tv->inq->ring) != 0) {
+            return true;
+        }
     }
 
     if (tv->stream_pq != NULL) {
@@ -1646,6 +1658,7 @@ static void TmThreadFree(ThreadVars *tv)
     }
 
     StatsThreadCleanup(tv);
+    SCLatencyThreadFree(tv);
 
     TmThreadDeinitMC(tv);
 
@@ -39,15 +39,58 @@
 
 #include "conf.h"
 #include "util-unittest.h"
+#include "tm-threads.h"
+#include "util-latency.h"
+#include "util-cpu.h"
 
 Packet *TmqhInputFlow(ThreadVars *t);
 void TmqhOutputFlowHash(ThreadVars *t, Packet *p);
 void TmqhOutputFlowIPPair(ThreadVars *t, Packet *p);
 static void TmqhOutputFlowFTPHash(ThreadVars *t, Packet *p);
+static Packet *TmqhInputFlowRing(ThreadVars *t);
 void *TmqhOutputFlowSetupCtx(const char *queue_str);
 void TmqhOutputFlowFreeCtx(void *ctx);
 void TmqhFlowRegisterTests(void);
 
+/** use the lock-free rings instead of the mutex protected queues */
+static bool flow_queue_ring = false;
+static uint32_t flow_ring_size = PACKET_RING_SIZE_DEFAULT;
+static uint32_t flow_ring_spin = PACKET_RING_SPIN_DEFAULT;
+
+static void TmqhFlowQueueConfig(void)
+{
+    const char *type = NULL;
+    if (SCConfGet("autofp-queue.type", &type) == 1) {
+        if (strcasecmp(type, "ring") == 0) {
+            flow_queue_ring = true;
+        } else if (strcasecmp(type, "mutex") != 0) {
+            FatalError("Invalid entry \"%s\" for autofp-queue.type in conf, "
+                       "expected \"mutex\" or \"ring\"",
+                    type);
+        }
+    }
+    if (!flow_queue_ring)
+        return;
+
+    intmax_t val = 0;
+    if (SCConfGetInt("autofp-queue.ring-size", &val) == 1) {
+        if (val < 2 || val > (1 << 20)) {
+            FatalError("Invalid value %" PRIdMAX " for autofp-queue.ring-size, "
+                       "should be between 2 and 1048576",
+                    val);
+        }
+        flow_ring_size = (uint32_t)val;
+    }
+    if (SCConfGetInt("autofp-queue.spin", &val) == 1) {
+        if (val < 0 || val > UINT16_MAX) {
+            FatalError("Invalid value %" PRIdMAX " for autofp-queue.spin, "
+                       "should be between 0 and 65535",
+                    val);
+        }
+        flow_ring_spin = (uint32_t)val;
+    }
+}
+
 void TmqhFlowRegister(void)
 {
     tmqh_table[TMQH_FLOW].name = "flow";
@@ -56,6 +99,11 @@ void TmqhFlowRegister(void)
     tmqh_table[TMQH_FLOW].OutHandlerCtxFree = TmqhOutputFlowFreeCtx;
     tmqh_table[TMQH_FLOW].RegisterTests = TmqhFlowRegisterTests;
 
+    TmqhFlowQueueConfig();
+    if (flow_queue_ring) {
+        tmqh_table[TMQH_FLOW].InHandler = TmqhInputFlowRing;
+    }
+
     const char *scheduler = NULL;
     if (SCConfGet("autofp-scheduler", &scheduler) == 1) {
         if (strcasecmp(scheduler, "round-robin") == 0) {
@@ -92,6 +140,10 @@ void TmqhFlowPrintAutofpHandler(void)
     PRINT_IF_FUNC(TmqhOutputFlowFTPHash, "FTPHash");
 
 #undef PRINT_IF_FUNC
+
+    if (flow_queue_ring) {
+        SCLogConfig("AutoFP mode using lock-free ring queues of %u packets", flow_ring_size);
+    }
 }
 
 /* same as 'simple' */
@@ -99,8 +151,6 @@ Packet *TmqhInputFlow(ThreadVars *tv)
 {
     PacketQueue *q = tv->inq->pq;
 
-    StatsSyncCountersIfSignalled(tv);
-
     SCMutexLock(&q->mutex_q);
     if (q->len == 0) {
         /* if we have no packets in queue, wait... */
@@ -110,6 +160,10 @@ Packet *TmqhInputFlow(ThreadVars *tv)
     if (q->len > 0) {
         Packet *p = PacketDequeue(q);
         SCMutexUnlock(&q->mutex_q);
+        if (unlikely(p->latency_ticks != 0)) {
+            SCLatencyRecordQueue(tv, p->latency_ticks);
+            p->latency_ticks = 0;
+        }
         return p;
     } else {
         /* return NULL if we have no pkt. Should only happen on signals. */
@@ -118,6 +172,63 @@ Packet *TmqhInputFlow(ThreadVars *tv)
     }
 }
 
+/**
+ *  \brief input handler for the ring mode
+ *
+ *  Spins on the ring for a while before parking on the queue cond. The
+ *  locked queue is still checked as the flow manager injects pseudo
+ *  packets there.
+ */
+static Packet *TmqhInputFlowRing(ThreadVars *tv)
+{
+    PacketRing *r = tv->inq->ring;
+    PacketQueue *q = tv->inq->pq;
+    Packet *p = NULL;
+
+    if (unlikely(r == NULL))
+        return TmqhInputFlow(tv);
+
+    for (uint32_t i = 0; i <= flow_ring_spin; i++) {
+        p = PacketRingDequeue(r);
+        if (p != NULL)
+            goto done;
+
+        if (q->len > 0) {
+            SCMutexLock(&q->mutex_q);
+            p = PacketDequeue(q);
+            SCMutexUnlock(&q->mutex_q);
+            if (p != NULL)
+                goto done;
+        }
+        UtilCpuRelax();
+    }
+
+    /* nothing showed up while spinning, so go to sleep. Writers check
+     * 'sleeping' after publishing their packet, so either we see their
+     * packet here or they will signal us. */
+    SCMutexLock(&q->mutex_q);
+    SC_ATOMIC_SET(r->sleeping, true);
+    if (q->len == 0 && PacketRingIsEmpty(r)) {
+        SCCondWait(&q->cond_q, &q->mutex_q);
+    }
+    SC_ATOMIC_SET(r->sleeping, false);
+    if (q->len > 0) {
+        p = PacketDequeue(q);
+    }
+    SCMutexUnlock(&q->mutex_q);
+
+    if (p == NULL) {
+        /* return NULL if we have no pkt. Should only happen on signals. */
+        p = PacketRingDequeue(r);
+    }
+done:
+    if (p != NULL && unlikely(p->latency_ticks != 0)) {
+        SCLatencyRecordQueue(tv, p->latency_ticks);
+        p->latency_ticks = 0;
+    }
+    return p;
+}
+
 static int StoreQueueId(TmqhFlowCtx *ctx, char *name)
 {
     void *ptmp;
@@ -149,6 +260,15 @@ static int StoreQueueId(TmqhFlowCtx *ctx, char *name)
     }
     ctx->queues[ctx->size - 1].q = tmq->pq;
 
+    if (flow_queue_ring) {
+        if (tmq->ring == NULL) {
+            tmq->ring = PacketRingAlloc(flow_ring_size);
+            if (tmq->ring == NULL)
+                return -1;
+        }
+        ctx->queues[ctx->size - 1].ring = tmq->ring;
+    }
+
     return 0;
 }
 
@@ -213,10 +333,70 @@ void TmqhOutputFlowFreeCtx(void *ctx)
 
     SCLogPerf("AutoFP - Total flow handler queues - %" PRIu16,
               fctx->size);
+    for (uint16_t i = 0; i < fctx->size; i++) {
+        if (fctx->queues[i].ring_full > 0) {
+            SCLogPerf("AutoFP - queue %" PRIu16 ": %" PRIu64 " packets waited for a full ring", i,
+                    fctx->queues[i].ring_full);
+        }
+    }
     SCFree(fctx->queues);
     SCFree(fctx);
 }
 
+static inline void TmqhFlowRingWakeup(PacketQueue *q)
+{
+    SCMutexLock(&q->mutex_q);
+    SCCondSignal(&q->cond_q);
+    SCMutexUnlock(&q->mutex_q);
+}
+
+/** spins on a full ring before the writer starts sleeping */
+#define FLOW_RING_FULL_SPIN 64
+/** upper bound of the sleep between retries on a full ring */
+#define FLOW_RING_FULL_SLEEP_MAX_USEC 128
+
+static void TmqhFlowRingEnqueue(TmqhFlowMode *m, Packet *p)
+{
+    PacketRing *r = m->ring;
+    if (unlikely(!PacketRingEnqueue(r, p))) {
+        /* ring is full: the reader is behind. Make sure it is awake
+         * and back off until it makes room. */
+        m->ring_full++;
+        uint32_t tries = 0;
+        uint32_t sleep_usec = 1;
+        do {
+            if (SC_ATOMIC_GET(r->sleeping))
+                TmqhFlowRingWakeup(m->q);
+            if (++tries < FLOW_RING_FULL_SPIN) {
+                UtilCpuRelax();
+            } else {
+                SleepUsec(sleep_usec);
+                sleep_usec = MIN(sleep_usec * 2, FLOW_RING_FULL_SLEEP_MAX_USEC);
+            }
+        } while (!PacketRingEnqueue(r, p));
+    }
+    if (SC_ATOMIC_GET(r->sleeping))
+        TmqhFlowRingWakeup(m->q);
+}
+
+static inline void TmqhFlowEnqueue(ThreadVars *tv, TmqhFlowMode *m, Packet *p)
+{
+    if (unlikely(SCLatencyIsSampled(tv))) {
+        p->latency_ticks = UtilCpuGetTicks();
+    }
+
+    if (m->ring != NULL) {
+        TmqhFlowRingEnqueue(m, p);
+        return;
+    }
+
+    PacketQueue *q = m->q;
+    SCMutexLock(&q->mutex_q);
+    PacketEnqueue(q, p);
+    SCCondSignal(&q->cond_q);
+    SCMutexUnlock(&q->mutex_q);
+}
+
 void TmqhOutputFlowHash(ThreadVars *tv, Packet *p)
 {
     uint32_t qid;
@@ -232,11 +412,7 @@ void TmqhOutputFlowHash(ThreadVars *tv, Packet *p)
             ctx->last = 0;
     }
 
-    PacketQueue *q = ctx->queues[qid].q;
-    SCMutexLock(&q->mutex_q);
-    PacketEnqueue(q, p);
-    SCCondSignal(&q->cond_q);
-    SCMutexUnlock(&q->mutex_q);
+    TmqhFlowEnqueue(tv, &ctx->queues[qid], p);
 }
 
 /**
@@ -260,11 +436,7 @@ void TmqhOutputFlowIPPair(ThreadVars *tv, Packet *p)
     }
 
     uint32_t qid = addr_hash % ctx->size;
-    PacketQueue *q = ctx->queues[qid].q;
-    SCMutexLock(&q->mutex_q);
-    PacketEnqueue(q, p);
-    SCCondSignal(&q->cond_q);
-    SCMutexUnlock(&q->mutex_q);
+    TmqhFlowEnqueue(tv, &ctx->queues[qid], p);
 }
 
 static void TmqhOutputFlowFTPHash(ThreadVars *tv, Packet *p)
@@ -286,11 +458,7 @@ static void TmqhOutputFlowFTPHash(ThreadVars *tv, Packet *p)
             ctx->last = 0;
     }
 
-    PacketQueue *q = ctx->queues[qid].q;
-    SCMutexLock(&q->mutex_q);
-    PacketEnqueue(q, p);
-    SCCondSignal(&q->cond_q);
-    SCMutexUnlock(&q->mutex_q);
+    TmqhFlowEnqueue(tv, &ctx->queues[qid], p);
 }
 
 #ifdef UNITTESTS
@@ -26,6 +26,9 @@
 
 typedef struct TmqhFlowMode_ {
     PacketQueue *q;
+    PacketRing *ring; /**< set in 'ring' mode, 'q' is then only used to
+                           wake up the reader */
+    uint64_t ring_full; /**< packets that had to wait for room in 'ring' */
 } TmqhFlowMode;
 
 /** \brief Ctx for the flow queue handler
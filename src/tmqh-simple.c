@@ -48,8 +48,6 @@ Packet *TmqhInputSimple(ThreadVars *t)
 {
     PacketQueue *q = t->inq->pq;
 
-    StatsSyncCountersIfSignalled(t);
-
     SCMutexLock(&q->mutex_q);
 
     if (q->len == 0) {
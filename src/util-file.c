@@ -641,6 +641,23 @@ static int FileStoreNoStoreCheck(File *ff)
     SCReturnInt(0);
 }
 
+/** \internal
+ *  \brief update the hashes of the file
+ *
+ *  All enabled hashes are updated in a single pass over the data.
+ *
+ *  \retval true if at least one hash is enabled
+ */
+static inline bool FileHashUpdate(File *ff, const uint8_t *data, uint32_t data_len)
+{
+    if (ff->md5_ctx == NULL && ff->sha1_ctx == NULL && ff->sha256_ctx == NULL)
+        return false;
+
+    SCLogDebug("file %p data %p data_len %u", ff, data, data_len);
+    SCHashUpdateMulti(ff->md5_ctx, ff->sha1_ctx, ff->sha256_ctx, data, data_len);
+    return true;
+}
+
 static int AppendData(
         const StreamingBufferConfig *sbcfg, File *file, const uint8_t *data, uint32_t data_len)
 {
@@ -653,18 +670,7 @@ static int AppendData(
         SCReturnInt(-1);
     }
 
-    if (file->md5_ctx) {
-        SCMd5Update(file->md5_ctx, data, data_len);
-    }
-    if (file->sha1_ctx) {
-        SCSha1Update(file->sha1_ctx, data, data_len);
-    }
-    if (file->sha256_ctx) {
-        SCLogDebug("SHA256 file %p data %p data_len %u", file, data, data_len);
-        SCSha256Update(file->sha256_ctx, data, data_len);
-    } else {
-        SCLogDebug("NO SHA256 file %p data %p data_len %u", file, data, data_len);
-    }
+    FileHashUpdate(file, data, data_len);
     SCReturnInt(0);
 }
 
@@ -712,23 +718,8 @@ static int FileAppendDataDo(
     }
 
     if (g_detect_disabled && FileStoreNoStoreCheck(ff) == 1) {
-        int hash_done = 0;
         /* no storage but forced hashing */
-        if (ff->md5_ctx) {
-            SCMd5Update(ff->md5_ctx, data, data_len);
-            hash_done = 1;
-        }
-        if (ff->sha1_ctx) {
-            SCSha1Update(ff->sha1_ctx, data, data_len);
-            hash_done = 1;
-        }
-        if (ff->sha256_ctx) {
-            SCLogDebug("file %p data %p data_len %u", ff, data, data_len);
-            SCSha256Update(ff->sha256_ctx, data, data_len);
-            hash_done = 1;
-        }
-
-        if (hash_done)
+        if (FileHashUpdate(ff, data, data_len))
             SCReturnInt(0);
 
         if (g_file_force_tracking || (!(ff->flags & FILE_NOTRACK)))
@@ -993,14 +984,7 @@ int FileCloseFilePtr(File *ff, const StreamingBufferConfig *sbcfg, const uint8_t
     if (data != NULL) {
         if (ff->flags & FILE_NOSTORE) {
             /* no storage but hashing */
-            if (ff->md5_ctx)
-                SCMd5Update(ff->md5_ctx, data, data_len);
-            if (ff->sha1_ctx)
-                SCSha1Update(ff->sha1_ctx, data, data_len);
-            if (ff->sha256_ctx) {
-                SCLogDebug("file %p data %p data_len %u", ff, data, data_len);
-                SCSha256Update(ff->sha256_ctx, data, data_len);
-            }
+            FileHashUpdate(ff, data, data_len);
         }
         if (AppendData(sbcfg, ff, data, data_len) != 0) {
             ff->state = FILE_STATE_ERROR;
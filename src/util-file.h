@@ -56,6 +56,7 @@ typedef struct SCMd5 SCMd5;
 #define FILE_STORED     BIT_U16(11)
 #define FILE_NOTRACK    BIT_U16(12) /**< track size of file */
 #define FILE_USE_DETECT BIT_U16(13) /**< use content_inspected tracker */
+#define FILE_STORE_DROPPED BIT_U16(14) /**< dropped by the async filestore writer */
 #define FILE_HAS_GAPS   BIT_U16(15)
 
 // to be used instead of PATH_MAX which depends on the OS
@@ -0,0 +1,497 @@
+/* Copyright (C) 2026 Open Information Security Foundation
+ *
+ * You can copy, redistribute or modify this Program under the terms of
+ * the GNU General Public License version 2 as published by the Free
+ * Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * version 2 along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+/**
+ * \file
+ *
+ * Sampled per thread latency histograms for the packet pipeline.
+ *
+ * Unlike the profiling code this is part of every build. When enabled,
+ * one in 'sample-rate' packets is timestamped and the time spent in each
+ * thread module slot, in the whole pipeline, in the autofp queue, in the
+ * app-layer parsers and in detection (overall and per app-layer protocol)
+ * is added to per thread log-linear histograms. Averages and maxima are
+ * exported as stats counters, the full histograms can be retrieved
+ * through the 'latency-dump' unix socket command.
+ */
+
+#include "suricata-common.h"
+#include "util-latency.h"
+#include "counters.h"
+#include "conf.h"
+#include "tm-modules.h"
+#include "tm-threads.h"
+#include "app-layer-protos.h"
+#include "util-byte.h"
+#include "util-unittest.h"
+
+#define LATENCY_SAMPLE_RATE_DEFAULT 1024
+
+static bool g_latency_enabled = false;
+uint32_t g_latency_sample_mask = LATENCY_SAMPLE_RATE_DEFAULT - 1;
+/** ticks per microsecond, calibrated at startup */
+static double g_latency_ticks_per_usec = 1.0;
+
+bool SCLatencyEnabled(void)
+{
+    return g_latency_enabled;
+}
+
+static void LatencyCalibrate(void)
+{
+    struct timespec ts_start, ts_end;
+    clock_gettime(CLOCK_MONOTONIC, &ts_start);
+    const uint64_t ticks_start = UtilCpuGetTicks();
+    usleep(10000);
+    clock_gettime(CLOCK_MONOTONIC, &ts_end);
+    const uint64_t ticks_end = UtilCpuGetTicks();
+
+    const double usecs = (double)(ts_end.tv_sec - ts_start.tv_sec) * 1000000.0 +
+                         (double)(ts_end.tv_nsec - ts_start.tv_nsec) / 1000.0;
+    if (usecs > 0 && ticks_end > ticks_start) {
+        g_latency_ticks_per_usec = (double)(ticks_end - ticks_start) / usecs;
+    }
+    SCLogDebug("latency: %.2f ticks per usec", g_latency_ticks_per_usec);
+}
+
+static inline uint64_t LatencyTicksToNsec(const uint64_t ticks)
+{
+    return (uint64_t)((double)ticks * 1000.0 / g_latency_ticks_per_usec);
+}
+
+/** \brief parse the 'stats.latency' config */
+void SCLatencyInit(void)
+{
+    SCConfNode *node = SCConfGetNode("stats.latency");
+    if (node == NULL)
+        return;
+
+    int enabled = 0;
+    if (SCConfGetChildValueBool(node, "enabled", &enabled) != 1 || !enabled)
+        return;
+
+    const char *rate = SCConfNodeLookupChildValue(node, "sample-rate");
+    if (rate != NULL) {
+        uint32_t r = 0;
+        if (StringParseUint32(&r, 10, 0, rate) < 0 || r == 0 || (r & (r - 1)) != 0) {
+            SCLogWarning("stats.latency.sample-rate must be a power of 2, "
+                         "got \"%s\". Using %u.",
+                    rate, LATENCY_SAMPLE_RATE_DEFAULT);
+            r = LATENCY_SAMPLE_RATE_DEFAULT;
+        }
+        g_latency_sample_mask = r - 1;
+    }
+
+    LatencyCalibrate();
+    g_latency_enabled = true;
+    SCLogConfig("pipeline latency sampling enabled: 1 in %u packets", g_latency_sample_mask + 1);
+}
+
+/** \brief setup the latency ctx for a packet thread
+ *
+ *  Needs to be called before StatsSetupPrivate() as it registers the
+ *  counters.
+ */
+void SCLatencyThreadInit(ThreadVars *tv)
+{
+    if (!g_latency_enabled || tv->latency_ctx != NULL)
+        return;
+
+    SCLatencyThreadCtx *lctx = SCCalloc(1, sizeof(*lctx));
+    if (lctx == NULL)
+        return;
+    lctx->app = SCCalloc(g_alproto_max, sizeof(SCLatencyHistogram *));
+    lctx->detect_app = SCCalloc(g_alproto_max, sizeof(SCLatencyHistogram *));
+    if (lctx->app == NULL || lctx->detect_app == NULL) {
+        SCFree(lctx->app);
+        SCFree(lctx->detect_app);
+        SCFree(lctx);
+        return;
+    }
+
+    lctx->counter_pipeline_avg = StatsRegisterAvgCounter("latency.pipeline_avg", tv);
+    lctx->counter_pipeline_max = StatsRegisterMaxCounter("latency.pipeline_max", tv);
+    if (tv->inq != NULL && !tv->inq->is_packet_pool) {
+        lctx->counter_queue_avg = StatsRegisterAvgCounter("latency.queue_avg", tv);
+        lctx->counter_queue_max = StatsRegisterMaxCounter("latency.queue_max", tv);
+    }
+    if (tv->tm_flowworker != NULL) {
+        lctx->counter_detect_avg = StatsRegisterAvgCounter("latency.detect_avg", tv);
+        lctx->counter_detect_max = StatsRegisterMaxCounter("latency.detect_max", tv);
+    }
+    tv->latency_ctx = lctx;
+}
+
+void SCLatencyThreadFree(ThreadVars *tv)
+{
+    SCLatencyThreadCtx *lctx = tv->latency_ctx;
+    if (lctx == NULL)
+        return;
+    tv->latency_ctx = NULL;
+
+    for (int i = 0; i < TMM_SIZE; i++) {
+        SCFree(lctx->slots[i]);
+    }
+    for (AppProto a = 0; a < g_alproto_max; a++) {
+        SCFree(lctx->app[a]);
+        SCFree(lctx->detect_app[a]);
+    }
+    SCFree(lctx->app);
+    SCFree(lctx->detect_app);
+    SCFree(lctx->pipeline);
+    SCFree(lctx->queue);
+    SCFree(lctx->detect);
+    SCFree(lctx);
+}
+
+/** \brief get the bucket for a value
+ *
+ *  Values below SC_LATENCY_SUB get their own bucket. Above that each
+ *  power of 2 is split into SC_LATENCY_SUB linear sub buckets.
+ */
+uint32_t SCLatencyBucketIdx(uint64_t v)
+{
+    if (v < SC_LATENCY_SUB)
+        return (uint32_t)v;
+    const uint32_t e = 63 - (uint32_t)__builtin_clzll(v);
+    const uint32_t sub = (uint32_t)(v >> (e - SC_LATENCY_SUB_BITS)) & (SC_LATENCY_SUB - 1);
+    return (e - SC_LATENCY_SUB_BITS + 1) * SC_LATENCY_SUB + sub;
+}
+
+/** \brief get the lowest value that maps to bucket 'idx' */
+uint64_t SCLatencyBucketLow(uint32_t idx)
+{
+    if (idx < SC_LATENCY_SUB)
+        return idx;
+    const uint32_t e = idx / SC_LATENCY_SUB + SC_LATENCY_SUB_BITS - 1;
+    const uint64_t sub = idx % SC_LATENCY_SUB;
+    return (SC_LATENCY_SUB + sub) << (e - SC_LATENCY_SUB_BITS);
+}
+
+void SCLatencyHistogramAdd(SCLatencyHistogram *h, uint64_t v)
+{
+    h->buckets[SCLatencyBucketIdx(v)]++;
+    h->count++;
+    h->sum += v;
+    if (v > h->max)
+        h->max = v;
+}
+
+/** \brief get the lower bound of the bucket holding the 'pct' percentile */
+uint64_t SCLatencyHistogramPercentile(const SCLatencyHistogram *h, double pct)
+{
+    const uint64_t count = h->count;
+    if (count == 0)
+        return 0;
+
+    uint64_t target = (uint64_t)((double)count * pct / 100.0);
+    if (target == 0)
+        target = 1;
+    uint64_t seen = 0;
+    for (uint32_t i = 0; i < SC_LATENCY_BUCKETS; i++) {
+        seen += h->buckets[i];
+        if (seen >= target)
+            return SCLatencyBucketLow(i);
+    }
+    return h->max;
+}
+
+static inline void LatencyAdd(SCLatencyHistogram **hp, const uint64_t ticks)
+{
+    if (unlikely(*hp == NULL)) {
+        *hp = SCCalloc(1, sizeof(SCLatencyHistogram));
+        if (*hp == NULL)
+            return;
+    }
+    SCLatencyHistogramAdd(*hp, ticks);
+}
+
+void SCLatencyRecordPipeline(ThreadVars *tv, uint64_t ticks)
+{
+    SCLatencyThreadCtx *lctx = tv->latency_ctx;
+    LatencyAdd(&lctx->pipeline, ticks);
+    const uint64_t ns = LatencyTicksToNsec(ticks);
+    StatsAddUI64(tv, lctx->counter_pipeline_avg, ns);
+    StatsSetUI64(tv, lctx->counter_pipeline_max, ns);
+}
+
+void SCLatencyRecordSlot(ThreadVars *tv, TmmId tm_id, uint64_t ticks)
+{
+    LatencyAdd(&tv->latency_ctx->slots[tm_id], ticks);
+}
+
+/** \brief record the time a packet spent in the autofp queue
+ *
+ *  \param enqueue_ticks ticks at enqueue time, set by the writer if it
+ *                       sampled the packet
+ */
+void SCLatencyRecordQueue(ThreadVars *tv, uint64_t enqueue_ticks)
+{
+    SCLatencyThreadCtx *lctx = tv->latency_ctx;
+    if (lctx == NULL || lctx->counter_queue_avg == 0)
+        return;
+    const uint64_t now = UtilCpuGetTicks();
+    if (now < enqueue_ticks)
+        return;
+    const uint64_t ticks = now - enqueue_ticks;
+    LatencyAdd(&lctx->queue, ticks);
+    const uint64_t ns = LatencyTicksToNsec(ticks);
+    StatsAddUI64(tv, lctx->counter_queue_avg, ns);
+    StatsSetUI64(tv, lctx->counter_queue_max, ns);
+}
+
+void SCLatencyRecordAppLayer(ThreadVars *tv, AppProto alproto, uint64_t ticks)
+{
+    if (alproto >= g_alproto_max)
+        return;
+    LatencyAdd(&tv->latency_ctx->app[alproto], ticks);
+}
+
+/** \brief record the time spent in detection
+ *
+ *  \param alproto app-layer protocol of the packet's flow, ALPROTO_UNKNOWN
+ *                 if there is none
+ */
+void SCLatencyRecordDetect(ThreadVars *tv, AppProto alproto, uint64_t ticks)
+{
+    SCLatencyThreadCtx *lctx = tv->latency_ctx;
+    LatencyAdd(&lctx->detect, ticks);
+    if (alproto < g_alproto_max)
+        LatencyAdd(&lctx->detect_app[alproto], ticks);
+    if (lctx->counter_detect_avg != 0) {
+        const uint64_t ns = LatencyTicksToNsec(ticks);
+        StatsAddUI64(tv, lctx->counter_detect_avg, ns);
+        StatsSetUI64(tv, lctx->counter_detect_max, ns);
+    }
+}
+
+#ifdef BUILD_UNIX_SOCKET
+static json_t *LatencyHistogramToJSON(const SCLatencyHistogram *h)
+{
+    json_t *js = json_object();
+    if (js == NULL)
+        return NULL;
+
+    /* take a snapshot to get a consistent view of the buckets */
+    SCLatencyHistogram *snap = SCMalloc(sizeof(*snap));
+    if (snap == NULL) {
+        json_decref(js);
+        return NULL;
+    }
+    memcpy(snap, h, sizeof(*snap));
+
+    json_object_set_new(js, "count", json_integer(snap->count));
+    if (snap->count > 0) {
+        json_object_set_new(
+                js, "avg_ns", json_integer(LatencyTicksToNsec(snap->sum / snap->count)));
+    }
+    json_object_set_new(js, "p50_ns",
+            json_integer(LatencyTicksToNsec(SCLatencyHistogramPercentile(snap, 50.0))));
+    json_object_set_new(js, "p90_ns",
+            json_integer(LatencyTicksToNsec(SCLatencyHistogramPercentile(snap, 90.0))));
+    json_object_set_new(js, "p99_ns",
+            json_integer(LatencyTicksToNsec(SCLatencyHistogramPercentile(snap, 99.0))));
+    json_object_set_new(js, "p999_ns",
+            json_integer(LatencyTicksToNsec(SCLatencyHistogramPercentile(snap, 99.9))));
+    json_object_set_new(js, "max_ns", json_integer(LatencyTicksToNsec(snap->max)));
+
+    /* sparse bucket list: [ lower bound in ns, count ] */
+    json_t *buckets = json_array();
+    if (buckets != NULL) {
+        for (uint32_t i = 0; i < SC_LATENCY_BUCKETS; i++) {
+            if (snap->buckets[i] == 0)
+                continue;
+            json_t *b = json_array();
+            if (b == NULL)
+                break;
+            json_array_append_new(b, json_integer(LatencyTicksToNsec(SCLatencyBucketLow(i))));
+            json_array_append_new(b, json_integer(snap->buckets[i]));
+            json_array_append_new(buckets, b);
+        }
+        json_object_set_new(js, "buckets", buckets);
+    }
+    SCFree(snap);
+    return js;
+}
+
+/** \internal
+ *  \brief histograms per app-layer protocol as an object keyed on the
+ *         protocol name */
+static json_t *LatencyAppProtoToJSON(SCLatencyHistogram **hs)
+{
+    json_t *js = json_object();
+    if (js == NULL)
+        return NULL;
+    for (AppProto a = 0; a < g_alproto_max; a++) {
+        if (hs[a] == NULL)
+            continue;
+        json_object_set_new(js, AppProtoToString(a), LatencyHistogramToJSON(hs[a]));
+    }
+    return js;
+}
+
+static json_t *LatencyThreadToJSON(const SCLatencyThreadCtx *lctx)
+{
+    json_t *js = json_object();
+    if (js == NULL)
+        return NULL;
+
+    if (lctx->pipeline != NULL)
+        json_object_set_new(js, "pipeline", LatencyHistogramToJSON(lctx->pipeline));
+
+    json_t *slots = json_object();
+    if (slots != NULL) {
+        for (int i = 0; i < TMM_SIZE; i++) {
+            if (lctx->slots[i] == NULL)
+                continue;
+            json_object_set_new(
+                    slots, TmModuleTmmIdToString(i), LatencyHistogramToJSON(lctx->slots[i]));
+        }
+        json_object_set_new(js, "slots", slots);
+    }
+    if (lctx->queue != NULL)
+        json_object_set_new(js, "queue", LatencyHistogramToJSON(lctx->queue));
+    if (lctx->detect != NULL)
+        json_object_set_new(js, "detect", LatencyHistogramToJSON(lctx->detect));
+
+    json_t *app = LatencyAppProtoToJSON(lctx->app);
+    if (app != NULL)
+        json_object_set_new(js, "app-layer", app);
+    json_t *detect_app = LatencyAppProtoToJSON(lctx->detect_app);
+    if (detect_app != NULL)
+        json_object_set_new(js, "detect-app-layer", detect_app);
+    return js;
+}
+
+/** \brief unix socket command returning the histograms of all packet threads */
+TmEcode SCLatencyUnixSocketDump(json_t *cmd, json_t *answer, void *data)
+{
+    if (!g_latency_enabled) {
+        json_object_set_new(answer, "message", json_string("latency sampling is not enabled"));
+        return TM_ECODE_FAILED;
+    }
+
+    json_t *threads = json_object();
+    if (threads == NULL) {
+        json_object_set_new(answer, "message", json_string("internal error"));
+        return TM_ECODE_FAILED;
+    }
+
+    SCMutexLock(&tv_root_lock);
+    for (ThreadVars *tv = tv_root[TVT_PPT]; tv != NULL; tv = tv->next) {
+        if (tv->latency_ctx == NULL)
+            continue;
+        json_object_set_new(threads, tv->printable_name ? tv->printable_name : tv->name,
+                LatencyThreadToJSON(tv->latency_ctx));
+    }
+    SCMutexUnlock(&tv_root_lock);
+
+    json_t *message = json_object();
+    if (message == NULL) {
+        json_decref(threads);
+        json_object_set_new(answer, "message", json_string("internal error"));
+        return TM_ECODE_FAILED;
+    }
+    json_object_set_new(message, "sample-rate", json_integer(g_latency_sample_mask + 1));
+    json_object_set_new(message, "threads", threads);
+    json_object_set_new(answer, "message", message);
+    return TM_ECODE_OK;
+}
+#endif /* BUILD_UNIX_SOCKET */
+
+#ifdef UNITTESTS
+static int LatencyBucketTest01(void)
+{
+    for (uint64_t v = 0; v < SC_LATENCY_SUB; v++) {
+        FAIL_IF_NOT(SCLatencyBucketIdx(v) == v);
+        FAIL_IF_NOT(SCLatencyBucketLow((uint32_t)v) == v);
+    }
+    /* every bucket's lower bound maps back to the bucket and bucket
+     * indexes are increasing */
+    uint32_t prev = 0;
+    for (uint32_t i = SC_LATENCY_SUB; i < SC_LATENCY_BUCKETS; i++) {
+        const uint64_t low = SCLatencyBucketLow(i);
+        FAIL_IF_NOT(SCLatencyBucketIdx(low) == i);
+        FAIL_IF_NOT(SCLatencyBucketIdx(low - 1) == i - 1);
+        FAIL_IF_NOT(i > prev);
+        prev = i;
+    }
+    FAIL_IF_NOT(SCLatencyBucketIdx(UINT64_MAX) == SC_LATENCY_BUCKETS - 1);
+    /* relative error stays within 1/SUB */
+    FAIL_IF_NOT(SCLatencyBucketLow(SCLatencyBucketIdx(1000)) >= 1000 - 1000 / SC_LATENCY_SUB);
+    PASS;
+}
+
+static int LatencyPercentileTest01(void)
+{
+    SCLatencyHistogram *h = SCCalloc(1, sizeof(*h));
+    FAIL_IF_NULL(h);
+    FAIL_IF_NOT(SCLatencyHistogramPercentile(h, 50.0) == 0);
+
+    for (uint64_t v = 1; v <= 100; v++) {
+        SCLatencyHistogramAdd(h, v * 100);
+    }
+    FAIL_IF_NOT(h->count == 100);
+    FAIL_IF_NOT(h->max == 10000);
+
+    const uint64_t p50 = SCLatencyHistogramPercentile(h, 50.0);
+    FAIL_IF_NOT(p50 <= 5000 && p50 >= 5000 - 5000 / SC_LATENCY_SUB);
+    const uint64_t p99 = SCLatencyHistogramPercentile(h, 99.0);
+    FAIL_IF_NOT(p99 <= 9900 && p99 >= 9900 - 9900 / SC_LATENCY_SUB);
+    SCFree(h);
+    PASS;
+}
+
+static int LatencyDetectTest01(void)
+{
+    ThreadVars tv;
+    memset(&tv, 0, sizeof(tv));
+    SCLatencyThreadCtx *lctx = SCCalloc(1, sizeof(*lctx));
+    FAIL_IF_NULL(lctx);
+    lctx->app = SCCalloc(g_alproto_max, sizeof(SCLatencyHistogram *));
+    FAIL_IF_NULL(lctx->app);
+    lctx->detect_app = SCCalloc(g_alproto_max, sizeof(SCLatencyHistogram *));
+    FAIL_IF_NULL(lctx->detect_app);
+    tv.latency_ctx = lctx;
+
+    SCLatencyRecordDetect(&tv, ALPROTO_HTTP1, 100);
+    SCLatencyRecordDetect(&tv, ALPROTO_HTTP1, 200);
+    SCLatencyRecordDetect(&tv, ALPROTO_UNKNOWN, 300);
+    /* out of range protocol only counts in the overall histogram */
+    SCLatencyRecordDetect(&tv, g_alproto_max, 400);
+
+    FAIL_IF_NOT(lctx->detect->count == 4);
+    FAIL_IF_NULL(lctx->detect_app[ALPROTO_HTTP1]);
+    FAIL_IF_NOT(lctx->detect_app[ALPROTO_HTTP1]->count == 2);
+    FAIL_IF_NOT(lctx->detect_app[ALPROTO_HTTP1]->sum == 300);
+    FAIL_IF_NULL(lctx->detect_app[ALPROTO_UNKNOWN]);
+    FAIL_IF_NOT(lctx->detect_app[ALPROTO_UNKNOWN]->count == 1);
+
+    SCLatencyThreadFree(&tv);
+    FAIL_IF_NOT(tv.latency_ctx == NULL);
+    PASS;
+}
+#endif
+
+void SCLatencyRegisterTests(void)
+{
+#ifdef UNITTESTS
+    UtRegisterTest("LatencyBucketTest01", LatencyBucketTest01);
+    UtRegisterTest("LatencyPercentileTest01", LatencyPercentileTest01);
+    UtRegisterTest("LatencyDetectTest01", LatencyDetectTest01);
+#endif
+}
@@ -0,0 +1,136 @@
+/* Copyright (C) 2026 Open Information Security Foundation
+ *
+ * You can copy, redistribute or modify this Program under the terms of
+ * the GNU General Public License version 2 as published by the Free
+ * Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * version 2 along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+/**
+ * \file
+ *
+ * Always available, sampled pipeline latency histograms.
+ */
+
+#ifndef SURICATA_UTIL_LATENCY_H
+#define SURICATA_UTIL_LATENCY_H
+
+#include "threadvars.h"
+#include "tm-threads-common.h"
+#include "app-layer-protos.h"
+#include "util-cpu.h"
+
+/** sub buckets per power of 2: 2^3 = 8 gives a max error of 12.5% */
+#define SC_LATENCY_SUB_BITS 3
+#define SC_LATENCY_SUB      (1 << SC_LATENCY_SUB_BITS)
+/** enough buckets to cover the full uint64_t range */
+#define SC_LATENCY_BUCKETS ((64 - SC_LATENCY_SUB_BITS + 1) * SC_LATENCY_SUB)
+
+/** \brief log-linear histogram of tick values
+ *
+ *  Only written by the owning thread. Readers (unix socket) read it
+ *  without locking, so their view is approximate while traffic flows.
+ */
+typedef struct SCLatencyHistogram_ {
+    uint64_t count;
+    uint64_t sum;
+    uint64_t max;
+    uint64_t buckets[SC_LATENCY_BUCKETS];
+} SCLatencyHistogram;
+
+typedef struct SCLatencyThreadCtx_ {
+    uint32_t sample_cnt;
+    /** nesting level of TmThreadsSlotVarRun() calls, > 1 for pseudo
+     *  packets created while processing another packet */
+    uint16_t depth;
+    /** the packet currently in the pipeline is sampled. For the outer
+     *  packet this stays set until the next packet, so the output
+     *  queue handler can still see it. */
+    bool sampled;
+
+    SCLatencyHistogram *pipeline;
+    SCLatencyHistogram *slots[TMM_SIZE];
+    SCLatencyHistogram *queue;
+    SCLatencyHistogram *detect;
+    /* indexed by AppProto, g_alproto_max entries */
+    SCLatencyHistogram **app;
+    SCLatencyHistogram **detect_app;
+
+    /* stats counters: values in nanoseconds */
+    uint16_t counter_pipeline_avg;
+    uint16_t counter_pipeline_max;
+    uint16_t counter_queue_avg;
+    uint16_t counter_queue_max;
+    uint16_t counter_detect_avg;
+    uint16_t counter_detect_max;
+} SCLatencyThreadCtx;
+
+extern uint32_t g_latency_sample_mask;
+
+void SCLatencyInit(void);
+bool SCLatencyEnabled(void);
+void SCLatencyThreadInit(ThreadVars *tv);
+void SCLatencyThreadFree(ThreadVars *tv);
+
+uint32_t SCLatencyBucketIdx(uint64_t v);
+uint64_t SCLatencyBucketLow(uint32_t idx);
+void SCLatencyHistogramAdd(SCLatencyHistogram *h, uint64_t v);
+uint64_t SCLatencyHistogramPercentile(const SCLatencyHistogram *h, double pct);
+
+void SCLatencyRecordPipeline(ThreadVars *tv, uint64_t ticks);
+void SCLatencyRecordSlot(ThreadVars *tv, TmmId tm_id, uint64_t ticks);
+void SCLatencyRecordQueue(ThreadVars *tv, uint64_t enqueue_ticks);
+void SCLatencyRecordAppLayer(ThreadVars *tv, AppProto alproto, uint64_t ticks);
+void SCLatencyRecordDetect(ThreadVars *tv, AppProto alproto, uint64_t ticks);
+
+#ifdef BUILD_UNIX_SOCKET
+TmEcode SCLatencyUnixSocketDump(json_t *cmd, json_t *answer, void *data);
+#endif
+
+void SCLatencyRegisterTests(void);
+
+/** \brief decide if the packet we're about to process is sampled
+ *
+ *  \param prev set to the sample state of the packet being processed
+ *              already, to be passed to SCLatencySampleEnd()
+ *  \retval sampled true if this packet is sampled
+ */
+static inline bool SCLatencySampleStart(ThreadVars *tv, bool *prev)
+{
+    SCLatencyThreadCtx *lctx = tv->latency_ctx;
+    if (likely(lctx == NULL)) {
+        *prev = false;
+        return false;
+    }
+    *prev = lctx->sampled;
+    lctx->depth++;
+    lctx->sampled = ((lctx->sample_cnt++ & g_latency_sample_mask) == 0);
+    return lctx->sampled;
+}
+
+static inline void SCLatencySampleEnd(ThreadVars *tv, const bool prev)
+{
+    SCLatencyThreadCtx *lctx = tv->latency_ctx;
+    if (lctx != NULL) {
+        /* restore the state of the outer packet */
+        if (--lctx->depth > 0)
+            lctx->sampled = prev;
+    }
+}
+
+/** \brief check if the packet currently processed by this thread is sampled */
+static inline bool SCLatencyIsSampled(const ThreadVars *tv)
+{
+    return (tv->latency_ctx != NULL && tv->latency_ctx->sampled);
+}
+
+#endif /* SURICATA_UTIL_LATENCY_H */
@@ -35,6 +35,11 @@
 
 #define SANDBOX_CTX "SANDBOX_CTX"
 
+/* the instruction limit is checked this many times over the budget, so a
+ * script can overrun it by at most 1/SANDBOX_HOOK_CHECKS */
+#define SANDBOX_HOOK_CHECKS 64
+#define SANDBOX_HOOK_MIN    100
+
 static void HookFunc(lua_State *L, lua_Debug *ar);
 
 /**
@@ -311,6 +316,24 @@ void SCLuaSbLoadLibs(lua_State *L)
     lua_setglobal(L, "require");
 }
 
+/**
+ * \brief Get the number of instructions between instruction count hooks.
+ *
+ * The count hook is called every N instructions, so a larger N makes the
+ * check cheaper. Without a limit no hook is needed at all.
+ *
+ * \retval interval or 0 if no hook is needed
+ */
+static int HookInterval(uint64_t instructionlimit)
+{
+    if (instructionlimit == 0)
+        return 0;
+    uint64_t interval = instructionlimit / SANDBOX_HOOK_CHECKS;
+    if (interval < SANDBOX_HOOK_MIN)
+        interval = SANDBOX_HOOK_MIN;
+    return (int)MIN(interval, (uint64_t)INT_MAX);
+}
+
 /**
  * \brief Allocate a new Lua sandbox.
  *
@@ -326,7 +349,7 @@ lua_State *SCLuaSbStateNew(uint64_t alloclimit, uint64_t instructionlimit)
 
     sb->alloc_limit = alloclimit;
     sb->alloc_bytes = 0;
-    sb->hook_instruction_count = 100;
+    sb->hook_instruction_count = HookInterval(instructionlimit);
     sb->instruction_limit = instructionlimit;
 
     sb->L = lua_newstate(LuaAlloc, sb);
@@ -339,7 +362,8 @@ lua_State *SCLuaSbStateNew(uint64_t alloclimit, uint64_t instructionlimit)
     lua_pushlightuserdata(sb->L, sb);
     lua_settable(sb->L, LUA_REGISTRYINDEX);
 
-    lua_sethook(sb->L, HookFunc, LUA_MASKCOUNT, sb->hook_instruction_count);
+    if (sb->hook_instruction_count > 0)
+        lua_sethook(sb->L, HookFunc, LUA_MASKCOUNT, sb->hook_instruction_count);
     return sb->L;
 }
 
@@ -392,6 +416,8 @@ void SCLuaSbResetInstructionCounter(lua_State *L)
         sb->blocked_function_error = false;
         sb->instruction_count_error = false;
         sb->instruction_count = 0;
-        lua_sethook(L, HookFunc, LUA_MASKCOUNT, sb->hook_instruction_count);
+        /* restarts the count down to the next hook call */
+        if (sb->hook_instruction_count > 0)
+            lua_sethook(L, HookFunc, LUA_MASKCOUNT, sb->hook_instruction_count);
     }
 }
@@ -47,7 +47,7 @@ typedef struct SCLuaSbState {
     /* Execution Limits */
     uint64_t instruction_count;
     uint64_t instruction_limit;
-    // used by lua_sethook
+    // used by lua_sethook, 0 if no hook is set
     int hook_instruction_count;
 
     /* Errors. */
@@ -364,6 +364,10 @@ static const struct luaL_Reg tlslib[] = {
 
 int SCLuaLoadTlsLib(lua_State *L)
 {
+    /* scripts can access all the certificate fields */
+    SSLEnableCertDecoding();
+    SSLEnableCertFingerprint();
+
     luaL_newmetatable(L, tls_state_mt);
     lua_pushvalue(L, -1);
     lua_setfield(L, -2, "__index");
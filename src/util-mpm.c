@@ -40,6 +40,7 @@
 #include "queue.h"
 #include "util-unittest.h"
 #include "util-memcpy.h"
+#include "util-hash-lookup3.h"
 #ifdef BUILD_HYPERSCAN
 #include "hs.h"
 #endif
@@ -160,7 +161,7 @@ void MpmFactoryReClaimMpmCtx(const DetectEngineCtx *de_ctx, MpmCtx *mpm_ctx)
 
     if (!MpmFactoryIsMpmCtxAvailable(de_ctx, mpm_ctx)) {
         if (mpm_ctx->mpm_type != MPM_NOTSET)
-            mpm_table[mpm_ctx->mpm_type].DestroyCtx(mpm_ctx);
+            MpmDestroyCtx(mpm_ctx);
         SCFree(mpm_ctx);
     }
 }
@@ -174,12 +175,12 @@ void MpmFactoryDeRegisterAllMpmCtxProfiles(DetectEngineCtx *de_ctx)
     while (item) {
         if (item->mpm_ctx_ts != NULL) {
             if (item->mpm_ctx_ts->mpm_type != MPM_NOTSET)
-                mpm_table[item->mpm_ctx_ts->mpm_type].DestroyCtx(item->mpm_ctx_ts);
+                MpmDestroyCtx(item->mpm_ctx_ts);
             SCFree(item->mpm_ctx_ts);
         }
         if (item->mpm_ctx_tc != NULL) {
             if (item->mpm_ctx_tc->mpm_type != MPM_NOTSET)
-                mpm_table[item->mpm_ctx_tc->mpm_type].DestroyCtx(item->mpm_ctx_tc);
+                MpmDestroyCtx(item->mpm_ctx_tc);
             SCFree(item->mpm_ctx_tc);
         }
 
@@ -562,9 +563,341 @@ error:
 }
 
 
+/************************************Sharing************************************/
+
+/* Contexts with the same patterns, pattern ids and sids are built the same
+ * way, so with multi tenancy identical rule sets don't need their own copy of
+ * the (expensive to build) matcher state. The patterns are serialized into a
+ * key before the ctx is prepared. If a ctx with the same key was prepared
+ * before, its matcher state is reused and refcounted. */
+
+struct MpmShareEntry_ {
+    uint8_t *key;
+    uint32_t key_len;
+    uint32_t hash;
+    uint32_t ref_cnt;
+    /** the ctx that was prepared and now owns the matcher state */
+    MpmCtx mpm_ctx;
+};
+
+#define MPM_SHARE_HASH_SIZE 4096
+
+static bool g_mpm_share = false;
+static HashListTable *g_mpm_share_table = NULL;
+static uint32_t g_mpm_share_cnt = 0;
+static SCMutex g_mpm_share_mutex = SCMUTEX_INITIALIZER;
+
+/** \brief enable sharing of identical mpm contexts between detection engines */
+void MpmShareEnable(void)
+{
+    g_mpm_share = true;
+}
+
+static uint32_t MpmShareHashFunc(HashListTable *ht, void *data, uint16_t datalen)
+{
+    const MpmShareEntry *e = data;
+    return e->hash % ht->array_size;
+}
+
+static char MpmShareCompareFunc(void *data1, uint16_t len1, void *data2, uint16_t len2)
+{
+    const MpmShareEntry *e1 = data1;
+    const MpmShareEntry *e2 = data2;
+    return (e1->hash == e2->hash && e1->key_len == e2->key_len &&
+            memcmp(e1->key, e2->key, e1->key_len) == 0);
+}
+
+static void MpmShareFreeFunc(void *data)
+{
+    MpmShareEntry *e = data;
+    if (e->mpm_ctx.mpm_type != MPM_NOTSET)
+        mpm_table[e->mpm_ctx.mpm_type].DestroyCtx(&e->mpm_ctx);
+    SCFree(e->key);
+    SCFree(e);
+}
+
+static int MpmSharePatternCompare(const void *a, const void *b)
+{
+    const MpmPattern *p1 = *(const MpmPattern **)a;
+    const MpmPattern *p2 = *(const MpmPattern **)b;
+    if (p1->id < p2->id)
+        return -1;
+    return p1->id > p2->id;
+}
+
+static inline void MpmShareKeyAppend(uint8_t **ptr, const void *data, const size_t len)
+{
+    memcpy(*ptr, data, len);
+    *ptr += len;
+}
+
+/** \internal
+ *  \brief serialize the patterns of a ctx that is not prepared yet
+ *
+ *  \retval key or NULL if the ctx can't be shared
+ */
+static uint8_t *MpmShareKeyBuild(const MpmCtx *mpm_ctx, uint32_t *key_len)
+{
+    MpmPattern **parray = SCCalloc(mpm_ctx->pattern_cnt, sizeof(MpmPattern *));
+    if (parray == NULL)
+        return NULL;
+
+    uint64_t len = sizeof(mpm_ctx->mpm_type) + sizeof(mpm_ctx->flags) +
+                   sizeof(mpm_ctx->pattern_cnt) + sizeof(mpm_ctx->maxdepth);
+    uint32_t cnt = 0;
+    for (uint32_t i = 0; i < MPM_INIT_HASH_SIZE; i++) {
+        for (MpmPattern *p = mpm_ctx->init_hash[i]; p != NULL; p = p->next) {
+            if (cnt == mpm_ctx->pattern_cnt) {
+                SCFree(parray);
+                return NULL;
+            }
+            parray[cnt++] = p;
+            len += sizeof(p->id) + sizeof(p->len) + sizeof(p->flags) + sizeof(p->offset) +
+                   sizeof(p->depth) + sizeof(p->sids_size) + p->len +
+                   p->sids_size * sizeof(SigIntId);
+        }
+    }
+    if (cnt != mpm_ctx->pattern_cnt || len > UINT32_MAX) {
+        SCFree(parray);
+        return NULL;
+    }
+    qsort(parray, cnt, sizeof(MpmPattern *), MpmSharePatternCompare);
+
+    uint8_t *key = SCMalloc(len);
+    if (key == NULL) {
+        SCFree(parray);
+        return NULL;
+    }
+    /* flags that only describe how this particular ctx is used are not part
+     * of the key */
+    const uint8_t flags = mpm_ctx->flags & ~MPMCTX_FLAGS_GLOBAL;
+    uint8_t *ptr = key;
+    MpmShareKeyAppend(&ptr, &mpm_ctx->mpm_type, sizeof(mpm_ctx->mpm_type));
+    MpmShareKeyAppend(&ptr, &flags, sizeof(flags));
+    MpmShareKeyAppend(&ptr, &mpm_ctx->pattern_cnt, sizeof(mpm_ctx->pattern_cnt));
+    MpmShareKeyAppend(&ptr, &mpm_ctx->maxdepth, sizeof(mpm_ctx->maxdepth));
+    for (uint32_t i = 0; i < cnt; i++) {
+        const MpmPattern *p = parray[i];
+        MpmShareKeyAppend(&ptr, &p->id, sizeof(p->id));
+        MpmShareKeyAppend(&ptr, &p->len, sizeof(p->len));
+        MpmShareKeyAppend(&ptr, &p->flags, sizeof(p->flags));
+        MpmShareKeyAppend(&ptr, &p->offset, sizeof(p->offset));
+        MpmShareKeyAppend(&ptr, &p->depth, sizeof(p->depth));
+        MpmShareKeyAppend(&ptr, &p->sids_size, sizeof(p->sids_size));
+        MpmShareKeyAppend(&ptr, p->original_pat, p->len);
+        MpmShareKeyAppend(&ptr, p->sids, p->sids_size * sizeof(SigIntId));
+    }
+    SCFree(parray);
+
+    *key_len = (uint32_t)len;
+    return key;
+}
+
+/** \internal
+ *  \brief make mpm_ctx use the matcher state of a shared entry
+ *
+ *  The ctx must either be prepared already or have no matcher state of its
+ *  own anymore. Called with g_mpm_share_mutex held.
+ */
+static void MpmShareAdopt(MpmCtx *mpm_ctx, MpmShareEntry *e)
+{
+    const uint8_t global = mpm_ctx->flags & MPMCTX_FLAGS_GLOBAL;
+    *mpm_ctx = e->mpm_ctx;
+    mpm_ctx->flags |= global;
+    mpm_ctx->share = e;
+    e->ref_cnt++;
+}
+
+/** \internal
+ *  \brief free the patterns and matcher state of a ctx that is not prepared */
+static void MpmShareDiscard(MpmCtx *mpm_ctx)
+{
+    for (uint32_t i = 0; i < MPM_INIT_HASH_SIZE; i++) {
+        MpmPattern *p = mpm_ctx->init_hash[i];
+        while (p != NULL) {
+            MpmPattern *next = p->next;
+            MpmFreePattern(mpm_ctx, p);
+            p = next;
+        }
+    }
+    SCFree(mpm_ctx->init_hash);
+    mpm_ctx->init_hash = NULL;
+    mpm_ctx->pattern_cnt = 0;
+    mpm_table[mpm_ctx->mpm_type].DestroyCtx(mpm_ctx);
+}
+
+/**
+ * \brief Prepare a mpm ctx after all patterns have been added.
+ *
+ * When sharing is enabled and an identical ctx was prepared before, possibly
+ * by another detection engine, its matcher state is used instead of building
+ * it again.
+ */
+int MpmPrepareCtx(MpmConfig *mpm_cfg, MpmCtx *mpm_ctx)
+{
+    if (mpm_ctx->mpm_type == MPM_NOTSET || mpm_table[mpm_ctx->mpm_type].Prepare == NULL)
+        return 0;
+
+    /* only matchers that use the generic pattern hash can be shared */
+    if (!g_mpm_share || mpm_ctx->init_hash == NULL || mpm_ctx->pattern_cnt == 0)
+        return mpm_table[mpm_ctx->mpm_type].Prepare(mpm_cfg, mpm_ctx);
+
+    MpmShareEntry lookup;
+    memset(&lookup, 0, sizeof(lookup));
+    lookup.key = MpmShareKeyBuild(mpm_ctx, &lookup.key_len);
+    if (lookup.key == NULL)
+        return mpm_table[mpm_ctx->mpm_type].Prepare(mpm_cfg, mpm_ctx);
+    lookup.hash = hashlittle(lookup.key, lookup.key_len, 0);
+
+    SCMutexLock(&g_mpm_share_mutex);
+    MpmShareEntry *e = NULL;
+    if (g_mpm_share_table != NULL)
+        e = HashListTableLookup(g_mpm_share_table, &lookup, 0);
+    if (e != NULL) {
+        MpmShareDiscard(mpm_ctx);
+        MpmShareAdopt(mpm_ctx, e);
+        SCMutexUnlock(&g_mpm_share_mutex);
+        SCLogDebug("mpm_ctx %p: reusing shared ctx with %u patterns (ref_cnt %u)", mpm_ctx,
+                mpm_ctx->pattern_cnt, e->ref_cnt);
+        SCFree(lookup.key);
+        return 0;
+    }
+    SCMutexUnlock(&g_mpm_share_mutex);
+
+    /* build outside of the lock, so other engines can load in parallel */
+    int r = mpm_table[mpm_ctx->mpm_type].Prepare(mpm_cfg, mpm_ctx);
+    if (r != 0) {
+        SCFree(lookup.key);
+        return r;
+    }
+
+    SCMutexLock(&g_mpm_share_mutex);
+    if (g_mpm_share_table == NULL) {
+        g_mpm_share_table = HashListTableInit(MPM_SHARE_HASH_SIZE, MpmShareHashFunc,
+                MpmShareCompareFunc, MpmShareFreeFunc);
+        if (g_mpm_share_table == NULL)
+            goto unshared;
+    }
+    e = HashListTableLookup(g_mpm_share_table, &lookup, 0);
+    if (e != NULL) {
+        /* another engine built the same ctx in the meantime */
+        mpm_table[mpm_ctx->mpm_type].DestroyCtx(mpm_ctx);
+        MpmShareAdopt(mpm_ctx, e);
+        SCMutexUnlock(&g_mpm_share_mutex);
+        SCFree(lookup.key);
+        return 0;
+    }
+
+    e = SCCalloc(1, sizeof(*e));
+    if (e == NULL)
+        goto unshared;
+    e->key = lookup.key;
+    e->key_len = lookup.key_len;
+    e->hash = lookup.hash;
+    e->mpm_ctx = *mpm_ctx;
+    e->mpm_ctx.flags &= ~MPMCTX_FLAGS_GLOBAL;
+    e->mpm_ctx.share = NULL;
+    if (HashListTableAdd(g_mpm_share_table, e, 0) != 0) {
+        SCFree(e);
+        goto unshared;
+    }
+    g_mpm_share_cnt++;
+    MpmShareAdopt(mpm_ctx, e);
+    SCMutexUnlock(&g_mpm_share_mutex);
+    return 0;
+
+unshared:
+    SCMutexUnlock(&g_mpm_share_mutex);
+    SCFree(lookup.key);
+    return 0;
+}
+
+/** \internal
+ *  \brief drop a reference to the shared matcher state of a ctx */
+static void MpmShareRelease(MpmCtx *mpm_ctx)
+{
+    MpmShareEntry *e = mpm_ctx->share;
+
+    SCMutexLock(&g_mpm_share_mutex);
+    BUG_ON(e->ref_cnt == 0);
+    if (--e->ref_cnt == 0) {
+        HashListTableRemove(g_mpm_share_table, e, 0);
+        if (--g_mpm_share_cnt == 0) {
+            HashListTableFree(g_mpm_share_table);
+            g_mpm_share_table = NULL;
+        }
+    }
+    SCMutexUnlock(&g_mpm_share_mutex);
+
+    mpm_ctx->ctx = NULL;
+    mpm_ctx->share = NULL;
+}
+
+/**
+ * \brief Destroy a mpm ctx, taking into account it may be shared.
+ */
+void MpmDestroyCtx(MpmCtx *mpm_ctx)
+{
+    if (mpm_ctx->share != NULL) {
+        MpmShareRelease(mpm_ctx);
+        return;
+    }
+    mpm_table[mpm_ctx->mpm_type].DestroyCtx(mpm_ctx);
+}
+
 /************************************Unittests*********************************/
 
 #ifdef UNITTESTS
+static void MpmShareTestSetup(MpmCtx *mpm_ctx, const char *pat2)
+{
+    memset(mpm_ctx, 0, sizeof(*mpm_ctx));
+    MpmInitCtx(mpm_ctx, MPM_AC);
+    MpmAddPatternCS(mpm_ctx, (uint8_t *)"abcd", 4, 0, 0, 0, 0, 0);
+    MpmAddPatternCI(mpm_ctx, (uint8_t *)pat2, (uint16_t)strlen(pat2), 0, 0, 1, 1, 0);
+    MpmAddPatternCS(mpm_ctx, (uint8_t *)"xyz", 3, 0, 0, 2, 0, 0);
+}
+
+/** \test identical contexts share the matcher state, others don't */
+static int MpmShareTest01(void)
+{
+    MpmCtx c1, c2, c3;
+    MpmThreadCtx mpm_thread_ctx;
+    PrefilterRuleStore pmq;
+    const bool share = g_mpm_share;
+    g_mpm_share = true;
+
+    memset(&mpm_thread_ctx, 0, sizeof(MpmThreadCtx));
+    PmqSetup(&pmq);
+
+    MpmShareTestSetup(&c1, "bCdE");
+    FAIL_IF_NOT(MpmPrepareCtx(NULL, &c1) == 0);
+    FAIL_IF_NULL(c1.share);
+    MpmShareTestSetup(&c2, "bCdE");
+    FAIL_IF_NOT(MpmPrepareCtx(NULL, &c2) == 0);
+    FAIL_IF_NOT(c1.share == c2.share);
+    FAIL_IF_NOT(c1.ctx == c2.ctx);
+    FAIL_IF_NOT(c2.share->ref_cnt == 2);
+    MpmShareTestSetup(&c3, "bCdF");
+    FAIL_IF_NOT(MpmPrepareCtx(NULL, &c3) == 0);
+    FAIL_IF(c3.share == c1.share);
+    FAIL_IF(c3.ctx == c1.ctx);
+
+    MpmDestroyCtx(&c1);
+    FAIL_IF_NOT(c2.share->ref_cnt == 1);
+
+    const char *buf = "abcdebcdexyz";
+    uint32_t cnt =
+            mpm_table[c2.mpm_type].Search(&c2, &mpm_thread_ctx, &pmq, (uint8_t *)buf, strlen(buf));
+    FAIL_IF_NOT(cnt == 3);
+
+    MpmDestroyCtx(&c2);
+    MpmDestroyCtx(&c3);
+    FAIL_IF_NOT_NULL(g_mpm_share_table);
+
+    PmqFree(&pmq);
+    g_mpm_share = share;
+    PASS;
+}
 #endif /* UNITTESTS */
 
 void MpmRegisterTests(void)
@@ -572,6 +905,8 @@ void MpmRegisterTests(void)
 #ifdef UNITTESTS
     uint16_t i;
 
+    UtRegisterTest("MpmShareTest01", MpmShareTest01);
+
     for (i = 0; i < MPM_TABLE_SIZE; i++) {
         if (i == MPM_NOTSET)
             continue;
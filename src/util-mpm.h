@@ -90,6 +90,8 @@ typedef struct MpmConfig_ {
     const char *cache_dir_path;
 } MpmConfig;
 
+typedef struct MpmShareEntry_ MpmShareEntry;
+
 typedef struct MpmCtx_ {
     void *ctx;
     uint8_t mpm_type;
@@ -111,6 +113,9 @@ typedef struct MpmCtx_ {
 
     /* hash used during ctx initialization */
     MpmPattern **init_hash;
+
+    /* set if ctx is shared with other detection engines, see MpmPrepareCtx */
+    MpmShareEntry *share;
 } MpmCtx;
 
 /* if we want to retrieve an unique mpm context from the mpm context factory
@@ -200,6 +205,9 @@ void MpmTableSetup(void);
 void MpmRegisterTests(void);
 
 void MpmInitCtx(MpmCtx *mpm_ctx, uint8_t matcher);
+int MpmPrepareCtx(MpmConfig *mpm_cfg, MpmCtx *mpm_ctx);
+void MpmDestroyCtx(MpmCtx *mpm_ctx);
+void MpmShareEnable(void);
 void MpmInitThreadCtx(MpmThreadCtx *mpm_thread_ctx, uint16_t);
 void MpmDestroyThreadCtx(MpmThreadCtx *mpm_thread_ctx, const uint16_t matcher);
 
@@ -50,6 +50,9 @@ typedef struct SCProfileSummary_ {
     uint64_t max;
     uint64_t ticks_match;
     uint64_t ticks_no_match;
+    uint64_t ticks_lua;
+    uint64_t pcre_guard_checks;
+    uint64_t pcre_guard_skips;
 } SCProfileSummary;
 
 extern int profiling_output_to_file;
@@ -306,6 +309,14 @@ static json_t *BuildJson(
             json_object_set_new(jsm, "ticks_avg", json_integer(summary[i].avgticks));
             json_object_set_new(jsm, "ticks_avg_match", json_integer(summary[i].avgticks_match));
             json_object_set_new(jsm, "ticks_avg_nomatch", json_integer(summary[i].avgticks_no_match));
+            if (summary[i].ticks_lua > 0)
+                json_object_set_new(jsm, "ticks_lua", json_integer(summary[i].ticks_lua));
+            if (summary[i].pcre_guard_checks > 0) {
+                json_object_set_new(jsm, "pcre_guard_checks",
+                        json_integer(summary[i].pcre_guard_checks));
+                json_object_set_new(
+                        jsm, "pcre_guard_skips", json_integer(summary[i].pcre_guard_skips));
+            }
 
             double percent = (long double)summary[i].ticks /
                 (long double)total_ticks * 100;
@@ -451,6 +462,9 @@ static void *SCProfilingRuleDump(SCProfileDetectCtx *rules_ctx, int file_output)
         summary[i].max = rules_ctx->data[i].max;
         summary[i].ticks_match = rules_ctx->data[i].ticks_match;
         summary[i].ticks_no_match = rules_ctx->data[i].ticks_no_match;
+        summary[i].ticks_lua = rules_ctx->data[i].ticks_lua;
+        summary[i].pcre_guard_checks = rules_ctx->data[i].pcre_guard_checks;
+        summary[i].pcre_guard_skips = rules_ctx->data[i].pcre_guard_skips;
         if (summary[i].ticks_match > 0) {
             summary[i].avgticks_match = (long double)summary[i].ticks_match /
                 (long double)summary[i].matches;
@@ -562,6 +576,35 @@ SCProfilingRuleUpdateCounter(DetectEngineThreadCtx *det_ctx, uint16_t id, uint64
     }
 }
 
+/**
+ * \brief Account the ticks spent in a lua script to a rule.
+ *
+ * The ticks are a part of the ticks of the rule, not added to them.
+ *
+ * \param id The ID of this counter.
+ * \param ticks Number of CPU ticks spent in the lua interpreter.
+ */
+void SCProfilingRuleUpdateLuaTicks(DetectEngineThreadCtx *det_ctx, uint16_t id, uint64_t ticks)
+{
+    if (det_ctx != NULL && det_ctx->rule_perf_data != NULL && det_ctx->rule_perf_data_size > id) {
+        det_ctx->rule_perf_data[id].ticks_lua += ticks;
+    }
+}
+
+/**
+ * \brief Account a check of the literal guard of a pcre keyword to a rule.
+ *
+ * \param id The ID of this counter.
+ * \param skipped Did the guard skip the regex execution?
+ */
+void SCProfilingRuleUpdatePcreGuard(DetectEngineThreadCtx *det_ctx, uint16_t id, bool skipped)
+{
+    if (det_ctx != NULL && det_ctx->rule_perf_data != NULL && det_ctx->rule_perf_data_size > id) {
+        det_ctx->rule_perf_data[id].pcre_guard_checks++;
+        det_ctx->rule_perf_data[id].pcre_guard_skips += skipped;
+    }
+}
+
 static SCProfileDetectCtx *SCProfilingRuleInitCtx(void)
 {
     SCProfileDetectCtx *ctx = SCCalloc(1, sizeof(SCProfileDetectCtx));
@@ -609,11 +652,19 @@ static void SCProfilingRuleThreadMerge(
         de_ctx->profile_ctx->data[i].matches += det_ctx->rule_perf_data[i].matches;
         de_ctx->profile_ctx->data[i].ticks_match += det_ctx->rule_perf_data[i].ticks_match;
         de_ctx->profile_ctx->data[i].ticks_no_match += det_ctx->rule_perf_data[i].ticks_no_match;
+        de_ctx->profile_ctx->data[i].ticks_lua += det_ctx->rule_perf_data[i].ticks_lua;
+        de_ctx->profile_ctx->data[i].pcre_guard_checks +=
+                det_ctx->rule_perf_data[i].pcre_guard_checks;
+        de_ctx->profile_ctx->data[i].pcre_guard_skips +=
+                det_ctx->rule_perf_data[i].pcre_guard_skips;
         if (reset) {
             det_ctx->rule_perf_data[i].checks = 0;
             det_ctx->rule_perf_data[i].matches = 0;
             det_ctx->rule_perf_data[i].ticks_match = 0;
             det_ctx->rule_perf_data[i].ticks_no_match = 0;
+            det_ctx->rule_perf_data[i].ticks_lua = 0;
+            det_ctx->rule_perf_data[i].pcre_guard_checks = 0;
+            det_ctx->rule_perf_data[i].pcre_guard_skips = 0;
         }
         if (det_ctx->rule_perf_data[i].max > de_ctx->profile_ctx->data[i].max)
             de_ctx->profile_ctx->data[i].max = det_ctx->rule_perf_data[i].max;
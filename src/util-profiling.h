@@ -375,6 +375,9 @@ typedef struct SCProfileData_ {
     uint64_t max;
     uint64_t ticks_match;
     uint64_t ticks_no_match;
+    uint64_t ticks_lua; /**< part of the ticks spent running lua scripts */
+    uint64_t pcre_guard_checks; /**< pcre literal guard checks */
+    uint64_t pcre_guard_skips;  /**< regex executions the guard skipped */
 } SCProfileData;
 
 typedef struct SCProfileDetectCtx_ {
@@ -388,6 +391,8 @@ void SCProfilingRulesGlobalInit(void);
 void SCProfilingRuleDestroyCtx(struct SCProfileDetectCtx_ *);
 void SCProfilingRuleInitCounters(DetectEngineCtx *);
 void SCProfilingRuleUpdateCounter(DetectEngineThreadCtx *, uint16_t, uint64_t, int);
+void SCProfilingRuleUpdateLuaTicks(DetectEngineThreadCtx *, uint16_t, uint64_t);
+void SCProfilingRuleUpdatePcreGuard(DetectEngineThreadCtx *, uint16_t, bool);
 void SCProfilingRuleThreadSetup(struct SCProfileDetectCtx_ *, DetectEngineThreadCtx *);
 void SCProfilingRuleThreadCleanup(DetectEngineThreadCtx *);
 int SCProfileRuleStart(Packet *p);
@@ -0,0 +1,540 @@
+/* Copyright (C) 2026 Open Information Security Foundation
+ *
+ * You can copy, redistribute or modify this Program under the terms of
+ * the GNU General Public License version 2 as published by the Free
+ * Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * version 2 along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+/**
+ * \file
+ *
+ * Per thread caches of fixed size objects.
+ *
+ * Each thread using a cache gets its own free list, so allocations and
+ * frees by the same thread don't touch any shared state. Every object
+ * carries a small header pointing to the thread cache it was allocated
+ * from. An object freed by another thread, e.g. the flow recycler freeing
+ * a worker's flow, is pushed on a lock-free return stack of the owning
+ * thread cache. The owner takes that whole stack in one go when its own
+ * free list runs empty.
+ *
+ * When a thread is done, SCSlabThreadCleanup() frees its cached objects
+ * and marks its thread caches orphaned. They can't be released, as objects
+ * that are still in use may point to them, but the next thread needing a
+ * cache adopts an orphaned one, including the objects returned to it in
+ * the meantime. This keeps the memory bounded when threads are recreated,
+ * like the unix socket runmode does for every pcap. The thread caches
+ * themselves are released at shutdown, unless objects are still in use.
+ */
+
+#include "suricata-common.h"
+#include "util-slab.h"
+#include "util-atomic.h"
+#include "util-debug.h"
+#include "util-validate.h"
+#include "counters.h"
+#include "util-unittest.h"
+
+/** max number of caches */
+#define SLAB_MAX_CACHES 64
+/** max objects kept on the free list of a thread, more are freed */
+#define SLAB_FREE_MAX 4096
+
+typedef struct SCSlabObj_ {
+    struct SCSlabThreadCache_ *owner;
+    struct SCSlabObj_ *next;
+} SCSlabObj;
+
+/* keep the objects aligned */
+_Static_assert(sizeof(SCSlabObj) % SC_SLAB_ALIGN == 0, "slab object header breaks alignment");
+
+typedef struct SCSlabThreadCache_ {
+    /* only used by the owning thread */
+    SCSlabObj *free;
+    uint32_t free_cnt;
+
+    /* objects freed by other threads */
+    SC_ATOMIC_DECLARE(SCSlabObj *, remote);
+    /** number of objects on 'remote', can be off briefly while objects
+     *  are being pushed and reclaimed */
+    SC_ATOMIC_DECLARE(int64_t, remote_cnt);
+
+    /** owning thread is gone, protected by slab_lock */
+    bool orphaned;
+    struct SCSlabThreadCache_ *next;
+} SCSlabThreadCache;
+
+struct SCSlabCache_ {
+    uint32_t id;
+    uint32_t size;
+    /** bytes allocated for this cache, including the free lists */
+    SC_ATOMIC_DECLARE(uint64_t, memuse);
+    /** thread caches, protected by slab_lock */
+    SCSlabThreadCache *thread_caches;
+    char name[32];
+    char counter_name[64];
+    char cached_counter_name[64];
+};
+
+static SCMutex slab_lock = SCMUTEX_INITIALIZER;
+static SCSlabCache *slab_caches[SLAB_MAX_CACHES];
+static uint32_t slab_caches_cnt = 0;
+
+static thread_local SCSlabThreadCache *slab_thread_caches[SLAB_MAX_CACHES];
+
+/**
+ *  \brief register a cache for objects of 'size' bytes
+ *
+ *  Registering the same name again returns the existing cache.
+ *
+ *  \retval c cache or NULL on error
+ */
+SCSlabCache *SCSlabCacheRegister(const char *name, uint32_t size)
+{
+    SCSlabCache *c = NULL;
+
+    SCMutexLock(&slab_lock);
+    for (uint32_t i = 0; i < slab_caches_cnt; i++) {
+        if (strcmp(slab_caches[i]->name, name) == 0) {
+            c = slab_caches[i];
+            if (c->size != size) {
+                SCLogError("slab cache %s registered with different sizes", name);
+                c = NULL;
+            }
+            goto end;
+        }
+    }
+    if (slab_caches_cnt == SLAB_MAX_CACHES) {
+        SCLogError("too many slab caches, can't register %s", name);
+        goto end;
+    }
+
+    c = SCCalloc(1, sizeof(*c));
+    if (c == NULL)
+        goto end;
+    c->id = slab_caches_cnt;
+    c->size = size;
+    SC_ATOMIC_INIT(c->memuse);
+    strlcpy(c->name, name, sizeof(c->name));
+    snprintf(c->counter_name, sizeof(c->counter_name), "app_layer.memuse.%s", c->name);
+    snprintf(c->cached_counter_name, sizeof(c->cached_counter_name), "app_layer.memcache.%s",
+            c->name);
+    slab_caches[slab_caches_cnt++] = c;
+end:
+    SCMutexUnlock(&slab_lock);
+    return c;
+}
+
+static SCSlabThreadCache *SlabThreadCacheGet(SCSlabCache *c)
+{
+    SCSlabThreadCache *tc = slab_thread_caches[c->id];
+    if (likely(tc != NULL))
+        return tc;
+
+    /* adopt the thread cache of a thread that is gone */
+    SCMutexLock(&slab_lock);
+    for (tc = c->thread_caches; tc != NULL; tc = tc->next) {
+        if (tc->orphaned) {
+            tc->orphaned = false;
+            break;
+        }
+    }
+    SCMutexUnlock(&slab_lock);
+
+    if (tc == NULL) {
+        tc = SCCalloc(1, sizeof(*tc));
+        if (tc == NULL)
+            return NULL;
+        SC_ATOMIC_INITPTR(tc->remote);
+        SC_ATOMIC_INIT(tc->remote_cnt);
+
+        SCMutexLock(&slab_lock);
+        tc->next = c->thread_caches;
+        c->thread_caches = tc;
+        SCMutexUnlock(&slab_lock);
+    }
+
+    slab_thread_caches[c->id] = tc;
+    return tc;
+}
+
+static void SlabObjFree(SCSlabCache *c, SCSlabObj *o)
+{
+    SC_ATOMIC_SUB(c->memuse, sizeof(SCSlabObj) + c->size);
+    SCFreeAligned(o);
+}
+
+/** \brief move the objects returned by other threads to the free list */
+static void SlabThreadCacheReclaim(SCSlabCache *c, SCSlabThreadCache *tc)
+{
+    SCSlabObj *head;
+    do {
+        head = SC_ATOMIC_GET(tc->remote);
+    } while (head != NULL && !SC_ATOMIC_CAS(&tc->remote, head, NULL));
+
+    int64_t cnt = 0;
+    while (head != NULL) {
+        SCSlabObj *next = head->next;
+        cnt++;
+        if (tc->free_cnt < SLAB_FREE_MAX) {
+            head->next = tc->free;
+            tc->free = head;
+            tc->free_cnt++;
+        } else {
+            SlabObjFree(c, head);
+        }
+        head = next;
+    }
+    SC_ATOMIC_SUB(tc->remote_cnt, cnt);
+}
+
+/**
+ *  \brief get a zeroed object from the cache
+ *
+ *  \retval ptr object, aligned to SC_SLAB_ALIGN, or NULL on error
+ */
+void *SCSlabAlloc(SCSlabCache *c)
+{
+    SCSlabThreadCache *tc = SlabThreadCacheGet(c);
+    if (unlikely(tc == NULL))
+        return NULL;
+
+    if (tc->free == NULL)
+        SlabThreadCacheReclaim(c, tc);
+
+    SCSlabObj *o = tc->free;
+    if (o != NULL) {
+        tc->free = o->next;
+        tc->free_cnt--;
+    } else {
+        o = SCMallocAligned(sizeof(SCSlabObj) + c->size, SC_SLAB_ALIGN);
+        if (unlikely(o == NULL))
+            return NULL;
+        o->owner = tc;
+        SC_ATOMIC_ADD(c->memuse, sizeof(SCSlabObj) + c->size);
+    }
+    o->next = NULL;
+
+    void *ptr = (uint8_t *)o + sizeof(SCSlabObj);
+    memset(ptr, 0, c->size);
+    return ptr;
+}
+
+/**
+ *  \brief return an object to the cache
+ *
+ *  Can be called from any thread.
+ */
+void SCSlabFree(SCSlabCache *c, void *ptr)
+{
+    if (ptr == NULL)
+        return;
+
+    SCSlabObj *o = (SCSlabObj *)((uint8_t *)ptr - sizeof(SCSlabObj));
+    SCSlabThreadCache *tc = o->owner;
+    if (tc == slab_thread_caches[c->id]) {
+        if (tc->free_cnt < SLAB_FREE_MAX) {
+            o->next = tc->free;
+            tc->free = o;
+            tc->free_cnt++;
+        } else {
+            SlabObjFree(c, o);
+        }
+        return;
+    }
+
+    SCSlabObj *head;
+    do {
+        head = SC_ATOMIC_GET(tc->remote);
+        o->next = head;
+    } while (!SC_ATOMIC_CAS(&tc->remote, head, o));
+    SC_ATOMIC_ADD(tc->remote_cnt, 1);
+}
+
+/** \brief bytes of the free objects kept in the thread caches
+ *
+ *  The free list counts are read without synchronization, so the result
+ *  is approximate while other threads use the cache.
+ */
+uint64_t SCSlabMemcache(SCSlabCache *c)
+{
+    int64_t cnt = 0;
+    SCMutexLock(&slab_lock);
+    for (SCSlabThreadCache *tc = c->thread_caches; tc != NULL; tc = tc->next) {
+        cnt += (int64_t)tc->free_cnt + SC_ATOMIC_GET(tc->remote_cnt);
+    }
+    SCMutexUnlock(&slab_lock);
+    if (cnt <= 0)
+        return 0;
+    return MIN((uint64_t)cnt * (sizeof(SCSlabObj) + c->size), SC_ATOMIC_GET(c->memuse));
+}
+
+/** \brief bytes of the objects in use, not counting the cached free objects */
+uint64_t SCSlabMemuse(SCSlabCache *c)
+{
+    return SC_ATOMIC_GET(c->memuse) - SCSlabMemcache(c);
+}
+
+static uint64_t SlabMemuseCounter(void *data)
+{
+    return SCSlabMemuse((SCSlabCache *)data);
+}
+
+static uint64_t SlabMemcacheCounter(void *data)
+{
+    return SCSlabMemcache((SCSlabCache *)data);
+}
+
+/** \brief register the 'app_layer.memuse.<name>' and
+ *         'app_layer.memcache.<name>' counters */
+void SCSlabRegisterCounters(void)
+{
+    SCMutexLock(&slab_lock);
+    for (uint32_t i = 0; i < slab_caches_cnt; i++) {
+        StatsRegisterGlobalCounterWithData(
+                slab_caches[i]->counter_name, SlabMemuseCounter, slab_caches[i]);
+        StatsRegisterGlobalCounterWithData(
+                slab_caches[i]->cached_counter_name, SlabMemcacheCounter, slab_caches[i]);
+    }
+    SCMutexUnlock(&slab_lock);
+}
+
+static void SlabObjListFree(SCSlabCache *c, SCSlabObj *o)
+{
+    while (o != NULL) {
+        SCSlabObj *next = o->next;
+        SlabObjFree(c, o);
+        o = next;
+    }
+}
+
+/**
+ *  \brief release the thread caches of the calling thread
+ *
+ *  Frees the cached objects and leaves the thread caches to be adopted by
+ *  another thread. To be called by a thread that is done using the caches.
+ */
+void SCSlabThreadCleanup(void)
+{
+    SCMutexLock(&slab_lock);
+    const uint32_t cnt = slab_caches_cnt;
+    SCMutexUnlock(&slab_lock);
+
+    for (uint32_t i = 0; i < cnt; i++) {
+        SCSlabThreadCache *tc = slab_thread_caches[i];
+        if (tc == NULL)
+            continue;
+        SCSlabCache *c = slab_caches[i];
+
+        SlabThreadCacheReclaim(c, tc);
+        SlabObjListFree(c, tc->free);
+        tc->free = NULL;
+        tc->free_cnt = 0;
+        slab_thread_caches[i] = NULL;
+
+        SCMutexLock(&slab_lock);
+        tc->orphaned = true;
+        SCMutexUnlock(&slab_lock);
+    }
+}
+
+/**
+ *  \brief free the caches and all cached objects
+ *
+ *  To be called after all app-layer states are freed. A cache that still
+ *  has objects in use is not freed, as those objects point to its thread
+ *  caches: it is leaked instead.
+ */
+void SCSlabShutdown(void)
+{
+    SCMutexLock(&slab_lock);
+    for (uint32_t i = 0; i < slab_caches_cnt; i++) {
+        SCSlabCache *c = slab_caches[i];
+        for (SCSlabThreadCache *tc = c->thread_caches; tc != NULL; tc = tc->next) {
+            SlabObjListFree(c, tc->free);
+            tc->free = NULL;
+            tc->free_cnt = 0;
+            SCSlabObj *remote = SC_ATOMIC_GET(tc->remote);
+            SC_ATOMIC_SET(tc->remote, NULL);
+            SC_ATOMIC_SET(tc->remote_cnt, 0);
+            SlabObjListFree(c, remote);
+        }
+        slab_caches[i] = NULL;
+
+        /* only objects in use are left */
+        if (SC_ATOMIC_GET(c->memuse) != 0) {
+            SCLogWarning("slab cache %s: %" PRIu64 " bytes still in use at shutdown, "
+                         "not freeing it",
+                    c->name, SC_ATOMIC_GET(c->memuse));
+            DEBUG_VALIDATE_BUG_ON(1);
+            continue;
+        }
+        SCSlabThreadCache *tc = c->thread_caches;
+        while (tc != NULL) {
+            SCSlabThreadCache *next = tc->next;
+            SCFree(tc);
+            tc = next;
+        }
+        SCFree(c);
+    }
+    slab_caches_cnt = 0;
+    memset(slab_thread_caches, 0, sizeof(slab_thread_caches));
+    SCMutexUnlock(&slab_lock);
+}
+
+#ifdef UNITTESTS
+typedef struct SlabTestThread_ {
+    SCSlabCache *c;
+    void *objs[64];
+} SlabTestThread;
+
+static void *SlabTestFreeThread(void *arg)
+{
+    SlabTestThread *t = arg;
+    for (int i = 0; i < 64; i++) {
+        SCSlabFree(t->c, t->objs[i]);
+    }
+    return NULL;
+}
+
+static int SlabTest01(void)
+{
+    SCSlabCache *c = SCSlabCacheRegister("slabtest01", 40);
+    FAIL_IF_NULL(c);
+    FAIL_IF_NOT(SCSlabCacheRegister("slabtest01", 40) == c);
+    FAIL_IF_NOT(SCSlabCacheRegister("slabtest01", 48) == NULL);
+
+    uint8_t *a = SCSlabAlloc(c);
+    FAIL_IF_NULL(a);
+    FAIL_IF_NOT(((uintptr_t)a % SC_SLAB_ALIGN) == 0);
+    FAIL_IF_NOT(SCSlabMemuse(c) == sizeof(SCSlabObj) + 40);
+    FAIL_IF_NOT(SCSlabMemcache(c) == 0);
+    memset(a, 0xff, 40);
+    SCSlabFree(c, a);
+    /* cached, not in use */
+    FAIL_IF_NOT(SCSlabMemuse(c) == 0);
+    FAIL_IF_NOT(SCSlabMemcache(c) == sizeof(SCSlabObj) + 40);
+
+    /* the object is reused and zeroed */
+    uint8_t *b = SCSlabAlloc(c);
+    FAIL_IF_NOT(a == b);
+    for (int i = 0; i < 40; i++) {
+        FAIL_IF_NOT(b[i] == 0);
+    }
+    FAIL_IF_NOT(SCSlabMemuse(c) == sizeof(SCSlabObj) + 40);
+    SCSlabFree(c, b);
+    PASS;
+}
+
+/** \test objects freed by another thread return to the owner */
+static int SlabTest02(void)
+{
+    SlabTestThread t;
+    t.c = SCSlabCacheRegister("slabtest02", 100);
+    FAIL_IF_NULL(t.c);
+
+    for (int i = 0; i < 64; i++) {
+        t.objs[i] = SCSlabAlloc(t.c);
+        FAIL_IF_NULL(t.objs[i]);
+    }
+    const uint64_t memuse = SCSlabMemuse(t.c);
+    FAIL_IF_NOT(memuse == 64 * (sizeof(SCSlabObj) + 100));
+
+    pthread_t thread;
+    FAIL_IF(pthread_create(&thread, NULL, SlabTestFreeThread, &t) != 0);
+    pthread_join(thread, NULL);
+    FAIL_IF_NOT(SCSlabMemuse(t.c) == 0);
+    FAIL_IF_NOT(SCSlabMemcache(t.c) == memuse);
+
+    /* all on the return stack of this thread: no new allocations */
+    for (int i = 0; i < 64; i++) {
+        void *ptr = SCSlabAlloc(t.c);
+        FAIL_IF_NULL(ptr);
+        t.objs[i] = ptr;
+    }
+    FAIL_IF_NOT(SCSlabMemuse(t.c) == memuse);
+
+    for (int i = 0; i < 64; i++) {
+        SCSlabFree(t.c, t.objs[i]);
+    }
+    PASS;
+}
+
+static void *SlabTestAllocThread(void *arg)
+{
+    SlabTestThread *t = arg;
+    for (int i = 0; i < 64; i++) {
+        t->objs[i] = SCSlabAlloc(t->c);
+    }
+    /* half is freed by this thread, half by the main thread later */
+    for (int i = 0; i < 32; i++) {
+        SCSlabFree(t->c, t->objs[i]);
+        t->objs[i] = NULL;
+    }
+    SCSlabThreadCleanup();
+    return NULL;
+}
+
+/** \test the caches of an exited thread are freed and adopted */
+static int SlabTest03(void)
+{
+    SlabTestThread t;
+    memset(&t, 0, sizeof(t));
+    t.c = SCSlabCacheRegister("slabtest03", 100);
+    FAIL_IF_NULL(t.c);
+    const uint64_t size = sizeof(SCSlabObj) + 100;
+
+    pthread_t thread;
+    FAIL_IF(pthread_create(&thread, NULL, SlabTestAllocThread, &t) != 0);
+    pthread_join(thread, NULL);
+    for (int i = 0; i < 64; i++) {
+        FAIL_IF(i >= 32 && t.objs[i] == NULL);
+    }
+
+    /* the free list of the thread is gone */
+    FAIL_IF_NOT(SCSlabMemuse(t.c) == 32 * size);
+    FAIL_IF_NOT(SCSlabMemcache(t.c) == 0);
+
+    /* objects of the exited thread are returned to its orphaned cache */
+    for (int i = 32; i < 64; i++) {
+        SCSlabFree(t.c, t.objs[i]);
+    }
+    FAIL_IF_NOT(SCSlabMemuse(t.c) == 0);
+    FAIL_IF_NOT(SCSlabMemcache(t.c) == 32 * size);
+
+    /* this thread adopts the orphaned cache and reuses the objects */
+    for (int i = 0; i < 32; i++) {
+        t.objs[i] = SCSlabAlloc(t.c);
+        FAIL_IF_NULL(t.objs[i]);
+    }
+    FAIL_IF_NOT(SCSlabMemuse(t.c) == 32 * size);
+    FAIL_IF_NOT(SCSlabMemcache(t.c) == 0);
+
+    for (int i = 0; i < 32; i++) {
+        SCSlabFree(t.c, t.objs[i]);
+    }
+    SCSlabThreadCleanup();
+    FAIL_IF_NOT(SCSlabMemuse(t.c) == 0);
+    FAIL_IF_NOT(SCSlabMemcache(t.c) == 0);
+    PASS;
+}
+#endif /* UNITTESTS */
+
+void SCSlabRegisterTests(void)
+{
+#ifdef UNITTESTS
+    UtRegisterTest("SlabTest01", SlabTest01);
+    UtRegisterTest("SlabTest02", SlabTest02);
+    UtRegisterTest("SlabTest03", SlabTest03);
+#endif
+}
@@ -0,0 +1,44 @@
+/* Copyright (C) 2026 Open Information Security Foundation
+ *
+ * You can copy, redistribute or modify this Program under the terms of
+ * the GNU General Public License version 2 as published by the Free
+ * Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * version 2 along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+/**
+ * \file
+ *
+ * Per thread caches of fixed size objects, for app-layer states and
+ * transactions.
+ */
+
+#ifndef SURICATA_UTIL_SLAB_H
+#define SURICATA_UTIL_SLAB_H
+
+/** alignment of the objects returned by SCSlabAlloc() */
+#define SC_SLAB_ALIGN 16
+
+typedef struct SCSlabCache_ SCSlabCache;
+
+SCSlabCache *SCSlabCacheRegister(const char *name, uint32_t size);
+void *SCSlabAlloc(SCSlabCache *c);
+void SCSlabFree(SCSlabCache *c, void *ptr);
+uint64_t SCSlabMemuse(SCSlabCache *c);
+uint64_t SCSlabMemcache(SCSlabCache *c);
+
+void SCSlabRegisterCounters(void);
+void SCSlabThreadCleanup(void);
+void SCSlabShutdown(void);
+void SCSlabRegisterTests(void);
+
+#endif /* SURICATA_UTIL_SLAB_H */